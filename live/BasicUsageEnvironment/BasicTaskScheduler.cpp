@@ -87,7 +87,15 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
     tv_timeToDelay.tv_usec = maxDelayTime%MILLION;
   }
 
+  _EventTime selectTime;
+  if (fEventLoopStats != NULL) selectTime = TimeNow();
   int selectResult = select(fMaxNumSockets, &readSet, &writeSet, &exceptionSet, &tv_timeToDelay);
+  if (fCPUAccounting) fUnattributedCPUAccount.noteSyscalls(1);
+  _EventTime busyStartTime;
+  if (fEventLoopStats != NULL) {
+    busyStartTime = TimeNow();
+    fEventLoopStats->noteWaitTime(EventLoopStats::usecsBetween(selectTime, busyStartTime));
+  }
   if (selectResult < 0) {
 #if defined(__WIN32__) || defined(_WIN32)
     int err = WSAGetLastError();
@@ -150,7 +158,7 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
       fLastHandledSocketNum = sock;
           // Note: we set "fLastHandledSocketNum" before calling the handler,
           // in case the handler calls "doEventLoop()" reentrantly.
-      (*handler->handlerProc)(handler->clientData, resultConditionSet);
+      runSocketHandler(handler, resultConditionSet);
       break;
     }
   }
@@ -168,7 +176,7 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
 	fLastHandledSocketNum = sock;
 	    // Note: we set "fLastHandledSocketNum" before calling the handler,
             // in case the handler calls "doEventLoop()" reentrantly.
-	(*handler->handlerProc)(handler->clientData, resultConditionSet);
+	runSocketHandler(handler, resultConditionSet);
 	break;
       }
     }
@@ -182,7 +190,8 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
       // Common-case optimization for a single event trigger:
       fTriggersAwaitingHandling &=~ fLastUsedTriggerMask;
       if (fTriggeredEventHandlers[fLastUsedTriggerNum] != NULL) {
-	(*fTriggeredEventHandlers[fLastUsedTriggerNum])(fTriggeredEventClientDatas[fLastUsedTriggerNum]);
+	runTask(EventLoopStats::EVENT_TRIGGER, fTriggeredEventHandlers[fLastUsedTriggerNum], fTriggeredEventClientDatas[fLastUsedTriggerNum],
+		fTriggeredEventCPUAccounts[fLastUsedTriggerNum]);
       }
     } else {
       // Look for an event trigger that needs handling (making sure that we make forward progress through all possible triggers):
@@ -197,7 +206,8 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
 	if ((fTriggersAwaitingHandling&mask) != 0) {
 	  fTriggersAwaitingHandling &=~ mask;
 	  if (fTriggeredEventHandlers[i] != NULL) {
-	    (*fTriggeredEventHandlers[i])(fTriggeredEventClientDatas[i]);
+	    runTask(EventLoopStats::EVENT_TRIGGER, fTriggeredEventHandlers[i], fTriggeredEventClientDatas[i],
+		    fTriggeredEventCPUAccounts[i]);
 	  }
 
 	  fLastUsedTriggerMask = mask;
@@ -210,6 +220,36 @@ void BasicTaskScheduler::SingleStep(unsigned maxDelayTime) {
 
   // Also handle any delayed event that may have come due.
   fDelayQueue.handleAlarm();
+
+  if (fEventLoopStats != NULL && busyStartTime.seconds() != 0) {
+    fEventLoopStats->noteBusyTime(EventLoopStats::usecsBetween(busyStartTime, TimeNow()));
+  }
+}
+
+void BasicTaskScheduler::runSocketHandler(HandlerDescriptor* handler, int resultConditionSet) {
+  // Make the handler's account current while it runs, so that anything that it sets up is charged to the same account:
+  CPUAccount* cpuAccount = handler->cpuAccount; // in case the handler call deletes "handler"
+  CPUAccount* prevAccount = fCurrentCPUAccount;
+  fCurrentCPUAccount = cpuAccount;
+
+  if (fEventLoopStats == NULL && !fCPUAccounting) {
+    (*handler->handlerProc)(handler->clientData, resultConditionSet);
+  } else {
+    BackgroundHandlerProc* handlerProc = handler->handlerProc; // in case the handler call deletes "handler"
+    Boolean const timed = fEventLoopStats != NULL;
+    Boolean const charged = fCPUAccounting;
+    _EventTime startTime;
+    if (timed) startTime = TimeNow();
+    u_int64_t cpuStartTime = charged ? CPUAccount::threadCPUTime() : 0;
+    (*handlerProc)(handler->clientData, resultConditionSet);
+    if (charged) chargeCPU(cpuAccount, cpuStartTime);
+    if (timed && fEventLoopStats != NULL) { // sanity check, in case the handler disabled our statistics
+      fEventLoopStats->noteHandlerTime(EventLoopStats::SOCKET_HANDLER, (void const*)handlerProc,
+				       EventLoopStats::usecsBetween(startTime, TimeNow()));
+    }
+  }
+
+  fCurrentCPUAccount = prevAccount;
 }
 
 void BasicTaskScheduler
@@ -227,7 +267,7 @@ void BasicTaskScheduler
       --fMaxNumSockets;
     }
   } else {
-    fHandlers->assignHandler(socketNum, conditionSet, handlerProc, clientData);
+    fHandlers->assignHandler(socketNum, conditionSet, handlerProc, clientData, fCurrentCPUAccount);
     if (socketNum+1 > fMaxNumSockets) {
       fMaxNumSockets = socketNum+1;
     }
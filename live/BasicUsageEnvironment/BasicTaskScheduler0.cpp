@@ -25,35 +25,44 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 class AlarmHandler: public DelayQueueEntry {
 public:
-  AlarmHandler(TaskFunc* proc, void* clientData, DelayInterval timeToDelay)
-    : DelayQueueEntry(timeToDelay), fProc(proc), fClientData(clientData) {
+  AlarmHandler(BasicTaskScheduler0& scheduler, TaskFunc* proc, void* clientData, DelayInterval timeToDelay)
+    : DelayQueueEntry(timeToDelay), fScheduler(scheduler), fProc(proc), fClientData(clientData),
+      fCPUAccount(scheduler.currentCPUAccount()) {
   }
 
 private: // redefined virtual functions
   virtual void handleTimeout() {
-    (*fProc)(fClientData);
+    if (fScheduler.eventLoopStats() != NULL) {
+      fScheduler.eventLoopStats()->noteTimerLateness(EventLoopStats::usecsBetween(dueTime(), TimeNow()));
+    }
+    fScheduler.runTask(EventLoopStats::DELAYED_TASK, fProc, fClientData, fCPUAccount);
     DelayQueueEntry::handleTimeout();
   }
 
 private:
+  BasicTaskScheduler0& fScheduler;
   TaskFunc* fProc;
   void* fClientData;
+  CPUAccount* fCPUAccount;
 };
 
 
 ////////// BasicTaskScheduler0 //////////
 
 BasicTaskScheduler0::BasicTaskScheduler0()
-  : fLastHandledSocketNum(-1), fTriggersAwaitingHandling(0), fLastUsedTriggerMask(1), fLastUsedTriggerNum(MAX_NUM_EVENT_TRIGGERS-1) {
+  : fLastHandledSocketNum(-1), fTriggersAwaitingHandling(0), fLastUsedTriggerMask(1), fLastUsedTriggerNum(MAX_NUM_EVENT_TRIGGERS-1),
+    fEventLoopStats(NULL), fCPUAccounting(False), fCurrentCPUAccount(NULL), fUnattributedCPUAccount("unattributed") {
   fHandlers = new HandlerSet;
   for (unsigned i = 0; i < MAX_NUM_EVENT_TRIGGERS; ++i) {
     fTriggeredEventHandlers[i] = NULL;
     fTriggeredEventClientDatas[i] = NULL;
+    fTriggeredEventCPUAccounts[i] = NULL;
   }
 }
 
 BasicTaskScheduler0::~BasicTaskScheduler0() {
   delete fHandlers;
+  delete fEventLoopStats;
 }
 
 TaskToken BasicTaskScheduler0::scheduleDelayedTask(int64_t microseconds,
@@ -61,7 +70,7 @@ TaskToken BasicTaskScheduler0::scheduleDelayedTask(int64_t microseconds,
 						 void* clientData) {
   if (microseconds < 0) microseconds = 0;
   DelayInterval timeToDelay((long)(microseconds/1000000), (long)(microseconds%1000000));
-  AlarmHandler* alarmHandler = new AlarmHandler(proc, clientData, timeToDelay);
+  AlarmHandler* alarmHandler = new AlarmHandler(*this, proc, clientData, timeToDelay);
   fDelayQueue.addEntry(alarmHandler);
 
   return (void*)(alarmHandler->token());
@@ -94,6 +103,7 @@ EventTriggerId BasicTaskScheduler0::createEventTrigger(TaskFunc* eventHandlerPro
       // This trigger number is free; use it:
       fTriggeredEventHandlers[i] = eventHandlerProc;
       fTriggeredEventClientDatas[i] = NULL; // sanity
+      fTriggeredEventCPUAccounts[i] = fCurrentCPUAccount;
 
       fLastUsedTriggerMask = mask;
       fLastUsedTriggerNum = i;
@@ -142,11 +152,70 @@ void BasicTaskScheduler0::triggerEvent(EventTriggerId eventTriggerId, void* clie
   fTriggersAwaitingHandling |= eventTriggerId;
 }
 
+void BasicTaskScheduler0::enableEventLoopStats(Boolean enable) {
+  if (enable) {
+    if (fEventLoopStats == NULL) fEventLoopStats = new EventLoopStats;
+  } else {
+    delete fEventLoopStats; fEventLoopStats = NULL;
+  }
+}
+
+void BasicTaskScheduler0::runTask(EventLoopStats::HandlerType type, TaskFunc* proc, void* clientData,
+				  CPUAccount* cpuAccount) {
+  // Make the task's account current while it runs, so that anything that it sets up is charged to the same account:
+  CPUAccount* prevAccount = fCurrentCPUAccount;
+  fCurrentCPUAccount = cpuAccount;
+
+  if (fEventLoopStats == NULL && !fCPUAccounting) {
+    (*proc)(clientData);
+  } else {
+    Boolean const timed = fEventLoopStats != NULL;
+    Boolean const charged = fCPUAccounting;
+    _EventTime startTime;
+    if (timed) startTime = TimeNow();
+    u_int64_t cpuStartTime = charged ? CPUAccount::threadCPUTime() : 0;
+    (*proc)(clientData);
+    if (charged) chargeCPU(cpuAccount, cpuStartTime);
+    if (timed && fEventLoopStats != NULL) { // sanity check, in case "proc" disabled our statistics
+      fEventLoopStats->noteHandlerTime(type, (void const*)proc, EventLoopStats::usecsBetween(startTime, TimeNow()));
+    }
+  }
+
+  fCurrentCPUAccount = prevAccount;
+}
+
+void BasicTaskScheduler0::enableCPUAccounting(Boolean enable) {
+  fCPUAccounting = enable;
+}
+
+CPUAccount* BasicTaskScheduler0::setCurrentCPUAccount(CPUAccount* account) {
+  CPUAccount* prevAccount = fCurrentCPUAccount;
+  fCurrentCPUAccount = account;
+  return prevAccount;
+}
+
+CPUAccount* BasicTaskScheduler0::currentCPUAccount() const {
+  return fCurrentCPUAccount;
+}
+
+void BasicTaskScheduler0::noteSyscalls(unsigned numSyscalls) {
+  if (!fCPUAccounting) return;
+
+  CPUAccount* account = fCurrentCPUAccount == NULL ? &fUnattributedCPUAccount : fCurrentCPUAccount;
+  account->noteSyscalls(numSyscalls);
+}
+
+void BasicTaskScheduler0::chargeCPU(CPUAccount* cpuAccount, u_int64_t cpuStartTime) {
+  if (cpuAccount == NULL) cpuAccount = &fUnattributedCPUAccount;
+  u_int64_t cpuEndTime = CPUAccount::threadCPUTime();
+  cpuAccount->noteHandlerCall(cpuEndTime > cpuStartTime ? cpuEndTime - cpuStartTime : 0);
+}
+
 
 ////////// HandlerSet (etc.) implementation //////////
 
 HandlerDescriptor::HandlerDescriptor(HandlerDescriptor* nextHandler)
-  : conditionSet(0), handlerProc(NULL) {
+  : conditionSet(0), handlerProc(NULL), cpuAccount(NULL) {
   // Link this descriptor into a doubly-linked list:
   if (nextHandler == this) { // initialization
     fNextHandler = fPrevHandler = this;
@@ -177,17 +246,23 @@ HandlerSet::~HandlerSet() {
 }
 
 void HandlerSet
-::assignHandler(int socketNum, int conditionSet, TaskScheduler::BackgroundHandlerProc* handlerProc, void* clientData) {
+::assignHandler(int socketNum, int conditionSet, TaskScheduler::BackgroundHandlerProc* handlerProc, void* clientData,
+		CPUAccount* cpuAccount) {
   // First, see if there's already a handler for this socket:
   HandlerDescriptor* handler = lookupHandler(socketNum);
   if (handler == NULL) { // No existing handler, so create a new descr:
     handler = new HandlerDescriptor(fHandlers.fNextHandler);
     handler->socketNum = socketNum;
+  } else if (handler->handlerProc == handlerProc && handler->clientData == clientData && handler->cpuAccount != NULL) {
+    // The same handler is just being re-armed (e.g., to add or remove SOCKET_WRITABLE) - perhaps from within some other
+    // stream's handler - so keep charging it to the account that was current when it was first set up:
+    cpuAccount = handler->cpuAccount;
   }
 
   handler->conditionSet = conditionSet;
   handler->handlerProc = handlerProc;
   handler->clientData = clientData;
+  handler->cpuAccount = cpuAccount;
 }
 
 void HandlerSet::clearHandler(int socketNum) {
@@ -19,6 +19,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "BasicUsageEnvironment.hh"
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 
 ////////// BasicUsageEnvironment //////////
 
@@ -27,7 +29,11 @@ extern "C" int initializeWinsockIfNecessary();
 #endif
 
 BasicUsageEnvironment::BasicUsageEnvironment(TaskScheduler& taskScheduler)
-: BasicUsageEnvironment0(taskScheduler) {
+: BasicUsageEnvironment0(taskScheduler),
+  fLogWriter(LogWriter::createNew(LogWriter::LOG_TO_STDERR, NULL, False)),
+  fLineLevel(LOG_LEVEL_INFO), fLineWasBegun(False), fMinLogLevel(LOG_LEVEL_INFO), fDebugCategories(0),
+  fMaxLogLinesPerSecond(LOG_DEFAULT_MAX_LINES_PER_SECOND),
+  fLogCallSites(HashTable::create(ONE_WORD_HASH_KEYS)) {
 #if defined(__WIN32__) || defined(_WIN32)
   if (!initializeWinsockIfNecessary()) {
     setResultErrMsg("Failed to initialize 'winsock': ");
@@ -37,7 +43,24 @@ BasicUsageEnvironment::BasicUsageEnvironment(TaskScheduler& taskScheduler)
 #endif
 }
 
+// The (rate limiting) state for each "ENV_LOG()" call site:
+class LogCallSiteState {
+public:
+  LogCallSiteState() : fCurrentSecond(0), fNumLinesThisSecond(0), fNumSuppressedLines(0) {}
+
+  time_t fCurrentSecond;
+  unsigned fNumLinesThisSecond;
+  unsigned fNumSuppressedLines;
+};
+
 BasicUsageEnvironment::~BasicUsageEnvironment() {
+  LogCallSiteState* state;
+  while ((state = (LogCallSiteState*)fLogCallSites->RemoveNext()) != NULL) {
+    delete state;
+  }
+  delete fLogCallSites;
+
+  delete fLogWriter;
 }
 
 BasicUsageEnvironment*
@@ -55,26 +78,104 @@ int BasicUsageEnvironment::getErrno() const {
 
 UsageEnvironment& BasicUsageEnvironment::operator<<(char const* str) {
   if (str == NULL) str = "(NULL)"; // sanity check
-  fprintf(stderr, "%s", str);
+  output(str, strlen(str));
   return *this;
 }
 
 UsageEnvironment& BasicUsageEnvironment::operator<<(int i) {
-  fprintf(stderr, "%d", i);
+  char buf[20];
+  sprintf(buf, "%d", i);
+  output(buf, strlen(buf));
   return *this;
 }
 
 UsageEnvironment& BasicUsageEnvironment::operator<<(unsigned u) {
-  fprintf(stderr, "%u", u);
+  char buf[20];
+  sprintf(buf, "%u", u);
+  output(buf, strlen(buf));
   return *this;
 }
 
 UsageEnvironment& BasicUsageEnvironment::operator<<(double d) {
-  fprintf(stderr, "%f", d);
+  char buf[400]; // large enough for any "%f" output
+  sprintf(buf, "%f", d);
+  output(buf, strlen(buf));
   return *this;
 }
 
 UsageEnvironment& BasicUsageEnvironment::operator<<(void* p) {
-  fprintf(stderr, "%p", p);
+  char buf[40];
+  sprintf(buf, "%p", p);
+  output(buf, strlen(buf));
   return *this;
 }
+
+Boolean BasicUsageEnvironment::beginLogLine(unsigned level, char const* callSite, unsigned debugCategory) {
+  if (debugCategory != 0) {
+    if ((debugCategory&fDebugCategories) == 0) return False;
+  } else if (level < fMinLogLevel) {
+    return False;
+  }
+
+  if (fMaxLogLinesPerSecond > 0 && callSite != NULL) {
+    LogCallSiteState* state = (LogCallSiteState*)fLogCallSites->Lookup(callSite);
+    if (state == NULL) {
+      state = new LogCallSiteState;
+      fLogCallSites->Add(callSite, state);
+    }
+
+    time_t const now = time(NULL);
+    if (now != state->fCurrentSecond) {
+      state->fCurrentSecond = now;
+      state->fNumLinesThisSecond = 0;
+    }
+    if (state->fNumLinesThisSecond >= fMaxLogLinesPerSecond) {
+      ++state->fNumSuppressedLines;
+      return False;
+    }
+    ++state->fNumLinesThisSecond;
+
+    if (state->fNumSuppressedLines > 0) {
+      // Report the lines that we suppressed (from this call site) since the last one that we output:
+      char buf[40];
+      sprintf(buf, "%u", state->fNumSuppressedLines);
+      fLineLevel = level; fLineWasBegun = True;
+      output("[", 1); output(buf, strlen(buf));
+      char const* suffix = " similar lines suppressed]\n";
+      output(suffix, strlen(suffix));
+      state->fNumSuppressedLines = 0;
+    }
+  }
+
+  fLineLevel = level; fLineWasBegun = True;
+  return True;
+}
+
+void BasicUsageEnvironment::setLogWriter(LogWriter* logWriter) {
+  if (logWriter == NULL) return;
+
+  if (fLogWriter != NULL) fLogWriter->flush();
+  delete fLogWriter;
+  fLogWriter = logWriter;
+}
+
+void BasicUsageEnvironment::flushLog() {
+  if (fLogWriter != NULL) fLogWriter->flush();
+}
+
+void BasicUsageEnvironment::output(char const* data, unsigned dataSize) {
+  Boolean const isSuppressed = !fLineWasBegun && LOG_LEVEL_INFO < fMinLogLevel;
+  if (isSuppressed) {
+    // Discard this output
+  } else if (fLogWriter == NULL) {
+    fwrite(data, 1, dataSize, stderr);
+  } else {
+    fLogWriter->output(fLineLevel, data, dataSize);
+  }
+
+  if (memchr(data, '\n', dataSize) != NULL) {
+    // Prepare for the next line:
+    fLineLevel = LOG_LEVEL_INFO;
+    fLineWasBegun = False;
+  }
+}
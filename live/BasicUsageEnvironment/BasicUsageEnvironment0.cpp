@@ -101,6 +101,6 @@ void BasicUsageEnvironment0::appendToResultMsg(MsgString msg) {
 }
 
 void BasicUsageEnvironment0::reportBackgroundError() {
-  fputs(getResultMsg(), stderr);
+  *this << getResultMsg(); // (using our 'console' output, so that it's ordered with our other output)
 }
 
@@ -125,6 +125,8 @@ DelayQueue::~DelayQueue() {
 
 void DelayQueue::addEntry(DelayQueueEntry* newEntry) {
   synchronize();
+  newEntry->fDueTime = fLastSyncTime;
+  newEntry->fDueTime += newEntry->fDeltaTimeRemaining;
 
   DelayQueueEntry* cur = head();
   while (newEntry->fDeltaTimeRemaining >= cur->fDeltaTimeRemaining) {
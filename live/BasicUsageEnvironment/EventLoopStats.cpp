@@ -0,0 +1,214 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Basic Usage Environment: for a simple, non-scripted, console application
+// Statistics about the event loop
+// Implementation
+
+#include "EventLoopStats.hh"
+#include <stdio.h>
+#include <string.h>
+#if defined(__linux__) && defined(__GLIBC__) && !defined(NO_DLADDR)
+#define USE_DLADDR 1
+#include <dlfcn.h>
+#include <cxxabi.h>
+#include <stdlib.h>
+#endif
+
+////////// EventLoopHandlerStats //////////
+
+class EventLoopHandlerStats {
+public:
+  EventLoopHandlerStats(EventLoopStats::HandlerType type, char const* name)
+    : fType(type), fName(strDup(name)) {
+  }
+  virtual ~EventLoopHandlerStats() { delete[] fName; }
+
+  void setName(char const* name) { delete[] fName; fName = strDup(name); }
+
+  EventLoopStats::HandlerType fType;
+  char* fName;
+  LatencyHistogram fTime;
+};
+
+
+////////// EventLoopStats //////////
+
+EventLoopStats::EventLoopStats()
+  : fHandlers(HashTable::create(ONE_WORD_HASH_KEYS)), fHandlerNames(HashTable::create(ONE_WORD_HASH_KEYS)),
+    fStartTime(TimeNow()) {
+}
+
+EventLoopStats::~EventLoopStats() {
+  EventLoopHandlerStats* handlerStats;
+  while ((handlerStats = (EventLoopHandlerStats*)fHandlers->RemoveNext()) != NULL) {
+    delete handlerStats;
+  }
+  delete fHandlers;
+
+  char* name;
+  while ((name = (char*)fHandlerNames->RemoveNext()) != NULL) {
+    delete[] name;
+  }
+  delete fHandlerNames;
+}
+
+char const* EventLoopStats::handlerTypeName(HandlerType type) {
+  switch (type) {
+    case SOCKET_HANDLER: return "socket";
+    case DELAYED_TASK: return "task";
+    default: return "trigger";
+  }
+}
+
+void EventLoopStats::noteHandlerTime(HandlerType type, void const* handlerProc, unsigned usecs) {
+  EventLoopHandlerStats* handlerStats = (EventLoopHandlerStats*)fHandlers->Lookup((char const*)handlerProc);
+  if (handlerStats == NULL) {
+    handlerStats = new EventLoopHandlerStats(type, handlerName(handlerProc));
+    fHandlers->Add((char const*)handlerProc, handlerStats);
+  }
+
+  handlerStats->fTime.record(usecs);
+}
+
+void EventLoopStats::nameHandler(void const* handlerProc, char const* name) {
+  delete[] (char*)fHandlerNames->Add((char const*)handlerProc, strDup(name));
+
+  EventLoopHandlerStats* handlerStats = (EventLoopHandlerStats*)fHandlers->Lookup((char const*)handlerProc);
+  if (handlerStats != NULL) handlerStats->setName(name);
+}
+
+void EventLoopStats::dump(UsageEnvironment& env) const {
+  env << "Event loop statistics, for the last " << (unsigned)(TimeNow() - fStartTime).seconds()
+      << " seconds (times in microseconds):\n";
+
+  char line[300];
+  sprintf(line, "  %-56s %10s %9s %8s %8s %8s %8s %8s\n", "", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+  env << line;
+
+  // Output a line for each histogram:
+  for (unsigned i = 0; ; ++i) {
+    char const* typeName;
+    char const* name;
+    LatencyHistogram const* histogram;
+    if (i == 0) {
+      typeName = "select()"; name = "wait"; histogram = &fWaitTime;
+    } else if (i == 1) {
+      typeName = "loop"; name = "busy"; histogram = &fBusyTime;
+    } else if (i == 2) {
+      typeName = "timer"; name = "lateness"; histogram = &fTimerLateness;
+    } else {
+      break;
+    }
+
+    sprintf(line, "  %-8s %-47.47s %10llu %9.1f %8u %8u %8u %8u %8u\n", typeName, name,
+	    (unsigned long long)histogram->count(), histogram->mean(),
+	    histogram->valueAtPercentile(50), histogram->valueAtPercentile(90),
+	    histogram->valueAtPercentile(99), histogram->valueAtPercentile(99.9), histogram->maxValue());
+    env << line;
+  }
+
+  Iterator iter(*this);
+  HandlerType type;
+  char const* name;
+  LatencyHistogram const* histogram;
+  while ((histogram = iter.next(type, name)) != NULL) {
+    sprintf(line, "  %-8s %-47.47s %10llu %9.1f %8u %8u %8u %8u %8u\n", handlerTypeName(type), name,
+	    (unsigned long long)histogram->count(), histogram->mean(),
+	    histogram->valueAtPercentile(50), histogram->valueAtPercentile(90),
+	    histogram->valueAtPercentile(99), histogram->valueAtPercentile(99.9), histogram->maxValue());
+    env << line;
+  }
+}
+
+void EventLoopStats::reset() {
+  fWaitTime.reset();
+  fBusyTime.reset();
+  fTimerLateness.reset();
+
+  HashTable::Iterator* iter = HashTable::Iterator::create(*fHandlers);
+  EventLoopHandlerStats* handlerStats;
+  char const* key;
+  while ((handlerStats = (EventLoopHandlerStats*)iter->next(key)) != NULL) {
+    handlerStats->fTime.reset();
+  }
+  delete iter;
+
+  fStartTime = TimeNow();
+}
+
+unsigned EventLoopStats::usecsBetween(Timeval const& startTime, Timeval const& endTime) {
+  DelayInterval const interval = endTime - startTime;
+  if (interval.seconds() >= 4000) return 0xFFFFFFFF; // (the largest value that we can record)
+
+  return interval.seconds()*1000000 + interval.useconds();
+}
+
+char const* EventLoopStats::handlerName(void const* handlerProc) {
+  char const* name = (char const*)fHandlerNames->Lookup((char const*)handlerProc);
+  if (name != NULL) return name;
+
+  static char nameBuffer[200];
+#ifdef USE_DLADDR
+  // Use the function's symbol name (if it's exported), or else its offset within its executable or library
+  // (which can be given to "addr2line"):
+  Dl_info info;
+  if (dladdr((void*)handlerProc, &info) != 0) {
+    if (info.dli_sname != NULL && info.dli_saddr == handlerProc) {
+      int status;
+      char* demangledName = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+      if (demangledName != NULL) {
+	char* parameters = strchr(demangledName, '('); // omit the parameter list
+	if (parameters != NULL) *parameters = '\0';
+	snprintf(nameBuffer, sizeof nameBuffer, "%s", demangledName);
+	free(demangledName);
+      } else {
+	snprintf(nameBuffer, sizeof nameBuffer, "%s", info.dli_sname);
+      }
+      return nameBuffer;
+    } else if (info.dli_fname != NULL) {
+      char const* fileName = strrchr(info.dli_fname, '/');
+      fileName = fileName == NULL ? info.dli_fname : fileName + 1;
+      snprintf(nameBuffer, sizeof nameBuffer, "%s+0x%lx", fileName,
+	       (unsigned long)((char const*)handlerProc - (char const*)info.dli_fbase));
+      return nameBuffer;
+    }
+  }
+#endif
+  sprintf(nameBuffer, "%p", handlerProc);
+  return nameBuffer;
+}
+
+
+////////// EventLoopStats::Iterator //////////
+
+EventLoopStats::Iterator::Iterator(EventLoopStats const& stats)
+  : fIter(HashTable::Iterator::create(*stats.fHandlers)) {
+}
+
+EventLoopStats::Iterator::~Iterator() {
+  delete fIter;
+}
+
+LatencyHistogram const* EventLoopStats::Iterator::next(HandlerType& type, char const*& name) {
+  char const* key;
+  EventLoopHandlerStats* handlerStats = (EventLoopHandlerStats*)fIter->next(key);
+  if (handlerStats == NULL) return NULL;
+
+  type = handlerStats->fType;
+  name = handlerStats->fName;
+  return &handlerStats->fTime;
+}
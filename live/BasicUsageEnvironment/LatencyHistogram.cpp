@@ -0,0 +1,98 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Basic Usage Environment: for a simple, non-scripted, console application
+// A histogram of latencies (in microseconds), in a fixed amount of memory
+// Implementation
+
+#include "LatencyHistogram.hh"
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+LatencyHistogram::~LatencyHistogram() {
+}
+
+void LatencyHistogram::record(unsigned value) {
+  ++fBuckets[bucketIndex(value)];
+  ++fCount;
+  fSum += value;
+  if (value > fMax) fMax = value;
+}
+
+void LatencyHistogram::merge(LatencyHistogram const& other) {
+  for (unsigned i = 0; i < LATENCY_HISTOGRAM_NUM_BUCKETS; ++i) fBuckets[i] += other.fBuckets[i];
+  fCount += other.fCount;
+  fSum += other.fSum;
+  if (other.fMax > fMax) fMax = other.fMax;
+}
+
+void LatencyHistogram::reset() {
+  for (unsigned i = 0; i < LATENCY_HISTOGRAM_NUM_BUCKETS; ++i) fBuckets[i] = 0;
+  fCount = 0;
+  fSum = 0.0;
+  fMax = 0;
+}
+
+unsigned LatencyHistogram::valueAtPercentile(double percentile) const {
+  if (fCount == 0) return 0;
+
+  // Find the bucket that contains the "percentile"th value:
+  if (percentile < 0.0) percentile = 0.0; else if (percentile > 100.0) percentile = 100.0;
+  u_int64_t target = (u_int64_t)(percentile*fCount/100.0 + 0.5);
+  if (target == 0) target = 1;
+
+  u_int64_t countSoFar = 0;
+  for (unsigned i = 0; i < LATENCY_HISTOGRAM_NUM_BUCKETS; ++i) {
+    countSoFar += fBuckets[i];
+    if (countSoFar >= target) {
+      unsigned result = bucketHighestValue(i);
+      return result < fMax ? result : fMax;
+    }
+  }
+
+  return fMax; // shouldn't happen
+}
+
+// Values below 2*LATENCY_HISTOGRAM_SUB_BUCKETS each have their own bucket.  Above that, each power of 2 is
+// divided into LATENCY_HISTOGRAM_SUB_BUCKETS equal-sized buckets.
+
+unsigned LatencyHistogram::bucketIndex(unsigned value) {
+  if (value < 2*LATENCY_HISTOGRAM_SUB_BUCKETS) return value;
+
+  // Find the position of the highest set bit in "value":
+  unsigned msb;
+#if defined(__GNUC__)
+  msb = 31 - __builtin_clz(value);
+#else
+  msb = LATENCY_HISTOGRAM_SUB_BUCKET_BITS+1;
+  while ((value>>msb) > 1) ++msb;
+#endif
+
+  unsigned const shift = msb - LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+  return 2*LATENCY_HISTOGRAM_SUB_BUCKETS + (shift-1)*LATENCY_HISTOGRAM_SUB_BUCKETS
+    + ((value>>shift) - LATENCY_HISTOGRAM_SUB_BUCKETS);
+}
+
+unsigned LatencyHistogram::bucketHighestValue(unsigned index) {
+  if (index < 2*LATENCY_HISTOGRAM_SUB_BUCKETS) return index;
+
+  unsigned const shift = (index - 2*LATENCY_HISTOGRAM_SUB_BUCKETS)/LATENCY_HISTOGRAM_SUB_BUCKETS + 1;
+  unsigned const subBucket = (index - 2*LATENCY_HISTOGRAM_SUB_BUCKETS)%LATENCY_HISTOGRAM_SUB_BUCKETS;
+  u_int64_t const highest = ((u_int64_t)(LATENCY_HISTOGRAM_SUB_BUCKETS + subBucket + 1)<<shift) - 1;
+  return highest > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned)highest;
+}
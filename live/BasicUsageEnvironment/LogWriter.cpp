@@ -0,0 +1,382 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Basic Usage Environment: for a simple, non-scripted, console application
+// A destination for 'console' output
+// Implementation
+
+#include "LogWriter.hh"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__WIN32__) || defined(_WIN32)
+#include <io.h>
+#define dup _dup
+#define fdopen _fdopen
+#define fileno _fileno
+#define sleepMilliseconds(ms) Sleep(ms)
+#else
+#include <unistd.h>
+#include <syslog.h>
+#define sleepMilliseconds(ms) usleep((ms)*1000)
+#ifndef NO_LOG_WRITER_THREADS
+#include <pthread.h>
+#endif
+#endif
+
+// Accesses to the ring buffer positions, which are shared between the caller's thread and our background thread:
+#if defined(__WIN32__) || defined(_WIN32)
+static unsigned loadAcquire(unsigned volatile* p) { unsigned value = *p; MemoryBarrier(); return value; }
+static void storeRelease(unsigned volatile* p, unsigned value) { MemoryBarrier(); *p = value; }
+#else
+static unsigned loadAcquire(unsigned volatile* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void storeRelease(unsigned volatile* p, unsigned value) { __atomic_store_n(p, value, __ATOMIC_RELEASE); }
+#endif
+
+////////// LogWriterThread //////////
+
+// A background thread that repeatedly drains a "LogWriter"s ring buffer:
+
+class LogWriterThread {
+public:
+  static LogWriterThread* createNew(LogWriter& writer); // returns NULL if threads aren't supported
+  ~LogWriterThread(); // stops (and waits for) the thread
+
+private:
+  LogWriterThread(LogWriter& writer);
+  void run();
+
+#if defined(__WIN32__) || defined(_WIN32)
+  static DWORD WINAPI threadMain(LPVOID instance);
+  HANDLE fThreadHandle;
+#elif !defined(NO_LOG_WRITER_THREADS)
+  static void* threadMain(void* instance);
+  pthread_t fThread;
+#endif
+
+private:
+  LogWriter& fWriter;
+  Boolean fHasStarted;
+  unsigned volatile fStopRequested;
+};
+
+#define LOG_WRITER_IDLE_SLEEP_MS 5
+
+LogWriterThread* LogWriterThread::createNew(LogWriter& writer) {
+  LogWriterThread* thread = new LogWriterThread(writer);
+#if defined(__WIN32__) || defined(_WIN32)
+  thread->fThreadHandle = CreateThread(NULL, 0, threadMain, thread, 0, NULL);
+  thread->fHasStarted = thread->fThreadHandle != NULL;
+#elif !defined(NO_LOG_WRITER_THREADS)
+  thread->fHasStarted = pthread_create(&thread->fThread, NULL, threadMain, thread) == 0;
+#endif
+  if (thread->fHasStarted) return thread;
+
+  delete thread;
+  return NULL;
+}
+
+LogWriterThread::LogWriterThread(LogWriter& writer)
+  : fWriter(writer), fHasStarted(False), fStopRequested(0) {
+}
+
+LogWriterThread::~LogWriterThread() {
+  if (!fHasStarted) return;
+
+  storeRelease(&fStopRequested, 1);
+#if defined(__WIN32__) || defined(_WIN32)
+  WaitForSingleObject(fThreadHandle, INFINITE);
+  CloseHandle(fThreadHandle);
+#elif !defined(NO_LOG_WRITER_THREADS)
+  pthread_join(fThread, NULL);
+#endif
+}
+
+#if defined(__WIN32__) || defined(_WIN32)
+DWORD WINAPI LogWriterThread::threadMain(LPVOID instance) {
+  ((LogWriterThread*)instance)->run();
+  return 0;
+}
+#elif !defined(NO_LOG_WRITER_THREADS)
+void* LogWriterThread::threadMain(void* instance) {
+  ((LogWriterThread*)instance)->run();
+  return NULL;
+}
+#endif
+
+void LogWriterThread::run() {
+  while (1) {
+    if (fWriter.drainRingBuffer()) continue;
+
+    // There was nothing to write.  Stop, if we've been asked to; otherwise wait a while before checking again:
+    if (loadAcquire(&fStopRequested)) break;
+    sleepMilliseconds(LOG_WRITER_IDLE_SLEEP_MS);
+  }
+}
+
+
+////////// LogWriter //////////
+
+// Each line in the ring buffer is preceded by a header: its size, and its level.
+// A header with size LINE_SIZE_WRAP_MARKER means: continue at the start of the ring buffer.
+#define LINE_HEADER_SIZE 8
+#define LINE_SIZE_WRAP_MARKER 0xFFFFFFFF
+#define recordSize(lineSize) (LINE_HEADER_SIZE + (((lineSize)+7)&~7))
+
+static LogWriter* allLogWriters = NULL;
+static Boolean haveRegisteredAtExitHandler = False;
+
+LogWriter* LogWriter::createNew(Destination destination, char const* fileNameOrIdent,
+				Boolean useBackgroundThread, unsigned ringBufferSize) {
+  FILE* fid = NULL;
+  char const* ident = NULL;
+
+  switch (destination) {
+    case LOG_TO_FILE: {
+      if (fileNameOrIdent == NULL || (fid = fopen(fileNameOrIdent, "a")) == NULL) return NULL;
+      break;
+    }
+    case LOG_TO_SYSLOG: {
+#if defined(__WIN32__) || defined(_WIN32)
+      destination = LOG_TO_STDERR; // there's no 'syslog', so use 'stderr' instead (i.e., fall through)
+#else
+      ident = fileNameOrIdent;
+      break;
+#endif
+    }
+    case LOG_TO_STDERR: {
+      fid = stderr;
+      if (useBackgroundThread) {
+	// Write (from the background thread) using our own (buffered) stream on "stderr", so that several lines
+	// can be output at once:
+	int fd = dup(fileno(stderr));
+	FILE* bufferedFid = fd < 0 ? NULL : fdopen(fd, "w");
+	if (bufferedFid != NULL) fid = bufferedFid;
+      }
+      break;
+    }
+  }
+
+  return new LogWriter(destination, fid, ident, useBackgroundThread, ringBufferSize);
+}
+
+LogWriter::LogWriter(Destination destination, FILE* fid, char const* ident,
+		     Boolean useBackgroundThread, unsigned ringBufferSize)
+  : fDestination(destination), fFid(fid), fIdent(strDup(ident)),
+    fLine(NULL), fLineSize(0), fLineMaxSize(0), fLineLevel(LOG_LEVEL_DEBUG),
+    fThread(NULL), fRing(NULL), fRingSize(0),
+    fWritePosition(0), fReadPosition(0), fWrittenPosition(0), fNumDroppedLines(0), fNumReportedDroppedLines(0) {
+#if !defined(__WIN32__) && !defined(_WIN32)
+  if (fDestination == LOG_TO_SYSLOG) openlog(fIdent, LOG_PID, LOG_DAEMON);
+#endif
+
+  if (useBackgroundThread) {
+    // Round "ringBufferSize" up to a power of 2:
+    fRingSize = 1024;
+    while (fRingSize < ringBufferSize) fRingSize *= 2;
+    fRing = new unsigned char[fRingSize];
+
+    fThread = LogWriterThread::createNew(*this);
+  }
+
+  // Add ourself to the list of all "LogWriter"s:
+  fNextWriter = allLogWriters;
+  allLogWriters = this;
+  if (!haveRegisteredAtExitHandler) {
+    atexit(flushAllWritersAtExit);
+    haveRegisteredAtExitHandler = True;
+  }
+}
+
+LogWriter::~LogWriter() {
+  flush();
+  delete fThread; fThread = NULL;
+
+  // Remove ourself from the list of all "LogWriter"s:
+  for (LogWriter** writerPtr = &allLogWriters; *writerPtr != NULL; writerPtr = &((*writerPtr)->fNextWriter)) {
+    if (*writerPtr == this) {
+      *writerPtr = fNextWriter;
+      break;
+    }
+  }
+
+  if (fFid != NULL && fFid != stderr) fclose(fFid);
+#if !defined(__WIN32__) && !defined(_WIN32)
+  if (fDestination == LOG_TO_SYSLOG) closelog();
+#endif
+  delete[] fRing;
+  delete[] fLine;
+  delete[] fIdent;
+}
+
+void LogWriter::output(unsigned level, char const* data, unsigned dataSize) {
+  // Find the end of the last line (if any) in "data":
+  unsigned completeSize = dataSize;
+  while (completeSize > 0 && data[completeSize-1] != '\n') --completeSize;
+
+  if (completeSize > 0) {
+    if (level > fLineLevel || fLineSize == 0) fLineLevel = level;
+    if (fLineSize == 0) {
+      // Common case: There's no earlier part of the line, so output directly from "data":
+      completeLine(fLineLevel, data, completeSize);
+    } else {
+      unsigned const lineSize = fLineSize + completeSize;
+      if (lineSize > fLineMaxSize) {
+	char* newLine = new char[lineSize];
+	memcpy(newLine, fLine, fLineSize);
+	delete[] fLine; fLine = newLine;
+	fLineMaxSize = lineSize;
+      }
+      memcpy(&fLine[fLineSize], data, completeSize);
+      fLineSize = 0; // before "completeLine()", which might call "flush()"
+      completeLine(fLineLevel, fLine, lineSize);
+    }
+    data += completeSize; dataSize -= completeSize;
+  }
+
+  // Save any remaining (incomplete line) data:
+  if (dataSize > 0) {
+    if (level > fLineLevel || fLineSize == 0) fLineLevel = level;
+    if (fLineSize + dataSize > fLineMaxSize) {
+      unsigned newMaxSize = 2*(fLineSize + dataSize);
+      if (newMaxSize < 200) newMaxSize = 200;
+      char* newLine = new char[newMaxSize];
+      memcpy(newLine, fLine, fLineSize);
+      delete[] fLine; fLine = newLine;
+      fLineMaxSize = newMaxSize;
+    }
+    memcpy(&fLine[fLineSize], data, dataSize);
+    fLineSize += dataSize;
+  }
+}
+
+void LogWriter::flush() {
+  if (fLineSize > 0) {
+    unsigned const lineSize = fLineSize;
+    fLineSize = 0; // before "completeLine()", which might call us again
+    completeLine(fLineLevel, fLine, lineSize);
+  }
+
+  if (fThread != NULL) {
+    while (loadAcquire(&fWrittenPosition) != fWritePosition) sleepMilliseconds(1);
+  } else if (fFid != NULL) {
+    fflush(fFid);
+  }
+}
+
+void LogWriter::completeLine(unsigned level, char const* line, unsigned lineSize) {
+  if (fThread == NULL) {
+    writeLines(level, line, lineSize);
+    if (fFid != NULL && fFid != stderr) fflush(fFid);
+    return;
+  }
+
+  enqueueLine(level, line, lineSize);
+  if (level >= LOG_LEVEL_ERROR) flush();
+}
+
+void LogWriter::enqueueLine(unsigned level, char const* line, unsigned lineSize) {
+  // Truncate lines that are too large to ever fit in the ring buffer:
+  if (recordSize(lineSize) > fRingSize/2) lineSize = fRingSize/2 - LINE_HEADER_SIZE;
+
+  unsigned writePosition = fWritePosition;
+  unsigned const readPosition = loadAcquire(&fReadPosition);
+  unsigned offset = writePosition&(fRingSize-1);
+  unsigned const spaceBeforeEnd = fRingSize - offset; // always >= LINE_HEADER_SIZE
+  unsigned const size = recordSize(lineSize);
+  unsigned const spaceNeeded = size <= spaceBeforeEnd ? size : spaceBeforeEnd + size;
+
+  if (fRingSize - (writePosition - readPosition) < spaceNeeded) {
+    // The background thread is too far behind (e.g., blocked on a slow output), so drop this line:
+    storeRelease(&fNumDroppedLines, fNumDroppedLines + 1);
+    return;
+  }
+
+  u_int32_t header[2];
+  if (size > spaceBeforeEnd) {
+    // Skip to the start of the ring buffer:
+    header[0] = LINE_SIZE_WRAP_MARKER; header[1] = 0;
+    memcpy(&fRing[offset], header, LINE_HEADER_SIZE);
+    writePosition += spaceBeforeEnd;
+    offset = 0;
+  }
+  header[0] = lineSize; header[1] = level;
+  memcpy(&fRing[offset], header, LINE_HEADER_SIZE);
+  memcpy(&fRing[offset + LINE_HEADER_SIZE], line, lineSize);
+
+  storeRelease(&fWritePosition, writePosition + size);
+}
+
+Boolean LogWriter::drainRingBuffer() {
+  unsigned readPosition = fReadPosition;
+  unsigned const writePosition = loadAcquire(&fWritePosition);
+
+  unsigned const numDroppedLines = loadAcquire(&fNumDroppedLines);
+  if (numDroppedLines != fNumReportedDroppedLines) {
+    char buf[100];
+    sprintf(buf, "[%u log lines dropped]\n", numDroppedLines - fNumReportedDroppedLines);
+    writeLines(LOG_LEVEL_WARNING, buf, strlen(buf));
+    fNumReportedDroppedLines = numDroppedLines;
+  }
+
+  if (readPosition == writePosition) return False;
+
+  while (readPosition != writePosition) {
+    unsigned const offset = readPosition&(fRingSize-1);
+    u_int32_t header[2];
+    memcpy(header, &fRing[offset], LINE_HEADER_SIZE);
+    if (header[0] == LINE_SIZE_WRAP_MARKER) {
+      readPosition += fRingSize - offset;
+      continue;
+    }
+
+    writeLines(header[1], (char const*)&fRing[offset + LINE_HEADER_SIZE], header[0]);
+    readPosition += recordSize(header[0]);
+  }
+  storeRelease(&fReadPosition, readPosition); // the caller's thread can now reuse this space
+
+  if (fFid != NULL) fflush(fFid);
+  storeRelease(&fWrittenPosition, readPosition);
+  return True;
+}
+
+void LogWriter::writeLines(unsigned level, char const* lines, unsigned linesSize) {
+#if !defined(__WIN32__) && !defined(_WIN32)
+  if (fDestination == LOG_TO_SYSLOG) {
+    static int const priorities[] = { LOG_DEBUG, LOG_INFO, LOG_WARNING, LOG_ERR };
+    int const priority = level <= LOG_LEVEL_ERROR ? priorities[level] : LOG_ERR;
+
+    // Output each line separately (without its trailing '\n'):
+    while (linesSize > 0) {
+      unsigned lineSize = 0;
+      while (lineSize < linesSize && lines[lineSize] != '\n') ++lineSize;
+      syslog(priority, "%.*s", (int)lineSize, lines);
+
+      if (lineSize < linesSize) ++lineSize; // skip over the '\n'
+      lines += lineSize; linesSize -= lineSize;
+    }
+    return;
+  }
+#endif
+
+  fwrite(lines, 1, linesSize, fFid);
+}
+
+void LogWriter::flushAllWritersAtExit() {
+  for (LogWriter* writer = allLogWriters; writer != NULL; writer = writer->fNextWriter) {
+    writer->flush();
+  }
+}
@@ -23,6 +23,16 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _BASIC_USAGE_ENVIRONMENT0_HH
 #include "BasicUsageEnvironment0.hh"
 #endif
+#ifndef _LOG_WRITER_HH
+#include "LogWriter.hh"
+#endif
+#ifndef _HASH_TABLE_HH
+#include "HashTable.hh"
+#endif
+
+#ifndef LOG_DEFAULT_MAX_LINES_PER_SECOND
+#define LOG_DEFAULT_MAX_LINES_PER_SECOND 20
+#endif
 
 class BasicUsageEnvironment: public BasicUsageEnvironment0 {
 public:
@@ -36,11 +46,34 @@ public:
   virtual UsageEnvironment& operator<<(unsigned u);
   virtual UsageEnvironment& operator<<(double d);
   virtual UsageEnvironment& operator<<(void* p);
+  virtual Boolean beginLogLine(unsigned level, char const* callSite, unsigned debugCategory = 0);
+
+  // Control of 'console' output:
+  void setLogWriter(LogWriter* logWriter);
+      // Where our output goes.  We take ownership of "logWriter" (and delete any previous one).
+      // By default, we write each line directly to 'stderr' (without a background thread).
+  void setMinLogLevel(unsigned level) { fMinLogLevel = level; } // default: LOG_LEVEL_INFO
+      // (This also applies to output that's not given a level - i.e., that's at LOG_LEVEL_INFO.)
+  void enableDebugCategories(unsigned categories) { fDebugCategories |= categories; }
+  void setMaxLogLinesPerSecond(unsigned maxLinesPerSecond) { fMaxLogLinesPerSecond = maxLinesPerSecond; }
+      // The maximum number of lines that are output each second from each "ENV_LOG()"/"ENV_DEBUG_LOG()" call site.
+      // (Lines beyond this are counted, rather than output.)  0 means: no limit.
+  void flushLog();
 
 protected:
   BasicUsageEnvironment(TaskScheduler& taskScheduler);
       // called only by "createNew()" (or subclass constructors)
   virtual ~BasicUsageEnvironment();
+
+private:
+  void output(char const* data, unsigned dataSize);
+
+private:
+  LogWriter* fLogWriter;
+  unsigned fLineLevel; // the level of the line currently being output
+  Boolean fLineWasBegun; // whether the current line was started by "beginLogLine()" (otherwise it's at LOG_LEVEL_INFO)
+  unsigned fMinLogLevel, fDebugCategories, fMaxLogLinesPerSecond;
+  HashTable* fLogCallSites; // maps "ENV_LOG()" call sites to (rate limiting) state
 };
 
 
@@ -60,6 +93,9 @@ protected:
   static void schedulerTickTask(void* clientData);
   void schedulerTickTask();
 
+  void runSocketHandler(class HandlerDescriptor* handler, int resultConditionSet);
+      // calls the handler (timing it, if we're keeping event loop statistics)
+
 protected:
   // Redefined virtual functions:
   virtual void SingleStep(unsigned maxDelayTime);
@@ -31,6 +31,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _DELAY_QUEUE_HH
 #include "DelayQueue.hh"
 #endif
+#ifndef _EVENT_LOOP_STATS_HH
+#include "EventLoopStats.hh"
+#endif
+#ifndef _CPU_ACCOUNT_HH
+#include "CPUAccount.hh"
+#endif
 
 #define RESULT_MSG_BUFFER_MAX 1000
 
@@ -92,9 +98,33 @@ public:
   virtual void deleteEventTrigger(EventTriggerId eventTriggerId);
   virtual void triggerEvent(EventTriggerId eventTriggerId, void* clientData = NULL);
 
+  virtual CPUAccount* setCurrentCPUAccount(CPUAccount* account);
+  virtual CPUAccount* currentCPUAccount() const;
+  virtual void noteSyscalls(unsigned numSyscalls = 1);
+
+  // Instrumentation of the event loop:
+  void enableEventLoopStats(Boolean enable = True);
+      // If enabled, we time each "select()", event loop iteration, and handler call (and the lateness of each
+      // delayed task).  This costs a few "gettimeofday()" calls per event loop iteration.  (By default: disabled.)
+  EventLoopStats* eventLoopStats() const { return fEventLoopStats; } // NULL if not enabled
+
+  // CPU accounting:
+  void enableCPUAccounting(Boolean enable = True);
+      // If enabled, we measure the thread's CPU time around each handler call, and charge it to the handler's "CPUAccount"
+      // (see "CPUAccount.hh").  This costs two "clock_gettime(CLOCK_THREAD_CPUTIME_ID)" calls per handler call.
+      // (By default: disabled.)
+  Boolean cpuAccountingEnabled() const { return fCPUAccounting; }
+  CPUAccount& unattributedCPUAccount() { return fUnattributedCPUAccount; }
+      // charged for handlers that were set up while no account was current (and for our own "select()" calls)
+
 protected:
   BasicTaskScheduler0();
 
+  void runTask(EventLoopStats::HandlerType type, TaskFunc* proc, void* clientData, CPUAccount* cpuAccount);
+      // calls "proc" (timing it, if we're keeping event loop statistics), charging it to "cpuAccount"
+      // (if we're doing CPU accounting)
+  void chargeCPU(CPUAccount* cpuAccount, u_int64_t cpuStartTime);
+
 protected:
   // To implement delayed operations:
   DelayQueue fDelayQueue;
@@ -108,7 +138,17 @@ protected:
   EventTriggerId fLastUsedTriggerMask; // implemented as a 32-bit bitmap
   TaskFunc* fTriggeredEventHandlers[MAX_NUM_EVENT_TRIGGERS];
   void* fTriggeredEventClientDatas[MAX_NUM_EVENT_TRIGGERS];
+  CPUAccount* fTriggeredEventCPUAccounts[MAX_NUM_EVENT_TRIGGERS];
   unsigned fLastUsedTriggerNum; // in the range [0,MAX_NUM_EVENT_TRIGGERS)
+
+  // To implement event loop statistics:
+  friend class AlarmHandler;
+  EventLoopStats* fEventLoopStats;
+
+  // To implement CPU accounting:
+  Boolean fCPUAccounting;
+  CPUAccount* fCurrentCPUAccount;
+  CPUAccount fUnattributedCPUAccount;
 };
 
 #endif
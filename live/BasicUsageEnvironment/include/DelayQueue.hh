@@ -145,11 +145,15 @@ protected: // abstract base class
 
   virtual void handleTimeout();
 
+  _EventTime const& dueTime() const { return fDueTime; }
+      // when we were due to be handled (set when we're added to - or updated in - a "DelayQueue")
+
 private:
   friend class DelayQueue;
   DelayQueueEntry* fNext;
   DelayQueueEntry* fPrev;
   DelayInterval fDeltaTimeRemaining;
+  _EventTime fDueTime;
 
   intptr_t fToken;
   static intptr_t tokenCounter;
@@ -0,0 +1,92 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Basic Usage Environment: for a simple, non-scripted, console application
+// Statistics about the event loop: how long "select()" waited, how late timers fired, and how long each socket
+// handler, delayed task, and event trigger handler took to run
+// C++ header
+
+#ifndef _EVENT_LOOP_STATS_HH
+#define _EVENT_LOOP_STATS_HH
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+#ifndef _HASH_TABLE_HH
+#include "HashTable.hh"
+#endif
+#ifndef _DELAY_QUEUE_HH
+#include "DelayQueue.hh"
+#endif
+#ifndef _LATENCY_HISTOGRAM_HH
+#include "LatencyHistogram.hh"
+#endif
+
+class EventLoopHandlerStats; // forward
+
+class EventLoopStats {
+public:
+  EventLoopStats();
+  virtual ~EventLoopStats();
+
+  enum HandlerType { SOCKET_HANDLER, DELAYED_TASK, EVENT_TRIGGER };
+  static char const* handlerTypeName(HandlerType type); // "socket", "task" or "trigger"
+
+  // The following are called by the task scheduler (with times in microseconds):
+  void noteWaitTime(unsigned usecs) { fWaitTime.record(usecs); }
+  void noteBusyTime(unsigned usecs) { fBusyTime.record(usecs); }
+  void noteTimerLateness(unsigned usecs) { fTimerLateness.record(usecs); }
+  void noteHandlerTime(HandlerType type, void const* handlerProc, unsigned usecs);
+      // Handlers are identified by their function (not by their 'client data'), so the memory that we use is fixed
+      // by the code, rather than growing with (e.g.) the number of sockets.
+
+  void nameHandler(void const* handlerProc, char const* name);
+      // Gives a name to a handler function.  Otherwise - if possible - we use its symbol name, or else its address.
+
+  LatencyHistogram const& waitTime() const { return fWaitTime; } // in "select()"
+  LatencyHistogram const& busyTime() const { return fBusyTime; } // per event loop iteration (i.e., not waiting)
+  LatencyHistogram const& timerLateness() const { return fTimerLateness; }
+  _EventTime const& startTime() const { return fStartTime; } // when we were created (or last reset)
+
+  class Iterator {
+  public:
+    Iterator(EventLoopStats const& stats);
+    virtual ~Iterator();
+
+    LatencyHistogram const* next(HandlerType& type, char const*& name); // returns NULL if none
+
+  private:
+    HashTable::Iterator* fIter;
+  };
+
+  void dump(UsageEnvironment& env) const;
+      // Outputs a summary (count, mean, percentiles, maximum) of each of our histograms
+  void reset();
+
+  static unsigned usecsBetween(Timeval const& startTime, Timeval const& endTime);
+      // (0 if "endTime" is before "startTime")
+
+private:
+  char const* handlerName(void const* handlerProc);
+
+private:
+  LatencyHistogram fWaitTime, fBusyTime, fTimerLateness;
+  HashTable* fHandlers; // maps handler functions to "EventLoopHandlerStats"
+  HashTable* fHandlerNames; // maps handler functions to names given by "nameHandler()"
+  _EventTime fStartTime;
+};
+
+#endif
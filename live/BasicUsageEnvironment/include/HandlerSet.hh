@@ -35,6 +35,7 @@ public:
   int conditionSet;
   TaskScheduler::BackgroundHandlerProc* handlerProc;
   void* clientData;
+  class CPUAccount* cpuAccount; // the account that was current when the handler was first assigned
 
 private:
   // Descriptors are linked together in a doubly-linked list:
@@ -49,7 +50,8 @@ public:
   HandlerSet();
   virtual ~HandlerSet();
 
-  void assignHandler(int socketNum, int conditionSet, TaskScheduler::BackgroundHandlerProc* handlerProc, void* clientData);
+  void assignHandler(int socketNum, int conditionSet, TaskScheduler::BackgroundHandlerProc* handlerProc, void* clientData,
+		     class CPUAccount* cpuAccount = NULL);
   void clearHandler(int socketNum);
   void moveHandler(int oldSocketNum, int newSocketNum);
 
@@ -0,0 +1,64 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Basic Usage Environment: for a simple, non-scripted, console application
+// A histogram of latencies (in microseconds), in a fixed amount of memory.  Like a "HDR Histogram", buckets are
+// linear within each power of 2, so that every recorded value is kept to within about 6% of its actual value.
+// C++ header
+
+#ifndef _LATENCY_HISTOGRAM_HH
+#define _LATENCY_HISTOGRAM_HH
+
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 4
+#define LATENCY_HISTOGRAM_SUB_BUCKETS (1<<LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+    // (the number of buckets within each power of 2)
+#define LATENCY_HISTOGRAM_NUM_BUCKETS (2*LATENCY_HISTOGRAM_SUB_BUCKETS + (31-LATENCY_HISTOGRAM_SUB_BUCKET_BITS)*LATENCY_HISTOGRAM_SUB_BUCKETS)
+    // (enough for any 32-bit value)
+
+class LatencyHistogram {
+public:
+  LatencyHistogram();
+  virtual ~LatencyHistogram();
+
+  void record(unsigned value);
+  void merge(LatencyHistogram const& other); // adds all of "other"s values to ours
+  void reset();
+
+  u_int64_t count() const { return fCount; }
+  double sum() const { return fSum; }
+  double mean() const { return fCount == 0 ? 0.0 : fSum/fCount; }
+  unsigned maxValue() const { return fMax; }
+
+  unsigned valueAtPercentile(double percentile) const;
+      // "percentile" is in the range [0,100].  Returns the highest value that could be in the bucket containing that
+      // percentile (but no more than "maxValue()"), or 0 if no values have been recorded.
+
+private:
+  static unsigned bucketIndex(unsigned value);
+  static unsigned bucketHighestValue(unsigned index);
+
+private:
+  u_int64_t fBuckets[LATENCY_HISTOGRAM_NUM_BUCKETS];
+  u_int64_t fCount;
+  double fSum;
+  unsigned fMax;
+};
+
+#endif
@@ -0,0 +1,93 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Basic Usage Environment: for a simple, non-scripted, console application
+// A destination for 'console' output: 'stderr', a file, or 'syslog' - optionally written from a background
+// thread (that drains a lock-free ring buffer), so that the event loop never blocks on output.
+// C++ header
+
+#ifndef _LOG_WRITER_HH
+#define _LOG_WRITER_HH
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+#include <stdio.h>
+
+#ifndef LOG_WRITER_DEFAULT_RING_BUFFER_SIZE
+#define LOG_WRITER_DEFAULT_RING_BUFFER_SIZE (256*1024)
+#endif
+
+class LogWriterThread; // forward
+
+class LogWriter {
+public:
+  enum Destination { LOG_TO_STDERR, LOG_TO_FILE, LOG_TO_SYSLOG };
+
+  static LogWriter* createNew(Destination destination = LOG_TO_STDERR, char const* fileNameOrIdent = NULL,
+			      Boolean useBackgroundThread = True,
+			      unsigned ringBufferSize = LOG_WRITER_DEFAULT_RING_BUFFER_SIZE);
+      // "fileNameOrIdent" is the name of the file (for LOG_TO_FILE; the file is appended to), or the 'ident'
+      // string (for LOG_TO_SYSLOG).  Returns NULL if the file could not be opened.
+      // (If threads are not supported, then "useBackgroundThread" is ignored, and output is written directly.)
+  virtual ~LogWriter(); // writes any remaining output first
+
+  void output(unsigned level, char const* data, unsigned dataSize);
+      // Appends "data" to the current line.  Each complete line (i.e., up to a '\n') is then written - or, if we
+      // have a background thread, queued (without blocking).  If the ring buffer is full, the line is dropped instead.
+      // Lines at LOG_LEVEL_ERROR are always waited for, so that they're not lost if the process then dies.
+      // (This - like "flush()" - must not be called from more than one thread at a time.)
+  void flush();
+      // Writes the current (incomplete) line, and - if we have a background thread - waits until it has written
+      // everything queued so far.  (This is also done - for every "LogWriter" - when the process calls "exit()".)
+
+  unsigned numDroppedLines() const { return fNumDroppedLines; }
+
+private:
+  LogWriter(Destination destination, FILE* fid, char const* ident, Boolean useBackgroundThread, unsigned ringBufferSize);
+      // called only by createNew()
+
+  void completeLine(unsigned level, char const* line, unsigned lineSize);
+  void enqueueLine(unsigned level, char const* line, unsigned lineSize);
+  void writeLines(unsigned level, char const* lines, unsigned linesSize); // does the actual output
+
+  friend class LogWriterThread;
+  static void flushAllWritersAtExit();
+  Boolean drainRingBuffer(); // called (only) from our background thread; returns False if there was nothing to do
+
+private:
+  Destination fDestination;
+  FILE* fFid; // for LOG_TO_STDERR or LOG_TO_FILE
+  char* fIdent; // for LOG_TO_SYSLOG
+
+  // The current (incomplete) line:
+  char* fLine;
+  unsigned fLineSize, fLineMaxSize;
+  unsigned fLineLevel; // the highest level given to any part of the line
+
+  // The ring buffer (written by the caller's thread; read by our background thread):
+  LogWriterThread* fThread; // NULL if we're writing directly
+  unsigned char* fRing;
+  unsigned fRingSize; // a power of 2
+  unsigned volatile fWritePosition, fReadPosition, fWrittenPosition; // (free-running; not masked)
+  unsigned volatile fNumDroppedLines;
+  unsigned fNumReportedDroppedLines; // used by our background thread
+
+  // All "LogWriter"s are kept in a list, so that their output can be flushed when the process exits:
+  LogWriter* fNextWriter;
+};
+
+#endif
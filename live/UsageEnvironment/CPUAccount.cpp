@@ -0,0 +1,51 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// CPU accounts
+// Implementation
+
+#include "CPUAccount.hh"
+#include "strDup.hh"
+
+#if defined(__WIN32__) || defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+CPUAccount::CPUAccount(char const* name)
+  : fName(strDup(name == NULL ? "" : name)), fCPUNanoseconds(0), fNumHandlerCalls(0), fNumSyscalls(0) {
+}
+
+CPUAccount::~CPUAccount() {
+  delete[] fName;
+}
+
+u_int64_t CPUAccount::threadCPUTime() {
+#if defined(__WIN32__) || defined(_WIN32)
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) return 0;
+
+  // These times are in units of 100 nanoseconds:
+  u_int64_t kernel100ns = ((u_int64_t)kernelTime.dwHighDateTime<<32) | kernelTime.dwLowDateTime;
+  u_int64_t user100ns = ((u_int64_t)userTime.dwHighDateTime<<32) | userTime.dwLowDateTime;
+  return (kernel100ns + user100ns)*100;
+#else
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+  return (u_int64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+#endif
+}
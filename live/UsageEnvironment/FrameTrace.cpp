@@ -0,0 +1,206 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Per-frame tracing
+// Implementation
+
+#include "FrameTrace.hh"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__WIN32__) || defined(_WIN32)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#include <time.h>
+#define THREAD_LOCAL __thread
+#endif
+
+// Accesses to each ring buffer's write position, which is shared between its (only) writing thread, and any reader:
+#if defined(__WIN32__) || defined(_WIN32)
+static unsigned loadAcquire(unsigned volatile* p) { unsigned value = *p; MemoryBarrier(); return value; }
+static void storeRelease(unsigned volatile* p, unsigned value) { MemoryBarrier(); *p = value; }
+#else
+static unsigned loadAcquire(unsigned volatile* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void storeRelease(unsigned volatile* p, unsigned value) { __atomic_store_n(p, value, __ATOMIC_RELEASE); }
+#endif
+
+#define EVENT_PHASE_INSTANT 'i'
+#define EVENT_PHASE_COMPLETE 'X'
+
+class FrameTraceEvent {
+public:
+  u_int64_t timestamp; // nanoseconds (from "FrameTrace::now()")
+  u_int64_t frameId;
+  char const* name;
+  char const* valueName; // NULL if the event has no value
+  u_int32_t value;
+  u_int32_t duration; // nanoseconds (for 'complete' events only)
+  char phase;
+};
+
+class FrameTraceRing {
+  // The events recorded by a single thread.  Only that thread writes to it (so it needs no lock);
+  // readers detect - and ignore - any events that were overwritten while they were reading them.
+public:
+  FrameTraceRing* fNext; // in the list of all threads' rings
+  unsigned fThreadNumber;
+  char fThreadName[32];
+  unsigned volatile fNumEventsRecorded; // (the next event goes in fEvents[fNumEventsRecorded%FRAME_TRACE_RING_SIZE])
+  FrameTraceEvent fEvents[FRAME_TRACE_RING_SIZE];
+};
+
+static FrameTraceRing* volatile allRings = NULL;
+static unsigned volatile numThreads = 0;
+static THREAD_LOCAL FrameTraceRing* ourRing = NULL;
+
+static FrameTraceRing* createRing() {
+  // Note: A thread's ring is never deleted (even if the thread exits), because a reader could be using it:
+  FrameTraceRing* ring = new FrameTraceRing;
+  ring->fNumEventsRecorded = 0;
+
+  // Add the ring to the list of all threads' rings (without a lock):
+#if defined(__WIN32__) || defined(_WIN32)
+  ring->fThreadNumber = InterlockedIncrement((LONG volatile*)&numThreads);
+  do {
+    ring->fNext = allRings;
+  } while (InterlockedCompareExchangePointer((PVOID volatile*)&allRings, ring, ring->fNext) != ring->fNext);
+#else
+  ring->fThreadNumber = __atomic_add_fetch(&numThreads, 1, __ATOMIC_RELAXED);
+  ring->fNext = __atomic_load_n(&allRings, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&allRings, &ring->fNext, ring, False, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+#endif
+  sprintf(ring->fThreadName, "thread %u", ring->fThreadNumber);
+
+  return ring;
+}
+
+static void record(char phase, char const* name, u_int64_t frameId, u_int64_t timestamp, u_int32_t duration,
+		   char const* valueName, u_int32_t value) {
+  FrameTraceRing* ring = ourRing;
+  if (ring == NULL) ourRing = ring = createRing();
+
+  unsigned const index = ring->fNumEventsRecorded; // (only we change this)
+  FrameTraceEvent& event = ring->fEvents[index&(FRAME_TRACE_RING_SIZE-1)];
+  event.timestamp = timestamp;
+  event.frameId = frameId;
+  event.name = name;
+  event.valueName = valueName;
+  event.value = value;
+  event.duration = duration;
+  event.phase = phase;
+  storeRelease(&ring->fNumEventsRecorded, index + 1);
+}
+
+void FrameTrace::instant(char const* name, u_int64_t frameId, char const* valueName, u_int32_t value) {
+  record(EVENT_PHASE_INSTANT, name, frameId, now(), 0, valueName, value);
+}
+
+void FrameTrace::complete(char const* name, u_int64_t frameId, u_int64_t startTime,
+			  char const* valueName, u_int32_t value) {
+  u_int64_t const duration = now() - startTime;
+  record(EVENT_PHASE_COMPLETE, name, frameId, startTime, duration > 0xFFFFFFFF ? 0xFFFFFFFF : (u_int32_t)duration,
+	 valueName, value);
+}
+
+u_int64_t FrameTrace::now() {
+#if defined(__WIN32__) || defined(_WIN32)
+  static LARGE_INTEGER frequency = { 0 };
+  if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return (u_int64_t)(counter.QuadPart/frequency.QuadPart)*1000000000
+    + (u_int64_t)(counter.QuadPart%frequency.QuadPart)*1000000000/frequency.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u_int64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+#endif
+}
+
+void FrameTrace::setThreadName(char const* name) {
+  FrameTraceRing* ring = ourRing;
+  if (ring == NULL) ourRing = ring = createRing();
+
+  strncpy(ring->fThreadName, name, sizeof ring->fThreadName - 1);
+  ring->fThreadName[sizeof ring->fThreadName - 1] = '\0';
+}
+
+#define MAX_EVENT_JSON_SIZE 256 // (our event names and value names are short literals)
+
+char* FrameTrace::chromeTraceJSON(double lastSeconds) {
+  u_int64_t const cutoffTime = now() - (u_int64_t)(lastSeconds*1000000000);
+
+  // Take a copy of each ring's events (so that we don't hold up its thread), then output those that are still valid:
+  FrameTraceEvent* events = new FrameTraceEvent[FRAME_TRACE_RING_SIZE];
+  unsigned resultMaxSize = 100;
+  char* result = new char[resultMaxSize];
+  unsigned resultSize = sprintf(result, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  char const* separator = "\n";
+
+#if defined(__WIN32__) || defined(_WIN32)
+  FrameTraceRing* ring = allRings; MemoryBarrier();
+#else
+  FrameTraceRing* ring = __atomic_load_n(&allRings, __ATOMIC_ACQUIRE);
+#endif
+  for (; ring != NULL; ring = ring->fNext) {
+    unsigned const end = loadAcquire(&ring->fNumEventsRecorded);
+    unsigned const numEvents = end < FRAME_TRACE_RING_SIZE ? end : FRAME_TRACE_RING_SIZE;
+    for (unsigned i = end - numEvents; i != end; ++i) events[i&(FRAME_TRACE_RING_SIZE-1)] = ring->fEvents[i&(FRAME_TRACE_RING_SIZE-1)];
+
+    // Any events that the thread might have overwritten (or might be overwriting) while we copied them are invalid:
+    unsigned const newEnd = loadAcquire(&ring->fNumEventsRecorded);
+    unsigned begin = end - numEvents;
+    if (newEnd - begin >= FRAME_TRACE_RING_SIZE) begin = newEnd - FRAME_TRACE_RING_SIZE + 1;
+    if (end - begin > numEvents) continue; // (the thread overwrote all of them)
+
+    // Make sure that we have room for all of this ring's events, and its thread's name:
+    unsigned const neededSize = resultSize + (end - begin + 1)*MAX_EVENT_JSON_SIZE + 10;
+    if (neededSize > resultMaxSize) {
+      resultMaxSize = neededSize;
+      char* newResult = new char[resultMaxSize];
+      memmove(newResult, result, resultSize);
+      delete[] result; result = newResult;
+    }
+
+    resultSize += sprintf(&result[resultSize],
+			  "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			  separator, ring->fThreadNumber, ring->fThreadName);
+    separator = ",\n";
+
+    for (unsigned i = begin; i != end; ++i) {
+      FrameTraceEvent const& event = events[i&(FRAME_TRACE_RING_SIZE-1)];
+      if (event.timestamp < cutoffTime) continue;
+
+      resultSize += sprintf(&result[resultSize], "%s{\"name\":\"%.60s\",\"ph\":\"%c\",", separator, event.name, event.phase);
+      if (event.phase == EVENT_PHASE_INSTANT) {
+	resultSize += sprintf(&result[resultSize], "\"s\":\"t\",");
+      } else {
+	resultSize += sprintf(&result[resultSize], "\"dur\":%u.%03u,", event.duration/1000, event.duration%1000);
+      }
+      resultSize += sprintf(&result[resultSize], "\"ts\":%lu.%03u,\"pid\":1,\"tid\":%u,\"args\":{\"frame\":%lu",
+			    (unsigned long)(event.timestamp/1000), (unsigned)(event.timestamp%1000), ring->fThreadNumber,
+			    (unsigned long)event.frameId);
+      if (event.valueName != NULL) {
+	resultSize += sprintf(&result[resultSize], ",\"%.30s\":%u", event.valueName, event.value);
+      }
+      resultSize += sprintf(&result[resultSize], "}}");
+    }
+  }
+  delete[] events;
+
+  sprintf(&result[resultSize], "\n]}\n");
+  return result;
+}
@@ -42,6 +42,10 @@ void UsageEnvironment::internalError() {
   abort();
 }
 
+Boolean UsageEnvironment::beginLogLine(unsigned level, char const* /*callSite*/, unsigned debugCategory) {
+  return debugCategory == 0 && level >= LOG_LEVEL_INFO;
+}
+
 
 TaskScheduler::TaskScheduler() {
 }
@@ -56,6 +60,17 @@ void TaskScheduler::rescheduleDelayedTask(TaskToken& task,
   task = scheduleDelayedTask(microseconds, proc, clientData);
 }
 
+CPUAccount* TaskScheduler::setCurrentCPUAccount(CPUAccount* /*account*/) {
+  return NULL;
+}
+
+CPUAccount* TaskScheduler::currentCPUAccount() const {
+  return NULL;
+}
+
+void TaskScheduler::noteSyscalls(unsigned /*numSyscalls*/) {
+}
+
 // By default, we handle 'should not occur'-type library errors by calling abort().  Subclasses can redefine this, if desired.
 void TaskScheduler::internalError() {
   abort();
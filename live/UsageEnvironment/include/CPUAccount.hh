@@ -0,0 +1,63 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// A 'CPU account': the CPU time (and the number of system calls) that the event loop spent on behalf of
+// one stream (or any other unit of work), for attributing cost within a process that handles many streams.
+// C++ header
+
+#ifndef _CPU_ACCOUNT_HH
+#define _CPU_ACCOUNT_HH
+
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+
+// A task scheduler that supports CPU accounting (see "TaskScheduler::setCurrentCPUAccount()") charges each
+// socket handler, delayed task and event trigger to the account that was current when it was set up,
+// by measuring the thread's CPU time around each call.  (This means that work that a handler sets up
+// - e.g., a delayed task that it schedules - is charged to the same account.  A socket handler that is
+// merely re-armed - the same handler, with new conditions - keeps its original account.)
+class CPUAccount {
+public:
+  CPUAccount(char const* name);
+  virtual ~CPUAccount();
+      // Note: An account must not be deleted while a handler or task that it was current for is still set up.
+
+  char const* name() const { return fName; }
+
+  double cpuSeconds() const { return fCPUNanoseconds/1e9; }
+  u_int64_t cpuNanoseconds() const { return fCPUNanoseconds; }
+  u_int64_t numHandlerCalls() const { return fNumHandlerCalls; }
+  u_int64_t numSyscalls() const { return fNumSyscalls; }
+
+  // Called by the task scheduler:
+  void noteHandlerCall(u_int64_t cpuNanoseconds) { fCPUNanoseconds += cpuNanoseconds; ++fNumHandlerCalls; }
+  void noteSyscalls(unsigned numSyscalls) { fNumSyscalls += numSyscalls; }
+
+  static u_int64_t threadCPUTime();
+      // the CPU time (in nanoseconds) that the calling thread has used so far
+
+private:
+  char* fName;
+  u_int64_t fCPUNanoseconds;
+  u_int64_t fNumHandlerCalls;
+  u_int64_t fNumSyscalls;
+};
+
+#endif
@@ -0,0 +1,88 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Per-frame tracing: 'instant' and 'complete' (span) events, each tagged with the frame that it concerns,
+// recorded into per-thread ring buffers, and exported in the Chrome 'trace event' JSON format
+// (which can be viewed with "chrome://tracing" or "https://ui.perfetto.dev").
+// C++ header
+
+#ifndef _FRAME_TRACE_HH
+#define _FRAME_TRACE_HH
+
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+
+// Events are recorded only by code that is compiled with FRAME_TRACING defined, using the following macros.
+// (Otherwise, these macros expand to nothing, and so cost nothing.)
+// "name" and "valueName" must be string literals (only the pointers are recorded).
+#ifdef FRAME_TRACING
+#define FRAME_TRACE_INSTANT(name, frameId, valueName, value) FrameTrace::instant(name, frameId, valueName, value)
+#define FRAME_TRACE_SPAN(var, name, frameId, valueName, value) FrameTraceSpan var(name, frameId, valueName, value)
+#else
+#define FRAME_TRACE_INSTANT(name, frameId, valueName, value)
+#define FRAME_TRACE_SPAN(var, name, frameId, valueName, value)
+#endif
+
+#ifndef FRAME_TRACE_RING_SIZE
+#define FRAME_TRACE_RING_SIZE 65536 // events kept for each thread (must be a power of 2)
+#endif
+
+class FrameTrace {
+public:
+  static void instant(char const* name, u_int64_t frameId, char const* valueName = NULL, u_int32_t value = 0);
+  static void complete(char const* name, u_int64_t frameId, u_int64_t startTime,
+		       char const* valueName = NULL, u_int32_t value = 0);
+      // records a span from "startTime" (a value returned by "now()") until now
+
+  static u_int64_t now(); // a monotonic time, in nanoseconds
+
+  static u_int64_t frameIdFromPresentationTime(struct timeval const& presentationTime) {
+    // Each frame's presentation time identifies it - from its packets' arrival until its delivery - so we use it
+    // (in microseconds) as the frame's id:
+    return (u_int64_t)presentationTime.tv_sec*1000000 + presentationTime.tv_usec;
+  }
+
+  static void setThreadName(char const* name); // for the calling thread's events
+
+  static char* chromeTraceJSON(double lastSeconds);
+      // Returns (in a string that the caller must delete[]) the events - from all threads - that were recorded
+      // within the last "lastSeconds" seconds (and that are still in the ring buffers).
+      // This may be called from any thread, while other threads continue recording.
+};
+
+class FrameTraceSpan {
+  // Records a 'complete' event that spans this object's lifetime
+public:
+  FrameTraceSpan(char const* name, u_int64_t frameId, char const* valueName = NULL, u_int32_t value = 0)
+    : fName(name), fValueName(valueName), fFrameId(frameId), fValue(value), fStartTime(FrameTrace::now()) {
+  }
+  ~FrameTraceSpan() {
+    FrameTrace::complete(fName, fFrameId, fStartTime, fValueName, fValue);
+  }
+
+private:
+  char const* fName;
+  char const* fValueName;
+  u_int64_t fFrameId;
+  u_int32_t fValue;
+  u_int64_t fStartTime;
+};
+
+#endif
@@ -47,6 +47,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class TaskScheduler; // forward
+class CPUAccount; // forward
+
+// Severity levels for 'console' output.  (Output that's not explicitly given a level - i.e., most output -
+// is at level LOG_LEVEL_INFO.)
+#define LOG_LEVEL_DEBUG   0
+#define LOG_LEVEL_INFO    1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR   3
 
 // An abstract base class, subclassed for each use of the library
 
@@ -86,6 +94,14 @@ public:
   virtual UsageEnvironment& operator<<(double d) = 0;
   virtual UsageEnvironment& operator<<(void* p) = 0;
 
+  // leveled 'console' output (normally used via the "ENV_LOG()" and "ENV_DEBUG_LOG()" macros, below):
+  virtual Boolean beginLogLine(unsigned level, char const* callSite, unsigned debugCategory = 0);
+      // Returns True iff a line (at "level", from "callSite") should be output; if so, the line's subsequent
+      // output - up to and including its terminating '\n' - is given that level.
+      // If "debugCategory" is non-zero, then the line is output only if that (application-defined) category
+      // has been enabled.
+      // (The default implementation outputs lines at LOG_LEVEL_INFO or above, and no debug categories.)
+
   // a pointer to additional, optional, client-specific state
   void* liveMediaPriv;
   void* groupsockPriv;
@@ -99,6 +115,28 @@ private:
 };
 
 
+// Macros for leveled output.  Use as (e.g.)
+//     ENV_LOG(env, LOG_LEVEL_WARNING) << "Something unexpected happened: " << x << "\n";
+// If the line is not to be output, then none of its "<<" expressions are evaluated.
+// Lines below LOG_COMPILED_MIN_LEVEL are removed at compile time; e.g., compile with
+// "-DLOG_COMPILED_MIN_LEVEL=1" to remove all debug output.
+#ifndef LOG_COMPILED_MIN_LEVEL
+#define LOG_COMPILED_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+#define LOG_STRINGIFY0(x) #x
+#define LOG_STRINGIFY(x) LOG_STRINGIFY0(x)
+#define LOG_CALL_SITE __FILE__ ":" LOG_STRINGIFY(__LINE__)
+
+#define ENV_LOG_ENABLED(env, level) \
+  ((level) >= LOG_COMPILED_MIN_LEVEL && (env).beginLogLine((level), LOG_CALL_SITE))
+#define ENV_LOG(env, level) if (!ENV_LOG_ENABLED(env, level)) {} else (env)
+
+// Debug output, in an (application-defined, non-zero) category that must be enabled explicitly:
+#define ENV_DEBUG_LOG_ENABLED(env, category) \
+  (LOG_LEVEL_DEBUG >= LOG_COMPILED_MIN_LEVEL && (env).beginLogLine(LOG_LEVEL_DEBUG, LOG_CALL_SITE, (category)))
+#define ENV_DEBUG_LOG(env, category) if (!ENV_DEBUG_LOG_ENABLED(env, category)) {} else (env)
+
+
 typedef void TaskFunc(void* clientData);
 typedef void* TaskToken;
 typedef u_int32_t EventTriggerId;
@@ -163,6 +201,14 @@ public:
   }
   void turnOffBackgroundReadHandling(int socketNum) { disableBackgroundHandling(socketNum); }
 
+  // CPU accounting (see "CPUAccount.hh").  By default, these do nothing:
+  virtual CPUAccount* setCurrentCPUAccount(CPUAccount* account);
+      // Makes "account" current, so that socket handlers, delayed tasks and event triggers that are set up from now on
+      // are charged to it.  Returns the previously-current account (which the caller will usually restore afterwards).
+  virtual CPUAccount* currentCPUAccount() const;
+  virtual void noteSyscalls(unsigned numSyscalls = 1);
+      // called (e.g., by socket I/O code) to charge system calls to the current account
+
   virtual void internalError(); // used to 'handle' a 'should not occur'-type error condition within the library.
 
 protected:
@@ -31,12 +31,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 OutputSocket::OutputSocket(UsageEnvironment& env)
   : Socket(env, 0 /* let kernel choose port */),
-    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/) {
+    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/),
+    fHaveCheckedSegmentationOffload(False), fUseSegmentationOffload(False) {
 }
 
 OutputSocket::OutputSocket(UsageEnvironment& env, Port port)
   : Socket(env, port),
-    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/) {
+    fSourcePort(0), fLastSentTTL(256/*hack: a deliberately invalid value*/),
+    fHaveCheckedSegmentationOffload(False), fUseSegmentationOffload(False) {
 }
 
 OutputSocket::~OutputSocket() {
@@ -53,6 +55,50 @@ Boolean OutputSocket::write(netAddressBits address, portNumBits portNum, u_int8_
     fLastSentTTL = (unsigned)ttl;
   }
 
+  return noteSourcePort();
+}
+
+Boolean OutputSocket
+::writeToDestinations(struct sockaddr_in const* destinations, unsigned numDestinations, u_int8_t ttl,
+		      unsigned char* buffer, unsigned bufferSize) {
+  if (numDestinations == 0) return True;
+
+  if ((unsigned)ttl != fLastSentTTL) {
+    // Send to the first destination separately, to set the TTL:
+    if (!write(destinations[0].sin_addr.s_addr, destinations[0].sin_port, ttl, buffer, bufferSize)) return False;
+    ++destinations; --numDestinations;
+  }
+
+  if (!writeSocketToDestinations(env(), socketNum(), destinations, numDestinations, buffer, bufferSize)) {
+    return False;
+  }
+
+  return noteSourcePort();
+}
+
+Boolean OutputSocket
+::writePacketsToDestinations(struct sockaddr_in const* destinations, unsigned numDestinations, u_int8_t ttl,
+			     unsigned char* buffer, unsigned const* packetSizes, unsigned numPackets) {
+  if (numDestinations == 0 || numPackets == 0) return True;
+
+  if ((unsigned)ttl != fLastSentTTL) {
+    if (!setSocketTTL(env(), socketNum(), ttl)) return False;
+    fLastSentTTL = (unsigned)ttl;
+  }
+
+  if (!fHaveCheckedSegmentationOffload) {
+    fUseSegmentationOffload = socketSupportsSegmentationOffload(socketNum());
+    fHaveCheckedSegmentationOffload = True;
+  }
+  if (!writeSocketPackets(env(), socketNum(), destinations, numDestinations, buffer, packetSizes, numPackets,
+			  fUseSegmentationOffload)) {
+    return False;
+  }
+
+  return noteSourcePort();
+}
+
+Boolean OutputSocket::noteSourcePort() {
   if (sourcePortNum() == 0) {
     // Now that we've sent a packet, we can find out what the
     // kernel chose as our ephemeral source port number:
@@ -102,7 +148,9 @@ Groupsock::Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
   : OutputSocket(env, port),
     deleteIfNoMembers(False), isSlave(False),
     fDests(new destRecord(groupAddr, port, ttl, 0, NULL)),
-    fIncomingGroupEId(groupAddr, port.num(), ttl) {
+    fIncomingGroupEId(groupAddr, port.num(), ttl),
+    fDestAddresses(NULL), fDestAddressesSize(0), fNumDestAddresses(0),
+    fOutputQueue(NULL), fOutputQueuePacketSizes(NULL), fNumQueuedPackets(0), fOutputQueueSize(0) {
 
   if (!socketJoinGroup(env, socketNum(), groupAddr.s_addr)) {
     if (DebugLevel >= 1) {
@@ -129,7 +177,9 @@ Groupsock::Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
   : OutputSocket(env, port),
     deleteIfNoMembers(False), isSlave(False),
     fDests(new destRecord(groupAddr, port, 255, 0, NULL)),
-    fIncomingGroupEId(groupAddr, sourceFilterAddr, port.num()) {
+    fIncomingGroupEId(groupAddr, sourceFilterAddr, port.num()),
+    fDestAddresses(NULL), fDestAddressesSize(0), fNumDestAddresses(0),
+    fOutputQueue(NULL), fOutputQueuePacketSizes(NULL), fNumQueuedPackets(0), fOutputQueueSize(0) {
   // First try a SSM join.  If that fails, try a regular join:
   if (!socketJoinGroupSSM(env, socketNum(), groupAddr.s_addr,
 			  sourceFilterAddr.s_addr)) {
@@ -150,6 +200,8 @@ Groupsock::Groupsock(UsageEnvironment& env, struct in_addr const& groupAddr,
 }
 
 Groupsock::~Groupsock() {
+  flushOutput(env()); // so that no queued packets are lost
+
   if (isSSM()) {
     if (!socketLeaveGroupSSM(env(), socketNum(), groupAddress().s_addr,
 			     sourceFilterAddress().s_addr)) {
@@ -160,6 +212,8 @@ Groupsock::~Groupsock() {
   }
 
   delete fDests;
+  delete[] fDestAddresses;
+  delete[] fOutputQueue; delete[] fOutputQueuePacketSizes;
 
   if (DebugLevel >= 2) env() << *this << ": deleting\n";
 }
@@ -264,11 +318,19 @@ Boolean Groupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned
   do {
     // First, do the datagram send, to each destination:
     Boolean writeSuccess = True;
-    for (destRecord* dests = fDests; dests != NULL; dests = dests->fNext) {
-      if (!write(dests->fGroupEId.groupAddress().s_addr, dests->fGroupEId.portNum(), dests->fGroupEId.ttl(),
-		 buffer, bufferSize)) {
+    if (hasMultipleDestinations() && collectDestAddresses()) {
+      // The usual 'multi-unicast' case (e.g., a stream shared by several clients): Send the same packet to every
+      // destination at once, rather than making a separate system call for each:
+      if (!writeToDestinations(fDestAddresses, fNumDestAddresses, fDests->fGroupEId.ttl(), buffer, bufferSize)) {
 	writeSuccess = False;
-	break;
+      }
+    } else {
+      for (destRecord* dests = fDests; dests != NULL; dests = dests->fNext) {
+	if (!write(dests->fGroupEId.groupAddress().s_addr, dests->fGroupEId.portNum(), dests->fGroupEId.ttl(),
+		   buffer, bufferSize)) {
+	  writeSuccess = False;
+	  break;
+	}
       }
     }
     if (!writeSuccess) break;
@@ -303,6 +365,96 @@ Boolean Groupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned
   return False;
 }
 
+Boolean Groupsock::queueOutput(UsageEnvironment& env, unsigned char* buffer, unsigned bufferSize) {
+  if (fDests == NULL || !members().IsEmpty() || bufferSize > MAX_BYTES_PER_WRITE) {
+    // There's nothing to be gained by queueing this packet; just send it (after any that are already queued):
+    return flushOutput(env) && output(env, buffer, bufferSize);
+  }
+
+  if (fNumQueuedPackets == MAX_PACKETS_PER_WRITE || fOutputQueueSize + bufferSize > MAX_BYTES_PER_WRITE) {
+    if (!flushOutput(env)) return False;
+  }
+  if (fOutputQueue == NULL) {
+    fOutputQueue = new unsigned char[MAX_BYTES_PER_WRITE];
+    fOutputQueuePacketSizes = new unsigned[MAX_PACKETS_PER_WRITE];
+  }
+
+  memcpy(&fOutputQueue[fOutputQueueSize], buffer, bufferSize);
+  fOutputQueueSize += bufferSize;
+  fOutputQueuePacketSizes[fNumQueuedPackets++] = bufferSize;
+  return True;
+}
+
+Boolean Groupsock::flushOutput(UsageEnvironment& env) {
+  if (fNumQueuedPackets == 0) return True;
+  unsigned const numPackets = fNumQueuedPackets, numBytes = fOutputQueueSize;
+  fNumQueuedPackets = fOutputQueueSize = 0; // (even if the write fails)
+
+  if (fDests == NULL) return True; // our destinations were removed while the packets were queued
+
+  if (!collectDestAddresses()) {
+    // Our destinations' TTLs differ, so send each packet normally:
+    unsigned char* packet = fOutputQueue;
+    for (unsigned i = 0; i < numPackets; ++i) {
+      if (!output(env, packet, fOutputQueuePacketSizes[i])) return False;
+      packet += fOutputQueuePacketSizes[i];
+    }
+    return True;
+  }
+
+  if (!writePacketsToDestinations(fDestAddresses, fNumDestAddresses, fDests->fGroupEId.ttl(),
+				  fOutputQueue, fOutputQueuePacketSizes, numPackets)) {
+    if (DebugLevel >= 0) { // this is a fatal error
+      UsageEnvironment::MsgString msg = strDup(env.getResultMsg());
+      env.setResultMsg("Groupsock write failed: ", msg);
+      delete[] (char*)msg;
+    }
+    return False;
+  }
+
+  for (unsigned i = 0; i < numPackets; ++i) {
+    statsOutgoing.countPacket(fOutputQueuePacketSizes[i]);
+    statsGroupOutgoing.countPacket(fOutputQueuePacketSizes[i]);
+  }
+  if (DebugLevel >= 3) {
+    env << *this << ": wrote " << numPackets << " packets (" << numBytes << " bytes), ttl " << (unsigned)ttl() << "\n";
+  }
+  return True;
+}
+
+Boolean Groupsock::setMaxPacingRate(unsigned bytesPerSecond) {
+  if (!setSocketMaxPacingRate(env(), socketNum(), bytesPerSecond)) return False;
+
+  if (bytesPerSecond > 0) disableSegmentationOffload();
+  return True;
+}
+
+Boolean Groupsock::collectDestAddresses() {
+  // Copy our destinations into "fDestAddresses" (enlarging it if necessary).
+  // We can do this only if all of our destinations have the same TTL:
+  u_int8_t const ttl = fDests->fGroupEId.ttl();
+  unsigned numDests = 0;
+  destRecord* dest;
+  for (dest = fDests; dest != NULL; dest = dest->fNext) {
+    if (dest->fGroupEId.ttl() != ttl) return False;
+    ++numDests;
+  }
+
+  if (numDests > fDestAddressesSize) {
+    delete[] fDestAddresses;
+    fDestAddressesSize = 2*numDests;
+    fDestAddresses = new struct sockaddr_in[fDestAddressesSize];
+  }
+
+  fNumDestAddresses = 0;
+  for (dest = fDests; dest != NULL; dest = dest->fNext) {
+    MAKE_SOCKADDR_IN(destAddr, dest->fGroupEId.groupAddress().s_addr, dest->fGroupEId.portNum());
+    fDestAddresses[fNumDestAddresses++] = destAddr;
+  }
+
+  return True;
+}
+
 Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			      unsigned& bytesRead,
 			      struct sockaddr_in& fromAddressAndPort) {
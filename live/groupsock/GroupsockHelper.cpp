@@ -36,6 +36,20 @@ extern "C" int initializeWinsockIfNecessary();
 #define USE_SIGNALS 1
 #endif
 #include <stdio.h>
+#if defined(__linux__) && !defined(NO_SENDMMSG)
+#include <sys/socket.h>
+#define HAVE_SENDMMSG 1
+#if !defined(NO_UDP_SEGMENT)
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 // (in case our C library's headers predate Linux 4.18)
+#endif
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#define HAVE_UDP_SEGMENT 1
+#endif
+#endif
 
 // By default, use INADDR_ANY for the sending and receiving interfaces:
 netAddressBits SendingInterfaceAddr = INADDR_ANY;
@@ -213,7 +227,7 @@ Boolean makeSocketBlocking(int sock, unsigned writeTimeoutInMilliseconds) {
 }
 
 int setupStreamSocket(UsageEnvironment& env,
-                      Port port, Boolean makeNonBlocking) {
+                      Port port, Boolean makeNonBlocking, Boolean sharePort) {
   if (!initializeWinsockIfNecessary()) {
     socketErr(env, "Failed to initialize 'winsock': ");
     return -1;
@@ -235,21 +249,25 @@ int setupStreamSocket(UsageEnvironment& env,
   }
 
   // SO_REUSEPORT doesn't really make sense for TCP sockets, so we
-  // normally don't set them.  However, if you really want to do this
+  // normally don't set them (unless we're asked to share a listening port).
+  // However, if you really want to do this
   // #define REUSE_FOR_TCP
-#ifdef REUSE_FOR_TCP
 #if defined(__WIN32__) || defined(_WIN32)
   // Windoze doesn't properly handle SO_REUSEPORT
 #else
 #ifdef SO_REUSEPORT
-  if (setsockopt(newSocket, SOL_SOCKET, SO_REUSEPORT,
-		 (const char*)&reuseFlag, sizeof reuseFlag) < 0) {
+#ifdef REUSE_FOR_TCP
+  int reusePortFlag = reuseFlag || sharePort;
+#else
+  int reusePortFlag = sharePort;
+#endif
+  if (reusePortFlag && setsockopt(newSocket, SOL_SOCKET, SO_REUSEPORT,
+				  (const char*)&reusePortFlag, sizeof reusePortFlag) < 0) {
     socketErr(env, "setsockopt(SO_REUSEPORT) error: ");
     closeSocket(newSocket);
     return -1;
   }
 #endif
-#endif
 #endif
 
   // Note: Windoze requires binding, even if the port number is 0
@@ -289,6 +307,7 @@ int readSocket(UsageEnvironment& env,
   int bytesRead = recvfrom(socket, (char*)buffer, bufferSize, 0,
 			   (struct sockaddr*)&fromAddress,
 			   &addressSize);
+  env.taskScheduler().noteSyscalls();
   if (bytesRead < 0) {
     //##### HACK to work around bugs in Linux and Windows:
     int err = env.getErrno();
@@ -323,19 +342,26 @@ Boolean writeSocket(UsageEnvironment& env,
 		    u_int8_t ttlArg,
 		    unsigned char* buffer, unsigned bufferSize) {
   // Before sending, set the socket's TTL:
+  if (!setSocketTTL(env, socket, ttlArg)) return False;
+
+  return writeSocket(env, socket, address, portNum, buffer, bufferSize);
+}
+
+Boolean setSocketTTL(UsageEnvironment& env, int socket, u_int8_t ttlArg) {
 #if defined(__WIN32__) || defined(_WIN32)
 #define TTL_TYPE int
 #else
 #define TTL_TYPE u_int8_t
 #endif
   TTL_TYPE ttl = (TTL_TYPE)ttlArg;
+  env.taskScheduler().noteSyscalls();
   if (setsockopt(socket, IPPROTO_IP, IP_MULTICAST_TTL,
 		 (const char*)&ttl, sizeof ttl) < 0) {
     socketErr(env, "setsockopt(IP_MULTICAST_TTL) error: ");
     return False;
   }
 
-  return writeSocket(env, socket, address, portNum, buffer, bufferSize);
+  return True;
 }
 
 Boolean writeSocket(UsageEnvironment& env,
@@ -345,6 +371,7 @@ Boolean writeSocket(UsageEnvironment& env,
     MAKE_SOCKADDR_IN(dest, address.s_addr, portNum);
     int bytesSent = sendto(socket, (char*)buffer, bufferSize, 0,
 			   (struct sockaddr*)&dest, sizeof dest);
+    env.taskScheduler().noteSyscalls();
     if (bytesSent != (int)bufferSize) {
       char tmpBuf[100];
       sprintf(tmpBuf, "writeSocket(%d), sendTo() error: wrote %d bytes instead of %u: ", socket, bytesSent, bufferSize);
@@ -358,6 +385,213 @@ Boolean writeSocket(UsageEnvironment& env,
   return False;
 }
 
+#define MAX_DESTINATIONS_PER_SENDMMSG 64
+
+Boolean writeSocketToDestinations(UsageEnvironment& env, int socket,
+				  struct sockaddr_in const* destinations, unsigned numDestinations,
+				  unsigned char* buffer, unsigned bufferSize) {
+#ifdef HAVE_SENDMMSG
+  // Every message refers to the same packet data; only the destination address differs:
+  struct iovec iov;
+  iov.iov_base = buffer;
+  iov.iov_len = bufferSize;
+
+  struct mmsghdr messages[MAX_DESTINATIONS_PER_SENDMMSG];
+  unsigned numSent = 0;
+  while (numSent < numDestinations) {
+    unsigned numInBatch = numDestinations - numSent;
+    if (numInBatch > MAX_DESTINATIONS_PER_SENDMMSG) numInBatch = MAX_DESTINATIONS_PER_SENDMMSG;
+
+    memset(messages, 0, numInBatch*sizeof messages[0]);
+    for (unsigned i = 0; i < numInBatch; ++i) {
+      messages[i].msg_hdr.msg_name = (void*)&destinations[numSent + i];
+      messages[i].msg_hdr.msg_namelen = sizeof destinations[0];
+      messages[i].msg_hdr.msg_iov = &iov;
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int result = sendmmsg(socket, messages, numInBatch, 0);
+    env.taskScheduler().noteSyscalls();
+    if (result < 0 && errno == EINTR) continue;
+    if (result <= 0) {
+      char tmpBuf[100];
+      sprintf(tmpBuf, "writeSocketToDestinations(%d), sendmmsg() error: ", socket);
+      socketErr(env, tmpBuf);
+      return False;
+    }
+
+    for (int i = 0; i < result; ++i) {
+      if (messages[i].msg_len != bufferSize) {
+	char tmpBuf[100];
+	sprintf(tmpBuf, "writeSocketToDestinations(%d), sendmmsg() error: wrote %u bytes instead of %u: ",
+		socket, messages[i].msg_len, bufferSize);
+	socketErr(env, tmpBuf);
+	return False;
+      }
+    }
+    numSent += result; // If only some of the messages were sent, we'll retry (and get the error for) the rest
+  }
+
+  return True;
+#else
+  for (unsigned i = 0; i < numDestinations; ++i) {
+    if (!writeSocket(env, socket, destinations[i].sin_addr, destinations[i].sin_port, buffer, bufferSize)) {
+      return False;
+    }
+  }
+
+  return True;
+#endif
+}
+
+#define MAX_MESSAGES_PER_SENDMMSG 64
+
+Boolean writeSocketPackets(UsageEnvironment& env, int socket,
+			   struct sockaddr_in const* destinations, unsigned numDestinations,
+			   unsigned char* buffer, unsigned const* packetSizes, unsigned numPackets,
+			   Boolean& useSegmentationOffload) {
+#ifdef HAVE_SENDMMSG
+  // First, divide the packets into 'runs', each of which will be sent (to each destination) as one message.
+  // With segmentation offload, a run is a sequence of same-size packets (except that the last may be shorter), which
+  // the kernel splits up again - at the segment size - into separate datagrams.  Otherwise, each packet is its own run:
+  struct iovec runs[MAX_PACKETS_PER_WRITE];
+  unsigned runSegmentSize[MAX_PACKETS_PER_WRITE]; // 0 if the run is just one packet
+  unsigned runFirstPacket[MAX_PACKETS_PER_WRITE];
+  unsigned numRuns = 0;
+  unsigned char* runStart = buffer;
+  for (unsigned i = 0; i < numPackets; ) {
+    unsigned const segmentSize = packetSizes[i];
+    unsigned runSize = segmentSize;
+    unsigned j = i+1;
+    if (useSegmentationOffload) {
+      while (j < numPackets && packetSizes[j] <= segmentSize) {
+	runSize += packetSizes[j];
+	if (packetSizes[j++] < segmentSize) break; // a shorter packet ends the run
+      }
+    }
+
+    runs[numRuns].iov_base = runStart;
+    runs[numRuns].iov_len = runSize;
+    runSegmentSize[numRuns] = j-i > 1 ? segmentSize : 0;
+    runFirstPacket[numRuns] = i;
+    ++numRuns;
+    runStart += runSize;
+    i = j;
+  }
+
+  // Then send each run to each destination - as a separate message - in as few "sendmmsg()" calls as possible:
+  struct mmsghdr messages[MAX_MESSAGES_PER_SENDMMSG];
+#ifdef HAVE_UDP_SEGMENT
+  union {
+    char buf[CMSG_SPACE(sizeof (u_int16_t))];
+    struct cmsghdr align;
+  } controls[MAX_MESSAGES_PER_SENDMMSG];
+#endif
+  unsigned const numMessages = numDestinations*numRuns;
+  unsigned numSent = 0;
+  while (numSent < numMessages) {
+    unsigned numInBatch = numMessages - numSent;
+    if (numInBatch > MAX_MESSAGES_PER_SENDMMSG) numInBatch = MAX_MESSAGES_PER_SENDMMSG;
+
+    memset(messages, 0, numInBatch*sizeof messages[0]);
+    for (unsigned k = 0; k < numInBatch; ++k) {
+      unsigned const destNum = (numSent + k)/numRuns;
+      unsigned const runNum = (numSent + k)%numRuns;
+      struct msghdr& hdr = messages[k].msg_hdr;
+      hdr.msg_name = (void*)&destinations[destNum];
+      hdr.msg_namelen = sizeof destinations[0];
+      hdr.msg_iov = &runs[runNum];
+      hdr.msg_iovlen = 1;
+#ifdef HAVE_UDP_SEGMENT
+      if (runSegmentSize[runNum] > 0) {
+	hdr.msg_control = controls[k].buf;
+	hdr.msg_controllen = sizeof controls[k].buf;
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+	cmsg->cmsg_level = SOL_UDP;
+	cmsg->cmsg_type = UDP_SEGMENT;
+	cmsg->cmsg_len = CMSG_LEN(sizeof (u_int16_t));
+	*(u_int16_t*)CMSG_DATA(cmsg) = (u_int16_t)runSegmentSize[runNum];
+      }
+#endif
+    }
+
+    int result = sendmmsg(socket, messages, numInBatch, 0);
+    env.taskScheduler().noteSyscalls();
+    if (result < 0 && errno == EINTR) continue;
+    if (result < 0 && useSegmentationOffload && (errno == EIO || errno == EINVAL || errno == EMSGSIZE)) {
+      // The kernel - or the outgoing interface - can't segment our packets (e.g., because they'd need IP fragmentation,
+      // which segmentation offload doesn't do).  Send the rest of them separately:
+      useSegmentationOffload = False;
+      unsigned const destNum = numSent/numRuns;
+      unsigned const firstPacket = runFirstPacket[numSent%numRuns];
+      return writeSocketPackets(env, socket, &destinations[destNum], 1,
+				(unsigned char*)runs[numSent%numRuns].iov_base, &packetSizes[firstPacket],
+				numPackets - firstPacket, useSegmentationOffload)
+	&& writeSocketPackets(env, socket, &destinations[destNum+1], numDestinations - (destNum+1),
+			      buffer, packetSizes, numPackets, useSegmentationOffload);
+    }
+    if (result <= 0) {
+      char tmpBuf[100];
+      sprintf(tmpBuf, "writeSocketPackets(%d), sendmmsg() error: ", socket);
+      socketErr(env, tmpBuf);
+      return False;
+    }
+
+    for (int k = 0; k < result; ++k) {
+      unsigned const runSize = runs[(numSent + k)%numRuns].iov_len;
+      if (messages[k].msg_len != runSize) {
+	char tmpBuf[100];
+	sprintf(tmpBuf, "writeSocketPackets(%d), sendmmsg() error: wrote %u bytes instead of %u: ",
+		socket, messages[k].msg_len, runSize);
+	socketErr(env, tmpBuf);
+	return False;
+      }
+    }
+    numSent += result; // If only some of the messages were sent, we'll retry (and get the error for) the rest
+  }
+
+  return True;
+#else
+  for (unsigned i = 0; i < numDestinations; ++i) {
+    unsigned char* packet = buffer;
+    for (unsigned j = 0; j < numPackets; ++j) {
+      if (!writeSocket(env, socket, destinations[i].sin_addr, destinations[i].sin_port, packet, packetSizes[j])) {
+	return False;
+      }
+      packet += packetSizes[j];
+    }
+  }
+
+  return True;
+#endif
+}
+
+Boolean socketSupportsSegmentationOffload(int socket) {
+#ifdef HAVE_UDP_SEGMENT
+  int segmentSize;
+  SOCKLEN_T optlen = sizeof segmentSize;
+  return getsockopt(socket, SOL_UDP, UDP_SEGMENT, &segmentSize, &optlen) == 0; // fails before Linux 4.18
+#else
+  return False;
+#endif
+}
+
+Boolean setSocketMaxPacingRate(UsageEnvironment& env, int socket, unsigned bytesPerSecond) {
+#ifdef SO_MAX_PACING_RATE
+  unsigned rate = bytesPerSecond == 0 ? ~0U : bytesPerSecond;
+  env.taskScheduler().noteSyscalls();
+  if (setsockopt(socket, SOL_SOCKET, SO_MAX_PACING_RATE, (const char*)&rate, sizeof rate) < 0) {
+    socketErr(env, "setsockopt(SO_MAX_PACING_RATE) error: ");
+    return False;
+  }
+
+  return True;
+#else
+  env.setResultMsg("Packet pacing is not supported on this OS");
+  return False;
+#endif
+}
+
 void ignoreSigPipeOnSocket(int socketNum) {
   #ifdef USE_SIGNALS
   #ifdef SO_NOSIGPIPE
@@ -53,14 +53,27 @@ protected:
 
   portNumBits sourcePortNum() const {return fSourcePort.num();}
 
+  Boolean writeToDestinations(struct sockaddr_in const* destinations, unsigned numDestinations, u_int8_t ttl,
+			      unsigned char* buffer, unsigned bufferSize);
+      // Sends the same packet to several destinations (that share a TTL), with as few system calls as possible
+  Boolean writePacketsToDestinations(struct sockaddr_in const* destinations, unsigned numDestinations, u_int8_t ttl,
+				     unsigned char* buffer, unsigned const* packetSizes, unsigned numPackets);
+      // Sends several packets (stored one after another in "buffer") to each destination, likewise
+
+  void disableSegmentationOffload() { fUseSegmentationOffload = False; fHaveCheckedSegmentationOffload = True; }
+
 private: // redefined virtual function
   virtual Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			     unsigned& bytesRead,
 			     struct sockaddr_in& fromAddressAndPort);
 
+private:
+  Boolean noteSourcePort(); // called after each write
+
 private:
   Port fSourcePort;
   unsigned fLastSentTTL;
+  Boolean fHaveCheckedSegmentationOffload, fUseSegmentationOffload;
 };
 
 class destRecord {
@@ -131,6 +144,20 @@ public:
   virtual Boolean output(UsageEnvironment& env, unsigned char* buffer, unsigned bufferSize,
 			 DirectedNetInterface* interfaceNotToFwdBackTo = NULL);
 
+  Boolean queueOutput(UsageEnvironment& env, unsigned char* buffer, unsigned bufferSize);
+      // Like "output()", except that the packet may be held back - to be sent, along with any others queued after it, by
+      // "flushOutput()" - so that a burst of packets (e.g., the fragments of a large video frame) can be sent with as few
+      // system calls as possible.  (If the queue is full, then it is flushed first.)
+      // Note: Queued packets are written directly to our destinations, *not* via "output()", so a subclass's redefinition
+      // of "output()" doesn't see them.  (That's why "MultiFramedRTPSink"s queue packets only if asked to.)
+  Boolean flushOutput(UsageEnvironment& env);
+      // Sends any queued packets
+
+  Boolean setMaxPacingRate(unsigned bytesPerSecond);
+      // Has the OS space out our outgoing packets, so that they leave no faster than "bytesPerSecond" (0 means: no limit);
+      // see "setSocketMaxPacingRate()".  (A burst is then also sent as separate packets, rather than segmentation offload
+      // 'super-packets', which would be paced as a whole.)
+
   DirectedNetInterfaceSet& members() { return fMembers; }
 
   Boolean deleteIfNoMembers;
@@ -158,6 +185,8 @@ protected:
 private:
   void removeDestinationFrom(destRecord*& dests, unsigned sessionId);
     // used to implement (the public) "removeDestination()", and "changeDestinationParameters()"
+  Boolean collectDestAddresses();
+    // used by "output()"; returns False (and collects nothing) if our destinations' TTLs differ
   int outputToAllMembersExcept(DirectedNetInterface* exceptInterface,
 			       u_int8_t ttlToFwd,
 			       unsigned char* data, unsigned size,
@@ -168,6 +197,11 @@ protected:
 private:
   GroupEId fIncomingGroupEId;
   DirectedNetInterfaceSet fMembers;
+  struct sockaddr_in* fDestAddresses; // scratch array, used by "output()" to send to multiple destinations at once
+  unsigned fDestAddressesSize, fNumDestAddresses;
+  unsigned char* fOutputQueue; // used by "queueOutput()"; allocated when first needed
+  unsigned* fOutputQueuePacketSizes;
+  unsigned fNumQueuedPackets, fOutputQueueSize;
 };
 
 UsageEnvironment& operator<<(UsageEnvironment& s, const Groupsock& g);
@@ -27,7 +27,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 int setupDatagramSocket(UsageEnvironment& env, Port port);
 int setupStreamSocket(UsageEnvironment& env,
-		      Port port, Boolean makeNonBlocking = True);
+		      Port port, Boolean makeNonBlocking = True, Boolean sharePort = False);
+    // If "sharePort" is True, then the socket is also given the SO_REUSEPORT option (where supported), so that
+    // several processes can each listen on the same port, with the OS distributing incoming connections among them.
 
 int readSocket(UsageEnvironment& env,
 	       int socket, unsigned char* buffer, unsigned bufferSize,
@@ -43,6 +45,35 @@ Boolean writeSocket(UsageEnvironment& env,
 		    unsigned char* buffer, unsigned bufferSize);
     // An optimized version of "writeSocket" that omits the "setsockopt()" call to set the TTL.
 
+Boolean writeSocketToDestinations(UsageEnvironment& env, int socket,
+				  struct sockaddr_in const* destinations, unsigned numDestinations,
+				  unsigned char* buffer, unsigned bufferSize);
+    // Sends the same datagram to each of "destinations" (again, without setting the TTL).
+    // Where "sendmmsg()" is available, this is done using a single system call (per batch of destinations),
+    // with each message's (gather) buffer pointing at the same, shared "buffer".
+
+#define MAX_PACKETS_PER_WRITE 64
+#define MAX_BYTES_PER_WRITE 65507 // the largest possible UDP payload (IPv4)
+
+Boolean writeSocketPackets(UsageEnvironment& env, int socket,
+			   struct sockaddr_in const* destinations, unsigned numDestinations,
+			   unsigned char* buffer, unsigned const* packetSizes, unsigned numPackets,
+			   Boolean& useSegmentationOffload);
+    // Sends each of "numPackets" datagrams - stored one after another in "buffer" - to each of "destinations" (again,
+    // without setting the TTL), with as few system calls as possible.  (There must be no more than MAX_PACKETS_PER_WRITE
+    // packets, totalling no more than MAX_BYTES_PER_WRITE bytes.)
+    // If "useSegmentationOffload" is True, then each run of same-size packets is handed to the kernel as a single
+    // 'super-packet', for it (or the network interface) to split up again ("UDP_SEGMENT", Linux 4.18+).  If this turns
+    // out not to work, then the packets are sent separately instead, and "useSegmentationOffload" is set to False.
+Boolean socketSupportsSegmentationOffload(int socket);
+
+Boolean setSocketTTL(UsageEnvironment& env, int socket, u_int8_t ttl);
+    // Sets the time-to-live of the multicast packets that are sent on "socket"
+Boolean setSocketMaxPacingRate(UsageEnvironment& env, int socket, unsigned bytesPerSecond);
+    // Asks the OS to space out the packets sent on "socket" so that they leave no faster than "bytesPerSecond" (0 means:
+    // no limit).  (On Linux, the pacing is done by the "fq" queueing discipline, which must be used on the outgoing
+    // interface.)  Returns False if this isn't supported.
+
 void ignoreSigPipeOnSocket(int socketNum);
 
 unsigned getSendBufferSize(UsageEnvironment& env, int socket);
@@ -21,6 +21,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "AVIFileSink.hh"
 #include "InputFile.hh"
 #include "OutputFile.hh"
+#include "AsyncFileIO.hh"
 #include "GroupsockHelper.hh"
 
 #define fourChar(x,y,z,w) ( ((w)<<24)|((z)<<16)|((y)<<8)|(x) )/*little-endian*/
@@ -126,7 +127,7 @@ AVIFileSink::AVIFileSink(UsageEnvironment& env,
 			 unsigned bufferSize,
 			 unsigned short movieWidth, unsigned short movieHeight,
 			 unsigned movieFPS, Boolean packetLossCompensate)
-  : Medium(env), fInputSession(inputSession),
+  : Medium(env), fInputSession(inputSession), fAsyncFileIO(NULL), fWriteHasFailed(False),
     fIndexRecordsHead(NULL), fIndexRecordsTail(NULL), fNumIndexRecords(0),
     fBufferSize(bufferSize), fPacketLossCompensate(packetLossCompensate),
     fAreCurrentlyBeingPlayed(False), fNumSubsessions(0), fNumBytesWritten(0),
@@ -135,6 +136,9 @@ AVIFileSink::AVIFileSink(UsageEnvironment& env,
   fOutFid = OpenOutputFile(env, outputFileName);
   if (fOutFid == NULL) return;
 
+  // Write frame data asynchronously, if we can, so that a slow disk doesn't stall the event loop:
+  if (fOutFid != stdout && fOutFid != stderr) fAsyncFileIO = AsyncFileIO::getInstance(env);
+
   // Set up I/O state for each input subsession:
   MediaSubsessionIterator iter(fInputSession);
   MediaSubsession* subsession;
@@ -196,6 +200,11 @@ AVIFileSink::~AVIFileSink() {
   }
 
   // Finally, close our output file:
+  if (fAsyncFileIO != NULL) {
+    fAsyncFileIO->flush(fOutFid);
+    fAsyncFileIO->cancel(this);
+    fAsyncFileIO->release();
+  }
   CloseOutputFile(fOutFid);
 }
 
@@ -268,6 +277,11 @@ void AVIFileSink
 		    struct timeval presentationTime,
 		    unsigned /*durationInMicroseconds*/) {
   AVISubsessionIOState* ioState = (AVISubsessionIOState*)clientData;
+  if (ioState->fOurSink.fWriteHasFailed) {
+    // The output file can no longer be written.  Handle this the same way as if the input source had closed:
+    ioState->onSourceClosure();
+    return;
+  }
   if (numTruncatedBytes > 0) {
     ioState->envir() << "AVIFileSink::afterGettingFrame(): The input frame data was too large for our buffer.  "
 		     << numTruncatedBytes
@@ -334,6 +348,12 @@ void AVIFileSink::addIndexRecord(AVIIndexRecord* newIndexRecord) {
 void AVIFileSink::completeOutputFile() {
   if (fHaveCompletedOutputFile || fOutFid == NULL) return;
 
+  // All frame data must reach the file before we go back and update its headers:
+  if (fAsyncFileIO != NULL) {
+    int result = fAsyncFileIO->flush(fOutFid);
+    if (result < 0) noteWriteFailure(-result);
+  }
+
   // Update various AVI 'size' fields to take account of the codec data that
   // we've now written to the file:
   unsigned maxBytesPerSecond = 0;
@@ -545,7 +565,7 @@ void AVISubsessionIOState::useFrame(SubsessionBuffer& buffer) {
   } else {
     fOurSink.fNumBytesWritten += fOurSink.addWord(frameSize);
   }
-  fwrite(frameSource, 1, frameSize, fOurSink.fOutFid);
+  fOurSink.addFrameData(frameSource, frameSize);
   fOurSink.fNumBytesWritten += frameSize;
   // Pad to an even length:
   if (frameSize%2 != 0) fOurSink.fNumBytesWritten += fOurSink.addByte(0);
@@ -561,6 +581,25 @@ void AVISubsessionIOState::onSourceClosure() {
 
 ////////// AVI-specific implementation //////////
 
+void AVIFileSink::addFrameData(unsigned char const* data, unsigned dataSize) {
+  if (fAsyncFileIO == NULL || !fAsyncFileIO->appendToFile(fOutFid, data, dataSize, afterAsyncWrite, this)) {
+    if (fwrite(data, 1, dataSize, fOutFid) < dataSize) noteWriteFailure(envir().getErrno());
+  }
+}
+
+void AVIFileSink::afterAsyncWrite(void* clientData, unsigned char const* /*data*/, int result) {
+  AVIFileSink* sink = (AVIFileSink*)clientData;
+  if (result < 0) sink->noteWriteFailure(-result);
+}
+
+void AVIFileSink::noteWriteFailure(int err) {
+  if (fWriteHasFailed) return; // we've already reported it
+
+  envir() << "AVIFileSink::addFrameData(): writing to the output file failed (err " << err
+	  << "); stopping recording\n";
+  fWriteHasFailed = True; // noticed when we next get a frame
+}
+
 unsigned AVIFileSink::addWord(unsigned word) {
   // Add "word" to the file in little-endian order:
   addByte(word); addByte(word>>8);
@@ -0,0 +1,419 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// An optional asynchronous file I/O backend (using Linux "io_uring"), whose completions are
+// handled - as a readable socket - from within the event loop.
+// Implementation
+
+#include "AsyncFileIO.hh"
+#include "InputFile.hh"
+#include "Media.hh"
+#include <string.h>
+
+#if defined(__linux__) && !defined(NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifndef ASYNC_FILE_IO_RING_SIZE
+#define ASYNC_FILE_IO_RING_SIZE 64 // the maximum number of operations that we keep in flight
+#endif
+#define ASYNC_FILE_IO_MAX_FREE_REQUESTS 16
+
+////////// AsyncFileIORequest //////////
+
+class AsyncFileIORequest {
+public:
+  AsyncFileIORequest() : fNext(NULL), fPrev(NULL), fBuffer(NULL), fBufferSize(0) {}
+  ~AsyncFileIORequest() { delete[] fBuffer; }
+
+  void reset(int fd, unsigned numBytes, u_int64_t offset,
+	     AsyncFileIO::CompletionFunc* completionFunc, void* clientData) {
+    if (numBytes > fBufferSize) {
+      delete[] fBuffer;
+      fBuffer = new unsigned char[numBytes];
+      fBufferSize = numBytes;
+    }
+    fFd = fd; fNumBytes = numBytes; fOffset = offset; fIsWrite = False;
+    fCompletionFunc = completionFunc; fClientData = clientData;
+    fResult = 0;
+    fNext = fPrev = NULL;
+  }
+
+public:
+  AsyncFileIORequest* fNext;
+  AsyncFileIORequest* fPrev;
+  unsigned char* fBuffer;
+  unsigned fBufferSize;
+  int fFd;
+  unsigned fNumBytes;
+  u_int64_t fOffset;
+  AsyncFileIO::CompletionFunc* fCompletionFunc;
+  void* fClientData;
+  int fResult;
+  Boolean fIsWrite;
+#ifdef HAVE_IO_URING
+  struct iovec fIOVec;
+#endif
+};
+
+////////// AsyncFileIO //////////
+
+#ifdef HAVE_IO_URING
+static int io_uring_setup(unsigned entries, struct io_uring_params* p) {
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, void* arg, unsigned numArgs) {
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, numArgs);
+}
+#endif
+
+AsyncFileIO* AsyncFileIO::getInstance(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env);
+  AsyncFileIO* instance = (AsyncFileIO*)(ourTables->asyncFileIO);
+  if (instance == NULL) {
+#ifdef HAVE_IO_URING
+    struct io_uring_params params;
+    memset(&params, 0, sizeof params);
+    int ringFd = io_uring_setup(ASYNC_FILE_IO_RING_SIZE, &params);
+    if (ringFd < 0) {
+      // The kernel doesn't support "io_uring" (or we're not allowed to use it):
+      ourTables->reclaimIfPossible();
+      return NULL;
+    }
+
+    int eventFd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+    if (eventFd < 0 || io_uring_register(ringFd, IORING_REGISTER_EVENTFD, &eventFd, 1) < 0) {
+      if (eventFd >= 0) close(eventFd);
+      close(ringFd);
+      ourTables->reclaimIfPossible();
+      return NULL;
+    }
+
+    instance = new AsyncFileIO(env, ringFd, eventFd);
+
+    // Map the submission and completion rings, and the submission entries:
+    instance->fNumRingEntries = params.sq_entries;
+    instance->fSQRingSize = params.sq_off.array + params.sq_entries*sizeof (unsigned);
+    instance->fCQRingSize = params.cq_off.cqes + params.cq_entries*sizeof (struct io_uring_cqe);
+    if (params.features&IORING_FEAT_SINGLE_MMAP) {
+      if (instance->fCQRingSize > instance->fSQRingSize) instance->fSQRingSize = instance->fCQRingSize;
+      instance->fCQRingSize = instance->fSQRingSize;
+    }
+    instance->fSQRing = mmap(NULL, instance->fSQRingSize, PROT_READ|PROT_WRITE,
+			     MAP_SHARED|MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (instance->fSQRing == MAP_FAILED) instance->fSQRing = NULL;
+    if (params.features&IORING_FEAT_SINGLE_MMAP) {
+      instance->fCQRing = instance->fSQRing;
+    } else {
+      instance->fCQRing = mmap(NULL, instance->fCQRingSize, PROT_READ|PROT_WRITE,
+			       MAP_SHARED|MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+      if (instance->fCQRing == MAP_FAILED) instance->fCQRing = NULL;
+    }
+    instance->fSQEntriesSize = params.sq_entries*sizeof (struct io_uring_sqe);
+    instance->fSQEntries = mmap(NULL, instance->fSQEntriesSize, PROT_READ|PROT_WRITE,
+				MAP_SHARED|MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (instance->fSQEntries == MAP_FAILED) instance->fSQEntries = NULL;
+
+    if (instance->fSQRing == NULL || instance->fCQRing == NULL || instance->fSQEntries == NULL) {
+      delete instance;
+      ourTables->reclaimIfPossible();
+      return NULL;
+    }
+
+    char* sq = (char*)instance->fSQRing;
+    instance->fSQHead = (unsigned*)(sq + params.sq_off.head);
+    instance->fSQTail = (unsigned*)(sq + params.sq_off.tail);
+    instance->fSQRingMask = (unsigned*)(sq + params.sq_off.ring_mask);
+    instance->fSQArray = (unsigned*)(sq + params.sq_off.array);
+    char* cq = (char*)instance->fCQRing;
+    instance->fCQHead = (unsigned*)(cq + params.cq_off.head);
+    instance->fCQTail = (unsigned*)(cq + params.cq_off.tail);
+    instance->fCQRingMask = (unsigned*)(cq + params.cq_off.ring_mask);
+    instance->fCQEntries = cq + params.cq_off.cqes;
+
+    // Completions are signaled by the "eventfd" becoming readable:
+    env.taskScheduler().setBackgroundHandling(eventFd, SOCKET_READABLE, completionHandler, instance);
+
+    ourTables->asyncFileIO = instance;
+#else
+    ourTables->reclaimIfPossible();
+    return NULL;
+#endif
+  }
+
+  ++instance->fReferenceCount;
+  return instance;
+}
+
+void AsyncFileIO::release() {
+  if (--fReferenceCount > 0) return;
+
+  if (fIsDelivering) {
+    // We're being called (indirectly) from a completion function; delete ourself afterwards:
+    fDeletionIsPending = True;
+    return;
+  }
+
+  _Tables* ourTables = _Tables::getOurTables(fEnv);
+  ourTables->asyncFileIO = NULL;
+  ourTables->reclaimIfPossible();
+  delete this;
+}
+
+AsyncFileIO::AsyncFileIO(UsageEnvironment& env, int ringFd, int eventFd)
+  : fEnv(env), fReferenceCount(0), fRingFd(ringFd), fEventFd(eventFd), fNumOutstanding(0),
+    fIsDelivering(False), fDeletionIsPending(False),
+    fSubmittedHead(NULL), fCompletedHead(NULL), fCompletedTail(NULL), fFreeList(NULL), fFreeListSize(0),
+    fSQRing(NULL), fSQRingSize(0), fCQRing(NULL), fCQRingSize(0), fSQEntries(NULL), fSQEntriesSize(0),
+    fNumRingEntries(0), fSQHead(NULL), fSQTail(NULL), fSQRingMask(NULL), fSQArray(NULL),
+    fCQHead(NULL), fCQTail(NULL), fCQRingMask(NULL), fCQEntries(NULL) {
+}
+
+AsyncFileIO::~AsyncFileIO() {
+#ifdef HAVE_IO_URING
+  // The kernel may still be using our buffers, so wait for all outstanding operations to complete:
+  if (fSQRing != NULL && fCQRing != NULL) {
+    while (fNumOutstanding > 0) reapCompletions(1);
+  }
+
+  fEnv.taskScheduler().disableBackgroundHandling(fEventFd);
+  if (fSQEntries != NULL) munmap(fSQEntries, fSQEntriesSize);
+  if (fCQRing != NULL && fCQRing != fSQRing) munmap(fCQRing, fCQRingSize);
+  if (fSQRing != NULL) munmap(fSQRing, fSQRingSize);
+  close(fEventFd);
+  close(fRingFd);
+#endif
+
+  AsyncFileIORequest* request;
+  while ((request = fCompletedHead) != NULL) {
+    fCompletedHead = request->fNext;
+    delete request;
+  }
+  while ((request = fFreeList) != NULL) {
+    fFreeList = request->fNext;
+    delete request;
+  }
+}
+
+Boolean AsyncFileIO::readAt(int fd, unsigned numBytes, u_int64_t offset,
+			    CompletionFunc* completionFunc, void* clientData) {
+  AsyncFileIORequest* request = newRequest(fd, numBytes, offset, completionFunc, clientData);
+  return submit(request, False);
+}
+
+Boolean AsyncFileIO::writeAt(int fd, unsigned char const* data, unsigned numBytes, u_int64_t offset,
+			     CompletionFunc* completionFunc, void* clientData) {
+  AsyncFileIORequest* request = newRequest(fd, numBytes, offset, completionFunc, clientData);
+  memcpy(request->fBuffer, data, numBytes);
+  return submit(request, True);
+}
+
+Boolean AsyncFileIO::appendToFile(FILE* fid, unsigned char const* data, unsigned numBytes,
+				  CompletionFunc* completionFunc, void* clientData) {
+  if (fid == NULL) return False;
+
+  // Any data that's still buffered by "stdio" must reach the file first, so that it lands before ours:
+  if (fflush(fid) == EOF) return False;
+  int64_t offset = TellFile64(fid);
+  if (offset < 0) return False; // not a seekable file
+
+  if (!writeAt(fileno(fid), data, numBytes, (u_int64_t)offset, completionFunc, clientData)) return False;
+  return SeekFile64(fid, offset + numBytes, SEEK_SET) >= 0;
+}
+
+int AsyncFileIO::flush(int fd) {
+  for (;;) {
+    AsyncFileIORequest* request;
+    for (request = fSubmittedHead; request != NULL; request = request->fNext) {
+      if (request->fFd == fd) break;
+    }
+    if (request == NULL) break; // nothing outstanding for "fd"
+
+    reapCompletions(1);
+  }
+
+  int result = 0;
+  for (AsyncFileIORequest* request = fCompletedHead; request != NULL; request = request->fNext) {
+    if (request->fFd != fd) continue;
+
+    if (request->fCompletionFunc != NULL && request->fResult < 0 && result == 0) result = request->fResult;
+    request->fCompletionFunc = NULL;
+  }
+  return result;
+}
+
+void AsyncFileIO::cancel(void* clientData) {
+  AsyncFileIORequest* request;
+  for (request = fSubmittedHead; request != NULL; request = request->fNext) {
+    if (request->fClientData == clientData) request->fCompletionFunc = NULL;
+  }
+  for (request = fCompletedHead; request != NULL; request = request->fNext) {
+    if (request->fClientData == clientData) request->fCompletionFunc = NULL;
+  }
+}
+
+AsyncFileIORequest* AsyncFileIO::newRequest(int fd, unsigned numBytes, u_int64_t offset,
+					    CompletionFunc* completionFunc, void* clientData) {
+  AsyncFileIORequest* request = fFreeList;
+  if (request != NULL) {
+    fFreeList = request->fNext;
+    --fFreeListSize;
+  } else {
+    request = new AsyncFileIORequest;
+  }
+
+  request->reset(fd, numBytes, offset, completionFunc, clientData);
+  return request;
+}
+
+void AsyncFileIO::freeRequest(AsyncFileIORequest* request) {
+  if (fFreeListSize >= ASYNC_FILE_IO_MAX_FREE_REQUESTS) {
+    delete request;
+  } else {
+    request->fNext = fFreeList;
+    fFreeList = request;
+    ++fFreeListSize;
+  }
+}
+
+Boolean AsyncFileIO::submit(AsyncFileIORequest* request, Boolean isWrite) {
+#ifdef HAVE_IO_URING
+  // If the ring is full, then wait for an operation to complete.  (This happens only if the
+  // storage can't keep up with us, in which case we have no choice but to slow down.)
+  while (fNumOutstanding >= fNumRingEntries) reapCompletions(1);
+
+  unsigned tail = *fSQTail;
+  unsigned index = tail & *fSQRingMask;
+  struct io_uring_sqe* sqe = &((struct io_uring_sqe*)fSQEntries)[index];
+  memset(sqe, 0, sizeof *sqe);
+
+  request->fIsWrite = isWrite;
+  request->fIOVec.iov_base = request->fBuffer;
+  request->fIOVec.iov_len = request->fNumBytes;
+  sqe->opcode = isWrite ? IORING_OP_WRITEV : IORING_OP_READV;
+  sqe->fd = request->fFd;
+  sqe->addr = (unsigned long)&request->fIOVec;
+  sqe->len = 1;
+  sqe->off = request->fOffset;
+  sqe->user_data = (unsigned long)request;
+
+  fSQArray[index] = index;
+  __atomic_store_n(fSQTail, tail+1, __ATOMIC_RELEASE);
+
+  if (io_uring_enter(fRingFd, 1, 0, 0) < 0) {
+    // The submission failed; take back the entry:
+    __atomic_store_n(fSQTail, tail, __ATOMIC_RELEASE);
+    fEnv.setResultErrMsg("io_uring_enter() failed: ");
+    freeRequest(request);
+    return False;
+  }
+
+  // Add the request to our 'submitted' list:
+  request->fPrev = NULL;
+  request->fNext = fSubmittedHead;
+  if (fSubmittedHead != NULL) fSubmittedHead->fPrev = request;
+  fSubmittedHead = request;
+  ++fNumOutstanding;
+
+  return True;
+#else
+  freeRequest(request);
+  return False;
+#endif
+}
+
+void AsyncFileIO::reapCompletions(unsigned minToWaitFor) {
+#ifdef HAVE_IO_URING
+  if (minToWaitFor > 0) {
+    while (io_uring_enter(fRingFd, 0, minToWaitFor, IORING_ENTER_GETEVENTS) < 0 && errno == EINTR) {}
+  }
+
+  unsigned head = *fCQHead;
+  unsigned const tail = __atomic_load_n(fCQTail, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    struct io_uring_cqe* cqe = &((struct io_uring_cqe*)fCQEntries)[head & *fCQRingMask];
+    AsyncFileIORequest* request = (AsyncFileIORequest*)(unsigned long)(cqe->user_data);
+    request->fResult = cqe->res;
+    if (request->fIsWrite && cqe->res >= 0 && (unsigned)cqe->res < request->fNumBytes) {
+      request->fResult = -EIO; // a short write (e.g., because the disk is full) leaves a hole in the file
+    }
+    ++head;
+
+    // Move the request from our 'submitted' list to our 'completed' list:
+    if (request->fPrev != NULL) request->fPrev->fNext = request->fNext; else fSubmittedHead = request->fNext;
+    if (request->fNext != NULL) request->fNext->fPrev = request->fPrev;
+    request->fNext = NULL;
+    request->fPrev = fCompletedTail;
+    if (fCompletedTail != NULL) fCompletedTail->fNext = request; else fCompletedHead = request;
+    fCompletedTail = request;
+    --fNumOutstanding;
+  }
+  __atomic_store_n(fCQHead, head, __ATOMIC_RELEASE);
+#endif
+}
+
+void AsyncFileIO::deliverCompletions() {
+  fIsDelivering = True;
+
+  AsyncFileIORequest* request;
+  while ((request = fCompletedHead) != NULL) {
+    fCompletedHead = request->fNext;
+    if (fCompletedHead == NULL) fCompletedTail = NULL;
+
+    if (request->fCompletionFunc != NULL) {
+      (*request->fCompletionFunc)(request->fClientData, request->fBuffer, request->fResult);
+    }
+    freeRequest(request);
+  }
+
+  fIsDelivering = False;
+  if (fDeletionIsPending) {
+    ++fReferenceCount; release();
+  }
+}
+
+void AsyncFileIO::completionHandler(void* clientData, int /*mask*/) {
+  AsyncFileIO* asyncFileIO = (AsyncFileIO*)clientData;
+  asyncFileIO->completionHandler1();
+}
+
+void AsyncFileIO::completionHandler1() {
+#ifdef HAVE_IO_URING
+  u_int64_t counter;
+  (void)read(fEventFd, &counter, sizeof counter); // clears the 'readable' state
+#endif
+
+  reapCompletions(0);
+  deliverCompletions();
+}
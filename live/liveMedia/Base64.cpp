@@ -19,22 +19,20 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // implementation
 
 #include "Base64.hh"
-#include <strDup.hh>
 #include <string.h>
 
-static char base64DecodeTable[256];
+static unsigned char base64DecodeTable[256];
 
 static void initBase64DecodeTable() {
   int i;
-  for (i = 0; i < 256; ++i) base64DecodeTable[i] = (char)0x80;
-      // default value: invalid
+  for (i = 0; i < 256; ++i) base64DecodeTable[i] = 0x80;
+      // default value: invalid (or '=' padding); groups containing these are handled separately
 
   for (i = 'A'; i <= 'Z'; ++i) base64DecodeTable[i] = 0 + (i - 'A');
   for (i = 'a'; i <= 'z'; ++i) base64DecodeTable[i] = 26 + (i - 'a');
   for (i = '0'; i <= '9'; ++i) base64DecodeTable[i] = 52 + (i - '0');
   base64DecodeTable[(unsigned char)'+'] = 62;
   base64DecodeTable[(unsigned char)'/'] = 63;
-  base64DecodeTable[(unsigned char)'='] = 0;
 }
 
 unsigned char* base64Decode(char const* in, unsigned& resultSize,
@@ -46,77 +44,110 @@ unsigned char* base64Decode(char const* in, unsigned& resultSize,
 unsigned char* base64Decode(char const* in, unsigned inSize,
 			    unsigned& resultSize,
 			    Boolean trimTrailingZeros) {
+  unsigned char* result = new unsigned char[3*(inSize/4)];
+  resultSize = base64Decode(in, inSize, result, trimTrailingZeros);
+
+  return result;
+}
+
+unsigned base64Decode(char const* inSigned, unsigned inSize, unsigned char* out,
+		      Boolean trimTrailingZeros) {
   static Boolean haveInitializedBase64DecodeTable = False;
   if (!haveInitializedBase64DecodeTable) {
     initBase64DecodeTable();
     haveInitializedBase64DecodeTable = True;
   }
 
-  unsigned char* out = (unsigned char*)strDupSize(in); // ensures we have enough space
-  int k = 0;
-  int paddingCount = 0;
-  int const jMax = inSize - 3;
-     // in case "inSize" is not a multiple of 4 (although it should be)
-  for (int j = 0; j < jMax; j += 4) {
-    char inTmp[4], outTmp[4];
-    for (int i = 0; i < 4; ++i) {
-      inTmp[i] = in[i+j];
-      if (inTmp[i] == '=') ++paddingCount;
-      outTmp[i] = base64DecodeTable[(unsigned char)inTmp[i]];
-      if ((outTmp[i]&0x80) != 0) outTmp[i] = 0; // this happens only if there was an invalid character; pretend that it was 'A'
+  unsigned char const* in = (unsigned char const*)inSigned;
+  unsigned k = 0;
+  unsigned paddingCount = 0;
+  unsigned const numGroups = inSize/4;
+     // in case "inSize" is not a multiple of 4 (although it should be), we ignore any trailing bytes
+  for (unsigned j = 0; j < numGroups; ++j, in += 4) {
+    // Note that we read each group of 4 input bytes before writing its 3 output bytes, so that "out" may be the same as "in":
+    unsigned char c0 = base64DecodeTable[in[0]];
+    unsigned char c1 = base64DecodeTable[in[1]];
+    unsigned char c2 = base64DecodeTable[in[2]];
+    unsigned char c3 = base64DecodeTable[in[3]];
+    if (((c0|c1|c2|c3)&0x80) != 0) {
+      // This group contains '=' padding and/or an invalid character (which we pretend was 'A'); this is rare:
+      paddingCount += (in[0] == '=') + (in[1] == '=') + (in[2] == '=') + (in[3] == '=');
+      if (c0 == 0x80) c0 = 0;
+      if (c1 == 0x80) c1 = 0;
+      if (c2 == 0x80) c2 = 0;
+      if (c3 == 0x80) c3 = 0;
     }
 
-    out[k++] = (outTmp[0]<<2) | (outTmp[1]>>4);
-    out[k++] = (outTmp[1]<<4) | (outTmp[2]>>2);
-    out[k++] = (outTmp[2]<<6) | outTmp[3];
+    unsigned const value = (c0<<18) | (c1<<12) | (c2<<6) | c3;
+    out[k++] = value>>16;
+    out[k++] = value>>8;
+    out[k++] = value;
   }
 
   if (trimTrailingZeros) {
     while (paddingCount > 0 && k > 0 && out[k-1] == '\0') { --k; --paddingCount; }
   }
-  resultSize = k;
-  unsigned char* result = new unsigned char[resultSize];
-  memmove(result, out, resultSize);
-  delete[] out;
-
-  return result;
+  return k;
 }
 
 static const char base64Char[] =
 "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-char* base64Encode(char const* origSigned, unsigned origLength) {
-  unsigned char const* orig = (unsigned char const*)origSigned; // in case any input bytes have the MSB set
+static char base64PairTable[2*4096]; // maps each 12-bit value to its 2 base-64 characters
+
+static void initBase64PairTable() {
+  for (unsigned i = 0; i < 4096; ++i) {
+    base64PairTable[2*i] = base64Char[i>>6];
+    base64PairTable[2*i+1] = base64Char[i&0x3F];
+  }
+}
+
+char* base64Encode(char const* orig, unsigned origLength) {
   if (orig == NULL) return NULL;
 
+  char* result = new char[base64EncodedSize(origLength)+1]; // allow for trailing '\0'
+  base64Encode(orig, origLength, result);
+
+  return result;
+}
+
+unsigned base64Encode(char const* origSigned, unsigned origLength, char* out) {
+  unsigned char const* orig = (unsigned char const*)origSigned; // in case any input bytes have the MSB set
+  if (orig == NULL) origLength = 0;
+
+  static Boolean haveInitializedBase64PairTable = False;
+  if (!haveInitializedBase64PairTable) {
+    initBase64PairTable();
+    haveInitializedBase64PairTable = True;
+  }
+
   unsigned const numOrig24BitValues = origLength/3;
   Boolean havePadding = origLength > numOrig24BitValues*3;
   Boolean havePadding2 = origLength == numOrig24BitValues*3 + 2;
-  unsigned const numResultBytes = 4*(numOrig24BitValues + havePadding);
-  char* result = new char[numResultBytes+1]; // allow for trailing '\0'
+  unsigned const numResultBytes = base64EncodedSize(origLength);
 
-  // Map each full group of 3 input bytes into 4 output base-64 characters:
+  // Map each full group of 3 input bytes into 4 output base-64 characters (2 at a time):
   unsigned i;
-  for (i = 0; i < numOrig24BitValues; ++i) {
-    result[4*i+0] = base64Char[(orig[3*i]>>2)&0x3F];
-    result[4*i+1] = base64Char[(((orig[3*i]&0x3)<<4) | (orig[3*i+1]>>4))&0x3F];
-    result[4*i+2] = base64Char[((orig[3*i+1]<<2) | (orig[3*i+2]>>6))&0x3F];
-    result[4*i+3] = base64Char[orig[3*i+2]&0x3F];
+  char* to = out;
+  for (i = 0; i < numOrig24BitValues; ++i, orig += 3, to += 4) {
+    unsigned const value = (orig[0]<<16) | (orig[1]<<8) | orig[2];
+    memcpy(&to[0], &base64PairTable[2*(value>>12)], 2);
+    memcpy(&to[2], &base64PairTable[2*(value&0xFFF)], 2);
   }
 
-  // Now, take padding into account.  (Note: i == numOrig24BitValues)
+  // Now, take padding into account.  (Note: "orig" now points to the remaining 1 or 2 input bytes)
   if (havePadding) {
-    result[4*i+0] = base64Char[(orig[3*i]>>2)&0x3F];
+    to[0] = base64Char[(orig[0]>>2)&0x3F];
     if (havePadding2) {
-      result[4*i+1] = base64Char[(((orig[3*i]&0x3)<<4) | (orig[3*i+1]>>4))&0x3F];
-      result[4*i+2] = base64Char[(orig[3*i+1]<<2)&0x3F];
+      to[1] = base64Char[(((orig[0]&0x3)<<4) | (orig[1]>>4))&0x3F];
+      to[2] = base64Char[(orig[1]<<2)&0x3F];
     } else {
-      result[4*i+1] = base64Char[((orig[3*i]&0x3)<<4)&0x3F];
-      result[4*i+2] = '=';
+      to[1] = base64Char[((orig[0]&0x3)<<4)&0x3F];
+      to[2] = '=';
     }
-    result[4*i+3] = '=';
+    to[3] = '=';
   }
 
-  result[numResultBytes] = '\0';
-  return result;
+  out[numResultBytes] = '\0';
+  return numResultBytes;
 }
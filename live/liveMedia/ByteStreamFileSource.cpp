@@ -20,6 +20,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "ByteStreamFileSource.hh"
 #include "InputFile.hh"
+#include "AsyncFileIO.hh"
 #include "GroupsockHelper.hh"
 
 ////////// ByteStreamFileSource //////////
@@ -51,21 +52,27 @@ ByteStreamFileSource::createNew(UsageEnvironment& env, FILE* fid,
 }
 
 void ByteStreamFileSource::seekToByteAbsolute(u_int64_t byteNumber, u_int64_t numBytesToStream) {
+  Boolean wasPending = cancelAsyncRead();
   SeekFile64(fFid, (int64_t)byteNumber, SEEK_SET);
 
   fNumBytesToStream = numBytesToStream;
   fLimitNumBytesToStream = fNumBytesToStream > 0;
+  restartAsyncRead(wasPending);
 }
 
 void ByteStreamFileSource::seekToByteRelative(int64_t offset, u_int64_t numBytesToStream) {
+  Boolean wasPending = cancelAsyncRead();
   SeekFile64(fFid, offset, SEEK_CUR);
 
   fNumBytesToStream = numBytesToStream;
   fLimitNumBytesToStream = fNumBytesToStream > 0;
+  restartAsyncRead(wasPending);
 }
 
 void ByteStreamFileSource::seekToEnd() {
+  Boolean wasPending = cancelAsyncRead();
   SeekFile64(fFid, 0, SEEK_END);
+  restartAsyncRead(wasPending);
 }
 
 ByteStreamFileSource::ByteStreamFileSource(UsageEnvironment& env, FILE* fid,
@@ -73,16 +80,25 @@ ByteStreamFileSource::ByteStreamFileSource(UsageEnvironment& env, FILE* fid,
 					   unsigned playTimePerFrame)
   : FramedFileSource(env, fid), fFileSize(0), fPreferredFrameSize(preferredFrameSize),
     fPlayTimePerFrame(playTimePerFrame), fLastPlayTime(0),
-    fHaveStartedReading(False), fLimitNumBytesToStream(False), fNumBytesToStream(0) {
+    fHaveStartedReading(False), fLimitNumBytesToStream(False), fNumBytesToStream(0),
+    fAsyncFileIO(NULL), fAsyncReadIsPending(False), fAsyncReadOffset(0) {
 #ifndef READ_FROM_FILES_SYNCHRONOUSLY
   makeSocketNonBlocking(fileno(fFid));
 #endif
 
   // Test whether the file is seekable
   fFidIsSeekable = FileIsSeekable(fFid);
+
+  // A regular file is always 'readable', so "select()" can't tell us when a read would block.
+  // If we can, read seekable files using asynchronous I/O instead:
+  if (fFidIsSeekable) fAsyncFileIO = AsyncFileIO::getInstance(env);
 }
 
 ByteStreamFileSource::~ByteStreamFileSource() {
+  if (fAsyncFileIO != NULL) {
+    fAsyncFileIO->cancel(this);
+    fAsyncFileIO->release();
+  }
   if (fFid == NULL) return;
 
 #ifndef READ_FROM_FILES_SYNCHRONOUSLY
@@ -98,6 +114,11 @@ void ByteStreamFileSource::doGetNextFrame() {
     return;
   }
 
+  if (fAsyncFileIO != NULL) {
+    if (!fAsyncReadIsPending) doReadFromFile(); // the result will be delivered later, from the event loop
+    return;
+  }
+
 #ifdef READ_FROM_FILES_SYNCHRONOUSLY
   doReadFromFile();
 #else
@@ -112,6 +133,7 @@ void ByteStreamFileSource::doGetNextFrame() {
 
 void ByteStreamFileSource::doStopGettingFrames() {
   envir().taskScheduler().unscheduleDelayedTask(nextTask());
+  cancelAsyncRead(); // because we didn't advance the file position, its data will be read again
 #ifndef READ_FROM_FILES_SYNCHRONOUSLY
   envir().taskScheduler().turnOffBackgroundReadHandling(fileno(fFid));
   fHaveStartedReading = False;
@@ -134,6 +156,15 @@ void ByteStreamFileSource::doReadFromFile() {
   if (fPreferredFrameSize > 0 && fPreferredFrameSize < fMaxSize) {
     fMaxSize = fPreferredFrameSize;
   }
+  if (fAsyncFileIO != NULL) {
+    fAsyncReadOffset = TellFile64(fFid);
+    if (fAsyncReadOffset >= 0
+	&& fAsyncFileIO->readAt(fileno(fFid), fMaxSize, fAsyncReadOffset, asyncReadCompletion, this)) {
+      fAsyncReadIsPending = True;
+      return;
+    }
+    // The asynchronous read couldn't be started, so read synchronously instead:
+  }
 #ifdef READ_FROM_FILES_SYNCHRONOUSLY
   fFrameSize = fread(fTo, 1, fMaxSize, fFid);
 #else
@@ -148,6 +179,62 @@ void ByteStreamFileSource::doReadFromFile() {
     handleClosure();
     return;
   }
+
+  afterReadingFromFile();
+
+  // Inform the reader that he has data:
+#ifndef READ_FROM_FILES_SYNCHRONOUSLY
+  if (fAsyncFileIO == NULL) {
+    // Because the file read was done from the event loop, we can call the
+    // 'after getting' function directly, without risk of infinite recursion:
+    FramedSource::afterGetting(this);
+    return;
+  }
+#endif
+  // To avoid possible infinite recursion, we need to return to the event loop to do this:
+  nextTask() = envir().taskScheduler().scheduleDelayedTask(0,
+				(TaskFunc*)FramedSource::afterGetting, this);
+}
+
+void ByteStreamFileSource
+::asyncReadCompletion(void* clientData, unsigned char const* data, int result) {
+  ByteStreamFileSource* source = (ByteStreamFileSource*)clientData;
+  source->asyncReadCompletion1(data, result);
+}
+
+void ByteStreamFileSource::asyncReadCompletion1(unsigned char const* data, int result) {
+  fAsyncReadIsPending = False;
+  if (result <= 0) {
+    // EOF, or a read error:
+    handleClosure();
+    return;
+  }
+
+  fFrameSize = (unsigned)result;
+  if (fFrameSize > fMaxSize) fFrameSize = fMaxSize; // shouldn't happen
+  memmove(fTo, data, fFrameSize);
+  SeekFile64(fFid, fAsyncReadOffset + fFrameSize, SEEK_SET);
+
+  // We're being called from the event loop, so we can deliver the data directly:
+  afterReadingFromFile();
+  FramedSource::afterGetting(this);
+}
+
+Boolean ByteStreamFileSource::cancelAsyncRead() {
+  if (!fAsyncReadIsPending) return False;
+
+  // The read's completion would otherwise deliver data from - and move the file position back to - the old offset:
+  fAsyncFileIO->cancel(this);
+  fAsyncReadIsPending = False;
+  return True;
+}
+
+void ByteStreamFileSource::restartAsyncRead(Boolean wasPending) {
+  // If our reader was waiting for the cancelled read, then read again, from the new position:
+  if (wasPending && isCurrentlyAwaitingData()) doGetNextFrame();
+}
+
+void ByteStreamFileSource::afterReadingFromFile() {
   fNumBytesToStream -= fFrameSize;
 
   // Set the 'presentation time':
@@ -170,15 +257,4 @@ void ByteStreamFileSource::doReadFromFile() {
     // so just record the current time as being the 'presentation time':
     gettimeofday(&fPresentationTime, NULL);
   }
-
-  // Inform the reader that he has data:
-#ifdef READ_FROM_FILES_SYNCHRONOUSLY
-  // To avoid possible infinite recursion, we need to return to the event loop to do this:
-  nextTask() = envir().taskScheduler().scheduleDelayedTask(0,
-				(TaskFunc*)FramedSource::afterGetting, this);
-#else
-  // Because the file read was done from the event loop, we can call the
-  // 'after getting' function directly, without risk of infinite recursion:
-  FramedSource::afterGetting(this);
-#endif
 }
@@ -103,38 +103,29 @@ void Authenticator::setUsernameAndPassword(char const* username,
 
 char const* Authenticator::computeDigestResponse(char const* cmd,
 						 char const* url) const {
+  return computeDigestResponse(cmd, url, new char[33]);
+}
+
+char const* Authenticator::computeDigestResponse(char const* cmd, char const* url, char* responseBuf) const {
   // The "response" field is computed as:
   //    md5(md5(<username>:<realm>:<password>):<nonce>:md5(<cmd>:<url>))
   // or, if "fPasswordIsMD5" is True:
   //    md5(<password>:<nonce>:md5(<cmd>:<url>))
+  // where the first part ('HA1') is usually precomputed.
   char ha1Buf[33];
-  if (fPasswordIsMD5) {
-    strncpy(ha1Buf, password(), 32);
-    ha1Buf[32] = '\0'; // just in case
-  } else {
-    unsigned const ha1DataLen = strlen(username()) + 1
-      + strlen(realm()) + 1 + strlen(password());
-    unsigned char* ha1Data = new unsigned char[ha1DataLen+1];
-    sprintf((char*)ha1Data, "%s:%s:%s", username(), realm(), password());
-    our_MD5Data(ha1Data, ha1DataLen, ha1Buf);
-    delete[] ha1Data;
+  char const* ha1 = fHA1;
+  if (!fHaveHA1) { // we're missing the realm or username; treat them as empty
+    char const* ha1Fields[3] = { username() == NULL ? "" : username(), realm() == NULL ? "" : realm(),
+				 password() == NULL ? "" : password() };
+    ha1 = our_MD5Fields(ha1Fields, 3, ha1Buf);
   }
 
-  unsigned const ha2DataLen = strlen(cmd) + 1 + strlen(url);
-  unsigned char* ha2Data = new unsigned char[ha2DataLen+1];
-  sprintf((char*)ha2Data, "%s:%s", cmd, url);
   char ha2Buf[33];
-  our_MD5Data(ha2Data, ha2DataLen, ha2Buf);
-  delete[] ha2Data;
+  char const* ha2Fields[2] = { cmd, url };
+  our_MD5Fields(ha2Fields, 2, ha2Buf);
 
-  unsigned const digestDataLen
-    = 32 + 1 + strlen(nonce()) + 1 + 32;
-  unsigned char* digestData = new unsigned char[digestDataLen+1];
-  sprintf((char*)digestData, "%s:%s:%s",
-          ha1Buf, nonce(), ha2Buf);
-  char const* result = our_MD5Data(digestData, digestDataLen, NULL);
-  delete[] digestData;
-  return result;
+  char const* digestFields[3] = { ha1, nonce() == NULL ? "" : nonce(), ha2Buf };
+  return our_MD5Fields(digestFields, 3, responseBuf);
 }
 
 void Authenticator::reclaimDigestResponse(char const* responseStr) const {
@@ -144,17 +135,20 @@ void Authenticator::reclaimDigestResponse(char const* responseStr) const {
 void Authenticator::resetRealmAndNonce() {
   delete[] fRealm; fRealm = NULL;
   delete[] fNonce; fNonce = NULL;
+  fHaveHA1 = False;
 }
 
 void Authenticator::resetUsernameAndPassword() {
   delete[] fUsername; fUsername = NULL;
   delete[] fPassword; fPassword = NULL;
   fPasswordIsMD5 = False;
+  fHaveHA1 = False;
 }
 
 void Authenticator::assignRealmAndNonce(char const* realm, char const* nonce) {
   fRealm = strDup(realm);
   fNonce = strDup(nonce);
+  computeHA1();
 }
 
 void Authenticator::assignUsernameAndPassword(char const* username, char const* password, Boolean passwordIsMD5) {
@@ -164,10 +158,26 @@ void Authenticator::assignUsernameAndPassword(char const* username, char const*
   fUsername = strDup(username);
   fPassword = strDup(password);
   fPasswordIsMD5 = passwordIsMD5;
+  computeHA1();
 }
 
 void Authenticator::assign(char const* realm, char const* nonce,
 			   char const* username, char const* password, Boolean passwordIsMD5) {
+  fUsername = fPassword = NULL; fPasswordIsMD5 = fHaveHA1 = False;
   assignRealmAndNonce(realm, nonce);
   assignUsernameAndPassword(username, password, passwordIsMD5);
 }
+
+void Authenticator::computeHA1() {
+  fHaveHA1 = False;
+  if (fPasswordIsMD5) {
+    strncpy(fHA1, fPassword, 32);
+    fHA1[32] = '\0'; // just in case
+  } else {
+    if (fRealm == NULL || fUsername == NULL || fPassword == NULL) return;
+
+    char const* ha1Fields[3] = { fUsername, fRealm, fPassword };
+    our_MD5Fields(ha1Fields, 3, fHA1);
+  }
+  fHaveHA1 = True;
+}
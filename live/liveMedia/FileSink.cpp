@@ -25,12 +25,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "FileSink.hh"
 #include "GroupsockHelper.hh"
 #include "OutputFile.hh"
+#include "AsyncFileIO.hh"
 
 ////////// FileSink //////////
 
 FileSink::FileSink(UsageEnvironment& env, FILE* fid, unsigned bufferSize,
 		   char const* perFrameFileNamePrefix)
-  : MediaSink(env), fOutFid(fid), fBufferSize(bufferSize), fSamePresentationTimeCounter(0) {
+  : MediaSink(env), fOutFid(fid), fBufferSize(bufferSize), fSamePresentationTimeCounter(0),
+    fAsyncFileIO(NULL), fAsyncWriteFailed(False) {
   fBuffer = new unsigned char[bufferSize];
   if (perFrameFileNamePrefix != NULL) {
     fPerFrameFileNamePrefix = strDup(perFrameFileNamePrefix);
@@ -40,9 +42,18 @@ FileSink::FileSink(UsageEnvironment& env, FILE* fid, unsigned bufferSize,
     fPerFrameFileNameBuffer = NULL;
   }
   fPrevPresentationTime.tv_sec = ~0; fPrevPresentationTime.tv_usec = 0;
+
+  // If we're writing to a single (regular) file, then write to it asynchronously, if we can,
+  // so that a slow disk doesn't stall the event loop:
+  if (fid != NULL && fid != stdout && fid != stderr) fAsyncFileIO = AsyncFileIO::getInstance(env);
 }
 
 FileSink::~FileSink() {
+  if (fAsyncFileIO != NULL) {
+    fAsyncFileIO->flush(fOutFid);
+    fAsyncFileIO->cancel(this);
+    fAsyncFileIO->release();
+  }
   delete[] fPerFrameFileNameBuffer;
   delete[] fPerFrameFileNamePrefix;
   delete[] fBuffer;
@@ -120,7 +131,10 @@ void FileSink::addData(unsigned char const* data, unsigned dataSize,
   if (!packetIsLost)
 #endif
   if (fOutFid != NULL && data != NULL) {
-    fwrite(data, 1, dataSize, fOutFid);
+    if (fAsyncFileIO == NULL
+	|| !fAsyncFileIO->appendToFile(fOutFid, data, dataSize, afterAsyncWrite, this)) {
+      fwrite(data, 1, dataSize, fOutFid);
+    }
   }
 }
 
@@ -135,7 +149,7 @@ void FileSink::afterGettingFrame(unsigned frameSize,
   }
   addData(fBuffer, frameSize, presentationTime);
 
-  if (fOutFid == NULL || fflush(fOutFid) == EOF) {
+  if (fOutFid == NULL || fflush(fOutFid) == EOF || fAsyncWriteFailed) {
     // The output file has closed.  Handle this the same way as if the input source had closed:
     if (fSource != NULL) fSource->stopGettingFrames();
     onSourceClosure();
@@ -149,3 +163,8 @@ void FileSink::afterGettingFrame(unsigned frameSize,
   // Then try getting the next frame:
   continuePlaying();
 }
+
+void FileSink::afterAsyncWrite(void* clientData, unsigned char const* /*data*/, int result) {
+  FileSink* sink = (FileSink*)clientData;
+  if (result < 0) sink->fAsyncWriteFailed = True; // noticed when we next get a frame
+}
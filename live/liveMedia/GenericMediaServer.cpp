@@ -21,6 +21,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "GenericMediaServer.hh"
 #include <GroupsockHelper.hh>
+#include "ourMD5.hh"
 #if defined(__WIN32__) || defined(_WIN32) || defined(_QNX4)
 #define snprintf _snprintf
 #endif
@@ -94,7 +95,14 @@ GenericMediaServer
     fServerSocket(ourSocket), fServerPort(ourPort), fReclamationSeconds(reclamationSeconds),
     fServerMediaSessions(HashTable::create(STRING_HASH_KEYS)),
     fClientConnections(HashTable::create(ONE_WORD_HASH_KEYS)),
-    fClientSessions(HashTable::create(STRING_HASH_KEYS)) {
+    fClientSessions(HashTable::create(ONE_WORD_HASH_KEYS)),
+    fLivenessWheel(NULL), fLivenessWheelSize(0), fLivenessTick(0), fNumSessionsInLivenessWheel(0),
+    fLivenessSweepTask(NULL) {
+  if (fReclamationSeconds > 0) {
+    fLivenessWheelSize = fReclamationSeconds + 2;
+    fLivenessWheel = new ClientSession*[fLivenessWheelSize];
+    for (unsigned i = 0; i < fLivenessWheelSize; ++i) fLivenessWheel[i] = NULL;
+  }
   ignoreSigPipeOnSocket(fServerSocket); // so that clients on the same host that are killed don't also kill us
   
   // Arrange to handle connections from others:
@@ -102,6 +110,9 @@ GenericMediaServer
 }
 
 GenericMediaServer::~GenericMediaServer() {
+  envir().taskScheduler().unscheduleDelayedTask(fLivenessSweepTask);
+  delete[] fLivenessWheel;
+
   // Turn off background read handling:
   envir().taskScheduler().turnOffBackgroundReadHandling(fServerSocket);
   ::closeSocket(fServerSocket);
@@ -137,6 +148,8 @@ void GenericMediaServer::cleanup() {
 }
 
 #define LISTEN_BACKLOG_SIZE 20
+unsigned GenericMediaServer::listenBacklogSize = LISTEN_BACKLOG_SIZE;
+Boolean GenericMediaServer::shareListeningPort = False;
 
 int GenericMediaServer::setUpOurSocket(UsageEnvironment& env, Port& ourPort) {
   int ourSocket = -1;
@@ -149,14 +162,14 @@ int GenericMediaServer::setUpOurSocket(UsageEnvironment& env, Port& ourPort) {
     NoReuse dummy(env); // Don't use this socket if there's already a local server using it
 #endif
     
-    ourSocket = setupStreamSocket(env, ourPort);
+    ourSocket = setupStreamSocket(env, ourPort, True, shareListeningPort);
     if (ourSocket < 0) break;
     
     // Make sure we have a big send buffer:
     if (!increaseSendBufferTo(env, ourSocket, 50*1024)) break;
     
     // Allow multiple simultaneous connections:
-    if (listen(ourSocket, LISTEN_BACKLOG_SIZE) < 0) {
+    if (listen(ourSocket, listenBacklogSize) < 0) {
       env.setResultErrMsg("listen() failed: ");
       break;
     }
@@ -181,27 +194,41 @@ void GenericMediaServer::incomingConnectionHandler() {
   incomingConnectionHandlerOnSocket(fServerSocket);
 }
 
+// Each time our (non-blocking) server socket becomes readable, we accept all of the connections that are waiting - rather than
+// just one - so that a burst of connections doesn't overflow the "listen()" backlog.  (But we limit this, so that a connection
+// storm doesn't hold up our streams.)
+#define MAX_CONNECTIONS_ACCEPTED_PER_WAKEUP 100
+
 void GenericMediaServer::incomingConnectionHandlerOnSocket(int serverSocket) {
-  struct sockaddr_in clientAddr;
-  SOCKLEN_T clientAddrLen = sizeof clientAddr;
-  int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
-  if (clientSocket < 0) {
-    int err = envir().getErrno();
-    if (err != EWOULDBLOCK) {
-      envir().setResultErrMsg("accept() failed: ");
+  for (unsigned i = 0; i < MAX_CONNECTIONS_ACCEPTED_PER_WAKEUP; ++i) {
+    struct sockaddr_in clientAddr;
+    SOCKLEN_T clientAddrLen = sizeof clientAddr;
+#if defined(__linux__) && defined(SOCK_NONBLOCK)
+    // Make the new socket non-blocking in the same system call:
+    int clientSocket = accept4(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen, SOCK_NONBLOCK|SOCK_CLOEXEC);
+#else
+    int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
+#endif
+    if (clientSocket < 0) {
+      int err = envir().getErrno();
+      if (err != EWOULDBLOCK) {
+	envir().setResultErrMsg("accept() failed: ");
+      }
+      return;
     }
-    return;
-  }
-  ignoreSigPipeOnSocket(clientSocket); // so that clients on the same host that are killed don't also kill us
-  makeSocketNonBlocking(clientSocket);
-  increaseSendBufferTo(envir(), clientSocket, 50*1024);
-  
+    ignoreSigPipeOnSocket(clientSocket); // so that clients on the same host that are killed don't also kill us
+#if !defined(__linux__) || !defined(SOCK_NONBLOCK)
+    makeSocketNonBlocking(clientSocket);
+#endif
+    increaseSendBufferTo(envir(), clientSocket, 50*1024);
+    
 #ifdef DEBUG
-  envir() << "accept()ed connection from " << AddressString(clientAddr).val() << "\n";
+    envir() << "accept()ed connection from " << AddressString(clientAddr).val() << "\n";
 #endif
-  
-  // Create a new object for handling this connection:
-  (void)createNewClientConnection(clientSocket, clientAddr);
+    
+    // Create a new object for handling this connection:
+    (void)createNewClientConnection(clientSocket, clientAddr);
+  }
 }
 
 
@@ -257,18 +284,17 @@ void GenericMediaServer::ClientConnection::resetRequestBuffer() {
 GenericMediaServer::ClientSession
 ::ClientSession(GenericMediaServer& ourServer, u_int32_t sessionId)
   : fOurServer(ourServer), fOurSessionId(sessionId), fOurServerMediaSession(NULL),
-    fLivenessCheckTask(NULL) {
+    fLastLivenessTick(0), fNextInLivenessSlot(NULL), fLivenessSlotLink(NULL) {
   noteLiveness();
+  fOurServer.addToLivenessWheel(this);
 }
 
 GenericMediaServer::ClientSession::~ClientSession() {
   // Turn off any liveness checking:
-  envir().taskScheduler().unscheduleDelayedTask(fLivenessCheckTask);
+  fOurServer.removeFromLivenessWheel(this);
 
   // Remove ourself from the server's 'client sessions' hash table before we go:
-  char sessionIdStr[8+1];
-  sprintf(sessionIdStr, "%08X", fOurSessionId);
-  fOurServer.fClientSessions->Remove(sessionIdStr);
+  fOurServer.fClientSessions->Remove((char const*)(uintptr_t)fOurSessionId);
   
   if (fOurServerMediaSession != NULL) {
     fOurServerMediaSession->decrementReferenceCount();
@@ -289,56 +315,115 @@ void GenericMediaServer::ClientSession::noteLiveness() {
 #endif
   if (fOurServerMediaSession != NULL) fOurServerMediaSession->noteLiveness();
 
-  if (fOurServer.fReclamationSeconds > 0) {
-    envir().taskScheduler().rescheduleDelayedTask(fLivenessCheckTask,
-						  fOurServer.fReclamationSeconds*1000000,
-						  (TaskFunc*)livenessTimeoutTask, this);
-  }
+  fLastLivenessTick = fOurServer.fLivenessTick; // our server's next 'liveness sweep' of our slot will see this
 }
 
 void GenericMediaServer::ClientSession::noteClientLiveness(ClientSession* clientSession) {
   clientSession->noteLiveness();
 }
 
-void GenericMediaServer::ClientSession::livenessTimeoutTask(ClientSession* clientSession) {
-  // If this gets called, the client session is assumed to have timed out, so delete it:
+void GenericMediaServer::addToLivenessWheel(ClientSession* clientSession) {
+  if (fLivenessWheel == NULL) return; // we don't reclaim inactive sessions
+
+  // Put "clientSession" in the slot for the tick at which it will time out (unless its liveness is noted again):
+  unsigned const timeoutTick = clientSession->fLastLivenessTick + fReclamationSeconds + 1;
+  ClientSession*& slotHead = fLivenessWheel[timeoutTick%fLivenessWheelSize];
+  clientSession->fNextInLivenessSlot = slotHead;
+  if (slotHead != NULL) slotHead->fLivenessSlotLink = &clientSession->fNextInLivenessSlot;
+  slotHead = clientSession;
+  clientSession->fLivenessSlotLink = &slotHead;
+
+  if (fNumSessionsInLivenessWheel++ == 0) {
+    // This is our only session, so (re)start our once-per-second sweep:
+    fLivenessSweepTask = envir().taskScheduler().scheduleDelayedTask(1000000, livenessSweepTask, this);
+  }
+}
+
+void GenericMediaServer::removeFromLivenessWheel(ClientSession* clientSession) {
+  if (clientSession->fLivenessSlotLink == NULL) return; // it's not in the wheel
+
+  *clientSession->fLivenessSlotLink = clientSession->fNextInLivenessSlot;
+  if (clientSession->fNextInLivenessSlot != NULL) {
+    clientSession->fNextInLivenessSlot->fLivenessSlotLink = clientSession->fLivenessSlotLink;
+  }
+  clientSession->fNextInLivenessSlot = NULL;
+  clientSession->fLivenessSlotLink = NULL;
+
+  if (--fNumSessionsInLivenessWheel == 0) {
+    // We no longer have any sessions to check, so stop our sweep (to avoid waking up an idle server):
+    envir().taskScheduler().unscheduleDelayedTask(fLivenessSweepTask);
+  }
+}
+
+void GenericMediaServer::livenessSweepTask(void* clientData) {
+  GenericMediaServer* server = (GenericMediaServer*)clientData;
+  server->fLivenessSweepTask = NULL;
+  server->livenessSweep();
+}
+
+void GenericMediaServer::livenessSweep() {
+  ++fLivenessTick;
+
+  // Check each session in the slot for this tick.  (We remove each one from the slot before handling it, because deleting
+  // a session might also delete others.)
+  ClientSession*& slotHead = fLivenessWheel[fLivenessTick%fLivenessWheelSize];
+  ClientSession* clientSession;
+  while ((clientSession = slotHead) != NULL) {
+    removeFromLivenessWheel(clientSession);
+
+    if (fLivenessTick - clientSession->fLastLivenessTick > fReclamationSeconds) {
+      // The client session has timed out (due to inactivity), so delete it:
 #ifdef DEBUG
-  char const* streamName
-    = (clientSession->fOurServerMediaSession == NULL) ? "???" : clientSession->fOurServerMediaSession->streamName();
-  fprintf(stderr, "Client session (id \"%08X\", stream name \"%s\") has timed out (due to inactivity)\n",
-	  clientSession->fOurSessionId, streamName);
+      char const* streamName
+	= (clientSession->fOurServerMediaSession == NULL) ? "???" : clientSession->fOurServerMediaSession->streamName();
+      fprintf(stderr, "Client session (id \"%08X\", stream name \"%s\") has timed out (due to inactivity)\n",
+	      clientSession->fOurSessionId, streamName);
 #endif
-  delete clientSession;
+      delete clientSession;
+    } else {
+      addToLivenessWheel(clientSession); // to a later slot (because its liveness was noted since it was added to this one)
+    }
+  }
+
+  if (fNumSessionsInLivenessWheel > 0 && fLivenessSweepTask == NULL) {
+    fLivenessSweepTask = envir().taskScheduler().scheduleDelayedTask(1000000, livenessSweepTask, this);
+  }
 }
 
 GenericMediaServer::ClientSession* GenericMediaServer::createNewClientSessionWithId() {
   u_int32_t sessionId;
-  char sessionIdStr[8+1];
 
   // Choose a random (unused) 32-bit integer for the session id
   // (it will be encoded as a 8-digit hex number).  (We avoid choosing session id 0,
   // because that has a special use by some servers.)
   do {
     sessionId = (u_int32_t)our_random32();
-    snprintf(sessionIdStr, sizeof sessionIdStr, "%08X", sessionId);
-  } while (sessionId == 0 || lookupClientSession(sessionIdStr) != NULL);
+  } while (sessionId == 0 || lookupClientSession(sessionId) != NULL);
 
   ClientSession* clientSession = createNewClientSession(sessionId);
-  if (clientSession != NULL) fClientSessions->Add(sessionIdStr, clientSession);
+  if (clientSession != NULL) fClientSessions->Add((char const*)(uintptr_t)sessionId, clientSession);
 
   return clientSession;
 }
 
 GenericMediaServer::ClientSession*
 GenericMediaServer::lookupClientSession(u_int32_t sessionId) {
-  char sessionIdStr[8+1];
-  snprintf(sessionIdStr, sizeof sessionIdStr, "%08X", sessionId);
-  return lookupClientSession(sessionIdStr);
+  return (GenericMediaServer::ClientSession*)fClientSessions->Lookup((char const*)(uintptr_t)sessionId);
 }
 
 GenericMediaServer::ClientSession*
 GenericMediaServer::lookupClientSession(char const* sessionIdStr) {
-  return (GenericMediaServer::ClientSession*)fClientSessions->Lookup(sessionIdStr);
+  // Session id strings are the session ids encoded as 8-digit (upper case) hex numbers:
+  u_int32_t sessionId = 0;
+  for (unsigned i = 0; i < 8; ++i) {
+    char const c = sessionIdStr[i];
+    if (c >= '0' && c <= '9') sessionId = (sessionId<<4) | (c - '0');
+    else if (c >= 'A' && c <= 'F') sessionId = (sessionId<<4) | (c - 'A' + 10);
+    else return NULL;
+  }
+  if (sessionIdStr[8] != '\0') return NULL;
+
+  return lookupClientSession(sessionId);
 }
 
 
@@ -364,11 +449,20 @@ ServerMediaSession* GenericMediaServer::ServerMediaSessionIterator::next() {
 
 ////////// UserAuthenticationDatabase implementation //////////
 
+class HA1Record {
+public:
+  HA1Record(char const* password) : password(strDup(password)) {}
+  ~HA1Record() { delete[] password; }
+
+  char* password; // from which "ha1" was computed
+  char ha1[33];
+};
+
 UserAuthenticationDatabase::UserAuthenticationDatabase(char const* realm,
 						       Boolean passwordsAreMD5)
   : fTable(HashTable::create(STRING_HASH_KEYS)),
     fRealm(strDup(realm == NULL ? "LIVE555 Streaming Media" : realm)),
-    fPasswordsAreMD5(passwordsAreMD5) {
+    fPasswordsAreMD5(passwordsAreMD5), fHA1Table(HashTable::create(STRING_HASH_KEYS)) {
 }
 
 UserAuthenticationDatabase::~UserAuthenticationDatabase() {
@@ -380,19 +474,62 @@ UserAuthenticationDatabase::~UserAuthenticationDatabase() {
     delete[] password;
   }
   delete fTable;
+
+  HA1Record* ha1Record;
+  while ((ha1Record = (HA1Record*)fHA1Table->RemoveNext()) != NULL) {
+    delete ha1Record;
+  }
+  delete fHA1Table;
 }
 
 void UserAuthenticationDatabase::addUserRecord(char const* username,
 					       char const* password) {
-  fTable->Add(username, (void*)(strDup(password)));
+  char* oldPassword = (char*)(fTable->Add(username, (void*)(strDup(password))));
+  delete[] oldPassword; // if the user was already present
+  removeHA1Record(username);
 }
 
 void UserAuthenticationDatabase::removeUserRecord(char const* username) {
   char* password = (char*)(fTable->Lookup(username));
   fTable->Remove(username);
   delete[] password;
+  removeHA1Record(username);
 }
 
 char const* UserAuthenticationDatabase::lookupPassword(char const* username) {
   return (char const*)(fTable->Lookup(username));
 }
+
+Boolean UserAuthenticationDatabase::lookupHA1(char const* username, char* resultHA1) {
+  char const* password = lookupPassword(username);
+  if (password == NULL) {
+    removeHA1Record(username);
+    return False;
+  }
+
+  // Use our cached value, unless the password has changed (e.g., if a subclass's "lookupPassword()" gave a new one):
+  HA1Record* ha1Record = (HA1Record*)(fHA1Table->Lookup(username));
+  if (ha1Record == NULL || strcmp(ha1Record->password, password) != 0) {
+    removeHA1Record(username);
+    ha1Record = new HA1Record(password);
+    if (fPasswordsAreMD5) {
+      strncpy(ha1Record->ha1, password, 32);
+      ha1Record->ha1[32] = '\0'; // just in case
+    } else {
+      char const* ha1Fields[3] = { username, fRealm, password };
+      our_MD5Fields(ha1Fields, 3, ha1Record->ha1);
+    }
+    fHA1Table->Add(username, ha1Record);
+  }
+
+  memcpy(resultHA1, ha1Record->ha1, 33);
+  return True;
+}
+
+void UserAuthenticationDatabase::removeHA1Record(char const* username) {
+  HA1Record* ha1Record = (HA1Record*)(fHA1Table->Lookup(username));
+  if (ha1Record == NULL) return;
+
+  fHA1Table->Remove(username);
+  delete ha1Record;
+}
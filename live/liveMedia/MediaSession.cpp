@@ -131,6 +131,7 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
 
     // Parse the line as "m=<medium_name> <client_portNum> RTP/AVP <fmt>"
     // or "m=<medium_name> <client_portNum>/<num_ports> RTP/AVP <fmt>"
+    // (or with the "RTP/AVPF" profile (RFC 4585), which adds RTCP feedback)
     // (Should we be checking for >1 payload format number here?)#####
     char* mediumName = strDupSize(sdpLine); // ensures we have enough space
     char const* protocolName = NULL;
@@ -138,6 +139,10 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
     if ((sscanf(sdpLine, "m=%s %hu RTP/AVP %u",
 		mediumName, &subsession->fClientPortNum, &payloadFormat) == 3 ||
 	 sscanf(sdpLine, "m=%s %hu/%*u RTP/AVP %u",
+		mediumName, &subsession->fClientPortNum, &payloadFormat) == 3 ||
+	 sscanf(sdpLine, "m=%s %hu RTP/AVPF %u",
+		mediumName, &subsession->fClientPortNum, &payloadFormat) == 3 ||
+	 sscanf(sdpLine, "m=%s %hu/%*u RTP/AVPF %u",
 		mediumName, &subsession->fClientPortNum, &payloadFormat) == 3)
 	&& payloadFormat <= 127) {
       protocolName = "RTP";
@@ -207,6 +212,7 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
       if (subsession->parseSDPLine_b(sdpLine)) continue;
       if (subsession->parseSDPAttribute_rtpmap(sdpLine)) continue;
       if (subsession->parseSDPAttribute_rtcpmux(sdpLine)) continue;
+      if (subsession->parseSDPAttribute_rtcpfb(sdpLine)) continue;
       if (subsession->parseSDPAttribute_control(sdpLine)) continue;
       if (subsession->parseSDPAttribute_range(sdpLine)) continue;
       if (subsession->parseSDPAttribute_fmtp(sdpLine)) continue;
@@ -599,7 +605,8 @@ MediaSubsession::MediaSubsession(MediaSession& parent)
     fConnectionEndpointName(NULL),
     fClientPortNum(0), fRTPPayloadFormat(0xFF),
     fSavedSDPLines(NULL), fMediumName(NULL), fCodecName(NULL), fProtocolName(NULL),
-    fRTPTimestampFrequency(0), fMultiplexRTCPWithRTP(False), fControlPath(NULL),
+    fRTPTimestampFrequency(0), fMultiplexRTCPWithRTP(False),
+    fRTXPayloadFormat(0), fSupportsGenericNACK(False), fSupportsPLI(False), fSupportsFIR(False), fControlPath(NULL),
     fSourceFilterAddr(parent.sourceFilterAddr()), fBandwidth(0),
     fPlayStartTime(0.0), fPlayEndTime(0.0), fAbsStartTime(NULL), fAbsEndTime(NULL),
     fVideoWidth(0), fVideoHeight(0), fVideoFPS(0), fNumChannels(1), fScale(1.0f), fNPT_PTS_Offset(0.0f),
@@ -607,7 +614,7 @@ MediaSubsession::MediaSubsession(MediaSession& parent)
     fRTPSocket(NULL), fRTCPSocket(NULL),
     fRTPSource(NULL), fRTCPInstance(NULL), fReadSource(NULL),
     fReceiveRawMP3ADUs(False), fReceiveRawJPEGFrames(False),
-    fSessionId(NULL) {
+    fSessionId(NULL), fCPUAccount(NULL) {
   rtpInfo.seqNum = 0; rtpInfo.timestamp = 0; rtpInfo.infoIsNew = False;
 
   // A few attributes have unusual default values.  Set these now:
@@ -676,6 +683,19 @@ static Boolean const honorSDPPortChoice
 Boolean MediaSubsession::initiate(int useSpecialRTPoffset) {
   if (fReadSource != NULL) return True; // has already been initiated
 
+  // Make our "CPUAccount" (if any) current while we create our RTP and RTCP objects, so that the socket handlers
+  // and tasks that they set up are charged to it:
+  TaskScheduler& scheduler = env().taskScheduler();
+  CPUAccount* prevAccount = fCPUAccount == NULL ? NULL : scheduler.setCurrentCPUAccount(fCPUAccount);
+  Boolean result = initiate1(useSpecialRTPoffset);
+  if (fCPUAccount != NULL) scheduler.setCurrentCPUAccount(prevAccount);
+
+  if (result) setCPUAccount(fCPUAccount); // also tells our new RTP and RTCP objects
+  return result;
+}
+
+Boolean MediaSubsession::initiate1(int useSpecialRTPoffset) {
+
   do {
     if (fCodecName == NULL) {
       env().setResultMsg("Codec is unspecified");
@@ -936,6 +956,12 @@ void MediaSubsession::setDestinations(netAddressBits defaultDestAddress) {
   }
 }
 
+void MediaSubsession::setCPUAccount(CPUAccount* cpuAccount) {
+  fCPUAccount = cpuAccount;
+  if (fRTPSource != NULL) fRTPSource->setCPUAccount(cpuAccount);
+  if (fRTCPInstance != NULL) fRTCPInstance->setCPUAccount(cpuAccount);
+}
+
 void MediaSubsession::setSessionId(char const* sessionId) {
   delete[] fSessionId;
   fSessionId = strDup(sessionId);
@@ -1057,6 +1083,38 @@ Boolean MediaSubsession::parseSDPAttribute_rtcpmux(char const* sdpLine) {
   return False;
 }
 
+Boolean MediaSubsession::parseSDPAttribute_rtcpfb(char const* sdpLine) {
+  // Check for a "a=rtcp-fb:<fmt> <feedback-type>" line (where <fmt> is our payload format, or "*"):
+  Boolean parseSuccess = False;
+
+  char* fmtStr = strDupSize(sdpLine); // ensures we have enough space
+  char* feedbackStr = strDupSize(sdpLine);
+  unsigned rtcpfbPayloadFormat;
+  if (sscanf(sdpLine, "a=rtcp-fb: %s %[^\r\n]", fmtStr, feedbackStr) == 2) {
+    parseSuccess = True;
+    if (strcmp(fmtStr, "*") == 0
+	|| (sscanf(fmtStr, "%u", &rtcpfbPayloadFormat) == 1 && rtcpfbPayloadFormat == fRTPPayloadFormat)) {
+      // (Ignore any trailing white space, and case:)
+      char* p = &feedbackStr[strlen(feedbackStr)];
+      while (p > feedbackStr && (p[-1] == ' ' || p[-1] == '\t')) *--p = '\0';
+      {
+	Locale l("POSIX");
+	for (p = feedbackStr; *p != '\0'; ++p) *p = tolower(*p);
+      }
+      if (strcmp(feedbackStr, "nack") == 0) {
+	fSupportsGenericNACK = True;
+      } else if (strcmp(feedbackStr, "nack pli") == 0) {
+	fSupportsPLI = True;
+      } else if (strcmp(feedbackStr, "ccm fir") == 0) {
+	fSupportsFIR = True;
+      }
+    }
+  }
+  delete[] fmtStr; delete[] feedbackStr;
+
+  return parseSuccess;
+}
+
 Boolean MediaSubsession::parseSDPAttribute_control(char const* sdpLine) {
   // Check for a "a=control:<control-path>" line:
   Boolean parseSuccess = False;
@@ -1104,6 +1162,16 @@ Boolean MediaSubsession::parseSDPAttribute_fmtp(char const* sdpLine) {
   // Later: Check that payload format number matches; #####
   do {
     if (strncmp(sdpLine, "a=fmtp:", 7) != 0) break; sdpLine += 7;
+
+    // A retransmission stream (RFC 4588) is described by a "a=fmtp:<rtx-fmt> apt=<our fmt>[;rtx-time=<ms>]" line:
+    unsigned fmtpPayloadFormat, associatedPayloadFormat;
+    if (sscanf(sdpLine, "%u apt=%u", &fmtpPayloadFormat, &associatedPayloadFormat) == 2) {
+      if (associatedPayloadFormat == fRTPPayloadFormat && fmtpPayloadFormat != fRTPPayloadFormat
+	  && fmtpPayloadFormat <= 127) {
+	fRTXPayloadFormat = (unsigned char)fmtpPayloadFormat;
+      }
+      return True;
+    }
     while (isdigit(*sdpLine)) ++sdpLine;
 
     // The remaining "sdpLine" should be a sequence of
@@ -52,12 +52,72 @@ MultiFramedRTPSink::MultiFramedRTPSink(UsageEnvironment& env,
   : RTPSink(env, rtpGS, rtpPayloadType, rtpTimestampFrequency,
 	    rtpPayloadFormatName, numChannels),
     fOutBuf(NULL), fCurFragmentationOffset(0), fPreviousFrameEndedFragmentation(False),
-    fOnSendErrorFunc(NULL), fOnSendErrorData(NULL) {
+    fOnSendErrorFunc(NULL), fOnSendErrorData(NULL),
+    fBatchedOutput(False), fHavePacketsQueued(False), fFlushTask(NULL),
+    fRTXPayloadType(0), fRetransmissionHistorySize(0), fRetransmissionSlotSize(0), fRetransmissionHistory(NULL),
+    fRetransmittablePacketSizes(NULL), fRetransmittableSeqNums(NULL), fRTXPacket(NULL),
+    fRTXSSRC(0), fRTXSeqNo(0), fNumPacketsRetransmitted(0) {
   setPacketSizes((RTP_PAYLOAD_PREFERRED_SIZE), (RTP_PAYLOAD_MAX_SIZE));
 }
 
 MultiFramedRTPSink::~MultiFramedRTPSink() {
+  flushQueuedPackets();
   delete fOutBuf;
+  delete[] fRetransmissionHistory; delete[] fRetransmittablePacketSizes; delete[] fRetransmittableSeqNums;
+  delete[] fRTXPacket;
+}
+
+void MultiFramedRTPSink::enableRetransmissions(unsigned char rtxPayloadType, unsigned numPacketsToKeep) {
+  if (rtxPayloadType == 0 || numPacketsToKeep == 0) return; // sanity check
+
+  delete[] fRetransmissionHistory; delete[] fRetransmittablePacketSizes; delete[] fRetransmittableSeqNums;
+  delete[] fRTXPacket;
+  fRTXPayloadType = rtxPayloadType;
+  fRetransmissionHistorySize = numPacketsToKeep;
+  fRetransmissionSlotSize = fOurMaxPacketSize;
+  fRetransmissionHistory = new unsigned char[fRetransmissionHistorySize*fRetransmissionSlotSize];
+  fRetransmittablePacketSizes = new unsigned[fRetransmissionHistorySize];
+  for (unsigned i = 0; i < fRetransmissionHistorySize; ++i) fRetransmittablePacketSizes[i] = 0;
+  fRetransmittableSeqNums = new u_int16_t[fRetransmissionHistorySize];
+  fRTXPacket = new unsigned char[2 + fRetransmissionSlotSize]; // allows for the 2-byte 'original sequence number'
+
+  // The retransmission stream has its own SSRC and sequence numbers:
+  fRTXSSRC = our_random32();
+  fRTXSeqNo = (u_int16_t)our_random();
+}
+
+void MultiFramedRTPSink::setBatchedOutput(Boolean batchedOutput) {
+  if (!batchedOutput) flushQueuedPackets();
+  fBatchedOutput = batchedOutput;
+}
+
+unsigned char MultiFramedRTPSink::rtxPayloadType() const {
+  return fRTXPayloadType;
+}
+
+Boolean MultiFramedRTPSink::retransmitPacket(u_int16_t seqNum) {
+  if (fRTXPayloadType == 0) return False;
+
+  unsigned const slot = seqNum%fRetransmissionHistorySize;
+  unsigned const packetSize = fRetransmittablePacketSizes[slot];
+  if (packetSize == 0 || fRetransmittableSeqNums[slot] != seqNum) return False; // we no longer have this packet
+  unsigned char const* packet = &fRetransmissionHistory[slot*fRetransmissionSlotSize];
+
+  // A RTX packet (RFC 4588, section 4) is the original packet, but with our RTX payload type, sequence number and SSRC,
+  // and with the original sequence number in front of the payload:
+  memmove(fRTXPacket, packet, 12);
+  fRTXPacket[1] = (packet[1]&0x80)|fRTXPayloadType; // (keeps the marker bit)
+  fRTXPacket[2] = fRTXSeqNo>>8; fRTXPacket[3] = (u_int8_t)fRTXSeqNo;
+  ++fRTXSeqNo;
+  *(u_int32_t*)&fRTXPacket[8] = htonl(fRTXSSRC);
+  fRTXPacket[12] = seqNum>>8; fRTXPacket[13] = (u_int8_t)seqNum;
+  memmove(&fRTXPacket[14], &packet[12], packetSize - 12);
+
+  // Send it the same way as our other packets - behind (and along with) any that are already queued:
+  if (!sendOrQueuePacket(fRTXPacket, packetSize + 2)) return False;
+  flushQueuedPackets();
+  ++fNumPacketsRetransmitted;
+  return True;
 }
 
 void MultiFramedRTPSink
@@ -161,6 +221,7 @@ Boolean MultiFramedRTPSink::continuePlaying() {
 }
 
 void MultiFramedRTPSink::stopPlaying() {
+  flushQueuedPackets();
   fOutBuf->resetPacketStart();
   fOutBuf->resetOffset();
   fOutBuf->resetOverflowData();
@@ -220,6 +281,11 @@ void MultiFramedRTPSink::packFrame() {
   } else {
     // Normal case: we need to read a new frame from the source
     if (fSource == NULL) return;
+    if (fHavePacketsQueued && fFlushTask == NULL) {
+      // If the source doesn't deliver its frame right away, then send our queued packets while we wait.
+      // (If it does, then we'll cancel this, in "afterGettingFrame1()".)
+      fFlushTask = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)flushQueuedPackets, this);
+    }
     fSource->getNextFrame(fOutBuf->curPtr(), fOutBuf->totalBytesAvailable(),
 			  afterGettingFrame, this, ourHandleClosure, this);
   }
@@ -239,6 +305,7 @@ void MultiFramedRTPSink
 ::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes,
 		     struct timeval presentationTime,
 		     unsigned durationInMicroseconds) {
+  envir().taskScheduler().unscheduleDelayedTask(fFlushTask);
   if (fIsFirstPacket) {
     // Record the fact that we're starting to play now:
     gettimeofday(&fNextSendTime, NULL);
@@ -368,10 +435,17 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
 #ifdef TEST_LOSS
     if ((our_random()%10) != 0) // simulate 10% packet loss #####
 #endif
-      if (!fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize())) {
+      if (!sendOrQueuePacket(fOutBuf->packet(), fOutBuf->curPacketSize())) {
 	// if failure handler has been specified, call it
 	if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);
       }
+    if (fRTXPayloadType != 0 && fOutBuf->curPacketSize() <= fRetransmissionSlotSize) {
+      // Keep a copy of the packet, in case it needs to be retransmitted:
+      unsigned const slot = fSeqNo%fRetransmissionHistorySize;
+      memmove(&fRetransmissionHistory[slot*fRetransmissionSlotSize], fOutBuf->packet(), fOutBuf->curPacketSize());
+      fRetransmittablePacketSizes[slot] = fOutBuf->curPacketSize();
+      fRetransmittableSeqNums[slot] = fSeqNo;
+    }
     ++fPacketCount;
     fTotalOctetCount += fOutBuf->curPacketSize();
     fOctetCount += fOutBuf->curPacketSize()
@@ -398,6 +472,7 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
 
   if (fNoFramesLeft) {
     // We're done:
+    flushQueuedPackets();
     onSourceClosure();
   } else {
     // We have more frames left to send.  Figure out when the next frame
@@ -410,6 +485,7 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
     if (uSecondsToGo < 0 || secsDiff < 0) { // sanity check: Make sure that the time-to-delay is non-negative:
       uSecondsToGo = 0;
     }
+    if (uSecondsToGo > 0) flushQueuedPackets(); // rather than holding them back until the next packet is sent
 
     // Delay this amount of time:
     nextTask() = envir().taskScheduler().scheduleDelayedTask(uSecondsToGo, (TaskFunc*)sendNext, this);
@@ -422,6 +498,29 @@ void MultiFramedRTPSink::sendNext(void* firstArg) {
   sink->buildAndSendPacket(False);
 }
 
+Boolean MultiFramedRTPSink::sendOrQueuePacket(unsigned char* packet, unsigned packetSize) {
+  if (!fBatchedOutput) return fRTPInterface.sendPacket(packet, packetSize);
+
+  fHavePacketsQueued = True;
+  return fRTPInterface.queuePacket(packet, packetSize);
+}
+
+void MultiFramedRTPSink::flushQueuedPackets(void* firstArg) {
+  MultiFramedRTPSink* sink = (MultiFramedRTPSink*)firstArg;
+  sink->fFlushTask = NULL;
+  sink->flushQueuedPackets();
+}
+
+void MultiFramedRTPSink::flushQueuedPackets() {
+  envir().taskScheduler().unscheduleDelayedTask(fFlushTask);
+  if (!fHavePacketsQueued) return;
+
+  fHavePacketsQueued = False;
+  if (!fRTPInterface.flushPackets()) {
+    if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);
+  }
+}
+
 void MultiFramedRTPSink::ourHandleClosure(void* clientData) {
   MultiFramedRTPSink* sink = (MultiFramedRTPSink*)clientData;
   // There are no frames left, but we may have a partially built packet
@@ -22,18 +22,32 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MultiFramedRTPSource.hh"
 #include "RTCP.hh"
 #include "GroupsockHelper.hh"
+#include "FrameTrace.hh"
 #include <string.h>
+#include <math.h>
 
 ////////// ReorderingPacketBuffer definition //////////
 
+// In 'adaptive' mode, we keep a histogram of how late (relative to the arrival of the packet that followed it) each
+// out-of-order packet arrived.  Bucket "i" counts latenesses of up to LATENESS_BUCKET_0_USECONDS*(4/3)^i:
+#define NUM_LATENESS_BUCKETS 32
+#define LATENESS_BUCKET_0_USECONDS 250
+#define LATENESS_HALF_LIFE_USECONDS 10000000 /* older samples count for less */
+#define ADAPTIVE_THRESHOLD_UPDATE_INTERVAL_USECONDS 100000
+#define MIN_ADAPTIVE_THRESHOLD_USECONDS 1000
+#define ADAPTIVE_THRESHOLD_JITTER_MULTIPLE 2
+
 class ReorderingPacketBuffer {
 public:
-  ReorderingPacketBuffer(BufferedPacketFactory* packetFactory);
+  ReorderingPacketBuffer(MultiFramedRTPSource* ourSource, BufferedPacketFactory* packetFactory);
   virtual ~ReorderingPacketBuffer();
   void reset();
 
   BufferedPacket* getFreePacket(MultiFramedRTPSource* ourSource);
-  Boolean storePacket(BufferedPacket* bPacket);
+  Boolean storePacket(BufferedPacket* bPacket, Boolean& followsMissingPacket);
+      // "followsMissingPacket" is set True iff the packet arrived in order, but after a gap in the sequence numbers
+  unsigned getMissingSeqNums(u_int16_t* seqNums, unsigned maxNumSeqNums) const;
+      // the sequence numbers of the packets that we're still waiting for
   BufferedPacket* getNextCompletedPacket(Boolean& packetLossPreceded);
   void releaseUsedPacket(BufferedPacket* packet);
   void freePacket(BufferedPacket* packet) {
@@ -44,13 +58,40 @@ public:
     }
   }
   Boolean isEmpty() const { return fHeadPacket == NULL; }
+  unsigned numPackets() const { return fNumPackets; }
+
+  void setThresholdTime(unsigned uSeconds) { fThresholdTime = uSeconds; fIsAdaptive = False; }
+  void setAdaptive(unsigned maxThresholdUSeconds, double lateFraction);
+  unsigned thresholdTime();
+  unsigned uSecondsUntilGiveUp(); // for the packet at the head of the queue
+  unsigned numLatePackets() const { return fNumLatePackets; }
+  void resetHaveSeenFirstPacket() { fHaveSeenFirstPacket = False; fHaveGivenUp = False; }
 
-  void setThresholdTime(unsigned uSeconds) { fThresholdTime = uSeconds; }
-  void resetHaveSeenFirstPacket() { fHaveSeenFirstPacket = False; }
+private:
+  void decayLateness(struct timeval const& timeNow);
+  void noteLateness(struct timeval const& timeNow, struct timeval const& timeExpected);
+  void updateAdaptiveThreshold(struct timeval const& timeNow);
 
 private:
+  MultiFramedRTPSource* fOurSource;
   BufferedPacketFactory* fPacketFactory;
   unsigned fThresholdTime; // uSeconds
+  unsigned fNumLatePackets; // that arrived after we'd given up on them
+
+  // 'Adaptive' mode state:
+  Boolean fIsAdaptive;
+  unsigned fMaxThresholdTime; // uSeconds
+  double fLateFraction;
+  double fLatenessWeight[NUM_LATENESS_BUCKETS];
+  struct timeval fLastLatenessDecayTime;
+  struct timeval fLastThresholdUpdateTime;
+  Boolean fThresholdNeedsUpdate;
+  // The packets that we most recently gave up waiting for - [fGaveUpFromSeqNo, fGaveUpToSeqNo) - and when we'd started
+  // waiting for them:
+  Boolean fHaveGivenUp;
+  unsigned short fGaveUpFromSeqNo, fGaveUpToSeqNo;
+  struct timeval fGaveUpWaitStartTime;
+
   Boolean fHaveSeenFirstPacket; // used to set initial "fNextExpectedSeqNo"
   unsigned short fNextExpectedSeqNo;
   BufferedPacket* fHeadPacket;
@@ -58,6 +99,29 @@ private:
   BufferedPacket* fSavedPacket;
       // to avoid calling new/free in the common case
   Boolean fSavedPacketFree;
+  unsigned fNumPackets; // in the queue
+};
+
+
+////////// NACKRecord definition //////////
+
+// Which missing packets we've asked the sender to retransmit, and when:
+#define NACK_TABLE_SIZE 1024 /* indexed by sequence number (modulo this, which must divide 65536) */
+#define MAX_NACKS_PER_PACKET 3
+#define MAX_NACKS_PER_REQUEST 256
+#define NACK_RECORD_LIFETIME_USECONDS 5000000
+#define DEFAULT_RETRANSMISSION_RTT_USECONDS 20000 /* until we've measured it */
+#define MIN_NACK_RETRY_INTERVAL_USECONDS 10000
+#define MIN_KEY_FRAME_REQUEST_INTERVAL_USECONDS 500000
+#define MAX_NACKABLE_GAP 512 /* a bigger jump in sequence numbers is probably a discontinuity, not packet loss */
+
+class NACKRecord {
+public:
+  NACKRecord() : numRequests(0) {}
+
+  u_int16_t seqNum;
+  unsigned numRequests;
+  struct timeval timeLastRequested;
 };
 
 
@@ -70,7 +134,16 @@ MultiFramedRTPSource
 		       BufferedPacketFactory* packetFactory)
   : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency) {
   reset();
-  fReorderingBuffer = new ReorderingPacketBuffer(packetFactory);
+  fReorderingTimeoutTask = NULL;
+  fReorderingBuffer = new ReorderingPacketBuffer(this, packetFactory);
+
+  fFeedbackRTCPInstance = NULL;
+  fRTXPayloadFormat = 0;
+  fSendNACKs = fSendPLIs = fSendFIRs = False;
+  fNACKTask = NULL;
+  fNACKRecords = NULL;
+  fRetransmissionRTT = DEFAULT_RETRANSMISSION_RTT_USECONDS;
+  fNumPacketsNACKed = fNumPacketsRetransmitted = fNumKeyFrameRequests = 0;
 
   // Try to use a big receive buffer for RTP:
   increaseReceiveBufferTo(env, RTPgs->socketNum(), 50*1024);
@@ -86,7 +159,10 @@ void MultiFramedRTPSource::reset() {
 }
 
 MultiFramedRTPSource::~MultiFramedRTPSource() {
+  envir().taskScheduler().unscheduleDelayedTask(fReorderingTimeoutTask);
+  envir().taskScheduler().unscheduleDelayedTask(fNACKTask);
   delete fReorderingBuffer;
+  delete[] fNACKRecords;
 }
 
 Boolean MultiFramedRTPSource
@@ -110,6 +186,8 @@ void MultiFramedRTPSource::doStopGettingFrames() {
     fPacketReadInProgress = NULL;
   }
   envir().taskScheduler().unscheduleDelayedTask(nextTask());
+  envir().taskScheduler().unscheduleDelayedTask(fReorderingTimeoutTask);
+  envir().taskScheduler().unscheduleDelayedTask(fNACKTask);
   fRTPInterface.stopNetworkReading();
   fReorderingBuffer->reset();
   reset();
@@ -138,6 +216,12 @@ void MultiFramedRTPSource::doGetNextFrame1() {
     BufferedPacket* nextPacket
       = fReorderingBuffer->getNextCompletedPacket(packetLossPrecededThis);
     if (nextPacket == NULL) break;
+    if (packetLossPrecededThis && !nextPacket->isFirstPacket() && fFeedbackRTCPInstance != NULL) {
+      // We've given up on a missing packet, so the decoder won't recover until the next key frame.  Ask for one now:
+      requestKeyFrame();
+    }
+    FRAME_TRACE_INSTANT("reorder release", FrameTrace::frameIdFromPresentationTime(nextPacket->presentationTime()),
+			"seq", nextPacket->rtpSeqNo());
 
     fNeedDelivery = False;
 
@@ -190,6 +274,7 @@ void MultiFramedRTPSource::doGetNextFrame1() {
 
     if (fCurrentPacketCompletesFrame && fFrameSize > 0) {
       // We have all the data that the client wants.
+      FRAME_TRACE_INSTANT("frame complete", FrameTrace::frameIdFromPresentationTime(fPresentationTime), "size", fFrameSize);
       if (fNumTruncatedBytes > 0) {
 	envir() << "MultiFramedRTPSource::doGetNextFrame1(): The total received frame size exceeds the client's buffer size ("
 		<< fSavedMaxSize << ").  "
@@ -213,6 +298,23 @@ void MultiFramedRTPSource::doGetNextFrame1() {
       fNeedDelivery = True;
     }
   }
+
+  // If we're waiting for a missing packet, then make sure that we stop waiting on time, even if no more packets arrive:
+  if (fReorderingTimeoutTask != NULL) envir().taskScheduler().unscheduleDelayedTask(fReorderingTimeoutTask);
+  if (fNeedDelivery && !fReorderingBuffer->isEmpty()) {
+    fReorderingTimeoutTask
+      = envir().taskScheduler().scheduleDelayedTask(fReorderingBuffer->uSecondsUntilGiveUp(),
+						    (TaskFunc*)reorderingTimeoutHandler, this);
+  }
+}
+
+void MultiFramedRTPSource::reorderingTimeoutHandler(MultiFramedRTPSource* source) {
+  source->fReorderingTimeoutTask = NULL;
+  source->doGetNextFrame1(); // gives up on the missing packet (if it still hasn't arrived)
+}
+
+unsigned MultiFramedRTPSource::numPacketsInReorderingBuffer() const {
+  return fReorderingBuffer->numPackets();
 }
 
 void MultiFramedRTPSource
@@ -220,6 +322,123 @@ void MultiFramedRTPSource
   fReorderingBuffer->setThresholdTime(uSeconds);
 }
 
+void MultiFramedRTPSource
+::setAdaptivePacketReordering(unsigned maxThresholdUSeconds, double lateFraction) {
+  fReorderingBuffer->setAdaptive(maxThresholdUSeconds, lateFraction);
+}
+
+unsigned MultiFramedRTPSource::packetReorderingThresholdTime() const {
+  return fReorderingBuffer->thresholdTime();
+}
+
+unsigned MultiFramedRTPSource::numPacketsArrivedTooLate() const {
+  return fReorderingBuffer->numLatePackets();
+}
+
+void MultiFramedRTPSource
+::enableRetransmissionRequests(RTCPInstance* rtcpInstance, unsigned char rtxPayloadFormat,
+			       Boolean sendNACKs, Boolean sendPLIs, Boolean sendFIRs) {
+  fFeedbackRTCPInstance = rtcpInstance;
+  fRTXPayloadFormat = rtxPayloadFormat;
+  fSendNACKs = sendNACKs;
+  fSendPLIs = sendPLIs;
+  fSendFIRs = sendFIRs;
+  if (fSendNACKs && fNACKRecords == NULL) fNACKRecords = new NACKRecord[NACK_TABLE_SIZE];
+}
+
+unsigned MultiFramedRTPSource::numPacketsNACKed() const {
+  return fNumPacketsNACKed;
+}
+
+unsigned MultiFramedRTPSource::numPacketsRetransmitted() const {
+  return fNumPacketsRetransmitted;
+}
+
+unsigned MultiFramedRTPSource::numKeyFrameRequests() const {
+  return fNumKeyFrameRequests;
+}
+
+void MultiFramedRTPSource::sendNACKsHandler(MultiFramedRTPSource* source) {
+  source->fNACKTask = NULL;
+  source->sendNACKs();
+}
+
+void MultiFramedRTPSource::sendNACKs() {
+  envir().taskScheduler().unscheduleDelayedTask(fNACKTask);
+  if (fFeedbackRTCPInstance == NULL || !fSendNACKs) return;
+
+  u_int16_t missingSeqNums[MAX_NACKS_PER_REQUEST];
+  unsigned const numMissing = fReorderingBuffer->getMissingSeqNums(missingSeqNums, MAX_NACKS_PER_REQUEST);
+
+  // Ask for each missing packet that we haven't asked for yet, and again for each that we asked for more than a couple
+  // of round-trip times ago (in case the request, or the retransmission, was lost too):
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  unsigned retryInterval = 2*fRetransmissionRTT;
+  if (retryInterval < MIN_NACK_RETRY_INTERVAL_USECONDS) retryInterval = MIN_NACK_RETRY_INTERVAL_USECONDS;
+  u_int16_t seqNumsToRequest[MAX_NACKS_PER_REQUEST];
+  unsigned numToRequest = 0;
+  unsigned uSecondsUntilNextRetry = 0; // 0 means: there won't be any
+  for (unsigned i = 0; i < numMissing; ++i) {
+    NACKRecord& record = fNACKRecords[missingSeqNums[i]%NACK_TABLE_SIZE];
+    unsigned uSecondsSinceRequested = 0;
+    if (record.numRequests > 0) {
+      uSecondsSinceRequested = (timeNow.tv_sec - record.timeLastRequested.tv_sec)*1000000
+	+ (timeNow.tv_usec - record.timeLastRequested.tv_usec);
+      if (record.seqNum != missingSeqNums[i] || uSecondsSinceRequested > NACK_RECORD_LIFETIME_USECONDS) {
+	record.numRequests = 0; // this record was for an older packet
+      }
+    }
+    record.seqNum = missingSeqNums[i];
+
+    if (record.numRequests >= MAX_NACKS_PER_PACKET) continue; // we've given up asking for this one
+    if (record.numRequests > 0 && uSecondsSinceRequested < retryInterval) {
+      unsigned const uSecondsUntilRetry = retryInterval - uSecondsSinceRequested;
+      if (uSecondsUntilNextRetry == 0 || uSecondsUntilRetry < uSecondsUntilNextRetry) {
+	uSecondsUntilNextRetry = uSecondsUntilRetry;
+      }
+      continue;
+    }
+
+    seqNumsToRequest[numToRequest++] = record.seqNum;
+    ++record.numRequests;
+    record.timeLastRequested = timeNow;
+    if (record.numRequests < MAX_NACKS_PER_PACKET
+	&& (uSecondsUntilNextRetry == 0 || retryInterval < uSecondsUntilNextRetry)) {
+      uSecondsUntilNextRetry = retryInterval;
+    }
+  }
+
+  if (numToRequest > 0) {
+    fFeedbackRTCPInstance->sendGenericNACK(fLastReceivedSSRC, seqNumsToRequest, numToRequest);
+    fNumPacketsNACKed += numToRequest;
+  }
+  if (uSecondsUntilNextRetry > 0) {
+    fNACKTask = envir().taskScheduler().scheduleDelayedTask(uSecondsUntilNextRetry, (TaskFunc*)sendNACKsHandler, this);
+  }
+}
+
+void MultiFramedRTPSource::requestKeyFrame() {
+  if (!fSendPLIs && !fSendFIRs) return;
+
+  // Don't ask again until the sender has had a chance to respond:
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  if (fNumKeyFrameRequests > 0) {
+    unsigned uSecondsSinceRequested = (timeNow.tv_sec - fLastKeyFrameRequestTime.tv_sec)*1000000
+      + (timeNow.tv_usec - fLastKeyFrameRequestTime.tv_usec);
+    if (uSecondsSinceRequested < MIN_KEY_FRAME_REQUEST_INTERVAL_USECONDS) return;
+  }
+
+  if (fSendPLIs) {
+    fFeedbackRTCPInstance->sendPLI(fLastReceivedSSRC);
+  } else {
+    fFeedbackRTCPInstance->sendFIR(fLastReceivedSSRC);
+  }
+  ++fNumKeyFrameRequests;
+  fLastKeyFrameRequestTime = timeNow;
+}
+
 #define ADVANCE(n) do { bPacket->skip(n); } while (0)
 
 void MultiFramedRTPSource::networkReadHandler(MultiFramedRTPSource* source, int /*mask*/) {
@@ -252,6 +471,7 @@ void MultiFramedRTPSource::networkReadHandler1() {
     } else {
       fPacketReadInProgress = NULL;
     }
+    fRTPInterface.notePacketRead(bPacket->data(), bPacket->dataSize());
 #ifdef TEST_LOSS
     setPacketReorderingThresholdTime(0);
        // don't wait for 'lost' packets to arrive out-of-order later
@@ -270,7 +490,8 @@ void MultiFramedRTPSource::networkReadHandler1() {
 
     // Check the Payload Type.
     unsigned char rtpPayloadType = (unsigned char)((rtpHdr&0x007F0000)>>16);
-    if (rtpPayloadType != rtpPayloadFormat()) {
+    Boolean isRetransmission = fRTXPayloadFormat != 0 && rtpPayloadType == fRTXPayloadFormat;
+    if (rtpPayloadType != rtpPayloadFormat() && !isRetransmission) {
       if (fRTCPInstanceForMultiplexedRTCPPackets != NULL
 	  && rtpPayloadType >= 64 && rtpPayloadType <= 95) {
 	// This is a multiplexed RTCP packet, and we've been asked to deliver such packets.
@@ -304,6 +525,27 @@ void MultiFramedRTPSource::networkReadHandler1() {
       bPacket->removePadding(numPaddingBytes);
     }
 
+    unsigned short rtpSeqNo = (unsigned short)(rtpHdr&0xFFFF);
+    if (isRetransmission) {
+      // This packet was retransmitted (RFC 4588) - in its own stream - because we NACKed it.  Its payload begins with
+      // its original sequence number; after that, it's the original packet (from the stream that we're receiving):
+      if (bPacket->dataSize() < 2) break;
+      rtpSeqNo = (bPacket->data()[0]<<8)|bPacket->data()[1]; ADVANCE(2);
+      rtpSSRC = fLastReceivedSSRC;
+      ++fNumPacketsRetransmitted;
+
+      NACKRecord* record = fNACKRecords == NULL ? NULL : &fNACKRecords[rtpSeqNo%NACK_TABLE_SIZE];
+      if (record != NULL && record->numRequests == 1 && record->seqNum == rtpSeqNo) {
+	// Update our estimate of the round-trip time for retransmissions.  (If we'd asked more than once, then we
+	// wouldn't know which request this was the response to.)
+	struct timeval timeNow;
+	gettimeofday(&timeNow, NULL);
+	int rtt = (timeNow.tv_sec - record->timeLastRequested.tv_sec)*1000000
+	  + (timeNow.tv_usec - record->timeLastRequested.tv_usec);
+	if (rtt >= 0) fRetransmissionRTT = (7*fRetransmissionRTT + rtt)/8;
+      }
+    }
+
     // The rest of the packet is the usable data.  Record and save it:
     if (rtpSSRC != fLastReceivedSSRC) {
       // The SSRC of incoming packets has changed.  Unfortunately we don't yet handle streams that contain multiple SSRCs,
@@ -311,10 +553,9 @@ void MultiFramedRTPSource::networkReadHandler1() {
       fLastReceivedSSRC = rtpSSRC;
       fReorderingBuffer->resetHaveSeenFirstPacket();
     }
-    unsigned short rtpSeqNo = (unsigned short)(rtpHdr&0xFFFF);
     Boolean usableInJitterCalculation
-      = packetIsUsableInJitterCalculation((bPacket->data()),
-						  bPacket->dataSize());
+      = !isRetransmission && packetIsUsableInJitterCalculation((bPacket->data()),
+							       bPacket->dataSize());
     struct timeval presentationTime; // computed by:
     Boolean hasBeenSyncedUsingRTCP; // computed by:
     receptionStatsDB()
@@ -329,7 +570,14 @@ void MultiFramedRTPSource::networkReadHandler1() {
     bPacket->assignMiscParams(rtpSeqNo, rtpTimestamp, presentationTime,
 			      hasBeenSyncedUsingRTCP, rtpMarkerBit,
 			      timeNow);
-    if (!fReorderingBuffer->storePacket(bPacket)) break;
+    Boolean followsMissingPacket;
+    if (!fReorderingBuffer->storePacket(bPacket, followsMissingPacket)) break;
+    if (followsMissingPacket && fSendNACKs) {
+      // Ask for the missing packet(s) - together with any others that we find missing - as soon as we return to the
+      // event loop:
+      envir().taskScheduler().rescheduleDelayedTask(fNACKTask, 0, (TaskFunc*)sendNACKsHandler, this);
+    }
+    FRAME_TRACE_INSTANT("rtp packet", FrameTrace::frameIdFromPresentationTime(presentationTime), "seq", rtpSeqNo);
 
     readSuccess = True;
   } while (0);
@@ -486,9 +734,12 @@ BufferedPacket* BufferedPacketFactory
 ////////// ReorderingPacketBuffer implementation //////////
 
 ReorderingPacketBuffer
-::ReorderingPacketBuffer(BufferedPacketFactory* packetFactory)
-  : fThresholdTime(100000) /* default reordering threshold: 100 ms */,
-    fHaveSeenFirstPacket(False), fHeadPacket(NULL), fTailPacket(NULL), fSavedPacket(NULL), fSavedPacketFree(True) {
+::ReorderingPacketBuffer(MultiFramedRTPSource* ourSource, BufferedPacketFactory* packetFactory)
+  : fOurSource(ourSource),
+    fThresholdTime(100000) /* default reordering threshold: 100 ms */, fNumLatePackets(0),
+    fIsAdaptive(False), fMaxThresholdTime(0), fLateFraction(0.0), fThresholdNeedsUpdate(False), fHaveGivenUp(False),
+    fHaveSeenFirstPacket(False), fHeadPacket(NULL), fTailPacket(NULL), fSavedPacket(NULL), fSavedPacketFree(True),
+    fNumPackets(0) {
   fPacketFactory = (packetFactory == NULL)
     ? (new BufferedPacketFactory)
     : packetFactory;
@@ -504,6 +755,103 @@ void ReorderingPacketBuffer::reset() {
   delete fHeadPacket; // will also delete fSavedPacket if it's in the list
   resetHaveSeenFirstPacket();
   fHeadPacket = fTailPacket = fSavedPacket = NULL;
+  fNumPackets = 0;
+}
+
+void ReorderingPacketBuffer::setAdaptive(unsigned maxThresholdUSeconds, double lateFraction) {
+  fIsAdaptive = True;
+  fMaxThresholdTime = maxThresholdUSeconds;
+  fLateFraction = lateFraction;
+
+  // Until we've seen some out-of-order packets, assume that there aren't any:
+  for (unsigned i = 0; i < NUM_LATENESS_BUCKETS; ++i) fLatenessWeight[i] = 0.0;
+  gettimeofday(&fLastLatenessDecayTime, NULL);
+  fThresholdNeedsUpdate = True;
+}
+
+unsigned ReorderingPacketBuffer::thresholdTime() {
+  if (fIsAdaptive) {
+    struct timeval timeNow;
+    gettimeofday(&timeNow, NULL);
+    updateAdaptiveThreshold(timeNow);
+  }
+  return fThresholdTime;
+}
+
+unsigned ReorderingPacketBuffer::uSecondsUntilGiveUp() {
+  if (fHeadPacket == NULL) return 0;
+
+  unsigned const threshold = thresholdTime();
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  unsigned uSecondsSinceReceived
+    = (timeNow.tv_sec - fHeadPacket->timeReceived().tv_sec)*1000000
+    + (timeNow.tv_usec - fHeadPacket->timeReceived().tv_usec);
+  return uSecondsSinceReceived > threshold ? 0 : threshold - uSecondsSinceReceived + 1;
+}
+
+void ReorderingPacketBuffer::decayLateness(struct timeval const& timeNow) {
+  double uSecondsSinceDecay = (timeNow.tv_sec - fLastLatenessDecayTime.tv_sec)*1000000.0
+    + (timeNow.tv_usec - fLastLatenessDecayTime.tv_usec);
+  if (uSecondsSinceDecay < ADAPTIVE_THRESHOLD_UPDATE_INTERVAL_USECONDS) return;
+
+  double const decay = pow(0.5, uSecondsSinceDecay/LATENESS_HALF_LIFE_USECONDS);
+  for (unsigned i = 0; i < NUM_LATENESS_BUCKETS; ++i) fLatenessWeight[i] *= decay;
+  fLastLatenessDecayTime = timeNow;
+}
+
+void ReorderingPacketBuffer::noteLateness(struct timeval const& timeNow, struct timeval const& timeExpected) {
+  if (!fIsAdaptive) return;
+
+  decayLateness(timeNow); // age the existing samples first
+  double lateness = (timeNow.tv_sec - timeExpected.tv_sec)*1000000.0 + (timeNow.tv_usec - timeExpected.tv_usec);
+  unsigned i = 0;
+  for (double bucketLimit = LATENESS_BUCKET_0_USECONDS; lateness > bucketLimit && i < NUM_LATENESS_BUCKETS-1;
+       bucketLimit *= 4.0/3) {
+    ++i;
+  }
+  fLatenessWeight[i] += 1.0;
+  fThresholdNeedsUpdate = True;
+}
+
+void ReorderingPacketBuffer::updateAdaptiveThreshold(struct timeval const& timeNow) {
+  // Update at most every ADAPTIVE_THRESHOLD_UPDATE_INTERVAL_USECONDS (because the jitter also changes), or after a new
+  // lateness sample:
+  if (!fThresholdNeedsUpdate) {
+    int uSecondsSinceUpdate = (timeNow.tv_sec - fLastThresholdUpdateTime.tv_sec)*1000000
+      + (timeNow.tv_usec - fLastThresholdUpdateTime.tv_usec);
+    if (uSecondsSinceUpdate < ADAPTIVE_THRESHOLD_UPDATE_INTERVAL_USECONDS) return;
+  }
+  fThresholdNeedsUpdate = False;
+  fLastThresholdUpdateTime = timeNow;
+  decayLateness(timeNow);
+
+  // Wait long enough that no more than "fLateFraction" of (recently seen) out-of-order packets would have arrived too
+  // late.  (The weight of one in-order packet keeps a single, decaying, sample from keeping the threshold high forever.)
+  double totalWeight = 1.0;
+  for (unsigned i = 0; i < NUM_LATENESS_BUCKETS; ++i) totalWeight += fLatenessWeight[i];
+  double const allowedLateWeight = fLateFraction*totalWeight;
+
+  double threshold = 0.0;
+  double weightAbove = totalWeight - 1.0; // of the samples that are later than "threshold"
+  double bucketLimit = LATENESS_BUCKET_0_USECONDS;
+  for (unsigned i = 0; weightAbove > allowedLateWeight && i < NUM_LATENESS_BUCKETS; ++i) {
+    weightAbove -= fLatenessWeight[i];
+    threshold = bucketLimit;
+    bucketLimit *= 4.0/3;
+  }
+
+  // But don't wait less than a few times the interarrival jitter (converted to microseconds):
+  RTPReceptionStats* stats = fOurSource->receptionStatsDB().lookup(fOurSource->lastReceivedSSRC());
+  if (stats != NULL && fOurSource->timestampFrequency() > 0) {
+    double const jitterThreshold
+      = ADAPTIVE_THRESHOLD_JITTER_MULTIPLE*(stats->jitter()*1000000.0/fOurSource->timestampFrequency());
+    if (jitterThreshold > threshold) threshold = jitterThreshold;
+  }
+
+  if (threshold < MIN_ADAPTIVE_THRESHOLD_USECONDS) threshold = MIN_ADAPTIVE_THRESHOLD_USECONDS;
+  if (threshold > fMaxThresholdTime) threshold = fMaxThresholdTime;
+  fThresholdTime = (unsigned)threshold;
 }
 
 BufferedPacket* ReorderingPacketBuffer::getFreePacket(MultiFramedRTPSource* ourSource) {
@@ -520,8 +868,9 @@ BufferedPacket* ReorderingPacketBuffer::getFreePacket(MultiFramedRTPSource* ourS
   }
 }
 
-Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
+Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket, Boolean& followsMissingPacket) {
   unsigned short rtpSeqNo = bPacket->rtpSeqNo();
+  followsMissingPacket = False;
 
   if (!fHaveSeenFirstPacket) {
     fNextExpectedSeqNo = rtpSeqNo; // initialization
@@ -531,20 +880,31 @@ Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
 
   // Ignore this packet if its sequence number is less than the one
   // that we're looking for (in this case, it's been excessively delayed).
-  if (seqNumLT(rtpSeqNo, fNextExpectedSeqNo)) return False;
+  if (seqNumLT(rtpSeqNo, fNextExpectedSeqNo)) {
+    if (fHaveGivenUp && !seqNumLT(rtpSeqNo, fGaveUpFromSeqNo) && seqNumLT(rtpSeqNo, fGaveUpToSeqNo)) {
+      // We'd stopped waiting for this packet too soon:
+      ++fNumLatePackets;
+      noteLateness(bPacket->timeReceived(), fGaveUpWaitStartTime);
+    }
+    return False;
+  }
 
   if (fTailPacket == NULL) {
     // Common case: There are no packets in the queue; this will be the first one:
+    followsMissingPacket = rtpSeqNo != fNextExpectedSeqNo;
     bPacket->nextPacket() = NULL;
     fHeadPacket = fTailPacket = bPacket;
+    ++fNumPackets;
     return True;
   }
 
   if (seqNumLT(fTailPacket->rtpSeqNo(), rtpSeqNo)) {
     // The next-most common case: There are packets already in the queue; this packet arrived in order => put it at the tail:
+    followsMissingPacket = rtpSeqNo != (unsigned short)(fTailPacket->rtpSeqNo() + 1);
     bPacket->nextPacket() = NULL;
     fTailPacket->nextPacket() = bPacket;
     fTailPacket = bPacket;
+    ++fNumPackets;
     return True;
   } 
 
@@ -567,6 +927,10 @@ Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
     afterPtr = afterPtr->nextPacket();
   }
 
+  // Note how long after the next packet this one arrived.  (Unless there were also earlier packets missing, this is how
+  // long we had to wait for it.)
+  if (afterPtr != NULL) noteLateness(bPacket->timeReceived(), afterPtr->timeReceived());
+
   // Link our new packet between "beforePtr" and "afterPtr":
   bPacket->nextPacket() = afterPtr;
   if (beforePtr == NULL) {
@@ -574,10 +938,29 @@ Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
   } else {
     beforePtr->nextPacket() = bPacket;
   }
+  ++fNumPackets;
 
   return True;
 }
 
+unsigned ReorderingPacketBuffer::getMissingSeqNums(u_int16_t* seqNums, unsigned maxNumSeqNums) const {
+  // Look for gaps - before the head packet, and between each pair of packets - in our queue:
+  unsigned numSeqNums = 0;
+  unsigned short expectedSeqNo = fNextExpectedSeqNo;
+  for (BufferedPacket* packet = fHeadPacket; packet != NULL; packet = packet->nextPacket()) {
+    unsigned short const gapSize = packet->rtpSeqNo() - expectedSeqNo;
+    if (gapSize <= MAX_NACKABLE_GAP) {
+      for (unsigned short i = 0; i < gapSize; ++i) {
+	if (numSeqNums == maxNumSeqNums) return numSeqNums;
+	seqNums[numSeqNums++] = expectedSeqNo + i;
+      }
+    }
+    expectedSeqNo = packet->rtpSeqNo() + 1;
+  }
+
+  return numSeqNums;
+}
+
 void ReorderingPacketBuffer::releaseUsedPacket(BufferedPacket* packet) {
   // ASSERT: packet == fHeadPacket
   // ASSERT: fNextExpectedSeqNo == packet->rtpSeqNo()
@@ -587,6 +970,7 @@ void ReorderingPacketBuffer::releaseUsedPacket(BufferedPacket* packet) {
   if (!fHeadPacket) { 
     fTailPacket = NULL;
   }
+  --fNumPackets;
   packet->nextPacket() = NULL;
 
   freePacket(packet);
@@ -609,17 +993,22 @@ BufferedPacket* ReorderingPacketBuffer
   // our time threshold has been exceeded, then forget it, and return
   // the head packet instead:
   Boolean timeThresholdHasBeenExceeded;
-  if (fThresholdTime == 0) {
+  if (fThresholdTime == 0 && !fIsAdaptive) {
     timeThresholdHasBeenExceeded = True; // optimization
   } else {
     struct timeval timeNow;
     gettimeofday(&timeNow, NULL);
+    if (fIsAdaptive) updateAdaptiveThreshold(timeNow);
     unsigned uSecondsSinceReceived
       = (timeNow.tv_sec - fHeadPacket->timeReceived().tv_sec)*1000000
       + (timeNow.tv_usec - fHeadPacket->timeReceived().tv_usec);
     timeThresholdHasBeenExceeded = uSecondsSinceReceived > fThresholdTime;
   }
   if (timeThresholdHasBeenExceeded) {
+    fHaveGivenUp = True;
+    fGaveUpFromSeqNo = fNextExpectedSeqNo;
+    fGaveUpToSeqNo = fHeadPacket->rtpSeqNo();
+    fGaveUpWaitStartTime = fHeadPacket->timeReceived();
     fNextExpectedSeqNo = fHeadPacket->rtpSeqNo();
         // we've given up on earlier packets now
     packetLossPreceded = True;
@@ -433,35 +433,57 @@ void OnDemandServerMediaSubsession
   char const* auxSDPLine = getAuxSDPLine(rtpSink, inputSource);
   if (auxSDPLine == NULL) auxSDPLine = "";
 
+  // If the sink retransmits lost packets (when asked to by a RTCP "Generic NACK"), then describe its retransmission
+  // stream (RFC 4588), and the feedback that we accept (RFC 4585).  (We keep the "RTP/AVP" profile, because clients that
+  // don't know "RTP/AVPF" would reject the stream; they just ignore these extra lines.)
+  char rtxPayloadTypeStr[5] = "";
+  char rtxLines[200] = "";
+  unsigned char rtxPayloadType = rtpSink->rtxPayloadType();
+  if (rtxPayloadType != 0) {
+    sprintf(rtxPayloadTypeStr, " %d", rtxPayloadType);
+    sprintf(rtxLines,
+	    "a=rtpmap:%d rtx/%u\r\n"
+	    "a=fmtp:%d apt=%d\r\n"
+	    "a=rtcp-fb:%d nack\r\n",
+	    rtxPayloadType, rtpSink->rtpTimestampFrequency(),
+	    rtxPayloadType, rtpPayloadType,
+	    rtpPayloadType);
+  }
+
   char const* const sdpFmt =
-    "m=%s %u RTP/AVP %d\r\n"
+    "m=%s %u RTP/AVP %d%s\r\n"
     "c=IN IP4 %s\r\n"
     "b=AS:%u\r\n"
     "%s"
     "%s"
     "%s"
     "%s"
+    "%s"
     "a=control:%s\r\n";
   unsigned sdpFmtSize = strlen(sdpFmt)
     + strlen(mediaType) + 5 /* max short len */ + 3 /* max char len */
+    + strlen(rtxPayloadTypeStr)
     + strlen(ipAddressStr.val())
     + 20 /* max int len */
     + strlen(rtpmapLine)
     + strlen(rtcpmuxLine)
     + strlen(rangeLine)
     + strlen(auxSDPLine)
+    + strlen(rtxLines)
     + strlen(trackId());
   char* sdpLines = new char[sdpFmtSize];
   sprintf(sdpLines, sdpFmt,
 	  mediaType, // m= <media>
 	  fPortNumForSDP, // m= <port>
 	  rtpPayloadType, // m= <fmt list>
+	  rtxPayloadTypeStr, // m= <fmt list> (continued, if we retransmit)
 	  ipAddressStr.val(), // c= address
 	  estBitrate, // b=AS:<bandwidth>
 	  rtpmapLine, // a=rtpmap:... (if present)
 	  rtcpmuxLine, // a=rtcp-mux:... (if present)
 	  rangeLine, // a=range:... (if present)
 	  auxSDPLine, // optional extra SDP line
+	  rtxLines, // a=rtpmap:... a=fmtp:... a=rtcp-fb:... (if we retransmit)
 	  trackId()); // a=control:<track-id>
   delete[] (char*)rangeLine; delete[] rtpmapLine;
 
@@ -23,6 +23,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "GroupsockHelper.hh"
 #include "InputFile.hh"
 #include "OutputFile.hh"
+#include "AsyncFileIO.hh"
 #include "H263plusVideoRTPSource.hh" // for the special header
 #include "MPEG4GenericRTPSource.hh" //for "samplingFrequencyFromAudioSpecificConfig()"
 #include "MPEG4LATMAudioRTPSource.hh" // for "parseGeneralConfigStr()"
@@ -227,7 +228,7 @@ QuickTimeFileSink::QuickTimeFileSink(UsageEnvironment& env,
 				     Boolean syncStreams,
 				     Boolean generateHintTracks,
 				     Boolean generateMP4Format)
-  : Medium(env), fInputSession(inputSession),
+  : Medium(env), fInputSession(inputSession), fAsyncFileIO(NULL), fWriteHasFailed(False),
     fBufferSize(bufferSize), fPacketLossCompensate(packetLossCompensate),
     fSyncStreams(syncStreams), fGenerateMP4Format(generateMP4Format),
     fAreCurrentlyBeingPlayed(False),
@@ -239,6 +240,9 @@ QuickTimeFileSink::QuickTimeFileSink(UsageEnvironment& env,
   fOutFid = OpenOutputFile(env, outputFileName);
   if (fOutFid == NULL) return;
 
+  // Write frame data asynchronously, if we can, so that a slow disk doesn't stall the event loop:
+  if (fOutFid != stdout && fOutFid != stderr) fAsyncFileIO = AsyncFileIO::getInstance(env);
+
   fNewestSyncTime.tv_sec = fNewestSyncTime.tv_usec = 0;
   fFirstDataTime.tv_sec = fFirstDataTime.tv_usec = (unsigned)(~0);
 
@@ -329,6 +333,11 @@ QuickTimeFileSink::~QuickTimeFileSink() {
   }
 
   // Finally, close our output file:
+  if (fAsyncFileIO != NULL) {
+    fAsyncFileIO->flush(fOutFid);
+    fAsyncFileIO->cancel(this);
+    fAsyncFileIO->release();
+  }
   CloseOutputFile(fOutFid);
 }
 
@@ -413,6 +422,11 @@ void QuickTimeFileSink
 		    struct timeval presentationTime,
 		    unsigned /*durationInMicroseconds*/) {
   SubsessionIOState* ioState = (SubsessionIOState*)clientData;
+  if (ioState->fOurSink.fWriteHasFailed) {
+    // The output file can no longer be written.  Handle this the same way as if the input source had closed:
+    ioState->onSourceClosure();
+    return;
+  }
   if (!ioState->syncOK(presentationTime)) {
     // Ignore this data:
     ioState->fOurSink.continuePlaying();
@@ -481,6 +495,12 @@ static Boolean timevalGE(struct timeval const& tv1,
 void QuickTimeFileSink::completeOutputFile() {
   if (fHaveCompletedOutputFile || fOutFid == NULL) return;
 
+  // All frame data must reach the file before we go back and update its headers:
+  if (fAsyncFileIO != NULL) {
+    int result = fAsyncFileIO->flush(fOutFid);
+    if (result < 0) noteWriteFailure(-result);
+  }
+
   // Begin by filling in the initial "mdat" atom with the current
   // file size:
   int64_t curFileSize = TellFile64(fOutFid);
@@ -852,7 +872,7 @@ void SubsessionIOState::useFrame(SubsessionBuffer& buffer) {
   if (avcHack) fOurSink.addWord(frameSize);
 
   // Write the data into the file:
-  fwrite(frameSource, 1, frameSize, fOurSink.fOutFid);
+  fOurSink.addFrameData(frameSource, frameSize);
 
   // If we have a hint track, then write to it also (only if we have a RTP stream):
   if (hasHintTrack() && fOurSubsession.rtpSource() != NULL) {
@@ -1197,6 +1217,25 @@ ChunkDescriptor* ChunkDescriptor
 
 ////////// QuickTime-specific implementation //////////
 
+void QuickTimeFileSink::addFrameData(unsigned char const* data, unsigned dataSize) {
+  if (fAsyncFileIO == NULL || !fAsyncFileIO->appendToFile(fOutFid, data, dataSize, afterAsyncWrite, this)) {
+    if (fwrite(data, 1, dataSize, fOutFid) < dataSize) noteWriteFailure(envir().getErrno());
+  }
+}
+
+void QuickTimeFileSink::afterAsyncWrite(void* clientData, unsigned char const* /*data*/, int result) {
+  QuickTimeFileSink* sink = (QuickTimeFileSink*)clientData;
+  if (result < 0) sink->noteWriteFailure(-result);
+}
+
+void QuickTimeFileSink::noteWriteFailure(int err) {
+  if (fWriteHasFailed) return; // we've already reported it
+
+  envir() << "QuickTimeFileSink::addFrameData(): writing to the output file failed (err " << err
+	  << "); stopping recording\n";
+  fWriteHasFailed = True; // noticed when we next get a frame
+}
+
 unsigned QuickTimeFileSink::addWord64(u_int64_t word) {
   addByte((unsigned char)(word>>56)); addByte((unsigned char)(word>>48));
   addByte((unsigned char)(word>>40)); addByte((unsigned char)(word>>32));
@@ -137,7 +137,8 @@ RTCPInstance::RTCPInstance(UsageEnvironment& env, Groupsock* RTCPgs,
     fSRHandlerTask(NULL), fSRHandlerClientData(NULL),
     fRRHandlerTask(NULL), fRRHandlerClientData(NULL),
     fSpecificRRHandlerTable(NULL),
-    fAppHandlerTask(NULL), fAppHandlerClientData(NULL) {
+    fAppHandlerTask(NULL), fAppHandlerClientData(NULL),
+    fKeyFrameRequestHandlerTask(NULL), fKeyFrameRequestHandlerClientData(NULL), fFIRSeqNum(0) {
 #ifdef DEBUG
   fprintf(stderr, "RTCPInstance[%p]::RTCPInstance()\n", this);
 #endif
@@ -367,6 +368,72 @@ void RTCPInstance::sendAppPacket(u_int8_t subtype, char const* name,
   sendBuiltPacket();
 }
 
+// RTCP feedback message types (RFC 4585, section 6.1; RFC 5104, section 4.3):
+#define RTPFB_FMT_GENERIC_NACK 1
+#define PSFB_FMT_PLI 1
+#define PSFB_FMT_FIR 4
+
+#define MAX_NACK_FCI_ENTRIES 64 // per "Generic NACK" message; enough for 1088 packets
+
+void RTCPInstance::sendGenericNACK(u_int32_t mediaSSRC, u_int16_t const* seqNums, unsigned numSeqNums) {
+  if (fSource == NULL || numSeqNums == 0) return;
+
+  // Each FCI entry is a 'packet id' (a sequence number), plus a bitmask of which of the 16 following packets are also
+  // lost.  Pack "seqNums" into as few of these as we can:
+  u_int32_t fciEntries[MAX_NACK_FCI_ENTRIES];
+  unsigned numFCIEntries = 0;
+  for (unsigned i = 0; i < numSeqNums; ++i) {
+    if (numFCIEntries > 0) {
+      u_int16_t const pid = (u_int16_t)(fciEntries[numFCIEntries-1]>>16);
+      u_int16_t const offset = seqNums[i] - pid;
+      if (offset >= 1 && offset <= 16) {
+	fciEntries[numFCIEntries-1] |= 1<<(offset-1); // add to the previous entry's bitmask
+	continue;
+      }
+    }
+    if (numFCIEntries == MAX_NACK_FCI_ENTRIES) break;
+    fciEntries[numFCIEntries++] = seqNums[i]<<16;
+  }
+
+  // The packet must begin with a RR (and a SDES):
+  (void)addReport(True);
+  addSDES();
+
+  addFeedbackHeader(RTPFB_FMT_GENERIC_NACK, RTCP_PT_RTPFB, numFCIEntries, mediaSSRC);
+  for (unsigned i = 0; i < numFCIEntries; ++i) fOutBuf->enqueueWord(fciEntries[i]);
+
+  sendBuiltPacket();
+}
+
+void RTCPInstance::sendPLI(u_int32_t mediaSSRC) {
+  if (fSource == NULL) return;
+
+  (void)addReport(True);
+  addSDES();
+  addFeedbackHeader(PSFB_FMT_PLI, RTCP_PT_PSFB, 0, mediaSSRC); // (a "PLI" has no FCI)
+  sendBuiltPacket();
+}
+
+void RTCPInstance::sendFIR(u_int32_t mediaSSRC) {
+  if (fSource == NULL) return;
+
+  (void)addReport(True);
+  addSDES();
+
+  // The request's target is in the FCI (the header's 'media source' field is unused), along with a sequence number that
+  // lets the sender ignore repeats of this same request:
+  addFeedbackHeader(PSFB_FMT_FIR, RTCP_PT_PSFB, 2, 0);
+  fOutBuf->enqueueWord(mediaSSRC);
+  fOutBuf->enqueueWord(fFIRSeqNum++<<24);
+
+  sendBuiltPacket();
+}
+
+void RTCPInstance::setKeyFrameRequestHandler(TaskFunc* handlerTask, void* clientData) {
+  fKeyFrameRequestHandlerTask = handlerTask;
+  fKeyFrameRequestHandlerClientData = clientData;
+}
+
 void RTCPInstance::setStreamSocket(int sockNum,
 				   unsigned char streamChannelId) {
   // Turn off background read handling:
@@ -440,6 +507,7 @@ void RTCPInstance::incomingReportHandler1() {
       fNumBytesAlreadyRead = 0; // for next time
     }
     if (!readResult) break;
+    fRTCPInterface.notePacketRead(fInBuf, packetSize);
 
     // Ignore the packet if it was looped-back from ourself:
     Boolean packetWasFromOurHost = False;
@@ -717,19 +785,46 @@ void RTCPInstance
 	}
         case RTCP_PT_RTPFB: {
 #ifdef DEBUG
-	  fprintf(stderr, "RTPFB(unhandled)\n");
+	  fprintf(stderr, "RTPFB\n");
 #endif
+	  if (length < 4) break;
+	  length -= 4;
+	  u_int32_t mediaSSRC = ntohl(*(u_int32_t*)pkt); ADVANCE(4);
+
+	  if (rc == RTPFB_FMT_GENERIC_NACK && fSink != NULL && mediaSSRC == fSink->SSRC()) {
+	    // Ask our sink to retransmit each packet that's listed in each FCI entry:
+	    while (length >= 4) {
+	      u_int32_t fci = ntohl(*(u_int32_t*)pkt); ADVANCE(4); length -= 4;
+	      u_int16_t const pid = (u_int16_t)(fci>>16);
+	      fSink->retransmitPacket(pid);
+	      for (unsigned i = 0; i < 16; ++i) {
+		if ((fci&(1<<i)) != 0) fSink->retransmitPacket(pid + i + 1);
+	      }
+	    }
+	  }
 	  subPacketOK = True;
 	  break;
 	}
         case RTCP_PT_PSFB: {
 #ifdef DEBUG
-	  fprintf(stderr, "PSFB(unhandled)\n");
+	  fprintf(stderr, "PSFB\n");
+#endif
+	  if (length < 4) break;
+	  length -= 4;
+	  u_int32_t mediaSSRC = ntohl(*(u_int32_t*)pkt); ADVANCE(4);
+
+	  if (fSink != NULL && fKeyFrameRequestHandlerTask != NULL) {
+	    if (rc == PSFB_FMT_FIR && length >= 8) mediaSSRC = ntohl(*(u_int32_t*)pkt); // the FCI's SSRC is the target
+	    if ((rc == PSFB_FMT_PLI || rc == PSFB_FMT_FIR) && mediaSSRC == fSink->SSRC()) {
+	      (*fKeyFrameRequestHandlerTask)(fKeyFrameRequestHandlerClientData);
+	    }
+	  }
+#ifdef DEBUG
 	  // Temporary code to show "Receiver Estimated Maximum Bitrate" (REMB) feedback reports:
 	  //#####
-	  if (length >= 12 && pkt[4] == 'R' && pkt[5] == 'E' && pkt[6] == 'M' && pkt[7] == 'B') {
-	    u_int8_t exp = pkt[9]>>2;
-	    u_int32_t mantissa = ((pkt[9]&0x03)<<16)|(pkt[10]<<8)|pkt[11];
+	  if (length >= 8 && pkt[0] == 'R' && pkt[1] == 'E' && pkt[2] == 'M' && pkt[3] == 'B') {
+	    u_int8_t exp = pkt[5]>>2;
+	    u_int32_t mantissa = ((pkt[5]&0x03)<<16)|(pkt[6]<<8)|pkt[7];
 	    double remb = (double)mantissa;
 	    while (exp > 0) {
 	      remb *= 2.0;
@@ -1136,6 +1231,18 @@ void RTCPInstance::addBYE() {
   }
 }
 
+void RTCPInstance
+::addFeedbackHeader(u_int8_t fmt, u_int8_t packetType, unsigned numFCIWords, u_int32_t mediaSSRC) {
+  u_int32_t rtcpHdr = 0x80000000; // version 2, no padding
+  rtcpHdr |= (fmt&0x1F)<<24;
+  rtcpHdr |= (packetType<<16);
+  rtcpHdr |= 2 + numFCIWords; // (the length, in 32-bit words, minus 1)
+  fOutBuf->enqueueWord(rtcpHdr);
+
+  fOutBuf->enqueueWord(fSource != NULL ? fSource->SSRC() : fSink != NULL ? fSink->SSRC() : 0); // packet sender SSRC
+  fOutBuf->enqueueWord(mediaSSRC); // media source SSRC
+}
+
 void RTCPInstance::schedule(double nextTime) {
   fNextReportTime = nextTime;
 
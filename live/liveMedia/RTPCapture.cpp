@@ -0,0 +1,205 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Capturing incoming RTP and RTCP packets to a file, and replaying them later
+// Implementation
+
+#include "RTPCapture.hh"
+#include "OutputFile.hh"
+#include "InputFile.hh"
+#include <GroupsockHelper.hh>
+#include <string.h>
+
+static char const captureFileHeader[8] = { 'R', 'T', 'P', 'C', 'A', 'P', 0, 1 };
+#define RECORD_HEADER_SIZE 12
+
+////////// RTPCaptureWriter //////////
+
+RTPCaptureWriter* RTPCaptureWriter::createNew(UsageEnvironment& env, char const* fileName) {
+  FILE* fid = OpenOutputFile(env, fileName);
+  if (fid == NULL) return NULL;
+
+  if (fwrite(captureFileHeader, 1, sizeof captureFileHeader, fid) != sizeof captureFileHeader) {
+    env.setResultErrMsg("Failed to write the capture file header: ");
+    CloseOutputFile(fid);
+    return NULL;
+  }
+
+  return new RTPCaptureWriter(env, fid);
+}
+
+RTPCaptureWriter::RTPCaptureWriter(UsageEnvironment& env, FILE* fid)
+  : Medium(env), fFid(fid), fFlushTask(NULL), fNumPacketsRecorded(0) {
+  fFlushTask = envir().taskScheduler().scheduleDelayedTask(1000000, flushTask, this);
+}
+
+RTPCaptureWriter::~RTPCaptureWriter() {
+  envir().taskScheduler().unscheduleDelayedTask(fFlushTask);
+  CloseOutputFile(fFid);
+}
+
+void RTPCaptureWriter::recordSDPDescription(char const* sdpDescription) {
+  if (sdpDescription == NULL) return;
+
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  writeRecord(timeNow, 0, RTP_CAPTURE_FLAG_SDP, (unsigned char const*)sdpDescription, strlen(sdpDescription));
+}
+
+void RTPCaptureWriter::recordPacket(u_int8_t streamId, Boolean isRTCP, Boolean wasReceivedOverTCP,
+				    unsigned char const* packet, unsigned packetSize) {
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  u_int8_t flags = 0;
+  if (isRTCP) flags |= RTP_CAPTURE_FLAG_RTCP;
+  if (wasReceivedOverTCP) flags |= RTP_CAPTURE_FLAG_TCP;
+  writeRecord(timeNow, streamId, flags, packet, packetSize);
+  ++fNumPacketsRecorded;
+}
+
+void RTPCaptureWriter::writeRecord(struct timeval const& arrivalTime, u_int8_t streamId, u_int8_t flags,
+				   unsigned char const* data, unsigned dataSize) {
+  if (dataSize > RTP_CAPTURE_MAX_RECORD_DATA_SIZE) dataSize = RTP_CAPTURE_MAX_RECORD_DATA_SIZE; // shouldn't happen
+
+  unsigned char header[RECORD_HEADER_SIZE];
+  u_int32_t const seconds = (u_int32_t)arrivalTime.tv_sec;
+  u_int32_t const useconds = (u_int32_t)arrivalTime.tv_usec;
+  header[0] = seconds>>24; header[1] = seconds>>16; header[2] = seconds>>8; header[3] = seconds;
+  header[4] = useconds>>24; header[5] = useconds>>16; header[6] = useconds>>8; header[7] = useconds;
+  header[8] = streamId;
+  header[9] = flags;
+  header[10] = dataSize>>8; header[11] = dataSize;
+
+  fwrite(header, 1, sizeof header, fFid);
+  fwrite(data, 1, dataSize, fFid);
+}
+
+void RTPCaptureWriter::flushTask(void* clientData) {
+  RTPCaptureWriter* writer = (RTPCaptureWriter*)clientData;
+  fflush(writer->fFid);
+  writer->fFlushTask = writer->envir().taskScheduler().scheduleDelayedTask(1000000, flushTask, writer);
+}
+
+
+////////// RTPCaptureReplayer //////////
+
+RTPCaptureReplayer* RTPCaptureReplayer::createNew(UsageEnvironment& env, char const* fileName, double speed) {
+  FILE* fid = OpenInputFile(env, fileName);
+  if (fid == NULL) return NULL;
+
+  char header[sizeof captureFileHeader];
+  if (fread(header, 1, sizeof header, fid) != sizeof header || memcmp(header, captureFileHeader, sizeof header) != 0) {
+    env.setResultMsg("\"", fileName, "\" is not a RTP capture file");
+    CloseInputFile(fid);
+    return NULL;
+  }
+
+  return new RTPCaptureReplayer(env, fid, speed);
+}
+
+RTPCaptureReplayer::RTPCaptureReplayer(UsageEnvironment& env, FILE* fid, double speed)
+  : Medium(env), fFid(fid), fSpeed(speed < 0.0 ? 0.0 : speed), fSDPDescription(NULL),
+    fOnEndFunc(NULL), fOnEndClientData(NULL), fNextPacketTask(NULL), fNumPacketsReplayed(0) {
+  fOurSocket = setupDatagramSocket(env, 0);
+  memset(fDestinations, 0, sizeof fDestinations);
+
+  // Read the SDP description (if any) that precedes the first packet:
+  while ((fHaveRecord = readNextRecord()) && (fRecordFlags&RTP_CAPTURE_FLAG_SDP) != 0) {
+    delete[] fSDPDescription;
+    fSDPDescription = new char[fRecordDataSize+1];
+    memcpy(fSDPDescription, fRecordData, fRecordDataSize);
+    fSDPDescription[fRecordDataSize] = '\0';
+  }
+}
+
+RTPCaptureReplayer::~RTPCaptureReplayer() {
+  envir().taskScheduler().unscheduleDelayedTask(fNextPacketTask);
+  if (fOurSocket >= 0) ::closeSocket(fOurSocket);
+  delete[] fSDPDescription;
+  CloseInputFile(fFid);
+}
+
+void RTPCaptureReplayer::setDestination(u_int8_t streamId, Boolean isRTCP, struct in_addr const& address, Port port) {
+  struct sockaddr_in& destination = fDestinations[streamId][isRTCP ? 1 : 0];
+  destination.sin_family = AF_INET;
+  destination.sin_addr = address;
+  destination.sin_port = port.num();
+}
+
+void RTPCaptureReplayer::startReplaying(TaskFunc* onEndFunc, void* onEndClientData) {
+  fOnEndFunc = onEndFunc;
+  fOnEndClientData = onEndClientData;
+
+  gettimeofday(&fStartTime, NULL);
+  fFirstArrivalTime = fRecordArrivalTime;
+  scheduleNextPacket();
+}
+
+Boolean RTPCaptureReplayer::readNextRecord() {
+  unsigned char header[RECORD_HEADER_SIZE];
+  if (fread(header, 1, sizeof header, fFid) != sizeof header) return False;
+
+  fRecordArrivalTime.tv_sec = (header[0]<<24)|(header[1]<<16)|(header[2]<<8)|header[3];
+  fRecordArrivalTime.tv_usec = (header[4]<<24)|(header[5]<<16)|(header[6]<<8)|header[7];
+  fRecordStreamId = header[8];
+  fRecordFlags = header[9];
+  fRecordDataSize = (header[10]<<8)|header[11];
+
+  return fread(fRecordData, 1, fRecordDataSize, fFid) == fRecordDataSize;
+}
+
+void RTPCaptureReplayer::scheduleNextPacket() {
+  if (!fHaveRecord) {
+    // We've sent the last packet:
+    fNextPacketTask = NULL;
+    if (fOnEndFunc != NULL) (*fOnEndFunc)(fOnEndClientData);
+    return;
+  }
+
+  int64_t uSecondsToGo = 0;
+  if (fSpeed > 0.0) {
+    // Send the packet at its original (scaled) offset from the first packet:
+    int64_t const uSecondsFromFirst = (fRecordArrivalTime.tv_sec - fFirstArrivalTime.tv_sec)*(int64_t)1000000
+      + (fRecordArrivalTime.tv_usec - fFirstArrivalTime.tv_usec);
+    struct timeval timeNow;
+    gettimeofday(&timeNow, NULL);
+    int64_t const uSecondsSinceStart = (timeNow.tv_sec - fStartTime.tv_sec)*(int64_t)1000000
+      + (timeNow.tv_usec - fStartTime.tv_usec);
+    uSecondsToGo = (int64_t)(uSecondsFromFirst/fSpeed) - uSecondsSinceStart;
+    if (uSecondsToGo < 0) uSecondsToGo = 0;
+  }
+
+  fNextPacketTask = envir().taskScheduler().scheduleDelayedTask(uSecondsToGo, sendNextPacket, this);
+}
+
+void RTPCaptureReplayer::sendNextPacket(void* clientData) {
+  ((RTPCaptureReplayer*)clientData)->sendNextPacket();
+}
+
+void RTPCaptureReplayer::sendNextPacket() {
+  if ((fRecordFlags&RTP_CAPTURE_FLAG_SDP) == 0) {
+    struct sockaddr_in const& destination
+      = fDestinations[fRecordStreamId][(fRecordFlags&RTP_CAPTURE_FLAG_RTCP) != 0 ? 1 : 0];
+    if (destination.sin_port != 0) {
+      writeSocket(envir(), fOurSocket, destination.sin_addr, destination.sin_port, fRecordData, fRecordDataSize);
+      ++fNumPacketsReplayed;
+    }
+  }
+
+  fHaveRecord = readNextRecord();
+  scheduleNextPacket();
+}
@@ -21,8 +21,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "RTPInterface.hh"
+#include "RTPCapture.hh"
 #include <GroupsockHelper.hh>
 #include <stdio.h>
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <sys/uio.h>
+#endif
 
 ////////// Helper Functions - Definition //////////
 
@@ -33,6 +37,10 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // The top-level hash table maps TCP socket numbers to a
 // "SocketDescriptor" that contains a hash table for each of the
 // sub-channels that are reading from this socket.
+//
+// Each "SocketDescriptor" also has a queue of outgoing data - shared by all of the socket's sub-channels - that
+// could not be sent immediately (because the socket's send buffer was full).  This queue is drained (in order)
+// when the socket becomes writable, so that a slow TCP receiver never blocks the event loop.
 
 static HashTable* socketHashTable(UsageEnvironment& env, Boolean createIfNotPresent = True) {
   _Tables* ourTables = _Tables::getOurTables(env, createIfNotPresent);
@@ -45,11 +53,65 @@ static HashTable* socketHashTable(UsageEnvironment& env, Boolean createIfNotPres
   return (HashTable*)(ourTables->socketTable);
 }
 
+#ifndef RTPINTERFACE_TCP_SEND_BACKLOG_LIMIT
+#define RTPINTERFACE_TCP_SEND_BACKLOG_LIMIT 500000
+#endif
+unsigned RTPInterface::tcpSendBacklogLimit = RTPINTERFACE_TCP_SEND_BACKLOG_LIMIT;
+
+#define MAX_BUFFERS_PER_TCP_SEND 16
+
+#ifndef RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS
+#define RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS 500
+#endif
+
+static int sendBuffers(UsageEnvironment& env, int socketNum,
+		       u_int8_t const* const* buffers, unsigned const* bufferSizes, unsigned numBuffers) {
+  // Sends several buffers with a single system call (like a single "send()"):
+  env.taskScheduler().noteSyscalls();
+#if defined(__WIN32__) || defined(_WIN32)
+  WSABUF wsaBufs[MAX_BUFFERS_PER_TCP_SEND];
+  for (unsigned i = 0; i < numBuffers; ++i) {
+    wsaBufs[i].buf = (char*)buffers[i];
+    wsaBufs[i].len = bufferSizes[i];
+  }
+  DWORD numBytesSent;
+  if (WSASend(socketNum, wsaBufs, numBuffers, &numBytesSent, 0, NULL, NULL) != 0) return -1;
+  return (int)numBytesSent;
+#else
+  struct iovec iov[MAX_BUFFERS_PER_TCP_SEND];
+  for (unsigned i = 0; i < numBuffers; ++i) {
+    iov[i].iov_base = (void*)buffers[i];
+    iov[i].iov_len = bufferSizes[i];
+  }
+  return writev(socketNum, iov, numBuffers);
+#endif
+}
+
+class tcpOutputRecord {
+public:
+  tcpOutputRecord(u_int8_t const* header, unsigned headerSize, u_int8_t const* data, unsigned dataSize,
+		  unsigned numBytesAlreadySent, int droppableStreamChannelId, Boolean endsFrame);
+  virtual ~tcpOutputRecord();
+
+public:
+  tcpOutputRecord* fNext;
+  u_int8_t* fData;
+  unsigned fSize, fNumBytesSent;
+  int fDroppableStreamChannelId; // -1 if the data must not be dropped (RTCP packets, and RTSP responses)
+  Boolean fEndsFrame; // whether the data is a RTP packet with the 'M' bit set
+};
+
 class SocketDescriptor {
 public:
   SocketDescriptor(UsageEnvironment& env, int socketNum);
   virtual ~SocketDescriptor();
 
+  Boolean sendRTPorRTCPPacket(unsigned char streamChannelId, u_int8_t const* packet, unsigned packetSize,
+			      Boolean isRTCP);
+      // Returns False iff the socket has failed (in which case it should no longer be used)
+  int sendData(u_int8_t const* data, unsigned dataSize);
+      // Sends (or queues) data other than a RTP or RTCP packet (e.g., a RTSP response) over the socket
+
   void registerRTPInterface(unsigned char streamChannelId,
 			    RTPInterface* rtpInterface);
   RTPInterface* lookupRTPInterface(unsigned char streamChannelId);
@@ -60,10 +122,23 @@ public:
     fServerRequestAlternativeByteHandlerClientData = clientData;
   }
 
+  void pushBackInput(u_int8_t const* data, unsigned dataSize);
+  int readInput(u_int8_t* buffer, unsigned bufferSize, struct sockaddr_in& fromAddress);
+      // Like "readSocket()", except that any pushed-back input is read first
+
 private:
   static void tcpReadHandler(SocketDescriptor*, int mask);
+  static void pushedBackInputHandler(SocketDescriptor*);
   Boolean tcpReadHandler1(int mask);
 
+  void enqueueOutput(u_int8_t const* header, unsigned headerSize, u_int8_t const* data, unsigned dataSize,
+		     unsigned numBytesAlreadySent, int droppableStreamChannelId, Boolean endsFrame);
+  void dropQueuedPartOfFrame(unsigned char streamChannelId);
+  void noteDroppedPacket(unsigned char streamChannelId);
+  Boolean sendQueuedOutput(); // returns False iff the socket has failed
+  void finishSendingQueuedOutput();
+  void setWritableHandling(Boolean handleWritable);
+
 private:
   UsageEnvironment& fEnv;
   int fOurSocketNum;
@@ -72,7 +147,15 @@ private:
   void* fServerRequestAlternativeByteHandlerClientData;
   u_int8_t fStreamChannelId, fSizeByte1;
   Boolean fReadErrorOccurred, fDeleteMyselfNext, fAreInReadHandlerLoop;
+      // ("fReadErrorOccurred" is also set if an error occurs when writing to the socket)
   enum { AWAITING_DOLLAR, AWAITING_STREAM_CHANNEL_ID, AWAITING_SIZE1, AWAITING_SIZE2, AWAITING_PACKET_DATA } fTCPReadingState;
+  tcpOutputRecord* fOutputHead;
+  tcpOutputRecord* fOutputTail;
+  unsigned fOutputBacklog; // the number of queued bytes, not yet sent
+  Boolean fIsDroppingFrame[256]; // for each sub-channel: whether we're dropping the rest of the current frame
+  u_int8_t* fPushedBackInput; // input that was read from the socket before we began handling it
+  unsigned fPushedBackInputSize, fPushedBackInputOffset;
+  TaskToken fPushedBackInputTask;
 };
 
 static SocketDescriptor* lookupSocketDescriptor(UsageEnvironment& env, int sockNum, Boolean createIfNotFound = True) {
@@ -119,7 +202,9 @@ RTPInterface::RTPInterface(Medium* owner, Groupsock* gs)
     fTCPStreams(NULL),
     fNextTCPReadSize(0), fNextTCPReadStreamSocketNum(-1),
     fNextTCPReadStreamChannelId(0xFF), fReadHandlerProc(NULL),
-    fAuxReadHandlerFunc(NULL), fAuxReadHandlerClientData(NULL) {
+    fAuxReadHandlerFunc(NULL), fAuxReadHandlerClientData(NULL),
+    fCaptureWriter(NULL), fCaptureStreamId(0), fCaptureIsRTCP(False),
+    fCPUAccount(NULL), fNumPacketsDroppedOverTCP(0) {
   // Make the socket non-blocking, even though it will be read from only asynchronously, when packets arrive.
   // The reason for this is that, in some OSs, reads on a blocking socket can (allegedly) sometimes block,
   // even if the socket was previously reported (e.g., by "select()") as having data available.
@@ -208,6 +293,24 @@ void RTPInterface::clearServerRequestAlternativeByteHandler(UsageEnvironment& en
   setServerRequestAlternativeByteHandler(env, socketNum, NULL, NULL);
 }
 
+int RTPInterface::sendDataOverStreamSocket(UsageEnvironment& env, int socketNum, u_int8_t const* data, unsigned dataSize) {
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(env, socketNum, False);
+  if (socketDescriptor == NULL) {
+    // Normal case: The socket is not being used for RTP-over-TCP, so just send the data:
+    return send(socketNum, (char const*)data, dataSize, 0/*flags*/);
+  }
+
+  return socketDescriptor->sendData(data, dataSize);
+}
+
+Boolean RTPInterface::pushBackStreamSocketInput(UsageEnvironment& env, int socketNum, u_int8_t const* data, unsigned dataSize) {
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(env, socketNum, False);
+  if (socketDescriptor == NULL) return False;
+
+  socketDescriptor->pushBackInput(data, dataSize);
+  return True;
+}
+
 Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize) {
   Boolean success = True; // we'll return False instead if any of the sends fail
 
@@ -215,11 +318,29 @@ Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize) {
   if (!fGS->output(envir(), packet, packetSize)) success = False;
 
   // Also, send over each of our TCP sockets:
+  if (!sendPacketOverTCPStreams(packet, packetSize)) success = False;
+
+  return success;
+}
+
+Boolean RTPInterface::queuePacket(unsigned char* packet, unsigned packetSize) {
+  Boolean success = True; // we'll return False instead if any of the sends fail
+
+  if (!fGS->queueOutput(envir(), packet, packetSize)) success = False;
+  if (!sendPacketOverTCPStreams(packet, packetSize)) success = False;
+
+  return success;
+}
+
+Boolean RTPInterface::sendPacketOverTCPStreams(unsigned char* packet, unsigned packetSize) {
+  Boolean success = True;
+  Boolean const isRTCP = fOwner->isRTCPInstance(); // (RTCP packets are never dropped)
+
   tcpStreamRecord* nextStream;
   for (tcpStreamRecord* stream = fTCPStreams; stream != NULL; stream = nextStream) {
     nextStream = stream->fNext; // Set this now, in case the following deletes "stream":
     if (!sendRTPorRTCPPacketOverTCP(packet, packetSize,
-				    stream->fStreamSocketNum, stream->fStreamChannelId)) {
+				    stream->fStreamSocketNum, stream->fStreamChannelId, isRTCP)) {
       success = False;
     }
   }
@@ -229,9 +350,11 @@ Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize) {
 
 void RTPInterface
 ::startNetworkReading(TaskScheduler::BackgroundHandlerProc* handlerProc) {
+  TaskScheduler& scheduler = envir().taskScheduler();
+  CPUAccount* prevAccount = fCPUAccount == NULL ? NULL : scheduler.setCurrentCPUAccount(fCPUAccount);
+
   // Normal case: Arrange to read UDP packets:
-  envir().taskScheduler().
-    turnOnBackgroundReadHandling(fGS->socketNum(), handlerProc, fOwner);
+  scheduler.turnOnBackgroundReadHandling(fGS->socketNum(), handlerProc, fOwner);
 
   // Also, receive RTP over TCP, on each of our TCP connections:
   fReadHandlerProc = handlerProc;
@@ -243,6 +366,8 @@ void RTPInterface
     // Tell it about our subChannel:
     socketDescriptor->registerRTPInterface(streams->fStreamChannelId, this);
   }
+
+  if (fCPUAccount != NULL) scheduler.setCurrentCPUAccount(prevAccount);
 }
 
 Boolean RTPInterface::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
@@ -265,9 +390,10 @@ Boolean RTPInterface::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
     if (totBytesToRead > bufferMaxSize) totBytesToRead = bufferMaxSize;
     unsigned curBytesToRead = totBytesToRead;
     int curBytesRead;
-    while ((curBytesRead = readSocket(envir(), fNextTCPReadStreamSocketNum,
-				      &buffer[bytesRead], curBytesToRead,
-				      fromAddress)) > 0) {
+    SocketDescriptor* socketDescriptor = lookupSocketDescriptor(envir(), fNextTCPReadStreamSocketNum, False);
+    while ((curBytesRead = socketDescriptor != NULL
+	    ? socketDescriptor->readInput(&buffer[bytesRead], curBytesToRead, fromAddress)
+	    : readSocket(envir(), fNextTCPReadStreamSocketNum, &buffer[bytesRead], curBytesToRead, fromAddress)) > 0) {
       bytesRead += curBytesRead;
       if (bytesRead >= totBytesToRead) break;
       curBytesToRead -= curBytesRead;
@@ -295,6 +421,10 @@ Boolean RTPInterface::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
   return readSuccess;
 }
 
+void RTPInterface::capturePacket(unsigned char const* packet, unsigned packetSize) {
+  fCaptureWriter->recordPacket(fCaptureStreamId, fCaptureIsRTCP, fTCPStreams != NULL, packet, packetSize);
+}
+
 void RTPInterface::stopNetworkReading() {
   // Normal case
   if (fGS != NULL) envir().taskScheduler().turnOffBackgroundReadHandling(fGS->socketNum());
@@ -309,79 +439,24 @@ void RTPInterface::stopNetworkReading() {
 ////////// Helper Functions - Implementation /////////
 
 Boolean RTPInterface::sendRTPorRTCPPacketOverTCP(u_int8_t* packet, unsigned packetSize,
-						 int socketNum, unsigned char streamChannelId) {
+						 int socketNum, unsigned char streamChannelId, Boolean isRTCP) {
 #ifdef DEBUG_SEND
   fprintf(stderr, "sendRTPorRTCPPacketOverTCP: %d bytes over channel %d (socket %d)\n",
 	  packetSize, streamChannelId, socketNum); fflush(stderr);
 #endif
-  // Send a RTP/RTCP packet over TCP, using the encoding defined in RFC 2326, section 10.12:
-  //     $<streamChannelId><packetSize><packet>
-  // (If the initial "send()" of '$<streamChannelId><packetSize>' succeeds, then we force
-  // the subsequent "send()" for the <packet> data to succeed, even if we have to do so with
-  // a blocking "send()".)
-  do {
-    u_int8_t framingHeader[4];
-    framingHeader[0] = '$';
-    framingHeader[1] = streamChannelId;
-    framingHeader[2] = (u_int8_t) ((packetSize&0xFF00)>>8);
-    framingHeader[3] = (u_int8_t) (packetSize&0xFF);
-    if (!sendDataOverTCP(socketNum, framingHeader, 4, False)) break;
-
-    if (!sendDataOverTCP(socketNum, packet, packetSize, True)) break;
-#ifdef DEBUG_SEND
-    fprintf(stderr, "sendRTPorRTCPPacketOverTCP: completed\n"); fflush(stderr);
-#endif
-
-    return True;
-  } while (0);
-
-#ifdef DEBUG_SEND
-  fprintf(stderr, "sendRTPorRTCPPacketOverTCP: failed! (errno %d)\n", envir().getErrno()); fflush(stderr);
-#endif
-  return False;
-}
-
-#ifndef RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS
-#define RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS 500
-#endif
-
-Boolean RTPInterface::sendDataOverTCP(int socketNum, u_int8_t const* data, unsigned dataSize, Boolean forceSendToSucceed) {
-  int sendResult = send(socketNum, (char const*)data, dataSize, 0/*flags*/);
-  if (sendResult < (int)dataSize) {
-    // The TCP send() failed - at least partially.
-
-    unsigned numBytesSentSoFar = sendResult < 0 ? 0 : (unsigned)sendResult;
-    if (numBytesSentSoFar > 0 || (forceSendToSucceed && envir().getErrno() == EAGAIN)) {
-      // The OS's TCP send buffer has filled up (because the stream's bitrate has exceeded
-      // the capacity of the TCP connection!).
-      // Force this data write to succeed, by blocking if necessary until it does:
-      unsigned numBytesRemainingToSend = dataSize - numBytesSentSoFar;
-#ifdef DEBUG_SEND
-      fprintf(stderr, "sendDataOverTCP: resending %d-byte send (blocking)\n", numBytesRemainingToSend); fflush(stderr);
-#endif
-      makeSocketBlocking(socketNum, RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS);
-      sendResult = send(socketNum, (char const*)(&data[numBytesSentSoFar]), numBytesRemainingToSend, 0/*flags*/);
-      if ((unsigned)sendResult != numBytesRemainingToSend) {
-	// The blocking "send()" failed, or timed out.  In either case, we assume that the
-	// TCP connection has failed (or is 'hanging' indefinitely), and we stop using it
-	// (for both RTP and RTP).
-	// (If we kept using the socket here, the RTP or RTCP packet write would be in an
-	//  incomplete, inconsistent state.)
+  // Note: We don't create a socket descriptor here, because that would take over reading from the socket.  Our
+  // "addStreamSocket()" created (and registered with) it; if it has since gone, then so has our use of the socket:
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(envir(), socketNum, False);
+  if (socketDescriptor == NULL) {
+    removeStreamSocket(socketNum, 0xFF);
+    return False;
+  }
+  if (!socketDescriptor->sendRTPorRTCPPacket(streamChannelId, packet, packetSize, isRTCP)) {
 #ifdef DEBUG_SEND
-	fprintf(stderr, "sendDataOverTCP: blocking send() failed (delivering %d bytes out of %d); closing socket %d\n", sendResult, numBytesRemainingToSend, socketNum); fflush(stderr);
+    fprintf(stderr, "sendRTPorRTCPPacketOverTCP: failed! (errno %d); closing socket %d\n", envir().getErrno(), socketNum); fflush(stderr);
 #endif
-	removeStreamSocket(socketNum, 0xFF);
-	return False;
-      }
-      makeSocketNonBlocking(socketNum);
-
-      return True;
-    } else if (sendResult < 0 && envir().getErrno() != EAGAIN) {
-      // Because the "send()" call failed, assume that the socket is now unusable, so stop
-      // using it (for both RTP and RTCP):
-      removeStreamSocket(socketNum, 0xFF);
-    }
-
+    // Because the send failed, assume that the socket is now unusable, so stop using it (for both RTP and RTCP):
+    removeStreamSocket(socketNum, 0xFF);
     return False;
   }
 
@@ -392,10 +467,17 @@ SocketDescriptor::SocketDescriptor(UsageEnvironment& env, int socketNum)
   :fEnv(env), fOurSocketNum(socketNum),
     fSubChannelHashTable(HashTable::create(ONE_WORD_HASH_KEYS)),
    fServerRequestAlternativeByteHandler(NULL), fServerRequestAlternativeByteHandlerClientData(NULL),
-   fReadErrorOccurred(False), fDeleteMyselfNext(False), fAreInReadHandlerLoop(False), fTCPReadingState(AWAITING_DOLLAR) {
+   fReadErrorOccurred(False), fDeleteMyselfNext(False), fAreInReadHandlerLoop(False), fTCPReadingState(AWAITING_DOLLAR),
+   fOutputHead(NULL), fOutputTail(NULL), fOutputBacklog(0),
+   fPushedBackInput(NULL), fPushedBackInputSize(0), fPushedBackInputOffset(0), fPushedBackInputTask(NULL) {
+  for (unsigned i = 0; i < 256; ++i) fIsDroppingFrame[i] = False;
 }
 
 SocketDescriptor::~SocketDescriptor() {
+  fEnv.taskScheduler().unscheduleDelayedTask(fPushedBackInputTask);
+  delete[] fPushedBackInput;
+  if (!fReadErrorOccurred) finishSendingQueuedOutput();
+  delete fOutputHead; // any other output that we hadn't yet sent is lost
   fEnv.taskScheduler().turnOffBackgroundReadHandling(fOurSocketNum);
   removeSocketDescription(fEnv, fOurSocketNum);
 
@@ -469,13 +551,269 @@ void SocketDescriptor
   }
 }
 
+Boolean SocketDescriptor::sendRTPorRTCPPacket(unsigned char streamChannelId, u_int8_t const* packet, unsigned packetSize,
+					       Boolean isRTCP) {
+  // Send a RTP/RTCP packet over TCP, using the encoding defined in RFC 2326, section 10.12:
+  //     $<streamChannelId><packetSize><packet>
+  u_int8_t framingHeader[4];
+  framingHeader[0] = '$';
+  framingHeader[1] = streamChannelId;
+  framingHeader[2] = (u_int8_t) ((packetSize&0xFF00)>>8);
+  framingHeader[3] = (u_int8_t) (packetSize&0xFF);
+
+  // RTCP packets are never dropped.
+  // RTP packets are dropped - rest-of-a-frame at a time - if our backlog would otherwise get too large:
+  Boolean const endsFrame = !isRTCP && packetSize >= 2 && (packet[1]&0x80) != 0; // the RTP 'M' bit
+  if (!isRTCP && fIsDroppingFrame[streamChannelId]) {
+    fIsDroppingFrame[streamChannelId] = !endsFrame;
+    noteDroppedPacket(streamChannelId);
+    return True;
+  }
+
+  if (fOutputHead == NULL) {
+    // Normal case: Try to send the framing header and the packet now, with a single system call:
+    u_int8_t const* buffers[2] = { framingHeader, packet };
+    unsigned const bufferSizes[2] = { 4, packetSize };
+    int sendResult = sendBuffers(fEnv, fOurSocketNum, buffers, bufferSizes, 2);
+    if (sendResult == (int)(4 + packetSize)) return True;
+    if (sendResult < 0 && fEnv.getErrno() != EAGAIN) return False;
+
+    // The OS's TCP send buffer has filled up (because the stream's bitrate has exceeded the capacity of the
+    // TCP connection!), so queue the rest of the packet, to be sent when the socket becomes writable:
+#ifdef DEBUG_SEND
+    fprintf(stderr, "SocketDescriptor(socket %d)::sendRTPorRTCPPacket(): queueing %d bytes (of %d)\n", fOurSocketNum, 4 + packetSize - (sendResult < 0 ? 0 : sendResult), 4 + packetSize); fflush(stderr);
+#endif
+    enqueueOutput(framingHeader, 4, packet, packetSize, sendResult < 0 ? 0 : (unsigned)sendResult,
+		  isRTCP ? -1 : streamChannelId, endsFrame);
+    return True;
+  }
+
+  // Earlier data is still waiting to be sent, so this packet must wait behind it - unless that would make our backlog
+  // too large, in which case we drop the rest of this frame (including any of its packets that are still waiting):
+  if (!isRTCP && fOutputBacklog + 4 + packetSize > RTPInterface::tcpSendBacklogLimit) {
+    dropQueuedPartOfFrame(streamChannelId);
+    fIsDroppingFrame[streamChannelId] = !endsFrame;
+    noteDroppedPacket(streamChannelId);
+    return True;
+  }
+
+  enqueueOutput(framingHeader, 4, packet, packetSize, 0, isRTCP ? -1 : streamChannelId, endsFrame);
+  return True;
+}
+
+int SocketDescriptor::sendData(u_int8_t const* data, unsigned dataSize) {
+  if (fOutputHead == NULL) {
+    fEnv.taskScheduler().noteSyscalls();
+    return send(fOurSocketNum, (char const*)data, dataSize, 0/*flags*/);
+  }
+
+  // Queue the data behind our pending RTP/RTCP data, so that it doesn't end up in the middle of a packet:
+  enqueueOutput(NULL, 0, data, dataSize, 0, -1, False);
+  return (int)dataSize;
+}
+
+void SocketDescriptor::enqueueOutput(u_int8_t const* header, unsigned headerSize, u_int8_t const* data, unsigned dataSize,
+				     unsigned numBytesAlreadySent, int droppableStreamChannelId, Boolean endsFrame) {
+  tcpOutputRecord* record
+    = new tcpOutputRecord(header, headerSize, data, dataSize, numBytesAlreadySent, droppableStreamChannelId, endsFrame);
+  if (fOutputTail == NULL) {
+    fOutputHead = fOutputTail = record;
+    setWritableHandling(True);
+  } else {
+    fOutputTail->fNext = record;
+    fOutputTail = record;
+  }
+  fOutputBacklog += record->fSize - numBytesAlreadySent;
+}
+
+void SocketDescriptor::dropQueuedPartOfFrame(unsigned char streamChannelId) {
+  // Find the last queued packet (on this sub-channel) that we must keep - i.e., one that ends a frame, or that we've
+  // already started sending - and then remove the remaining queued packets (on this sub-channel) after it:
+  tcpOutputRecord* lastToKeep = NULL;
+  tcpOutputRecord* record;
+  for (record = fOutputHead; record != NULL; record = record->fNext) {
+    if (record->fDroppableStreamChannelId == streamChannelId && (record->fEndsFrame || record->fNumBytesSent > 0)) {
+      lastToKeep = record;
+    }
+  }
+
+  tcpOutputRecord* prev = lastToKeep;
+  record = lastToKeep == NULL ? fOutputHead : lastToKeep->fNext;
+  while (record != NULL) {
+    tcpOutputRecord* next = record->fNext;
+    if (record->fDroppableStreamChannelId == streamChannelId && record->fNumBytesSent == 0) {
+      if (prev == NULL) fOutputHead = next; else prev->fNext = next;
+      if (fOutputTail == record) fOutputTail = prev;
+      fOutputBacklog -= record->fSize;
+      record->fNext = NULL;
+      delete record;
+      noteDroppedPacket(streamChannelId);
+    } else {
+      prev = record;
+    }
+    record = next;
+  }
+  // (We never remove the head record, because we will have started sending it.)
+}
+
+void SocketDescriptor::noteDroppedPacket(unsigned char streamChannelId) {
+  RTPInterface* rtpInterface = lookupRTPInterface(streamChannelId);
+  if (rtpInterface != NULL) ++rtpInterface->fNumPacketsDroppedOverTCP;
+}
+
+Boolean SocketDescriptor::sendQueuedOutput() {
+  while (fOutputHead != NULL) {
+    // Send as many queued records as we can, with a single system call:
+    u_int8_t const* buffers[MAX_BUFFERS_PER_TCP_SEND];
+    unsigned bufferSizes[MAX_BUFFERS_PER_TCP_SEND];
+    unsigned numBuffers = 0, numBytesToSend = 0;
+    for (tcpOutputRecord* record = fOutputHead; record != NULL && numBuffers < MAX_BUFFERS_PER_TCP_SEND;
+	 record = record->fNext) {
+      buffers[numBuffers] = &record->fData[record->fNumBytesSent];
+      bufferSizes[numBuffers] = record->fSize - record->fNumBytesSent;
+      numBytesToSend += bufferSizes[numBuffers++];
+    }
+
+    int sendResult = sendBuffers(fEnv, fOurSocketNum, buffers, bufferSizes, numBuffers);
+    if (sendResult < 0) {
+      if (fEnv.getErrno() == EAGAIN) break; // try again when the socket is next writable
+      return False;
+    }
+
+    // Remove the records that we've now sent completely:
+    unsigned numBytesSent = (unsigned)sendResult;
+    fOutputBacklog -= numBytesSent;
+    while (numBytesSent > 0) {
+      unsigned numBytesLeftInRecord = fOutputHead->fSize - fOutputHead->fNumBytesSent;
+      if (numBytesSent < numBytesLeftInRecord) {
+	fOutputHead->fNumBytesSent += numBytesSent;
+	break;
+      }
+      numBytesSent -= numBytesLeftInRecord;
+      tcpOutputRecord* next = fOutputHead->fNext;
+      fOutputHead->fNext = NULL;
+      delete fOutputHead;
+      fOutputHead = next;
+    }
+    if (fOutputHead == NULL) fOutputTail = NULL;
+
+    if ((unsigned)sendResult < numBytesToSend) break; // the socket's send buffer is full again
+  }
+
+  if (fOutputHead == NULL) setWritableHandling(False);
+  return True;
+}
+
+void SocketDescriptor::finishSendingQueuedOutput() {
+  // We're going away, but the socket might still be used (e.g., for RTSP responses, after a "TEARDOWN").  So first
+  // send the rest of any packet that we've started sending - or else the next data on the socket would land in the
+  // middle of it - and any queued data that must not be dropped (RTCP packets, and RTSP responses).  We drop the
+  // other (RTP) packets:
+  tcpOutputRecord* prev = NULL;
+  tcpOutputRecord* record = fOutputHead;
+  while (record != NULL) {
+    tcpOutputRecord* next = record->fNext;
+    if (record->fDroppableStreamChannelId != -1 && record->fNumBytesSent == 0) {
+      if (prev == NULL) fOutputHead = next; else prev->fNext = next;
+      record->fNext = NULL;
+      delete record;
+    } else {
+      prev = record;
+    }
+    record = next;
+  }
+  fOutputTail = prev;
+  if (fOutputHead == NULL) return;
+
+  // Send this data now, blocking (briefly) if necessary:
+  makeSocketBlocking(fOurSocketNum, RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS);
+  while (fOutputHead != NULL) {
+    unsigned numBytesToSend = fOutputHead->fSize - fOutputHead->fNumBytesSent;
+    fEnv.taskScheduler().noteSyscalls();
+    int sendResult = send(fOurSocketNum, (char const*)&fOutputHead->fData[fOutputHead->fNumBytesSent], numBytesToSend, 0);
+    if (sendResult != (int)numBytesToSend) break; // the connection has failed, or is hanging; give up on it
+
+    tcpOutputRecord* next = fOutputHead->fNext;
+    fOutputHead->fNext = NULL;
+    delete fOutputHead;
+    fOutputHead = next;
+  }
+  if (fOutputHead == NULL) fOutputTail = NULL;
+  makeSocketNonBlocking(fOurSocketNum);
+}
+
+void SocketDescriptor::setWritableHandling(Boolean handleWritable) {
+  TaskScheduler::BackgroundHandlerProc* handler = (TaskScheduler::BackgroundHandlerProc*)&tcpReadHandler;
+  fEnv.taskScheduler().setBackgroundHandling(fOurSocketNum,
+					     SOCKET_READABLE|SOCKET_EXCEPTION|(handleWritable ? SOCKET_WRITABLE : 0),
+					     handler, this);
+}
+
 void SocketDescriptor::tcpReadHandler(SocketDescriptor* socketDescriptor, int mask) {
-  // Call the read handler until it returns false, with a limit to avoid starving other sockets
-  unsigned count = 2000;
   socketDescriptor->fAreInReadHandlerLoop = True;
-  while (!socketDescriptor->fDeleteMyselfNext && socketDescriptor->tcpReadHandler1(mask) && --count > 0) {}
+
+  // First, send as much queued output as we can:
+  if ((mask&SOCKET_WRITABLE) != 0 && !socketDescriptor->sendQueuedOutput()) {
+#ifdef DEBUG_SEND
+    fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): sending queued output failed (errno %d)\n", socketDescriptor->fOurSocketNum, socketDescriptor->fEnv.getErrno());
+#endif
+    socketDescriptor->fReadErrorOccurred = True;
+    socketDescriptor->fDeleteMyselfNext = True;
+  }
+
+  if ((mask&(SOCKET_READABLE|SOCKET_EXCEPTION)) != 0) {
+    // Call the read handler until it returns false, with a limit to avoid starving other sockets
+    unsigned count = 2000;
+    while (!socketDescriptor->fDeleteMyselfNext && socketDescriptor->tcpReadHandler1(mask) && --count > 0) {}
+  }
   socketDescriptor->fAreInReadHandlerLoop = False;
-  if (socketDescriptor->fDeleteMyselfNext) delete socketDescriptor;
+  if (socketDescriptor->fDeleteMyselfNext) {
+    delete socketDescriptor;
+  } else if (socketDescriptor->fPushedBackInputOffset < socketDescriptor->fPushedBackInputSize
+	     && socketDescriptor->fPushedBackInputTask == NULL) {
+    // We stopped (to avoid starving other sockets) before handling all of our pushed-back input, so handle the rest later:
+    socketDescriptor->fPushedBackInputTask
+      = socketDescriptor->fEnv.taskScheduler().scheduleDelayedTask(0, (TaskFunc*)pushedBackInputHandler, socketDescriptor);
+  }
+}
+
+void SocketDescriptor::pushBackInput(u_int8_t const* data, unsigned dataSize) {
+  if (dataSize == 0) return;
+
+  // Append "data" to whatever pushed-back input we haven't yet read:
+  unsigned numUnreadBytes = fPushedBackInputSize - fPushedBackInputOffset;
+  u_int8_t* newInput = new u_int8_t[numUnreadBytes + dataSize];
+  if (numUnreadBytes > 0) memmove(newInput, &fPushedBackInput[fPushedBackInputOffset], numUnreadBytes);
+  memmove(&newInput[numUnreadBytes], data, dataSize);
+  delete[] fPushedBackInput;
+  fPushedBackInput = newInput;
+  fPushedBackInputSize = numUnreadBytes + dataSize;
+  fPushedBackInputOffset = 0;
+
+  // The socket might not become readable again, so handle this input from the event loop:
+  if (fPushedBackInputTask == NULL) {
+    fPushedBackInputTask = fEnv.taskScheduler().scheduleDelayedTask(0, (TaskFunc*)pushedBackInputHandler, this);
+  }
+}
+
+int SocketDescriptor::readInput(u_int8_t* buffer, unsigned bufferSize, struct sockaddr_in& fromAddress) {
+  if (fPushedBackInputOffset == fPushedBackInputSize) return readSocket(fEnv, fOurSocketNum, buffer, bufferSize, fromAddress);
+
+  unsigned numBytesRead = fPushedBackInputSize - fPushedBackInputOffset;
+  if (numBytesRead > bufferSize) numBytesRead = bufferSize;
+  memmove(buffer, &fPushedBackInput[fPushedBackInputOffset], numBytesRead);
+  fPushedBackInputOffset += numBytesRead;
+  if (fPushedBackInputOffset == fPushedBackInputSize) {
+    delete[] fPushedBackInput; fPushedBackInput = NULL;
+    fPushedBackInputSize = fPushedBackInputOffset = 0;
+  }
+
+  return (int)numBytesRead;
+}
+
+void SocketDescriptor::pushedBackInputHandler(SocketDescriptor* socketDescriptor) {
+  socketDescriptor->fPushedBackInputTask = NULL;
+  tcpReadHandler(socketDescriptor, SOCKET_READABLE);
 }
 
 Boolean SocketDescriptor::tcpReadHandler1(int mask) {
@@ -490,7 +828,7 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
   u_int8_t c;
   struct sockaddr_in fromAddress;
   if (fTCPReadingState != AWAITING_PACKET_DATA) {
-    int result = readSocket(fEnv, fOurSocketNum, &c, 1, fromAddress);
+    int result = readInput(&c, 1, fromAddress);
     if (result == 0) { // There was no more data to read
       return False;
     } else if (result != 1) { // error reading TCP socket, so we will no longer handle it
@@ -574,7 +912,7 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
 #ifdef DEBUG_RECEIVE
 	  fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): No handler proc for \"rtpInterface\" for channel %d; need to skip %d remaining bytes\n", fOurSocketNum, fStreamChannelId, rtpInterface->fNextTCPReadSize);
 #endif
-	  int result = readSocket(fEnv, fOurSocketNum, &c, 1, fromAddress);
+	  int result = readInput(&c, 1, fromAddress);
 	  if (result < 0) { // error reading TCP socket, so we will no longer handle it
 #ifdef DEBUG_RECEIVE
 	    fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readSocket(1 byte) returned %d (error)\n", fOurSocketNum, result);
@@ -613,3 +951,21 @@ tcpStreamRecord
 tcpStreamRecord::~tcpStreamRecord() {
   delete fNext;
 }
+
+
+////////// tcpOutputRecord implementation //////////
+
+tcpOutputRecord
+::tcpOutputRecord(u_int8_t const* header, unsigned headerSize, u_int8_t const* data, unsigned dataSize,
+		  unsigned numBytesAlreadySent, int droppableStreamChannelId, Boolean endsFrame)
+  : fNext(NULL), fData(new u_int8_t[headerSize + dataSize]), fSize(headerSize + dataSize),
+    fNumBytesSent(numBytesAlreadySent),
+    fDroppableStreamChannelId(droppableStreamChannelId), fEndsFrame(endsFrame) {
+  if (headerSize > 0) memmove(fData, header, headerSize);
+  memmove(&fData[headerSize], data, dataSize);
+}
+
+tcpOutputRecord::~tcpOutputRecord() {
+  delete[] fData;
+  delete fNext;
+}
@@ -163,6 +163,14 @@ char const* RTPSink::auxSDPLine() {
   return NULL; // by default
 }
 
+unsigned char RTPSink::rtxPayloadType() const {
+  return 0; // by default
+}
+
+Boolean RTPSink::retransmitPacket(u_int16_t /*seqNum*/) {
+  return False; // by default
+}
+
 
 ////////// RTPTransmissionStatsDB //////////
 
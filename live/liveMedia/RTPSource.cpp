@@ -44,6 +44,39 @@ Boolean RTPSource::hasBeenSynchronizedUsingRTCP() {
   return fCurPacketHasBeenSynchronizedUsingRTCP;
 }
 
+void RTPSource::setAdaptivePacketReordering(unsigned /*maxThresholdUSeconds*/, double /*lateFraction*/) {
+  // By default, we don't reorder packets
+}
+
+unsigned RTPSource::packetReorderingThresholdTime() const {
+  return 0; // by default, we don't reorder packets
+}
+
+unsigned RTPSource::numPacketsInReorderingBuffer() const {
+  return 0; // by default, we don't reorder packets
+}
+
+unsigned RTPSource::numPacketsArrivedTooLate() const {
+  return 0; // by default, we don't reorder packets
+}
+
+void RTPSource::enableRetransmissionRequests(RTCPInstance* /*rtcpInstance*/, unsigned char /*rtxPayloadFormat*/,
+					     Boolean /*sendNACKs*/, Boolean /*sendPLIs*/, Boolean /*sendFIRs*/) {
+  // By default, we don't send RTCP feedback
+}
+
+unsigned RTPSource::numPacketsNACKed() const {
+  return 0; // by default, we don't send RTCP feedback
+}
+
+unsigned RTPSource::numPacketsRetransmitted() const {
+  return 0; // by default, we don't send RTCP feedback
+}
+
+unsigned RTPSource::numKeyFrameRequests() const {
+  return 0; // by default, we don't send RTCP feedback
+}
+
 Boolean RTPSource::isRTPSource() const {
   return True;
 }
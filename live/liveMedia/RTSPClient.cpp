@@ -364,10 +364,12 @@ RTSPClient::RTSPClient(UsageEnvironment& env, char const* rtspURL,
     fTunnelOverHTTPPortNum(tunnelOverHTTPPortNum),
     fUserAgentHeaderStr(NULL), fUserAgentHeaderStrLen(0),
     fInputSocketNum(-1), fOutputSocketNum(-1), fBaseURL(NULL), fTCPStreamIdCount(0),
-    fLastSessionId(NULL), fSessionTimeoutParameter(0), fSessionCookieCounter(0), fHTTPTunnelingConnectionIsPending(False) {
+    fLastSessionId(NULL), fSessionTimeoutParameter(0), fPipelineId(0),
+    fSessionCookieCounter(0), fHTTPTunnelingConnectionIsPending(False) {
   setBaseURL(rtspURL);
 
   fResponseBuffer = new char[responseBufferSize+1];
+  fResponseHeaders = new char[responseBufferSize+1];
   resetResponseBuffer();
 
   if (socketNumToServer >= 0) {
@@ -400,7 +402,7 @@ RTSPClient::~RTSPClient() {
   RTPInterface::clearServerRequestAlternativeByteHandler(envir(), fInputSocketNum); // in case we were receiving RTP-over-TCP
   reset();
 
-  delete[] fResponseBuffer;
+  delete[] fResponseBuffer; delete[] fResponseHeaders;
   delete[] fUserAgentHeaderStr;
 }
 
@@ -417,6 +419,7 @@ void RTSPClient::reset() {
   fCurrentAuthenticator.reset();
 
   delete[] fLastSessionId; fLastSessionId = NULL;
+  fPipelineId = 0;
 }
 
 void RTSPClient::setBaseURL(char const* url) {
@@ -536,7 +539,8 @@ unsigned RTSPClient::sendRequest(RequestRecord* request) {
       delete[] origCmd;
     }
 
-    if (send(fOutputSocketNum, cmd, strlen(cmd), 0) < 0) {
+    if (RTPInterface::sendDataOverStreamSocket(envir(), fOutputSocketNum, (u_int8_t const*)cmd, strlen(cmd)) < 0) {
+        // (rather than "send()", in case the socket is also carrying RTP-over-TCP, with packets waiting to be sent)
       char const* errFmt = "%s send() failed: ";
       unsigned const errLength = strlen(errFmt) + strlen(request->commandName());
       char* err = new char[errLength];
@@ -578,6 +582,17 @@ static char* createSessionString(char const* sessionId) {
   return sessionStr;
 }
 
+static char* createPipelinedRequestsString(u_int32_t pipelineId) {
+  char buf[100];
+  if (pipelineId == 0) {
+    buf[0] = '\0';
+  } else {
+    sprintf(buf, "Pipelined-Requests: %u\r\n", pipelineId);
+  }
+
+  return strDup(buf);
+}
+
 // Add support for faster download thru "speed:" option on PLAY
 static char* createSpeedString(float speed) {
   char buf[100];
@@ -711,12 +726,15 @@ Boolean RTSPClient::setRequestFields(RequestRecord* request,
     // Optionally include a "Blocksize:" string:
     char* blocksizeStr = createBlocksizeString(streamUsingTCP);
 
-    // The "Transport:" and "Session:" (if present) and "Blocksize:" (if present) headers
-    // make up the 'extra headers':
-    extraHeaders = new char[transportSize + strlen(sessionStr) + strlen(blocksizeStr)];
+    // Optionally include a "Pipelined-Requests:" string:
+    char* pipelinedRequestsStr = createPipelinedRequestsString(fPipelineId);
+
+    // The "Transport:" and "Session:" (if present) and "Blocksize:" (if present) and "Pipelined-Requests:" (if present)
+    // headers make up the 'extra headers':
+    extraHeaders = new char[transportSize + strlen(sessionStr) + strlen(blocksizeStr) + strlen(pipelinedRequestsStr)];
     extraHeadersWereAllocated = True;
-    sprintf(extraHeaders, "%s%s%s", transportStr, sessionStr, blocksizeStr);
-    delete[] transportStr; delete[] sessionStr; delete[] blocksizeStr;
+    sprintf(extraHeaders, "%s%s%s%s", transportStr, sessionStr, blocksizeStr, pipelinedRequestsStr);
+    delete[] transportStr; delete[] sessionStr; delete[] blocksizeStr; delete[] pipelinedRequestsStr;
   } else if (strcmp(request->commandName(), "GET") == 0 || strcmp(request->commandName(), "POST") == 0) {
     // We will be sending a HTTP (not a RTSP) request.
     // Begin by re-parsing our RTSP URL, to get the stream name (which we'll use as our 'cmdURL'
@@ -780,7 +798,8 @@ Boolean RTSPClient::setRequestFields(RequestRecord* request,
     }
   } else { // "PLAY", "PAUSE", "TEARDOWN", "RECORD", "SET_PARAMETER", "GET_PARAMETER"
     // First, make sure that we have a RTSP session in progress
-    if (fLastSessionId == NULL) {
+    // (or - for "PLAY" - that it'll be the session that our pipelined "SETUP" creates):
+    if (fLastSessionId == NULL && !(fPipelineId != 0 && strcmp(request->commandName(), "PLAY") == 0)) {
       envir().setResultMsg("No RTSP session is currently in progress\n");
       return False;
     }
@@ -813,10 +832,12 @@ Boolean RTSPClient::setRequestFields(RequestRecord* request,
       float speed = request->session() != NULL ? request->session()->speed() : request->subsession()->speed();
       char* speedStr = createSpeedString(speed);
       char* rangeStr = createRangeString(request->start(), request->end(), request->absStartTime(), request->absEndTime());
-      extraHeaders = new char[strlen(sessionStr) + strlen(scaleStr) + strlen(speedStr) + strlen(rangeStr) + 1];
+      char* pipelinedRequestsStr = createPipelinedRequestsString(fPipelineId);
+      extraHeaders = new char[strlen(sessionStr) + strlen(scaleStr) + strlen(speedStr) + strlen(rangeStr)
+			      + strlen(pipelinedRequestsStr) + 1];
       extraHeadersWereAllocated = True;
-      sprintf(extraHeaders, "%s%s%s%s", sessionStr, scaleStr, speedStr, rangeStr);
-      delete[] sessionStr; delete[] scaleStr; delete[] speedStr; delete[] rangeStr;
+      sprintf(extraHeaders, "%s%s%s%s%s", sessionStr, scaleStr, speedStr, rangeStr, pipelinedRequestsStr);
+      delete[] sessionStr; delete[] scaleStr; delete[] speedStr; delete[] rangeStr; delete[] pipelinedRequestsStr;
     } else {
       // Create a "Session:" header; this makes up our 'extra headers':
       extraHeaders = createSessionString(sessionId);
@@ -846,6 +867,7 @@ void RTSPClient::resetTCPSockets() {
 void RTSPClient::resetResponseBuffer() {
   fResponseBytesAlreadySeen = 0;
   fResponseBufferBytesLeft = responseBufferSize;
+  fResponseParser.reset();
 }
 
 int RTSPClient::openConnection() {
@@ -918,7 +940,8 @@ char* RTSPClient::createAuthenticatorString(char const* cmd, char const* url) {
       char const* const authFmt =
 	"Authorization: Digest username=\"%s\", realm=\"%s\", "
 	"nonce=\"%s\", uri=\"%s\", response=\"%s\"\r\n";
-      char const* response = auth.computeDigestResponse(cmd, url);
+      char response[33];
+      auth.computeDigestResponse(cmd, url, response);
       unsigned authBufSize = strlen(authFmt)
 	+ strlen(auth.username()) + strlen(auth.realm())
 	+ strlen(auth.nonce()) + strlen(url) + strlen(response);
@@ -926,7 +949,6 @@ char* RTSPClient::createAuthenticatorString(char const* cmd, char const* url) {
       sprintf(authenticatorStr, authFmt,
 	      auth.username(), auth.realm(),
 	      auth.nonce(), url, response);
-      auth.reclaimDigestResponse(response);
     } else { // Basic authentication
       char const* const authFmt = "Authorization: Basic %s\r\n";
 
@@ -1005,14 +1027,12 @@ void RTSPClient::handleIncomingRequest() {
   char urlSuffix[RTSP_PARAM_STRING_MAX];
   char cseq[RTSP_PARAM_STRING_MAX];
   char sessionId[RTSP_PARAM_STRING_MAX];
-  unsigned contentLength;
-  if (!parseRTSPRequestString(fResponseBuffer, fResponseBytesAlreadySeen,
-			      cmdName, sizeof cmdName,
-			      urlPreSuffix, sizeof urlPreSuffix,
-			      urlSuffix, sizeof urlSuffix,
-			      cseq, sizeof cseq,
-			      sessionId, sizeof sessionId,
-			      contentLength)) {
+  if (!fResponseParser.getRTSPRequestParams(fResponseBuffer,
+					    cmdName, sizeof cmdName,
+					    urlPreSuffix, sizeof urlPreSuffix,
+					    urlSuffix, sizeof urlSuffix,
+					    cseq, sizeof cseq,
+					    sessionId, sizeof sessionId)) {
     return;
   } else {
     if (fVerbosityLevel >= 1) {
@@ -1021,22 +1041,10 @@ void RTSPClient::handleIncomingRequest() {
     char tmpBuf[2*RTSP_PARAM_STRING_MAX];
     snprintf((char*)tmpBuf, sizeof tmpBuf,
              "RTSP/1.0 405 Method Not Allowed\r\nCSeq: %s\r\n\r\n", cseq);
-    send(fOutputSocketNum, tmpBuf, strlen(tmpBuf), 0);
+    RTPInterface::sendDataOverStreamSocket(envir(), fOutputSocketNum, (u_int8_t const*)tmpBuf, strlen(tmpBuf));
   }
 }
 
-Boolean RTSPClient::checkForHeader(char const* line, char const* headerName, unsigned headerNameLength, char const*& headerParams) {
-  if (_strncasecmp(line, headerName, headerNameLength) != 0) return False;
-
-  // The line begins with the desired header name.  Trim off any whitespace, and return the header parameters:
-  unsigned paramIndex = headerNameLength;
-  while (line[paramIndex] != '\0' && (line[paramIndex] == ' ' || line[paramIndex] == '\t')) ++paramIndex;
-  if (line[paramIndex] == '\0') return False; // the header is assumed to be bad if it has no parameters
-
-  headerParams = &line[paramIndex];
-  return True;
-}
-
 Boolean RTSPClient::parseTransportParams(char const* paramsStr,
 					 char*& serverAddressStr, portNumBits& serverPortNum,
 					 unsigned char& rtpChannelId, unsigned char& rtcpChannelId) {
@@ -1563,25 +1571,6 @@ void RTSPClient::incomingDataHandler1() {
   handleResponseBytes(bytesRead);
 }
 
-static char* getLine(char* startOfLine) {
-  // returns the start of the next line, or NULL if none.  Note that this modifies the input string to add '\0' characters.
-  for (char* ptr = startOfLine; *ptr != '\0'; ++ptr) {
-    // Check for the end of line: \r\n (but also accept \r or \n by itself):
-    if (*ptr == '\r' || *ptr == '\n') {
-      // We found the end of the line
-      if (*ptr == '\r') {
-	*ptr++ = '\0';
-	if (*ptr == '\n') ++ptr;
-      } else {
-        *ptr++ = '\0';
-      }
-      return ptr;
-    }
-  }
-
-  return NULL;
-}
-
 void RTSPClient::handleResponseBytes(int newBytesRead) {
   do {
     if (newBytesRead >= 0 && (unsigned)newBytesRead < fResponseBufferBytesLeft) break; // data was read OK; process it below
@@ -1619,28 +1608,15 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
   
   unsigned numExtraBytesAfterResponse = 0;
   Boolean responseSuccess = False; // by default
+  Boolean startedRTPOverTCP = False, extraBytesWerePushedBack = False;
   do {
-    // Data was read OK.  Look through the data that we've read so far, to see if it contains <CR><LF><CR><LF>.
-    // (If not, wait for more data to arrive.)
-    Boolean endOfHeaders = False;
-    char const* ptr = fResponseBuffer;
-    if (fResponseBytesAlreadySeen > 3) {
-      char const* const ptrEnd = &fResponseBuffer[fResponseBytesAlreadySeen-3];
-      while (ptr < ptrEnd) {
-	if (*ptr++ == '\r' && *ptr++ == '\n' && *ptr++ == '\r' && *ptr++ == '\n') {
-	  // This is it
-	  endOfHeaders = True;
-	  break;
-	}
-      }
-    }
+    // Data was read OK.  Continue parsing the data that we've read so far, up to the blank line at the end of the headers.
+    // (If we haven't reached it yet, wait for more data to arrive.)
+    if (!fResponseParser.parse(fResponseBuffer, fResponseBytesAlreadySeen)) return;
     
-    if (!endOfHeaders) return; // subsequent reads will be needed to get the complete response
-    
-    // Now that we have the complete response headers (ending with <CR><LF><CR><LF>), parse them to get the response code, CSeq,
-    // and various other header parameters.  To do this, we first make a copy of the received header data, because we'll be
-    // modifying it by adding '\0' bytes.
-    char* headerDataCopy;
+    // Now that we have the complete response headers, get the response code, CSeq, and various other header parameters.
+    // To do this, we use a copy of the headers, to which we add '\0' bytes at the end of the first line and of each header value.
+    unsigned const headersSize = fResponseParser.headersSize();
     unsigned responseCode = 200;
     char const* responseStr = NULL;
     RequestRecord* foundRequest = NULL;
@@ -1656,105 +1632,116 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
     unsigned numBodyBytes = 0;
     responseSuccess = False;
     do {
-      headerDataCopy = new char[responseBufferSize];
-      strncpy(headerDataCopy, fResponseBuffer, fResponseBytesAlreadySeen);
-      headerDataCopy[fResponseBytesAlreadySeen] = '\0';
-      
-      char* lineStart;
-      char* nextLineStart = headerDataCopy;
-      do {
-	lineStart = nextLineStart;
-	nextLineStart = getLine(lineStart);
-      } while (lineStart[0] == '\0' && nextLineStart != NULL); // skip over any blank lines at the start
-      if (!parseResponseCode(lineStart, responseCode, responseStr)) {
+      memcpy(fResponseHeaders, fResponseBuffer, headersSize);
+      fResponseHeaders[headersSize] = '\0';
+      char* startLine = &fResponseHeaders[fResponseParser.startLineOffset()];
+      startLine[fResponseParser.startLineSize()] = '\0';
+      if (!parseResponseCode(startLine, responseCode, responseStr)) {
 	// This does not appear to be a RTSP response; perhaps it's a RTSP request instead?
 	handleIncomingRequest();
 	break; // we're done with this data
       }
       
-      // Scan through the headers, handling the ones that we're interested in:
-      Boolean reachedEndOfHeaders;
+      // Go through the headers, handling the ones that we're interested in:
+      Boolean badHeader = False;
       unsigned cseq = 0;
       unsigned contentLength = 0;
       
-      while (1) {
-	reachedEndOfHeaders = True; // by default; may get changed below
-	lineStart = nextLineStart;
-	if (lineStart == NULL) break;
+      for (unsigned i = 0; i < fResponseParser.numKnownHeaders() && !badHeader; ++i) {
+	if (fResponseParser.headerValueSize(i) == 0) continue; // the header is assumed to be bad if it has no parameters
+	char* headerParamsStr = &fResponseHeaders[fResponseParser.headerValueOffset(i)];
+	headerParamsStr[fResponseParser.headerValueSize(i)] = '\0';
 	
-	nextLineStart = getLine(lineStart);
-	if (lineStart[0] == '\0') break; // this is a blank line
-	reachedEndOfHeaders = False;
-	
-	char const* headerParamsStr; 
-	if (checkForHeader(lineStart, "CSeq:", 5, headerParamsStr)) {
-	  if (sscanf(headerParamsStr, "%u", &cseq) != 1 || cseq <= 0) {
-	    envir().setResultMsg("Bad \"CSeq:\" header: \"", lineStart, "\"");
+	switch (fResponseParser.headerId(i)) {
+	  case RTSPMessageParser::CSEQ: {
+	    if (sscanf(headerParamsStr, "%u", &cseq) != 1 || cseq <= 0) {
+	      envir().setResultMsg("Bad \"CSeq:\" header: \"", headerParamsStr, "\"");
+	      badHeader = True;
+	      break;
+	    }
+	    // Find the handler function for "cseq":
+	    RequestRecord* request;
+	    while ((request = fRequestsAwaitingResponse.dequeue()) != NULL) {
+	      if (request->cseq() < cseq) { // assumes that the CSeq counter will never wrap around
+		// We never received (and will never receive) a response for this handler, so delete it:
+		if (fVerbosityLevel >= 1 && strcmp(request->commandName(), "POST") != 0) {
+		  envir() << "WARNING: The server did not respond to our \"" << request->commandName() << "\" request (CSeq: "
+			  << request->cseq() << ").  The server appears to be buggy (perhaps not handling pipelined requests properly).\n";
+		}
+		delete request;
+	      } else if (request->cseq() == cseq) {
+		// This is the handler that we want. Remove its record, but remember it, so that we can later call its handler:
+		foundRequest = request;
+		break;
+	      } else { // request->cseq() > cseq
+		// No handler was registered for this response, so ignore it.
+		break;
+	      }
+	    }
 	    break;
 	  }
-	  // Find the handler function for "cseq":
-	  RequestRecord* request;
-	  while ((request = fRequestsAwaitingResponse.dequeue()) != NULL) {
-	    if (request->cseq() < cseq) { // assumes that the CSeq counter will never wrap around
-	      // We never received (and will never receive) a response for this handler, so delete it:
-	      if (fVerbosityLevel >= 1 && strcmp(request->commandName(), "POST") != 0) {
-		envir() << "WARNING: The server did not respond to our \"" << request->commandName() << "\" request (CSeq: "
-			<< request->cseq() << ").  The server appears to be buggy (perhaps not handling pipelined requests properly).\n";
-	      }
-	      delete request;
-	    } else if (request->cseq() == cseq) {
-	      // This is the handler that we want. Remove its record, but remember it, so that we can later call its handler:
-	      foundRequest = request;
-	      break;
-	    } else { // request->cseq() > cseq
-	      // No handler was registered for this response, so ignore it.
-	      break;
+	  case RTSPMessageParser::CONTENT_LENGTH: {
+	    if (sscanf(headerParamsStr, "%u", &contentLength) != 1) {
+	      envir().setResultMsg("Bad \"Content-Length:\" header: \"", headerParamsStr, "\"");
+	      badHeader = True;
 	    }
+	    break;
 	  }
-	} else if (checkForHeader(lineStart, "Content-Length:", 15, headerParamsStr)) {
-	  if (sscanf(headerParamsStr, "%u", &contentLength) != 1) {
-	    envir().setResultMsg("Bad \"Content-Length:\" header: \"", lineStart, "\"");
+	  case RTSPMessageParser::CONTENT_BASE: {
+	    setBaseURL(headerParamsStr);
 	    break;
 	  }
-	} else if (checkForHeader(lineStart, "Content-Base:", 13, headerParamsStr)) {
-	  setBaseURL(headerParamsStr);
-	} else if (checkForHeader(lineStart, "Session:", 8, sessionParamsStr)) {
-	} else if (checkForHeader(lineStart, "Transport:", 10, transportParamsStr)) {
-	} else if (checkForHeader(lineStart, "Scale:", 6, scaleParamsStr)) {
-	} else if (checkForHeader(lineStart, "Speed:", 6, speedParamsStr)) {
-	} else if (checkForHeader(lineStart, "Range:", 6, rangeParamsStr)) {
-	} else if (checkForHeader(lineStart, "RTP-Info:", 9, rtpInfoParamsStr)) {
-	} else if (checkForHeader(lineStart, "WWW-Authenticate:", 17, headerParamsStr)) {
-	  // If we've already seen a "WWW-Authenticate:" header, then we replace it with this new one only if
-	  // the new one specifies "Digest" authentication:
-	  if (wwwAuthenticateParamsStr == NULL || _strncasecmp(headerParamsStr, "Digest", 6) == 0) {
-	    wwwAuthenticateParamsStr = headerParamsStr;
+	  case RTSPMessageParser::SESSION: { sessionParamsStr = headerParamsStr; break; }
+	  case RTSPMessageParser::TRANSPORT: { transportParamsStr = headerParamsStr; break; }
+	  case RTSPMessageParser::SCALE: { scaleParamsStr = headerParamsStr; break; }
+	  case RTSPMessageParser::SPEED: { speedParamsStr = headerParamsStr; break; }
+	  case RTSPMessageParser::RANGE: { rangeParamsStr = headerParamsStr; break; }
+	  case RTSPMessageParser::RTP_INFO: { rtpInfoParamsStr = headerParamsStr; break; }
+	  case RTSPMessageParser::WWW_AUTHENTICATE: {
+	    // If we've already seen a "WWW-Authenticate:" header, then we replace it with this new one only if
+	    // the new one specifies "Digest" authentication:
+	    if (wwwAuthenticateParamsStr == NULL || _strncasecmp(headerParamsStr, "Digest", 6) == 0) {
+	      wwwAuthenticateParamsStr = headerParamsStr;
+	    }
+	    break;
 	  }
-	} else if (checkForHeader(lineStart, "Public:", 7, publicParamsStr)) {
-	} else if (checkForHeader(lineStart, "Allow:", 6, publicParamsStr)) {
-	  // Note: we accept "Allow:" instead of "Public:", so that "OPTIONS" requests made to HTTP servers will work.
-	} else if (checkForHeader(lineStart, "Location:", 9, headerParamsStr)) {
-	  setBaseURL(headerParamsStr);
-	} else if (checkForHeader(lineStart, "com.ses.streamID:", 17, headerParamsStr)) {
-	  // Replace the tail of the 'base URL' with the value of this header parameter:
-	  char* oldBaseURLTail = strrchr(fBaseURL, '/');
-	  if (oldBaseURLTail != NULL) {
-	    unsigned newBaseURLLen
-	      = (oldBaseURLTail - fBaseURL) + 8/* for "/stream=" */ + strlen(headerParamsStr);
-	    char* newBaseURL = new char[newBaseURLLen + 1];
-	        // Note: We couldn't use "asprintf()", because some compilers don't support it
-	    sprintf(newBaseURL, "%.*s/stream=%s",
-		     (int)(oldBaseURLTail - fBaseURL), fBaseURL, headerParamsStr);
-	    setBaseURL(newBaseURL);
-	    delete[] newBaseURL;
+	  case RTSPMessageParser::PUBLIC:
+	  case RTSPMessageParser::ALLOW: {
+	    // Note: we accept "Allow:" instead of "Public:", so that "OPTIONS" requests made to HTTP servers will work.
+	    publicParamsStr = headerParamsStr;
+	    break;
+	  }
+	  case RTSPMessageParser::LOCATION: {
+	    setBaseURL(headerParamsStr);
+	    break;
+	  }
+	  case RTSPMessageParser::COM_SES_STREAMID: {
+	    // Replace the tail of the 'base URL' with the value of this header parameter:
+	    char* oldBaseURLTail = strrchr(fBaseURL, '/');
+	    if (oldBaseURLTail != NULL) {
+	      unsigned newBaseURLLen
+		= (oldBaseURLTail - fBaseURL) + 8/* for "/stream=" */ + strlen(headerParamsStr);
+	      char* newBaseURL = new char[newBaseURLLen + 1];
+	          // Note: We couldn't use "asprintf()", because some compilers don't support it
+	      sprintf(newBaseURL, "%.*s/stream=%s",
+		      (int)(oldBaseURLTail - fBaseURL), fBaseURL, headerParamsStr);
+	      setBaseURL(newBaseURL);
+	      delete[] newBaseURL;
+	    }
+	    break;
 	  }
-	} else if (checkForHeader(lineStart, "Connection:", 11, headerParamsStr)) {
-	  if (fTunnelOverHTTPPortNum == 0 && _strncasecmp(headerParamsStr, "Close", 5) == 0) {
-	    resetTCPSockets();
+	  case RTSPMessageParser::CONNECTION: {
+	    if (fTunnelOverHTTPPortNum == 0 && _strncasecmp(headerParamsStr, "Close", 5) == 0) {
+	      resetTCPSockets();
+	    }
+	    break;
+	  }
+	  default: {
+	    break;
 	  }
 	}
       }
-      if (!reachedEndOfHeaders) break; // an error occurred
+      if (badHeader) break; // an error occurred
       
       if (foundRequest == NULL) {
 	// Hack: The response didn't have a "CSeq:" header; assume it's for our most recent request:
@@ -1762,9 +1749,8 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
       }
       
       // If we saw a "Content-Length:" header, then make sure that we have the amount of data that it specified:
-      unsigned bodyOffset = nextLineStart == NULL ? fResponseBytesAlreadySeen : nextLineStart - headerDataCopy;
-      bodyStart = &fResponseBuffer[bodyOffset];
-      numBodyBytes = fResponseBytesAlreadySeen - bodyOffset;
+      bodyStart = &fResponseBuffer[headersSize];
+      numBodyBytes = fResponseBytesAlreadySeen - headersSize;
       if (contentLength > numBodyBytes) {
 	// We need to read more data.  First, make sure we have enough space for it:
 	unsigned numExtraBytesNeeded = contentLength - numBodyBytes;
@@ -1782,7 +1768,6 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 		  << (foundRequest != NULL ? foundRequest->commandName() : "(unknown)")
 		  << " RTSP response; awaiting " << numExtraBytesNeeded << " bytes more.\n";
 	}
-	delete[] headerDataCopy;
 	if (foundRequest != NULL) fRequestsAwaitingResponse.putAtHead(foundRequest);// put our request record back; we need it again
 	return; // We need to read more data
       }
@@ -1807,6 +1792,7 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	  // Do special-case response handling for some commands:
 	  if (strcmp(foundRequest->commandName(), "SETUP") == 0) {
 	    if (!handleSETUPResponse(*foundRequest->subsession(), sessionParamsStr, transportParamsStr, foundRequest->booleanFlags()&0x1)) break;
+	    if ((foundRequest->booleanFlags()&0x1) != 0) startedRTPOverTCP = True;
 	  } else if (strcmp(foundRequest->commandName(), "PLAY") == 0) {
 	    if (!handlePLAYResponse(*foundRequest->session(), *foundRequest->subsession(), scaleParamsStr, speedParamsStr, rangeParamsStr, rtpInfoParamsStr)) break;
 	  } else if (strcmp(foundRequest->commandName(), "TEARDOWN") == 0) {
@@ -1832,7 +1818,6 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	if (needToResendCommand) {
 	  resetResponseBuffer();
 	  (void)resendCommand(foundRequest);
-	  delete[] headerDataCopy;
 	  return; // without calling our response handler; the response to the resent command will do that
 	}
       }
@@ -1855,10 +1840,19 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	*responseEnd = saved;
       }
       
-      memmove(fResponseBuffer, responseEnd, numExtraBytesAfterResponse);
-      fResponseBytesAlreadySeen = numExtraBytesAfterResponse;
-      fResponseBufferBytesLeft = responseBufferSize - numExtraBytesAfterResponse;
-      fResponseBuffer[numExtraBytesAfterResponse] = '\0';
+      if (startedRTPOverTCP
+	  && RTPInterface::pushBackStreamSocketInput(envir(), fInputSocketNum, (u_int8_t*)responseEnd, numExtraBytesAfterResponse)) {
+	// Our socket is now read for RTP-over-TCP, and the extra bytes might be RTP or RTCP packets (sent ahead of the
+	// response to a pipelined "PLAY"), so they're handled there; any response bytes come back to us, one at a time:
+	resetResponseBuffer();
+	extraBytesWerePushedBack = True;
+      } else {
+	memmove(fResponseBuffer, responseEnd, numExtraBytesAfterResponse);
+	fResponseBytesAlreadySeen = numExtraBytesAfterResponse;
+	fResponseBufferBytesLeft = responseBufferSize - numExtraBytesAfterResponse;
+	fResponseBuffer[numExtraBytesAfterResponse] = '\0';
+	fResponseParser.reset();
+      }
     } else {
       resetResponseBuffer();
     }
@@ -1882,9 +1876,8 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
       }
     }
     delete foundRequest;
-    delete[] headerDataCopy;
     if (numExtraBytesAfterResponse > 0 && numBodyBytes > 0) delete[] bodyStart;
-  } while (numExtraBytesAfterResponse > 0 && responseSuccess);
+  } while (numExtraBytesAfterResponse > 0 && responseSuccess && !extraBytesWerePushedBack);
 }
 
 
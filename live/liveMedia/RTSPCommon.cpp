@@ -48,166 +48,365 @@ static void decodeURL(char* url) {
   *url = '\0';
 }
 
-Boolean parseRTSPRequestString(char const* reqStr,
-			       unsigned reqStrSize,
-			       char* resultCmdName,
-			       unsigned resultCmdNameMaxSize,
-			       char* resultURLPreSuffix,
-			       unsigned resultURLPreSuffixMaxSize,
-			       char* resultURLSuffix,
-			       unsigned resultURLSuffixMaxSize,
-			       char* resultCSeq,
-			       unsigned resultCSeqMaxSize,
-                               char* resultSessionIdStr,
-                               unsigned resultSessionIdStrMaxSize,
-			       unsigned& contentLength) {
-  // This parser is currently rather dumb; it should be made smarter #####
+////////// RTSPMessageParser implementation //////////
+
+static char const* const knownHeaderNames[RTSPMessageParser::NUM_KNOWN_HEADERS] = {
+  "CSeq", "Session", "Content-Length", "Content-Base", "Content-Type", "Transport", "Range", "Scale", "Speed", "RTP-Info",
+  "WWW-Authenticate", "Public", "Allow", "Location", "com.ses.streamID", "Connection", "Authorization", "Accept",
+  "x-sessioncookie", "User-Agent", "Date", "Require", "Cache-Control", "Pragma"
+};
+
+// A perfect hash of the (case-insensitive) names above: "hash = hash*5 + (c|0x20)" over the name's characters; then the low
+// 6 bits of "hash" index this table.  (If you add a header name, check that it doesn't collide with an existing one.)
+#define HEADER_NAME_HASH_STEP(hash, c) ((hash)*5 + ((c)|0x20))
+#define HEADER_NAME_HASH_TABLE_SIZE 64
+static RTSPMessageParser::HeaderId const headerNameHashTable[HEADER_NAME_HASH_TABLE_SIZE] = {
+  RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN,
+  RTSPMessageParser::UNKNOWN, RTSPMessageParser::WWW_AUTHENTICATE, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN,
+  RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::COM_SES_STREAMID,
+  RTSPMessageParser::UNKNOWN, RTSPMessageParser::REQUIRE, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN,
+  RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::CONTENT_TYPE, RTSPMessageParser::UNKNOWN,
+  RTSPMessageParser::SCALE, RTSPMessageParser::RANGE, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN,
+  RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::RTP_INFO,
+  RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN,
+  RTSPMessageParser::ACCEPT, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::USER_AGENT,
+  RTSPMessageParser::UNKNOWN, RTSPMessageParser::TRANSPORT, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN,
+  RTSPMessageParser::UNKNOWN, RTSPMessageParser::AUTHORIZATION, RTSPMessageParser::CONTENT_LENGTH, RTSPMessageParser::PUBLIC,
+  RTSPMessageParser::CONNECTION, RTSPMessageParser::SPEED, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN,
+  RTSPMessageParser::PRAGMA, RTSPMessageParser::LOCATION, RTSPMessageParser::CACHE_CONTROL, RTSPMessageParser::UNKNOWN,
+  RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::DATE, RTSPMessageParser::X_SESSIONCOOKIE,
+  RTSPMessageParser::SESSION, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::ALLOW,
+  RTSPMessageParser::CSEQ, RTSPMessageParser::UNKNOWN, RTSPMessageParser::UNKNOWN, RTSPMessageParser::CONTENT_BASE
+};
+
+static RTSPMessageParser::HeaderId lookupHeaderNameWithHash(char const* name, unsigned nameSize, u_int32_t hash) {
+  RTSPMessageParser::HeaderId id = headerNameHashTable[hash&(HEADER_NAME_HASH_TABLE_SIZE-1)];
+  if (id == RTSPMessageParser::UNKNOWN) return id;
+
+  // Check that this really is the name (rather than another one with the same hash):
+  char const* knownName = knownHeaderNames[id];
+  if (strlen(knownName) != nameSize || _strncasecmp(name, knownName, nameSize) != 0) return RTSPMessageParser::UNKNOWN;
+  return id;
+}
+
+RTSPMessageParser::HeaderId RTSPMessageParser::lookupHeaderName(char const* name, unsigned nameSize) {
+  u_int32_t hash = 0;
+  for (unsigned i = 0; i < nameSize; ++i) hash = HEADER_NAME_HASH_STEP(hash, name[i]);
+  return lookupHeaderNameWithHash(name, nameSize, hash);
+}
+
+char const* RTSPMessageParser::headerName(HeaderId id) {
+  return id < NUM_KNOWN_HEADERS ? knownHeaderNames[id] : NULL;
+}
+
+void RTSPMessageParser::reset() {
+  fState = START;
+  fParsedSize = 0;
+  fHaveCR = False;
+  fHeadersSize = 0;
+  fStartLineOffset = fStartLineEnd = fFirstSpace = fLastTokenOffset = fLastTokenSpaceOffset = fSpaceOffset = 0;
+  fInSpace = False;
+  fNameOffset = fValueOffset = 0;
+  fNameHash = 0;
+  fCurrentHeaderId = UNKNOWN;
+  fNumKnownHeaders = 0;
+  for (unsigned i = 0; i < NUM_KNOWN_HEADERS; ++i) fFirstValueOffset[i] = fFirstValueSize[i] = 0;
+}
 
-  // "Be liberal in what you accept": Skip over any whitespace at the start of the request:
+Boolean RTSPMessageParser::parse(char const* message, unsigned messageSize) {
   unsigned i;
-  for (i = 0; i < reqStrSize; ++i) {
-    char c = reqStr[i];
-    if (!(c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\0')) break;
+  for (i = fParsedSize; i < messageSize && fState != DONE; ++i) {
+    char const c = message[i];
+    Boolean const isEndOfLine = c == '\r' || c == '\n';
+
+    switch (fState) {
+      case START: {
+	// "Be liberal in what you accept": Skip over any white space at the start of the message:
+	if (c == ' ' || c == '\t' || isEndOfLine || c == '\0') break;
+
+	fStartLineOffset = fLastTokenOffset = i;
+	fState = START_LINE;
+	break;
+      }
+      case START_LINE: {
+	if (isEndOfLine) {
+	  fStartLineEnd = fInSpace ? fSpaceOffset : i; // omitting any trailing white space
+	  if (fFirstSpace == 0) fFirstSpace = fStartLineEnd;
+	  fHaveCR = c == '\r';
+	  fState = LINE_START;
+	} else if (c == ' ' || c == '\t') {
+	  if (fFirstSpace == 0) fFirstSpace = i;
+	  if (!fInSpace) fSpaceOffset = i;
+	  fInSpace = True;
+	} else if (fInSpace) {
+	  fLastTokenOffset = i;
+	  fLastTokenSpaceOffset = fSpaceOffset;
+	  fInSpace = False;
+	}
+	break;
+      }
+      case LINE_START: {
+	if (c == '\n' && fHaveCR) { // the rest of the previous line's <CR><LF>
+	  fHaveCR = False;
+	  break;
+	}
+	fHaveCR = False;
+
+	if (c == '\n') {
+	  // A blank line: the end of the headers
+	  fHeadersSize = i+1;
+	  fState = DONE;
+	} else if (c == '\r') {
+	  fState = BLANK_LINE_CR;
+	} else {
+	  fNameOffset = i;
+	  fNameHash = HEADER_NAME_HASH_STEP(0, c);
+	  fState = HEADER_NAME;
+	}
+	break;
+      }
+      case HEADER_NAME: {
+	if (c == ':') {
+	  fCurrentHeaderId = lookupHeaderNameWithHash(&message[fNameOffset], i - fNameOffset, fNameHash);
+	  fState = HEADER_VALUE_START;
+	} else if (isEndOfLine) {
+	  // A (bad) header line with no ':'; ignore it
+	  fHaveCR = c == '\r';
+	  fState = LINE_START;
+	} else {
+	  fNameHash = HEADER_NAME_HASH_STEP(fNameHash, c);
+	}
+	break;
+      }
+      case HEADER_VALUE_START: {
+	if (c == ' ' || c == '\t') break;
+
+	fValueOffset = i;
+	if (isEndOfLine) {
+	  noteHeader(i); // with an empty value
+	  fHaveCR = c == '\r';
+	  fState = LINE_START;
+	} else {
+	  fState = HEADER_VALUE;
+	}
+	break;
+      }
+      case HEADER_VALUE: {
+	if (isEndOfLine) {
+	  noteHeader(i);
+	  fHaveCR = c == '\r';
+	  fState = LINE_START;
+	}
+	break;
+      }
+      case BLANK_LINE_CR: {
+	// The headers end with this blank line's <CR> - and also its <LF>, if that's what this is:
+	fHeadersSize = c == '\n' ? i+1 : i;
+	fState = DONE;
+	break;
+      }
+      case DONE: {
+	break;
+      }
+    }
   }
-  if (i == reqStrSize) return False; // The request consisted of nothing but whitespace!
-
-  // Then read everything up to the next space (or tab) as the command name:
-  Boolean parseSucceeded = False;
-  unsigned i1 = 0;
-  for (; i1 < resultCmdNameMaxSize-1 && i < reqStrSize; ++i,++i1) {
-    char c = reqStr[i];
-    if (c == ' ' || c == '\t') {
-      parseSucceeded = True;
+  fParsedSize = i;
+  if (fState == DONE) fParsedSize = fHeadersSize; // in case we stopped on a byte that's not part of the headers
+
+  return fState == DONE;
+}
+
+void RTSPMessageParser::finish(unsigned messageSize) {
+  switch (fState) {
+    case START_LINE: {
+      fStartLineEnd = fInSpace ? fSpaceOffset : messageSize;
+      if (fFirstSpace == 0) fFirstSpace = fStartLineEnd;
       break;
     }
-
-    resultCmdName[i1] = c;
-  }
-  resultCmdName[i1] = '\0';
-  if (!parseSucceeded) return False;
-
-  // Skip over the prefix of any "rtsp://" or "rtsp:/" URL that follows:
-  unsigned j = i+1;
-  while (j < reqStrSize && (reqStr[j] == ' ' || reqStr[j] == '\t')) ++j; // skip over any additional white space
-  for (; (int)j < (int)(reqStrSize-8); ++j) {
-    if ((reqStr[j] == 'r' || reqStr[j] == 'R')
-	&& (reqStr[j+1] == 't' || reqStr[j+1] == 'T')
-	&& (reqStr[j+2] == 's' || reqStr[j+2] == 'S')
-	&& (reqStr[j+3] == 'p' || reqStr[j+3] == 'P')
-	&& reqStr[j+4] == ':' && reqStr[j+5] == '/') {
-      j += 6;
-      if (reqStr[j] == '/') {
-	// This is a "rtsp://" URL; skip over the host:port part that follows:
-	++j;
-	while (j < reqStrSize && reqStr[j] != '/' && reqStr[j] != ' ') ++j;
-      } else {
-	// This is a "rtsp:/" URL; back up to the "/":
-	--j;
-      }
-      i = j;
+    case HEADER_VALUE_START: {
+      fValueOffset = messageSize;
+      // fall through:
+    }
+    case HEADER_VALUE: {
+      noteHeader(messageSize);
+      break;
+    }
+    default: {
       break;
     }
   }
+  fHeadersSize = fParsedSize = messageSize;
+  fState = DONE;
+}
 
-  // Look for the URL suffix (before the following "RTSP/"):
-  parseSucceeded = False;
-  for (unsigned k = i+1; (int)k < (int)(reqStrSize-5); ++k) {
-    if (reqStr[k] == 'R' && reqStr[k+1] == 'T' &&
-	reqStr[k+2] == 'S' && reqStr[k+3] == 'P' && reqStr[k+4] == '/') {
-      while (--k >= i && reqStr[k] == ' ') {} // go back over all spaces before "RTSP/"
-      unsigned k1 = k;
-      while (k1 > i && reqStr[k1] != '/') --k1;
-
-      // ASSERT: At this point
-      //   i: first space or slash after "host" or "host:port"
-      //   k: last non-space before "RTSP/"
-      //   k1: last slash in the range [i,k]
-
-      // The URL suffix comes from [k1+1,k]
-      // Copy "resultURLSuffix":
-      unsigned n = 0, k2 = k1+1;
-      if (k2 <= k) {
-        if (k - k1 + 1 > resultURLSuffixMaxSize) return False; // there's no room
-        while (k2 <= k) resultURLSuffix[n++] = reqStr[k2++];
-      }
-      resultURLSuffix[n] = '\0';
-
-      // The URL 'pre-suffix' comes from [i+1,k1-1]
-      // Copy "resultURLPreSuffix":
-      n = 0; k2 = i+1;
-      if (k2+1 <= k1) {
-        if (k1 - i > resultURLPreSuffixMaxSize) return False; // there's no room
-        while (k2 <= k1-1) resultURLPreSuffix[n++] = reqStr[k2++];
-      }
-      resultURLPreSuffix[n] = '\0';
-      decodeURL(resultURLPreSuffix);
+void RTSPMessageParser::noteHeader(unsigned endOffset) {
+  if (fCurrentHeaderId == UNKNOWN) return;
 
-      i = k + 7; // to go past " RTSP/"
-      parseSucceeded = True;
-      break;
-    }
+  unsigned const valueSize = endOffset - fValueOffset;
+  if (fFirstValueOffset[fCurrentHeaderId] == 0) {
+    fFirstValueOffset[fCurrentHeaderId] = fValueOffset;
+    fFirstValueSize[fCurrentHeaderId] = valueSize;
   }
-  if (!parseSucceeded) return False;
-
-  // Look for "CSeq:" (mandatory, case insensitive), skip whitespace,
-  // then read everything up to the next \r or \n as 'CSeq':
-  parseSucceeded = False;
-  for (j = i; (int)j < (int)(reqStrSize-5); ++j) {
-    if (_strncasecmp("CSeq:", &reqStr[j], 5) == 0) {
-      j += 5;
-      while (j < reqStrSize && (reqStr[j] ==  ' ' || reqStr[j] == '\t')) ++j;
-      unsigned n;
-      for (n = 0; n < resultCSeqMaxSize-1 && j < reqStrSize; ++n,++j) {
-	char c = reqStr[j];
-	if (c == '\r' || c == '\n') {
-	  parseSucceeded = True;
-	  break;
-	}
+  if (fNumKnownHeaders < RTSP_MAX_KNOWN_HEADERS) {
+    fKnownHeaders[fNumKnownHeaders].id = (u_int8_t)fCurrentHeaderId;
+    fKnownHeaders[fNumKnownHeaders].valueOffset = fValueOffset;
+    fKnownHeaders[fNumKnownHeaders].valueSize = valueSize;
+    ++fNumKnownHeaders;
+  }
+  fCurrentHeaderId = UNKNOWN;
+}
 
-	resultCSeq[n] = c;
-      }
-      resultCSeq[n] = '\0';
-      break;
-    }
+Boolean RTSPMessageParser::lookupHeader(HeaderId id, unsigned& valueOffset, unsigned& valueSize) const {
+  if (id >= NUM_KNOWN_HEADERS || fFirstValueOffset[id] == 0) return False;
+
+  valueOffset = fFirstValueOffset[id];
+  valueSize = fFirstValueSize[id];
+  return True;
+}
+
+Boolean RTSPMessageParser
+::copyHeaderValue(char const* message, HeaderId id, char* resultStr, unsigned resultMaxSize) const {
+  resultStr[0] = '\0'; // by default
+  unsigned valueOffset, valueSize;
+  if (!lookupHeader(id, valueOffset, valueSize) || valueSize >= resultMaxSize) return False;
+
+  memcpy(resultStr, &message[valueOffset], valueSize);
+  resultStr[valueSize] = '\0';
+  return True;
+}
+
+unsigned RTSPMessageParser::contentLength(char const* message) const {
+  unsigned valueOffset, valueSize;
+  if (!lookupHeader(CONTENT_LENGTH, valueOffset, valueSize)) return 0;
+
+  unsigned result = 0;
+  for (unsigned i = 0; i < valueSize; ++i) {
+    char const c = message[valueOffset+i];
+    if (c < '0' || c > '9') break;
+    if (result > 100000000) return 0; // absurdly large
+    result = 10*result + (c - '0');
   }
-  if (!parseSucceeded) return False;
-
-  // Look for "Session:" (optional, case insensitive), skip whitespace,
-  // then read everything up to the next \r or \n as 'Session':
-  resultSessionIdStr[0] = '\0'; // default value (empty string)
-  for (j = i; (int)j < (int)(reqStrSize-8); ++j) {
-    if (_strncasecmp("Session:", &reqStr[j], 8) == 0) {
-      j += 8;
-      while (j < reqStrSize && (reqStr[j] ==  ' ' || reqStr[j] == '\t')) ++j;
-      unsigned n;
-      for (n = 0; n < resultSessionIdStrMaxSize-1 && j < reqStrSize; ++n,++j) {
-	char c = reqStr[j];
-	if (c == '\r' || c == '\n') {
-	  break;
-	}
+  return result;
+}
 
-	resultSessionIdStr[n] = c;
-      }
-      resultSessionIdStr[n] = '\0';
-      break;
+Boolean RTSPMessageParser::getRequestLine(char const* message, char const* protocolPrefix,
+					  char* resultCmdName, unsigned resultCmdNameMaxSize,
+					  unsigned& urlOffset, unsigned& urlSize) const {
+  // A request line is "<command-name> <url> <protocol>", where the last token begins with "protocolPrefix":
+  if (fStartLineEnd == fStartLineOffset || fLastTokenOffset == fStartLineOffset) return False; // fewer than 2 tokens
+
+  unsigned const prefixSize = strlen(protocolPrefix);
+  if (fStartLineEnd - fLastTokenOffset < prefixSize
+      || strncmp(&message[fLastTokenOffset], protocolPrefix, prefixSize) != 0) return False;
+
+  unsigned const cmdNameSize = fFirstSpace - fStartLineOffset;
+  if (cmdNameSize >= resultCmdNameMaxSize) return False;
+  memcpy(resultCmdName, &message[fStartLineOffset], cmdNameSize);
+  resultCmdName[cmdNameSize] = '\0';
+
+  // The URL is everything between the command name and the protocol (omitting white space), and might be empty:
+  urlOffset = fFirstSpace;
+  while (urlOffset < fLastTokenSpaceOffset && (message[urlOffset] == ' ' || message[urlOffset] == '\t')) ++urlOffset;
+  urlSize = fLastTokenSpaceOffset > urlOffset ? fLastTokenSpaceOffset - urlOffset : 0;
+  return True;
+}
+
+Boolean RTSPMessageParser::getRTSPRequestParams(char const* message,
+						char* resultCmdName, unsigned resultCmdNameMaxSize,
+						char* resultURLPreSuffix, unsigned resultURLPreSuffixMaxSize,
+						char* resultURLSuffix, unsigned resultURLSuffixMaxSize,
+						char* resultCSeq, unsigned resultCSeqMaxSize,
+						char* resultSessionId, unsigned resultSessionIdMaxSize) const {
+  unsigned urlOffset, urlSize;
+  if (!getRequestLine(message, "RTSP/", resultCmdName, resultCmdNameMaxSize, urlOffset, urlSize)) return False;
+  char const* url = &message[urlOffset];
+  int const urlEnd = (int)urlSize;
+
+  // Skip over the prefix of any "rtsp://" or "rtsp:/" URL:
+  int i = -1; // the first slash after "host" or "host:port" (or the position before the URL)
+  if (urlSize >= 6 && _strncasecmp(url, "rtsp:/", 6) == 0) {
+    int j = 6;
+    if (j < urlEnd && url[j] == '/') {
+      // This is a "rtsp://" URL; skip over the host:port part that follows:
+      ++j;
+      while (j < urlEnd && url[j] != '/') ++j;
+    } else {
+      // This is a "rtsp:/" URL; back up to the "/":
+      --j;
     }
+    i = j;
   }
 
-  // Also: Look for "Content-Length:" (optional, case insensitive)
-  contentLength = 0; // default value
-  for (j = i; (int)j < (int)(reqStrSize-15); ++j) {
-    if (_strncasecmp("Content-Length:", &(reqStr[j]), 15) == 0) {
-      j += 15;
-      while (j < reqStrSize && (reqStr[j] ==  ' ' || reqStr[j] == '\t')) ++j;
-      unsigned num;
-      if (sscanf(&reqStr[j], "%u", &num) == 1) {
-	contentLength = num;
-      }
-    }
+  // The URL suffix is after the last slash; the URL 'pre-suffix' is between the first slash (at "i") and the last slash:
+  int const k = urlEnd - 1;
+  int k1 = k;
+  while (k1 > i && url[k1] != '/') --k1;
+
+  unsigned n = 0;
+  int k2 = k1+1;
+  if (k2 <= k) {
+    if ((unsigned)(k - k1 + 1) > resultURLSuffixMaxSize) return False; // there's no room
+    while (k2 <= k) resultURLSuffix[n++] = url[k2++];
+  }
+  resultURLSuffix[n] = '\0';
+
+  n = 0; k2 = i+1;
+  if (k2+1 <= k1) {
+    if ((unsigned)(k1 - i) > resultURLPreSuffixMaxSize) return False; // there's no room
+    while (k2 <= k1-1) resultURLPreSuffix[n++] = url[k2++];
   }
+  resultURLPreSuffix[n] = '\0';
+  decodeURL(resultURLPreSuffix);
+
+  // "CSeq:" is mandatory; "Session:" is optional:
+  if (!copyHeaderValue(message, CSEQ, resultCSeq, resultCSeqMaxSize)) return False;
+  copyHeaderValue(message, SESSION, resultSessionId, resultSessionIdMaxSize);
+
   return True;
 }
 
+Boolean RTSPMessageParser::getHTTPRequestParams(char const* message,
+						char* resultCmdName, unsigned resultCmdNameMaxSize,
+						char* resultURLSuffix, unsigned resultURLSuffixMaxSize) const {
+  unsigned urlOffset, urlSize;
+  if (!getRequestLine(message, "HTTP/", resultCmdName, resultCmdNameMaxSize, urlOffset, urlSize)) return False;
+
+  // The 'URL suffix' is the part of the URL after its last slash:
+  unsigned suffixOffset = urlOffset + urlSize;
+  while (suffixOffset > urlOffset && message[suffixOffset-1] != '/') --suffixOffset;
+  unsigned const suffixSize = urlOffset + urlSize - suffixOffset;
+  if (suffixSize >= resultURLSuffixMaxSize) return False; // there's no room
+
+  memcpy(resultURLSuffix, &message[suffixOffset], suffixSize);
+  resultURLSuffix[suffixSize] = '\0';
+  return True;
+}
+
+Boolean parseRTSPRequestString(char const* reqStr,
+			       unsigned reqStrSize,
+			       char* resultCmdName,
+			       unsigned resultCmdNameMaxSize,
+			       char* resultURLPreSuffix,
+			       unsigned resultURLPreSuffixMaxSize,
+			       char* resultURLSuffix,
+			       unsigned resultURLSuffixMaxSize,
+			       char* resultCSeq,
+			       unsigned resultCSeqMaxSize,
+                               char* resultSessionIdStr,
+                               unsigned resultSessionIdStrMaxSize,
+			       unsigned& contentLength) {
+  RTSPMessageParser parser;
+  if (!parser.parse(reqStr, reqStrSize)) parser.finish(reqStrSize);
+
+  contentLength = parser.contentLength(reqStr);
+  return parser.getRTSPRequestParams(reqStr,
+				     resultCmdName, resultCmdNameMaxSize,
+				     resultURLPreSuffix, resultURLPreSuffixMaxSize,
+				     resultURLSuffix, resultURLSuffixMaxSize,
+				     resultCSeq, resultCSeqMaxSize,
+				     resultSessionIdStr, resultSessionIdStrMaxSize);
+}
+
 Boolean parseRangeParam(char const* paramStr,
 			double& rangeStart, double& rangeEnd,
 			char*& absStartTime, char*& absEndTime,
@@ -272,7 +272,7 @@ RTSPServer::RTSPClientConnection
 ::RTSPClientConnection(RTSPServer& ourServer, int clientSocket, struct sockaddr_in clientAddr)
   : GenericMediaServer::ClientConnection(ourServer, clientSocket, clientAddr),
     fOurRTSPServer(ourServer), fClientInputSocket(fOurSocket), fClientOutputSocket(fOurSocket),
-    fIsActive(True), fRecursionCount(0), fOurSessionCookie(NULL) {
+    fIsActive(True), fRecursionCount(0), fOurSessionCookie(NULL), fPipelineId(0), fPipelinedSessionId(0) {
   resetRequestBuffer();
 }
 
@@ -381,28 +381,6 @@ void RTSPServer::RTSPClientConnection
   delete[] rtspURL;
 }
 
-static void lookForHeader(char const* headerName, char const* source, unsigned sourceLen, char* resultStr, unsigned resultMaxSize) {
-  resultStr[0] = '\0';  // by default, return an empty string
-  unsigned headerNameLen = strlen(headerName);
-  for (int i = 0; i < (int)(sourceLen-headerNameLen); ++i) {
-    if (strncmp(&source[i], headerName, headerNameLen) == 0 && source[i+headerNameLen] == ':') {
-      // We found the header.  Skip over any whitespace, then copy the rest of the line to "resultStr":
-      for (i += headerNameLen+1; i < (int)sourceLen && (source[i] == ' ' || source[i] == '\t'); ++i) {}
-      for (unsigned j = i; j < sourceLen; ++j) {
-	if (source[j] == '\r' || source[j] == '\n') {
-	  // We've found the end of the line.  Copy it to the result (if it will fit):
-	  if (j-i+1 > resultMaxSize) break;
-	  char const* resultSource = &source[i];
-	  char const* resultSourceEnd = &source[j];
-	  while (resultSource < resultSourceEnd) *resultStr++ = *resultSource++;
-	  *resultStr = '\0';
-	  break;
-	}
-      }
-    }
-  }
-}
-
 void RTSPServer::RTSPClientConnection::handleCmd_bad() {
   // Don't do anything with "fCurrentCSeq", because it might be nonsense
   snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
@@ -432,51 +410,15 @@ Boolean RTSPServer::RTSPClientConnection::parseHTTPRequestString(char* resultCmd
 								 char* urlSuffix, unsigned urlSuffixMaxSize,
 								 char* sessionCookie, unsigned sessionCookieMaxSize,
 								 char* acceptStr, unsigned acceptStrMaxSize) {
-  // Check for the limited HTTP requests that we expect for specifying RTSP-over-HTTP tunneling.
-  // This parser is currently rather dumb; it should be made smarter #####
+  // Check for the limited HTTP requests that we expect for specifying RTSP-over-HTTP tunneling:
   char const* reqStr = (char const*)fRequestBuffer;
-  unsigned const reqStrSize = fRequestBytesAlreadySeen;
-  
-  // Read everything up to the first space as the command name:
-  Boolean parseSucceeded = False;
-  unsigned i;
-  for (i = 0; i < resultCmdNameMaxSize-1 && i < reqStrSize; ++i) {
-    char c = reqStr[i];
-    if (c == ' ' || c == '\t') {
-      parseSucceeded = True;
-      break;
-    }
-    
-    resultCmdName[i] = c;
-  }
-  resultCmdName[i] = '\0';
-  if (!parseSucceeded) return False;
-  
-  // Look for the string "HTTP/", before the first \r or \n:
-  parseSucceeded = False;
-  for (; i < reqStrSize-5 && reqStr[i] != '\r' && reqStr[i] != '\n'; ++i) {
-    if (reqStr[i] == 'H' && reqStr[i+1] == 'T' && reqStr[i+2]== 'T' && reqStr[i+3]== 'P' && reqStr[i+4]== '/') {
-      i += 5; // to advance past the "HTTP/"
-      parseSucceeded = True;
-      break;
-    }
+  if (!fRequestParser.getHTTPRequestParams(reqStr, resultCmdName, resultCmdNameMaxSize, urlSuffix, urlSuffixMaxSize)) {
+    return False;
   }
-  if (!parseSucceeded) return False;
-  
-  // Get the 'URL suffix' that occurred before this:
-  unsigned k = i-6;
-  while (k > 0 && reqStr[k] == ' ') --k; // back up over white space
-  unsigned j = k;
-  while (j > 0 && reqStr[j] != ' ' && reqStr[j] != '/') --j;
-  // The URL suffix is in position (j,k]:
-  if (k - j + 1 > urlSuffixMaxSize) return False; // there's no room> 
-  unsigned n = 0;
-  while (++j <= k) urlSuffix[n++] = reqStr[j];
-  urlSuffix[n] = '\0';
   
   // Look for various headers that we're interested in:
-  lookForHeader("x-sessioncookie", &reqStr[i], reqStrSize-i, sessionCookie, sessionCookieMaxSize);
-  lookForHeader("Accept", &reqStr[i], reqStrSize-i, acceptStr, acceptStrMaxSize);
+  fRequestParser.copyHeaderValue(reqStr, RTSPMessageParser::X_SESSIONCOOKIE, sessionCookie, sessionCookieMaxSize);
+  fRequestParser.copyHeaderValue(reqStr, RTSPMessageParser::ACCEPT, acceptStr, acceptStrMaxSize);
   
   return True;
 }
@@ -565,7 +507,7 @@ void RTSPServer::RTSPClientConnection::handleHTTPCmd_StreamingGET(char const* /*
 void RTSPServer::RTSPClientConnection::resetRequestBuffer() {
   ClientConnection::resetRequestBuffer();
   
-  fLastCRLF = &fRequestBuffer[-3]; // hack: Ensures that we don't think we have end-of-msg if the data starts with <CR><LF>
+  fRequestParser.reset();
   fBase64RemainderCount = 0;
 }
 
@@ -604,6 +546,21 @@ void RTSPServer::RTSPClientConnection::handleAlternativeRequestByte1(u_int8_t re
   }
 }
 
+static inline Boolean isBase64Whitespace(unsigned char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static Boolean parsePipelinedRequestsHeader(char const* buf, unsigned bufSize, u_int32_t& pipelineId) {
+  // Find a "Pipelined-Requests:" header (RFC 7826, section 18.33), if present, in the first "bufSize" bytes of "buf":
+  for (unsigned i = 0; i + 19 < bufSize; ++i) {
+    if ((i == 0 || buf[i-1] == '\n') && _strncasecmp(&buf[i], "Pipelined-Requests:", 19) == 0) {
+      return sscanf(&buf[i+19], " %u", &pipelineId) == 1 && pipelineId != 0;
+    }
+  }
+
+  return False;
+}
+
 void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
   int numBytesRemaining = 0;
   ++fRecursionCount;
@@ -621,7 +578,6 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
       break;
     }
     
-    Boolean endOfMsg = False;
     unsigned char* ptr = &fRequestBuffer[fRequestBytesAlreadySeen];
 #ifdef DEBUG
     ptr[newBytesRead] = '\0';
@@ -633,13 +589,13 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
       // We're doing RTSP-over-HTTP tunneling, and input commands are assumed to have been Base64-encoded.
       // We therefore Base64-decode as much of this new data as we can (i.e., up to a multiple of 4 bytes).
       
-      // But first, we remove any whitespace that may be in the input data:
+      // But first, we remove any whitespace that may be in the input data.  (There usually isn't any, so we don't start
+      // moving bytes until we find some.)
       unsigned toIndex = 0;
-      for (int fromIndex = 0; fromIndex < newBytesRead; ++fromIndex) {
-	char c = ptr[fromIndex];
-	if (!(c == ' ' || c == '\t' || c == '\r' || c == '\n')) { // not 'whitespace': space,tab,CR,NL
-	  ptr[toIndex++] = c;
-	}
+      while (toIndex < (unsigned)newBytesRead && !isBase64Whitespace(ptr[toIndex])) ++toIndex;
+      for (unsigned fromIndex = toIndex; fromIndex < (unsigned)newBytesRead; ++fromIndex) {
+	unsigned char c = ptr[fromIndex];
+	if (!isBase64Whitespace(c)) ptr[toIndex++] = c;
       }
       newBytesRead = toIndex;
       
@@ -647,49 +603,31 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
       unsigned newBase64RemainderCount = numBytesToDecode%4;
       numBytesToDecode -= newBase64RemainderCount;
       if (numBytesToDecode > 0) {
-	ptr[newBytesRead] = '\0';
-	unsigned decodedSize;
-	unsigned char* decodedBytes = base64Decode((char const*)(ptr-fBase64RemainderCount), numBytesToDecode, decodedSize);
+	// Decode in place (we can do this because there are fewer decoded bytes than original),
+	// then move any remaining (undecoded) bytes to follow the decoded ones:
+	unsigned char* from = ptr-fBase64RemainderCount;
+	unsigned decodedSize = base64Decode((char const*)from, numBytesToDecode, from);
 #ifdef DEBUG
 	fprintf(stderr, "Base64-decoded %d input bytes into %d new bytes:", numBytesToDecode, decodedSize);
-	for (unsigned k = 0; k < decodedSize; ++k) fprintf(stderr, "%c", decodedBytes[k]);
+	for (unsigned k = 0; k < decodedSize; ++k) fprintf(stderr, "%c", from[k]);
 	fprintf(stderr, "\n");
 #endif
-	
-	// Copy the new decoded bytes in place of the old ones (we can do this because there are fewer decoded bytes than original):
-	unsigned char* to = ptr-fBase64RemainderCount;
-	for (unsigned i = 0; i < decodedSize; ++i) *to++ = decodedBytes[i];
-	
-	// Then copy any remaining (undecoded) bytes to the end:
-	for (unsigned j = 0; j < newBase64RemainderCount; ++j) *to++ = (ptr-fBase64RemainderCount+numBytesToDecode)[j];
+	memmove(&from[decodedSize], &from[numBytesToDecode], newBase64RemainderCount);
 	
 	newBytesRead = decodedSize - fBase64RemainderCount + newBase64RemainderCount;
 	  // adjust to allow for the size of the new decoded data (+ remainder)
-	delete[] decodedBytes;
       }
       fBase64RemainderCount = newBase64RemainderCount;
     }
     
-    unsigned char* tmpPtr = fLastCRLF + 2;
-    if (fBase64RemainderCount == 0) { // no more Base-64 bytes remain to be read/decoded
-      // Look for the end of the message: <CR><LF><CR><LF>
-      if (tmpPtr < fRequestBuffer) tmpPtr = fRequestBuffer;
-      while (tmpPtr < &ptr[newBytesRead-1]) {
-	if (*tmpPtr == '\r' && *(tmpPtr+1) == '\n') {
-	  if (tmpPtr - fLastCRLF == 2) { // This is it:
-	    endOfMsg = True;
-	    break;
-	  }
-	  fLastCRLF = tmpPtr;
-	}
-	++tmpPtr;
-      }
-    }
-    
     fRequestBufferBytesLeft -= newBytesRead;
     fRequestBytesAlreadySeen += newBytesRead;
     
-    if (!endOfMsg) break; // subsequent reads will be needed to complete the request
+    // Continue parsing the request headers (if no more Base-64 bytes remain to be read/decoded), up to the blank line at their end:
+    if (fBase64RemainderCount > 0 || !fRequestParser.parse((char const*)fRequestBuffer, fRequestBytesAlreadySeen)) {
+      break; // subsequent reads will be needed to complete the request
+    }
+    unsigned const headersSize = fRequestParser.headersSize();
     
     // Parse the request string into command name and 'CSeq', then handle the command:
     fRequestBuffer[fRequestBytesAlreadySeen] = '\0';
@@ -699,22 +637,20 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
     char cseq[RTSP_PARAM_STRING_MAX];
     char sessionIdStr[RTSP_PARAM_STRING_MAX];
     unsigned contentLength = 0;
-    fLastCRLF[2] = '\0'; // temporarily, for parsing
-    Boolean parseSucceeded = parseRTSPRequestString((char*)fRequestBuffer, fLastCRLF+2 - fRequestBuffer,
-						    cmdName, sizeof cmdName,
-						    urlPreSuffix, sizeof urlPreSuffix,
-						    urlSuffix, sizeof urlSuffix,
-						    cseq, sizeof cseq,
-						    sessionIdStr, sizeof sessionIdStr,
-						    contentLength);
-    fLastCRLF[2] = '\r'; // restore its value
+    Boolean parseSucceeded = fRequestParser.getRTSPRequestParams((char const*)fRequestBuffer,
+								 cmdName, sizeof cmdName,
+								 urlPreSuffix, sizeof urlPreSuffix,
+								 urlSuffix, sizeof urlSuffix,
+								 cseq, sizeof cseq,
+								 sessionIdStr, sizeof sessionIdStr);
     Boolean playAfterSetup = False;
     if (parseSucceeded) {
+      contentLength = fRequestParser.contentLength((char const*)fRequestBuffer);
 #ifdef DEBUG
-      fprintf(stderr, "parseRTSPRequestString() succeeded, returning cmdName \"%s\", urlPreSuffix \"%s\", urlSuffix \"%s\", CSeq \"%s\", Content-Length %u, with %d bytes following the message.\n", cmdName, urlPreSuffix, urlSuffix, cseq, contentLength, ptr + newBytesRead - (tmpPtr + 2));
+      fprintf(stderr, "getRTSPRequestParams() succeeded, returning cmdName \"%s\", urlPreSuffix \"%s\", urlSuffix \"%s\", CSeq \"%s\", Content-Length %u, with %d bytes following the message.\n", cmdName, urlPreSuffix, urlSuffix, cseq, contentLength, fRequestBytesAlreadySeen - headersSize);
 #endif
       // If there was a "Content-Length:" header, then make sure we've received all of the data that it specified:
-      if (ptr + newBytesRead < tmpPtr + 2 + contentLength) break; // we still need more data; subsequent reads will give it to us 
+      if (fRequestBytesAlreadySeen < headersSize + contentLength) break; // we still need more data; subsequent reads will give it to us 
       
       // If the request included a "Session:" id, and it refers to a client session that's
       // current ongoing, then use this command to indicate 'liveness' on that client session:
@@ -724,6 +660,18 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 	  = (RTSPServer::RTSPClientSession*)(fOurRTSPServer.lookupClientSession(sessionIdStr));
 	if (clientSession != NULL) clientSession->noteLiveness();
       }
+
+      // A request with no "Session:" id, but with the same "Pipelined-Requests:" id as an earlier "SETUP" (on this
+      // connection), refers to the session that that "SETUP" created.  (This lets a client send e.g. "SETUP" and "PLAY"
+      // back-to-back, without first waiting for the session id.)
+      u_int32_t pipelineId;
+      Boolean const requestIncludedPipelineId
+	= parsePipelinedRequestsHeader((char const*)fRequestBuffer, headersSize, pipelineId);
+      if (!requestIncludedSessionId && requestIncludedPipelineId && pipelineId == fPipelineId) {
+	clientSession
+	  = (RTSPServer::RTSPClientSession*)(fOurRTSPServer.lookupClientSession(fPipelinedSessionId));
+	if (clientSession != NULL) clientSession->noteLiveness();
+      }
     
       // We now have a complete RTSP request.
       // Handle the specified command (beginning with commands that are session-independent):
@@ -751,7 +699,7 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
       } else if (strcmp(cmdName, "SETUP") == 0) {
 	Boolean areAuthenticated = True;
 
-	if (!requestIncludedSessionId) {
+	if (!requestIncludedSessionId && clientSession == NULL) {
 	  // No session id was present in the request.
 	  // So create a new "RTSPClientSession" object for this request.
 
@@ -767,6 +715,10 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 	  if (authenticationOK("SETUP", urlTotalSuffix, (char const*)fRequestBuffer)) {
 	    clientSession
 	      = (RTSPServer::RTSPClientSession*)fOurRTSPServer.createNewClientSessionWithId();
+	    if (clientSession != NULL && requestIncludedPipelineId) {
+	      fPipelineId = pipelineId;
+	      fPipelinedSessionId = clientSession->fOurSessionId;
+	    }
 	  } else {
 	    areAuthenticated = False;
 	  }
@@ -809,17 +761,15 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
       }
     } else {
 #ifdef DEBUG
-      fprintf(stderr, "parseRTSPRequestString() failed; checking now for HTTP commands (for RTSP-over-HTTP tunneling)...\n");
+      fprintf(stderr, "getRTSPRequestParams() failed; checking now for HTTP commands (for RTSP-over-HTTP tunneling)...\n");
 #endif
       // The request was not (valid) RTSP, but check for a special case: HTTP commands (for setting up RTSP-over-HTTP tunneling):
       char sessionCookie[RTSP_PARAM_STRING_MAX];
       char acceptStr[RTSP_PARAM_STRING_MAX];
-      *fLastCRLF = '\0'; // temporarily, for parsing
       parseSucceeded = parseHTTPRequestString(cmdName, sizeof cmdName,
 					      urlSuffix, sizeof urlPreSuffix,
 					      sessionCookie, sizeof sessionCookie,
 					      acceptStr, sizeof acceptStr);
-      *fLastCRLF = '\r';
       if (parseSucceeded) {
 #ifdef DEBUG
 	fprintf(stderr, "parseHTTPRequestString() succeeded, returning cmdName \"%s\", urlSuffix \"%s\", sessionCookie \"%s\", acceptStr \"%s\"\n", cmdName, urlSuffix, sessionCookie, acceptStr);
@@ -841,7 +791,7 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 	} else if (strcmp(cmdName, "POST") == 0) {
 	  // We might have received additional data following the HTTP "POST" command - i.e., the first Base64-encoded RTSP command.
 	  // Check for this, and handle it if it exists:
-	  unsigned char const* extraData = fLastCRLF+4;
+	  unsigned char const* extraData = &fRequestBuffer[headersSize];
 	  unsigned extraDataSize = &fRequestBuffer[fRequestBytesAlreadySeen] - extraData;
 	  if (handleHTTPCmd_TunnelingPOST(sessionCookie, extraData, extraDataSize)) {
 	    // We don't respond to the "POST" command, and we go away:
@@ -865,7 +815,8 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 #ifdef DEBUG
     fprintf(stderr, "sending response: %s", fResponseBuffer);
 #endif
-    send(fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
+    RTPInterface::sendDataOverStreamSocket(envir(), fClientOutputSocket, fResponseBuffer, strlen((char*)fResponseBuffer));
+        // (rather than "send()", in case the socket is also carrying RTP-over-TCP, with packets waiting to be sent)
     
     if (playAfterSetup) {
       // The client has asked for streaming to commence now, rather than after a
@@ -875,7 +826,7 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
     
     // Check whether there are extra bytes remaining in the buffer, after the end of the request (a rare case).
     // If so, move them to the front of our buffer, and keep processing it, because it might be a following, pipelined request.
-    unsigned requestSize = (fLastCRLF+4-fRequestBuffer) + contentLength;
+    unsigned requestSize = headersSize + contentLength;
     numBytesRemaining = fRequestBytesAlreadySeen - requestSize;
     resetRequestBuffer(); // to prepare for any subsequent request
     
@@ -973,20 +924,20 @@ Boolean RTSPServer::RTSPClientConnection
       break;
     }
     
-    // Next, the username has to be known to us:
-    char const* password = authDB->lookupPassword(username);
+    // Next, the username has to be known to us.  (We use the database's cached md5(<username>:<realm>:<password>),
+    // rather than the password itself, so that this isn't recomputed for each request.)
+    char ha1[33];
+    if (!authDB->lookupHA1(username, ha1)) break;
 #ifdef DEBUG
-    fprintf(stderr, "lookupPassword(%s) returned password %s\n", username, password);
+    fprintf(stderr, "lookupHA1(%s) returned %s\n", username, ha1);
 #endif
-    if (password == NULL) break;
-    fCurrentAuthenticator.setUsernameAndPassword(username, password, authDB->passwordsAreMD5());
+    fCurrentAuthenticator.setUsernameAndPassword(username, ha1, True);
     
     // Finally, compute a digest response from the information that we have,
     // and compare it to the one that we were given:
-    char const* ourResponse
-      = fCurrentAuthenticator.computeDigestResponse(cmdName, uri);
+    char ourResponse[33];
+    fCurrentAuthenticator.computeDigestResponse(cmdName, uri, ourResponse);
     success = (strcmp(ourResponse, response) == 0);
-    fCurrentAuthenticator.reclaimDigestResponse(ourResponse);
   } while (0);
   
   delete[] (char*)realm; delete[] (char*)nonce;
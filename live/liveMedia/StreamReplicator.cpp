@@ -34,6 +34,10 @@ private: // redefined virtual functions:
 
 private:
   static void copyReceivedFrame(StreamReplica* toReplica, StreamReplica* fromReplica);
+  void deliverSharedFrame(); // delivers the frame at the head of our queue
+  void scheduleSharedFrameDelivery(); // does this later, from the event loop
+  static void deliverSharedFrameTask(void* clientData);
+  void handleSharedFrameClosure();
 
 private:
   StreamReplicator& fOurReplicator;
@@ -41,32 +45,182 @@ private:
 
   // Replicas that are currently awaiting data are kept in a (singly-linked) list:
   StreamReplica* fNext;
+
+  // Used only in 'shared frames' mode:
+  StreamReplica* fNextReplica; // in the replicator's list of all replicas
+  SharedFrame** fQueue; // a circular queue of frames that have been received for us, but not yet delivered
+  unsigned fQueueHead, fQueueSize;
+  unsigned fNumDroppedFrames;
+  Boolean fIsAwaitingSharedFrame;
+  StreamReplicator::afterGettingSharedFrameFunc* fAfterGettingSharedFrameFunc; // NULL if we're being read by "getNextFrame()"
+  void* fAfterGettingSharedFrameClientData;
+  onCloseFunc* fSharedFrameOnCloseFunc;
+  void* fSharedFrameOnCloseClientData;
 };
 
 
+////////// SharedFrame and SharedFramePool implementation //////////
+
+#ifndef SHARED_FRAME_POOL_MAX_FREE_FRAMES
+#define SHARED_FRAME_POOL_MAX_FREE_FRAMES 16 // the number of unused frames that we keep, to avoid reallocating them
+#endif
+
+class SharedFramePool {
+public:
+  SharedFramePool(unsigned maxFrameSize)
+    : fMaxFrameSize(maxFrameSize), fReferenceCount(1/*our replicator*/), fIsOrphaned(False),
+      fFreeList(NULL), fNumFreeFrames(0) {
+  }
+
+  unsigned maxFrameSize() const { return fMaxFrameSize; }
+
+  SharedFrame* allocate() {
+    SharedFrame* frame = fFreeList;
+    if (frame != NULL) {
+      fFreeList = frame->fNextFree;
+      --fNumFreeFrames;
+    } else {
+      frame = new SharedFrame(*this, fMaxFrameSize);
+    }
+    frame->fReferenceCount = 1;
+    frame->fFrameSize = frame->fNumTruncatedBytes = frame->fDurationInMicroseconds = 0;
+    ++fReferenceCount; // each outstanding frame keeps us alive
+    return frame;
+  }
+
+  void recycle(SharedFrame* frame) {
+    if (fIsOrphaned || fNumFreeFrames >= SHARED_FRAME_POOL_MAX_FREE_FRAMES) {
+      delete frame;
+    } else {
+      frame->fNextFree = fFreeList;
+      fFreeList = frame;
+      ++fNumFreeFrames;
+    }
+    release();
+  }
+
+  void orphan() {
+    // Our replicator is going away, but some frames might still be held by their readers:
+    fIsOrphaned = True;
+    while (fFreeList != NULL) {
+      SharedFrame* frame = fFreeList;
+      fFreeList = frame->fNextFree;
+      delete frame;
+    }
+    fNumFreeFrames = 0;
+    release();
+  }
+
+private:
+  void release() {
+    if (--fReferenceCount == 0) delete this;
+  }
+
+private:
+  unsigned fMaxFrameSize;
+  unsigned fReferenceCount;
+  Boolean fIsOrphaned;
+  SharedFrame* fFreeList;
+  unsigned fNumFreeFrames;
+};
+
+SharedFrame::SharedFrame(SharedFramePool& ourPool, unsigned maxSize)
+  : fOurPool(ourPool), fData(new unsigned char[maxSize]),
+    fFrameSize(0), fNumTruncatedBytes(0), fDurationInMicroseconds(0), fReferenceCount(0), fNextFree(NULL) {
+  fPresentationTime.tv_sec = fPresentationTime.tv_usec = 0;
+}
+
+SharedFrame::~SharedFrame() {
+  delete[] fData;
+}
+
+void SharedFrame::release() {
+  if (fReferenceCount == 0) return; // shouldn't happen
+  if (--fReferenceCount == 0) fOurPool.recycle(this);
+}
+
+
 ////////// StreamReplicator implementation //////////
 
 StreamReplicator* StreamReplicator::createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies) {
   return new StreamReplicator(env, inputSource, deleteWhenLastReplicaDies);
 }
 
-StreamReplicator::StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies)
+StreamReplicator* StreamReplicator
+::createNewWithSharedFrames(UsageEnvironment& env, FramedSource* inputSource,
+			    unsigned maxFrameSize, unsigned maxQueuedFramesPerReplica, DropPolicy dropPolicy,
+			    Boolean deleteWhenLastReplicaDies) {
+  if (maxFrameSize == 0) return NULL;
+  if (maxQueuedFramesPerReplica == 0) maxQueuedFramesPerReplica = 1;
+
+  return new StreamReplicator(env, inputSource, deleteWhenLastReplicaDies,
+			      maxFrameSize, maxQueuedFramesPerReplica, dropPolicy);
+}
+
+StreamReplicator::StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies,
+				   unsigned maxFrameSize, unsigned maxQueuedFramesPerReplica, DropPolicy dropPolicy)
   : Medium(env),
     fInputSource(inputSource), fDeleteWhenLastReplicaDies(deleteWhenLastReplicaDies), fInputSourceHasClosed(False),
     fNumReplicas(0), fNumActiveReplicas(0), fNumDeliveriesMadeSoFar(0),
-    fFrameIndex(0), fMasterReplica(NULL), fReplicasAwaitingCurrentFrame(NULL), fReplicasAwaitingNextFrame(NULL) {
+    fFrameIndex(0), fMasterReplica(NULL), fReplicasAwaitingCurrentFrame(NULL), fReplicasAwaitingNextFrame(NULL),
+    fSharedFramePool(maxFrameSize == 0 ? NULL : new SharedFramePool(maxFrameSize)),
+    fMaxQueuedFramesPerReplica(maxQueuedFramesPerReplica), fDropPolicy(dropPolicy),
+    fFrameBeingRead(NULL), fAllReplicas(NULL) {
 }
 
 StreamReplicator::~StreamReplicator() {
   Medium::close(fInputSource);
+
+  if (fSharedFramePool != NULL) {
+    if (fFrameBeingRead != NULL) fFrameBeingRead->release();
+    fSharedFramePool->orphan(); // it will delete itself once any frames that are still being used have been released
+  }
 }
 
 FramedSource* StreamReplicator::createStreamReplica() {
   ++fNumReplicas;
-  return new StreamReplica(*this);
+  StreamReplica* replica = new StreamReplica(*this);
+
+  replica->fNextReplica = fAllReplicas;
+  fAllReplicas = replica;
+  return replica;
+}
+
+void StreamReplicator
+::getNextSharedFrame(FramedSource* replica,
+		     afterGettingSharedFrameFunc* afterGettingFunc, void* afterGettingClientData,
+		     FramedSource::onCloseFunc* onCloseFunc, void* onCloseClientData) {
+  StreamReplica* ourReplica = (StreamReplica*)replica;
+  if (fSharedFramePool == NULL || ourReplica == NULL || afterGettingFunc == NULL) {
+    envir() << "StreamReplicator::getNextSharedFrame(): This replicator was not created using \"createNewWithSharedFrames()\"!\n";
+    envir().internalError();
+  }
+  if (ourReplica->fIsAwaitingSharedFrame) {
+    envir() << "StreamReplicator::getNextSharedFrame(): attempting to read more than once at the same time!\n";
+    envir().internalError();
+  }
+
+  ourReplica->fAfterGettingSharedFrameFunc = afterGettingFunc;
+  ourReplica->fAfterGettingSharedFrameClientData = afterGettingClientData;
+  ourReplica->fSharedFrameOnCloseFunc = onCloseFunc;
+  ourReplica->fSharedFrameOnCloseClientData = onCloseClientData;
+  ourReplica->fIsAwaitingSharedFrame = True;
+
+  getNextSharedFrame(ourReplica);
+}
+
+unsigned StreamReplicator::numDroppedFrames(FramedSource* replica) const {
+  return replica == NULL ? 0 : ((StreamReplica*)replica)->fNumDroppedFrames;
 }
 
 void StreamReplicator::getNextFrame(StreamReplica* replica) {
+  if (fSharedFramePool != NULL) {
+    replica->fAfterGettingSharedFrameFunc = NULL; // we'll copy each frame into the reader's buffer
+    replica->fIsAwaitingSharedFrame = True;
+    getNextSharedFrame(replica);
+    return;
+  }
+
   if (fInputSourceHasClosed) { // handle closure instead
     replica->handleClosure();
     return;
@@ -103,6 +257,11 @@ void StreamReplicator::getNextFrame(StreamReplica* replica) {
 }
 
 void StreamReplicator::deactivateStreamReplica(StreamReplica* replicaBeingDeactivated) {
+  if (fSharedFramePool != NULL) {
+    deactivateSharedFrameReplica(replicaBeingDeactivated);
+    return;
+  }
+
   if (replicaBeingDeactivated->fFrameIndex == -1) return; // this replica has already been deactivated (or was never activated at all)
 
   // Assert: fNumActiveReplicas > 0
@@ -194,6 +353,14 @@ void StreamReplicator::removeStreamReplica(StreamReplica* replicaBeingRemoved) {
   // First, handle the replica that's being removed the same way that we would if it were merely being deactivated:
   deactivateStreamReplica(replicaBeingRemoved);
 
+  // Remove it from our list of all replicas:
+  for (StreamReplica** r = &fAllReplicas; *r != NULL; r = &((*r)->fNextReplica)) {
+    if (*r == replicaBeingRemoved) {
+      *r = replicaBeingRemoved->fNextReplica;
+      break;
+    }
+  }
+
   // Assert: fNumReplicas > 0
   if (fNumReplicas == 0) fprintf(stderr, "StreamReplicator::removeStreamReplica() Internal Error!\n"); // should not happen
   --fNumReplicas;
@@ -212,6 +379,11 @@ void StreamReplicator::afterGettingFrame(void* clientData, unsigned frameSize, u
 
 void StreamReplicator::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes,
 					 struct timeval presentationTime, unsigned durationInMicroseconds) {
+  if (fSharedFramePool != NULL) {
+    afterGettingSharedFrame(frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
+    return;
+  }
+
   // The frame was read into our master replica's buffer.  Update the master replica's state, but don't complete delivery to it
   // just yet.  We do that later, after we're sure that we've delivered it to all other replicas.
   fMasterReplica->fFrameSize = frameSize;
@@ -227,6 +399,11 @@ void StreamReplicator::onSourceClosure(void* clientData) {
 }
 
 void StreamReplicator::onSourceClosure() {
+  if (fSharedFramePool != NULL) {
+    onSourceClosureSharedFrames();
+    return;
+  }
+
   fInputSourceHasClosed = True;
 
   // Signal the closure to each replica that is currently awaiting a frame:
@@ -299,17 +476,158 @@ void StreamReplicator::deliverReceivedFrame() {
   }
 }
 
+void StreamReplicator::getNextSharedFrame(StreamReplica* replica) {
+  if (replica->fFrameIndex == -1) {
+    // This replica had stopped playing (or had just been created), but is now actively reading.  Note this:
+    replica->fFrameIndex = 0; // (in this mode, we use this only to tell whether the replica is active)
+    ++fNumActiveReplicas;
+  }
+
+  if (replica->fQueueSize > 0) {
+    // A frame has already arrived for this replica.  We're being called by its reader, so - to avoid recursing once
+    // per queued frame, if the reader asks for the next frame from its 'after getting' function - we need to return
+    // to the event loop to deliver it:
+    replica->scheduleSharedFrameDelivery();
+    return;
+  }
+
+  if (fInputSourceHasClosed) { // handle closure instead
+    replica->fIsAwaitingSharedFrame = False;
+    replica->handleSharedFrameClosure();
+    return;
+  }
+
+  // Make sure that we're reading from our input source.  (Other replicas might already have caused this.)
+  if (fInputSource != NULL && !fInputSource->isCurrentlyAwaitingData()) readNextSharedFrame();
+}
+
+void StreamReplicator::replaceInputSource(FramedSource* newInputSource) {
+  if (!usesSharedFrames()) return; // not supported
+
+  if (fInputSource != NULL) fInputSource->stopGettingFrames();
+    // (Any frame that was being read is kept in "fFrameBeingRead", and reused for the next read.)
+  fInputSource = newInputSource;
+  fInputSourceHasClosed = False;
+
+  // If any replicas are active, start reading from the new source:
+  if (fNumActiveReplicas > 0 && fInputSource != NULL && !fInputSource->isCurrentlyAwaitingData()) readNextSharedFrame();
+}
+
+void StreamReplicator::deactivateSharedFrameReplica(StreamReplica* replica) {
+  if (replica->fFrameIndex == -1) return; // this replica has already been deactivated (or was never activated at all)
+
+  --fNumActiveReplicas;
+  replica->fFrameIndex = -1;
+  replica->fIsAwaitingSharedFrame = False;
+  envir().taskScheduler().unscheduleDelayedTask(replica->nextTask());
+
+  // Discard any frames that were queued for this replica:
+  while (replica->fQueueSize > 0) {
+    replica->fQueue[replica->fQueueHead]->release();
+    replica->fQueueHead = (replica->fQueueHead + 1)%fMaxQueuedFramesPerReplica;
+    --replica->fQueueSize;
+  }
+
+  if (fNumActiveReplicas == 0 && fInputSource != NULL) fInputSource->stopGettingFrames(); // tell our source to stop too
+}
+
+void StreamReplicator::readNextSharedFrame() {
+  // Read the next frame (if we're not reusing one from a stopped read) directly into a shared frame:
+  if (fFrameBeingRead == NULL) fFrameBeingRead = fSharedFramePool->allocate();
+
+  fInputSource->getNextFrame(fFrameBeingRead->fData, fSharedFramePool->maxFrameSize(),
+			     afterGettingFrame, this, onSourceClosure, this);
+}
+
+void StreamReplicator::afterGettingSharedFrame(unsigned frameSize, unsigned numTruncatedBytes,
+					       struct timeval presentationTime, unsigned durationInMicroseconds) {
+  SharedFrame* frame = fFrameBeingRead;
+  fFrameBeingRead = NULL;
+  if (frame == NULL) return; // shouldn't happen
+
+  frame->fFrameSize = frameSize;
+  frame->fNumTruncatedBytes = numTruncatedBytes;
+  frame->fPresentationTime = presentationTime;
+  frame->fDurationInMicroseconds = durationInMicroseconds;
+
+  // Give each active replica a reference to the frame, then drop our own reference:
+  for (StreamReplica* replica = fAllReplicas; replica != NULL; replica = replica->fNextReplica) {
+    if (replica->fFrameIndex != -1) enqueueSharedFrame(replica, frame);
+  }
+  frame->release();
+
+  // Complete delivery to each replica that is currently waiting for a frame:
+  while (deliverQueuedFrames()) {}
+
+  // Then continue reading - at the input source's own pace - as long as anyone is still interested:
+  if (fNumActiveReplicas > 0 && fInputSource != NULL && !fInputSourceHasClosed
+      && !fInputSource->isCurrentlyAwaitingData()) {
+    readNextSharedFrame();
+  }
+}
+
+void StreamReplicator::enqueueSharedFrame(StreamReplica* replica, SharedFrame* frame) {
+  if (replica->fQueueSize == fMaxQueuedFramesPerReplica) {
+    // This replica's queue is full (i.e., it's not keeping up with the input), so we need to drop a frame for it:
+    ++replica->fNumDroppedFrames;
+    if (fDropPolicy == DROP_NEWEST_FRAME) return;
+
+    replica->fQueue[replica->fQueueHead]->release();
+    replica->fQueueHead = (replica->fQueueHead + 1)%fMaxQueuedFramesPerReplica;
+    --replica->fQueueSize;
+  }
+
+  frame->addReference();
+  replica->fQueue[(replica->fQueueHead + replica->fQueueSize)%fMaxQueuedFramesPerReplica] = frame;
+  ++replica->fQueueSize;
+}
+
+Boolean StreamReplicator::deliverQueuedFrames() {
+  // Note: Each delivery might cause replicas to be added, stopped or removed, so we rescan our list each time:
+  for (StreamReplica* replica = fAllReplicas; replica != NULL; replica = replica->fNextReplica) {
+    if (replica->fIsAwaitingSharedFrame && replica->fQueueSize > 0) {
+      replica->deliverSharedFrame();
+      return True;
+    }
+  }
+
+  return False;
+}
+
+void StreamReplicator::onSourceClosureSharedFrames() {
+  fInputSourceHasClosed = True;
+
+  // Signal the closure to each replica that is currently awaiting a frame.  (Any that have frames still queued will
+  // get these first, and will see the closure when they next ask for a frame.)
+  StreamReplica* replica;
+  do {
+    for (replica = fAllReplicas; replica != NULL; replica = replica->fNextReplica) {
+      if (replica->fIsAwaitingSharedFrame && replica->fQueueSize == 0) {
+	replica->fIsAwaitingSharedFrame = False;
+	replica->handleSharedFrameClosure();
+	break; // because the list might have changed
+      }
+    }
+  } while (replica != NULL);
+}
+
 
 ////////// StreamReplica implementation //////////
 
 StreamReplica::StreamReplica(StreamReplicator& ourReplicator)
   : FramedSource(ourReplicator.envir()),
     fOurReplicator(ourReplicator),
-    fFrameIndex(-1/*we haven't started playing yet*/), fNext(NULL) {
+    fFrameIndex(-1/*we haven't started playing yet*/), fNext(NULL),
+    fNextReplica(NULL), fQueue(NULL), fQueueHead(0), fQueueSize(0), fNumDroppedFrames(0),
+    fIsAwaitingSharedFrame(False),
+    fAfterGettingSharedFrameFunc(NULL), fAfterGettingSharedFrameClientData(NULL),
+    fSharedFrameOnCloseFunc(NULL), fSharedFrameOnCloseClientData(NULL) {
+  if (ourReplicator.usesSharedFrames()) fQueue = new SharedFrame*[ourReplicator.fMaxQueuedFramesPerReplica];
 }
 
 StreamReplica::~StreamReplica() {
   fOurReplicator.removeStreamReplica(this);
+  delete[] fQueue;
 }
 
 void StreamReplica::doGetNextFrame() {
@@ -331,3 +649,50 @@ void StreamReplica::copyReceivedFrame(StreamReplica* toReplica, StreamReplica* f
   toReplica->fPresentationTime = fromReplica->fPresentationTime;
   toReplica->fDurationInMicroseconds = fromReplica->fDurationInMicroseconds;
 }
+
+void StreamReplica::deliverSharedFrame() {
+  envir().taskScheduler().unscheduleDelayedTask(nextTask()); // in case this delivery had also been scheduled
+
+  SharedFrame* frame = fQueue[fQueueHead];
+  fQueueHead = (fQueueHead + 1)%fOurReplicator.fMaxQueuedFramesPerReplica;
+  --fQueueSize;
+  fIsAwaitingSharedFrame = False;
+
+  if (fAfterGettingSharedFrameFunc != NULL) {
+    // Hand our reference to the frame to the reader:
+    (*fAfterGettingSharedFrameFunc)(fAfterGettingSharedFrameClientData, frame);
+    return;
+  }
+
+  // Otherwise, copy the frame into the reader's buffer:
+  unsigned numNewBytesToTruncate = fMaxSize < frame->frameSize() ? frame->frameSize() - fMaxSize : 0;
+  fFrameSize = frame->frameSize() - numNewBytesToTruncate;
+  fNumTruncatedBytes = frame->numTruncatedBytes() + numNewBytesToTruncate;
+  memmove(fTo, frame->data(), fFrameSize);
+  fPresentationTime = frame->presentationTime();
+  fDurationInMicroseconds = frame->durationInMicroseconds();
+  frame->release();
+
+  FramedSource::afterGetting(this);
+}
+
+void StreamReplica::scheduleSharedFrameDelivery() {
+  nextTask() = envir().taskScheduler().scheduleDelayedTask(0, deliverSharedFrameTask, this);
+}
+
+void StreamReplica::deliverSharedFrameTask(void* clientData) {
+  StreamReplica* replica = (StreamReplica*)clientData;
+  replica->nextTask() = NULL;
+
+  // (The frame might already have been delivered - or the replica stopped - in the meantime.)
+  if (replica->fIsAwaitingSharedFrame && replica->fQueueSize > 0) replica->deliverSharedFrame();
+}
+
+void StreamReplica::handleSharedFrameClosure() {
+  if (fAfterGettingSharedFrameFunc != NULL) {
+    // We're being read by "getNextSharedFrame()":
+    if (fSharedFrameOnCloseFunc != NULL) (*fSharedFrameOnCloseFunc)(fSharedFrameOnCloseClientData);
+  } else {
+    handleClosure();
+  }
+}
@@ -25,6 +25,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MediaSession.hh"
 #endif
 
+class AsyncFileIO; // forward
+
 class AVIFileSink: public Medium {
 public:
   static AVIFileSink* createNew(UsageEnvironment& env,
@@ -65,6 +67,8 @@ private:
   friend class AVISubsessionIOState;
   MediaSession& fInputSession;
   FILE* fOutFid;
+  AsyncFileIO* fAsyncFileIO; // non-NULL iff we write frame data using "io_uring"
+  Boolean fWriteHasFailed; // if so, we stop recording
   class AVIIndexRecord *fIndexRecordsHead, *fIndexRecordsTail;
   unsigned fNumIndexRecords;
   unsigned fBufferSize;
@@ -86,6 +90,9 @@ private:
     putc(byte, fOutFid);
     return 1;
   }
+  void addFrameData(unsigned char const* data, unsigned dataSize);
+  static void afterAsyncWrite(void* clientData, unsigned char const* data, int result);
+  void noteWriteFailure(int err);
   unsigned addZeroWords(unsigned numWords);
   unsigned add4ByteString(char const* str);
   void setWord(unsigned filePosn, unsigned size);
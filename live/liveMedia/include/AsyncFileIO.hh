@@ -0,0 +1,112 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// An optional asynchronous file I/O backend (using Linux "io_uring"), whose completions are
+// handled - as a readable socket - from within the event loop.
+// C++ header
+
+#ifndef _ASYNC_FILE_IO_HH
+#define _ASYNC_FILE_IO_HH
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+#include <stdio.h>
+
+class AsyncFileIORequest; // forward
+
+class AsyncFileIO {
+public:
+  static AsyncFileIO* getInstance(UsageEnvironment& env);
+      // Returns the (reference-counted) instance for "env", creating it if necessary.
+      // Returns NULL if asynchronous file I/O is not available (e.g., because we're not running
+      // on Linux, because the kernel doesn't support "io_uring", or because we were compiled with
+      // NO_IO_URING defined).  Callers should then fall back to their (blocking) "stdio" code.
+  void release(); // each successful call to "getInstance()" must be matched by a call to this
+
+  typedef void (CompletionFunc)(void* clientData, unsigned char const* data, int result);
+      // "result" is the number of bytes read/written, or -errno on failure.  (A write that was
+      // completed only partially is reported as a failure: -EIO.)
+      // For reads, "data" points to the bytes that were read (valid only during the call).
+
+  Boolean readAt(int fd, unsigned numBytes, u_int64_t offset,
+		 CompletionFunc* completionFunc, void* clientData);
+      // Reads up to "numBytes" bytes, starting at "offset", into a buffer that we own.
+      // "completionFunc" is called later, from the event loop.
+
+  Boolean writeAt(int fd, unsigned char const* data, unsigned numBytes, u_int64_t offset,
+		  CompletionFunc* completionFunc = NULL, void* clientData = NULL);
+      // Copies "data", then writes it - asynchronously - at "offset".  (The caller's buffer can be
+      // reused as soon as we return.)
+
+  Boolean appendToFile(FILE* fid, unsigned char const* data, unsigned numBytes,
+		       CompletionFunc* completionFunc = NULL, void* clientData = NULL);
+      // Writes "data" at the current position of "fid" (flushing any "stdio" output first),
+      // then advances "fid"s position past it, so that subsequent "stdio" writes follow on.
+
+  int flush(int fd);
+  int flush(FILE* fid) { if (fid == NULL) return 0; fflush(fid); return flush(fileno(fid)); }
+      // Waits (blocking) until all outstanding operations on "fd" have completed.  Their completion
+      // functions are *not* called; instead, we return the (-errno) result of the first of them that
+      // failed (or 0 if none did).  Call this before closing (or seeking back within) a file.
+
+  void cancel(void* clientData);
+      // Ensures that no further completion functions will be called with "clientData".  (The
+      // operations themselves may still be in progress; we continue to own their buffers.)
+
+  unsigned numOutstanding() const { return fNumOutstanding; }
+
+protected:
+  AsyncFileIO(UsageEnvironment& env, int ringFd, int eventFd);
+      // called only by "getInstance()"
+  virtual ~AsyncFileIO();
+
+private:
+  AsyncFileIORequest* newRequest(int fd, unsigned numBytes, u_int64_t offset,
+				 CompletionFunc* completionFunc, void* clientData);
+  Boolean submit(AsyncFileIORequest* request, Boolean isWrite);
+  void reapCompletions(unsigned minToWaitFor);
+  void deliverCompletions();
+  void freeRequest(AsyncFileIORequest* request);
+
+  static void completionHandler(void* clientData, int mask);
+  void completionHandler1();
+
+private:
+  UsageEnvironment& fEnv;
+  unsigned fReferenceCount;
+  int fRingFd, fEventFd;
+  unsigned fNumOutstanding;
+  Boolean fIsDelivering, fDeletionIsPending;
+
+  AsyncFileIORequest* fSubmittedHead; // requests that have been submitted, but not yet reaped
+  AsyncFileIORequest* fCompletedHead; // requests that have been reaped, but not yet delivered
+  AsyncFileIORequest* fCompletedTail;
+  AsyncFileIORequest* fFreeList; // recycled requests (and their buffers)
+  unsigned fFreeListSize;
+
+  // The shared (mmap()ed) submission and completion rings:
+  void* fSQRing; unsigned fSQRingSize;
+  void* fCQRing; unsigned fCQRingSize;
+  void* fSQEntries; unsigned fSQEntriesSize;
+  unsigned fNumRingEntries;
+  unsigned *fSQHead, *fSQTail, *fSQRingMask, *fSQArray;
+  unsigned *fCQHead, *fCQTail, *fCQRingMask;
+  void* fCQEntries;
+};
+
+#endif
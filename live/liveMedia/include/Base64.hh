@@ -36,8 +36,19 @@ unsigned char* base64Decode(char const* in, unsigned inSize,
     // As above, but includes the size of the input string (i.e., the number of bytes to decode) as a parameter.
     // This saves an extra call to "strlen()" if we already know the length of the input string.
 
+unsigned base64Decode(char const* in, unsigned inSize, unsigned char* out,
+		      Boolean trimTrailingZeros = True);
+    // As above, but decodes into a caller-supplied buffer "out" (which must be at least 3*(inSize/4) bytes long), and
+    // returns the number of bytes decoded.  "out" may be the same as "in" (i.e., the data may be decoded in place).
+
 char* base64Encode(char const* orig, unsigned origLength);
     // returns a 0-terminated string that
     // the caller is responsible for delete[]ing.
 
+unsigned base64Encode(char const* orig, unsigned origLength, char* out);
+    // As above, but encodes into a caller-supplied buffer "out" (which must be at least
+    // "base64EncodedSize(origLength)" + 1 bytes long), and returns the length of the (0-terminated) result.
+
+inline unsigned base64EncodedSize(unsigned origLength) { return 4*((origLength+2)/3); }
+
 #endif
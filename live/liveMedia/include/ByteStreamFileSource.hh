@@ -25,6 +25,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "FramedFileSource.hh"
 #endif
 
+class AsyncFileIO; // forward
+
 class ByteStreamFileSource: public FramedFileSource {
 public:
   static ByteStreamFileSource* createNew(UsageEnvironment& env,
@@ -60,6 +62,12 @@ protected:
 
   static void fileReadableHandler(ByteStreamFileSource* source, int mask);
   void doReadFromFile();
+  static void asyncReadCompletion(void* clientData, unsigned char const* data, int result);
+  void asyncReadCompletion1(unsigned char const* data, int result);
+  void afterReadingFromFile();
+  Boolean cancelAsyncRead();
+      // Forgets any outstanding asynchronous read (e.g., because we're about to seek); returns True iff there was one
+  void restartAsyncRead(Boolean wasPending);
 
 private:
   // redefined virtual functions:
@@ -77,6 +85,9 @@ private:
   Boolean fHaveStartedReading;
   Boolean fLimitNumBytesToStream;
   u_int64_t fNumBytesToStream; // used iff "fLimitNumBytesToStream" is True
+  AsyncFileIO* fAsyncFileIO; // non-NULL iff we read (seekable) files using "io_uring"
+  Boolean fAsyncReadIsPending;
+  int64_t fAsyncReadOffset;
 };
 
 #endif
@@ -57,6 +57,9 @@ public:
   char const* computeDigestResponse(char const* cmd, char const* url) const;
       // The returned string from this function must later be freed by calling:
   void reclaimDigestResponse(char const* responseStr) const;
+  char const* computeDigestResponse(char const* cmd, char const* url, char* responseBuf) const;
+      // Like the above, except that the response is written to "responseBuf" (which must be >= 33 bytes long, and is
+      // also returned), so nothing is allocated.
 
 private:
   void resetRealmAndNonce();
@@ -65,11 +68,14 @@ private:
   void assignUsernameAndPassword(char const* username, char const* password, Boolean passwordIsMD5);
   void assign(char const* realm, char const* nonce,
 	      char const* username, char const* password, Boolean passwordIsMD5);
+  void computeHA1();
 
 private:
   char* fRealm; char* fNonce;
   char* fUsername; char* fPassword;
   Boolean fPasswordIsMD5;
+  char fHA1[33]; Boolean fHaveHA1;
+      // md5(<username>:<realm>:<password>), which is precomputed (whenever these change), because it's the same for each request
 };
 
 #endif
@@ -25,6 +25,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MediaSink.hh"
 #endif
 
+class AsyncFileIO; // forward
+
 class FileSink: public MediaSink {
 public:
   static FileSink* createNew(UsageEnvironment& env, char const* fileName,
@@ -58,6 +60,7 @@ protected:
   virtual void afterGettingFrame(unsigned frameSize,
 				 unsigned numTruncatedBytes,
 				 struct timeval presentationTime);
+  static void afterAsyncWrite(void* clientData, unsigned char const* data, int result);
 
   FILE* fOutFid;
   unsigned char* fBuffer;
@@ -66,6 +69,8 @@ protected:
   char* fPerFrameFileNameBuffer; // used if "oneFilePerFrame" is True
   struct timeval fPrevPresentationTime;
   unsigned fSamePresentationTimeCounter;
+  AsyncFileIO* fAsyncFileIO; // non-NULL iff we write to our (single) file using "io_uring"
+  Boolean fAsyncWriteFailed;
 };
 
 #endif
@@ -65,6 +65,13 @@ public:
       // Equivalent to:
       //     "closeAllClientSessionsForServerMediaSession(streamName); removeServerMediaSession(streamName);
 
+  static unsigned listenBacklogSize;
+      // The "listen()" backlog of the servers that are created after this is set (default: 20).  Increase it (and the OS's
+      // limit - e.g., "net.core.somaxconn" on Linux) if many clients might connect at once (e.g., after a network outage).
+  static Boolean shareListeningPort;
+      // If True when a server is created, then its listening socket can be shared (using SO_REUSEPORT, where supported) with
+      // servers in other processes, with the OS distributing new connections among them.  (default: False)
+
 protected:
   GenericMediaServer(UsageEnvironment& env, int ourSocket, Port ourPort,
 		     unsigned reclamationSeconds);
@@ -116,7 +123,6 @@ public: // should be protected, but some old compilers complain otherwise
     UsageEnvironment& envir() { return fOurServer.envir(); }
     void noteLiveness();
     static void noteClientLiveness(ClientSession* clientSession);
-    static void livenessTimeoutTask(ClientSession* clientSession);
 
   protected:
     friend class GenericMediaServer;
@@ -124,7 +130,9 @@ public: // should be protected, but some old compilers complain otherwise
     GenericMediaServer& fOurServer;
     u_int32_t fOurSessionId;
     ServerMediaSession* fOurServerMediaSession;
-    TaskToken fLivenessCheckTask;
+    unsigned fLastLivenessTick; // our server's "fLivenessTick" when we last noted liveness
+    ClientSession* fNextInLivenessSlot;
+    ClientSession** fLivenessSlotLink; // the pointer (in our server's 'liveness wheel') that points to us; NULL if none
   };
 
 protected:
@@ -157,10 +165,25 @@ protected:
   Port fServerPort;
   unsigned fReclamationSeconds;
 
+private:
+  // Inactive "ClientSession"s are reclaimed using a 'liveness wheel' that has one slot for each second (of the last
+  // "fReclamationSeconds"+2 seconds).  Each session is in the slot of the second in which it will next be checked.
+  // Once each second, we check the sessions in the next slot: deleting those that have timed out, and moving the others
+  // to the slot in which they'll next time out.  Noting a session's liveness therefore just records the current 'tick'.
+  void addToLivenessWheel(ClientSession* clientSession);
+  void removeFromLivenessWheel(ClientSession* clientSession);
+  static void livenessSweepTask(void* clientData);
+  void livenessSweep();
+
 private:
   HashTable* fServerMediaSessions; // maps 'stream name' strings to "ServerMediaSession" objects
   HashTable* fClientConnections; // the "ClientConnection" objects that we're using
-  HashTable* fClientSessions; // maps 'session id' strings to "ClientSession" objects
+  HashTable* fClientSessions; // maps (integer) session ids to "ClientSession" objects
+  ClientSession** fLivenessWheel; // NULL if "fReclamationSeconds" == 0
+  unsigned fLivenessWheelSize;
+  unsigned fLivenessTick; // incremented (while we have sessions) once per second
+  unsigned fNumSessionsInLivenessWheel;
+  TaskToken fLivenessSweepTask;
 };
 
 // A data structure used for optional user/password authentication:
@@ -180,6 +203,11 @@ public:
   virtual char const* lookupPassword(char const* username);
       // returns NULL if the user name was not present
 
+  Boolean lookupHA1(char const* username, char* resultHA1);
+      // Sets "resultHA1" (which must be >= 33 bytes long) to md5(<username>:<realm>:<password>) - as used in digest
+      // authentication - for the user's password (from "lookupPassword()").  Returns False if the user name was not present.
+      // This is computed only when the user's password is first looked up (or has changed), rather than for each request.
+
   char const* realm() { return fRealm; }
   Boolean passwordsAreMD5() { return fPasswordsAreMD5; }
 
@@ -187,6 +215,12 @@ protected:
   HashTable* fTable;
   char* fRealm;
   Boolean fPasswordsAreMD5;
+
+private:
+  void removeHA1Record(char const* username);
+
+private:
+  HashTable* fHA1Table; // maps user names to (cached) "HA1Record"s
 };
 
 #endif
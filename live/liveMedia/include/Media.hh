@@ -125,6 +125,7 @@ public:
 
   MediaLookupTable* mediaTable;
   void* socketTable;
+  void* asyncFileIO;
 
 protected:
   _Tables(UsageEnvironment& env);
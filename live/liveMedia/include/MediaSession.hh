@@ -180,6 +180,12 @@ public:
   RTCPInstance* rtcpInstance() { return fRTCPInstance; }
   unsigned rtpTimestampFrequency() const { return fRTPTimestampFrequency; }
   Boolean rtcpIsMuxed() const { return fMultiplexRTCPWithRTP; }
+  unsigned char rtxPayloadFormat() const { return fRTXPayloadFormat; }
+      // the payload format of the stream (RFC 4588) in which the server retransmits lost packets; 0 if there's none
+  Boolean supportsGenericNACK() const { return fSupportsGenericNACK; }
+  Boolean supportsPLI() const { return fSupportsPLI; }
+  Boolean supportsFIR() const { return fSupportsFIR; }
+      // whether the server accepts these RTCP feedback messages (set by "a=rtcp-fb:" lines; RFC 4585 and RFC 5104)
   FramedSource* readSource() { return fReadSource; }
     // This is the source that client sinks read from.  It is usually
     // (but not necessarily) the same as "rtpSource()"
@@ -209,6 +215,10 @@ public:
       // called after initiate().
   void receiveRawMP3ADUs() { fReceiveRawMP3ADUs = True; } // optional hack for audio/MPA-ROBUST; must not be called after initiate()
   void receiveRawJPEGFrames() { fReceiveRawJPEGFrames = True; } // optional hack for video/JPEG; must not be called after initiate()
+  void setCPUAccount(class CPUAccount* cpuAccount);
+      // Charges the handling of this subsession's incoming RTP and RTCP packets - and anything that this sets up - to
+      // "cpuAccount" (see "CPUAccount.hh").  This should be called before initiate().
+  class CPUAccount* cpuAccount() const { return fCPUAccount; }
   char*& connectionEndpointName() { return fConnectionEndpointName; }
   char const* connectionEndpointName() const {
     return fConnectionEndpointName;
@@ -283,6 +293,7 @@ protected:
   Boolean parseSDPLine_b(char const* sdpLine);
   Boolean parseSDPAttribute_rtpmap(char const* sdpLine);
   Boolean parseSDPAttribute_rtcpmux(char const* sdpLine);
+  Boolean parseSDPAttribute_rtcpfb(char const* sdpLine);
   Boolean parseSDPAttribute_control(char const* sdpLine);
   Boolean parseSDPAttribute_range(char const* sdpLine);
   Boolean parseSDPAttribute_fmtp(char const* sdpLine);
@@ -293,6 +304,9 @@ protected:
   virtual Boolean createSourceObjects(int useSpecialRTPoffset);
     // create "fRTPSource" and "fReadSource" member objects, after we've been initialized via SDP
 
+private:
+  Boolean initiate1(int useSpecialRTPoffset); // called (with our "CPUAccount" current) by initiate()
+
 protected:
   // Linkage fields:
   MediaSession& fParent;
@@ -309,6 +323,8 @@ protected:
   char* fProtocolName;
   unsigned fRTPTimestampFrequency;
   Boolean fMultiplexRTCPWithRTP;
+  unsigned char fRTXPayloadFormat; // 0 if none
+  Boolean fSupportsGenericNACK, fSupportsPLI, fSupportsFIR;
   char* fControlPath; // holds optional a=control: string
   struct in_addr fSourceFilterAddr; // used for SSM
   unsigned fBandwidth; // in kilobits-per-second, from b= line
@@ -336,6 +352,7 @@ protected:
 
   // Other fields:
   char* fSessionId; // used by RTSP
+  class CPUAccount* fCPUAccount; // if any
 };
 
 #endif
@@ -37,6 +37,18 @@ public:
     fOnSendErrorData = onSendErrorFuncData;
   }
 
+  void setBatchedOutput(Boolean batchedOutput = True);
+      // If True, then packets that we send in quick succession (e.g., the fragments of a large frame) are queued in our
+      // "Groupsock", then sent together, just before we next have to wait - either for our source, or until the next packet
+      // is due.  This is off by default, because queued packets bypass the "Groupsock"s (virtual) "output()" function.
+
+  void enableRetransmissions(unsigned char rtxPayloadType, unsigned numPacketsToKeep = 512);
+      // Keep a copy of each of the last "numPacketsToKeep" packets that we've sent, so that - if a receiver reports (in a
+      // RTCP "Generic NACK") that it didn't get one of them - we can retransmit it, in a separate stream (RFC 4588) with
+      // payload type "rtxPayloadType".  (Our SDP description then advertises this.)
+
+  unsigned numPacketsRetransmitted() const { return fNumPacketsRetransmitted; }
+
 protected:
   MultiFramedRTPSink(UsageEnvironment& env,
 		     Groupsock* rtpgs, unsigned char rtpPayloadType,
@@ -93,6 +105,8 @@ protected:
 
 public: // redefined virtual functions:
   virtual void stopPlaying();
+  virtual unsigned char rtxPayloadType() const;
+  virtual Boolean retransmitPacket(u_int16_t seqNum);
 
 protected: // redefined virtual functions:
   virtual Boolean continuePlaying();
@@ -103,6 +117,9 @@ private:
   void sendPacketIfNecessary();
   static void sendNext(void* firstArg);
   friend void sendNext(void*);
+  Boolean sendOrQueuePacket(unsigned char* packet, unsigned packetSize);
+  static void flushQueuedPackets(void* firstArg);
+  void flushQueuedPackets();
 
   static void afterGettingFrame(void* clientData,
 				unsigned numBytesRead, unsigned numTruncatedBytes,
@@ -135,6 +152,24 @@ private:
 
   onSendErrorFunc* fOnSendErrorFunc;
   void* fOnSendErrorData;
+
+  // If "fBatchedOutput" (see "setBatchedOutput()"), packets that we send in quick succession are queued, then sent together:
+  Boolean fBatchedOutput;
+  Boolean fHavePacketsQueued;
+  TaskToken fFlushTask;
+
+  // Retransmissions (if enabled): The last "fRetransmissionHistorySize" packets that we sent, in slots of
+  // "fRetransmissionSlotSize" bytes, indexed by sequence number:
+  unsigned char fRTXPayloadType; // 0 means: retransmissions aren't enabled
+  unsigned fRetransmissionHistorySize;
+  unsigned fRetransmissionSlotSize;
+  unsigned char* fRetransmissionHistory;
+  unsigned* fRetransmittablePacketSizes; // 0 if the slot is empty
+  u_int16_t* fRetransmittableSeqNums;
+  unsigned char* fRTXPacket; // where we build each retransmitted packet
+  u_int32_t fRTXSSRC;
+  u_int16_t fRTXSeqNo;
+  unsigned fNumPacketsRetransmitted;
 };
 
 #endif
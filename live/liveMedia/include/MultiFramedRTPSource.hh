@@ -59,6 +59,15 @@ private:
   // redefined virtual functions:
   virtual void doGetNextFrame();
   virtual void setPacketReorderingThresholdTime(unsigned uSeconds);
+  virtual void setAdaptivePacketReordering(unsigned maxThresholdUSeconds, double lateFraction);
+  virtual unsigned packetReorderingThresholdTime() const;
+  virtual unsigned numPacketsInReorderingBuffer() const;
+  virtual unsigned numPacketsArrivedTooLate() const;
+  virtual void enableRetransmissionRequests(class RTCPInstance* rtcpInstance, unsigned char rtxPayloadFormat,
+					    Boolean sendNACKs, Boolean sendPLIs, Boolean sendFIRs);
+  virtual unsigned numPacketsNACKed() const;
+  virtual unsigned numPacketsRetransmitted() const;
+  virtual unsigned numKeyFrameRequests() const;
 
 private:
   void reset();
@@ -66,6 +75,10 @@ private:
 
   static void networkReadHandler(MultiFramedRTPSource* source, int /*mask*/);
   void networkReadHandler1();
+  static void reorderingTimeoutHandler(MultiFramedRTPSource* source);
+  static void sendNACKsHandler(MultiFramedRTPSource* source);
+  void sendNACKs();
+  void requestKeyFrame();
 
   Boolean fAreDoingNetworkReads;
   BufferedPacket* fPacketReadInProgress;
@@ -76,6 +89,17 @@ private:
 
   // A buffer to (optionally) hold incoming pkts that have been reorderered
   class ReorderingPacketBuffer* fReorderingBuffer;
+  TaskToken fReorderingTimeoutTask; // for giving up on a missing packet, if no more packets arrive
+
+  // RTCP feedback (see "enableRetransmissionRequests()"):
+  class RTCPInstance* fFeedbackRTCPInstance; // NULL if we don't send any
+  unsigned char fRTXPayloadFormat; // 0 if none
+  Boolean fSendNACKs, fSendPLIs, fSendFIRs;
+  TaskToken fNACKTask;
+  class NACKRecord* fNACKRecords; // which missing packets we've asked for, and when; indexed by sequence number
+  unsigned fRetransmissionRTT; // uSeconds; measured from our "NACK"s until the arrival of the retransmitted packets
+  struct timeval fLastKeyFrameRequestTime;
+  unsigned fNumPacketsNACKed, fNumPacketsRetransmitted, fNumKeyFrameRequests;
 };
 
 
@@ -108,6 +132,7 @@ public:
   BufferedPacket*& nextPacket() { return fNextPacket; }
 
   unsigned short rtpSeqNo() const { return fRTPSeqNo; }
+  struct timeval const& presentationTime() const { return fPresentationTime; }
   struct timeval const& timeReceived() const { return fTimeReceived; }
 
   unsigned char* data() const { return &fBuf[fHead]; }
@@ -25,6 +25,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MediaSession.hh"
 #endif
 
+class AsyncFileIO; // forward
+
 class QuickTimeFileSink: public Medium {
 public:
   static QuickTimeFileSink* createNew(UsageEnvironment& env,
@@ -73,6 +75,8 @@ private:
   friend class SubsessionIOState;
   MediaSession& fInputSession;
   FILE* fOutFid;
+  AsyncFileIO* fAsyncFileIO; // non-NULL iff we write frame data using "io_uring"
+  Boolean fWriteHasFailed; // if so, we stop recording
   unsigned fBufferSize;
   Boolean fPacketLossCompensate;
   Boolean fSyncStreams, fGenerateMP4Format;
@@ -96,6 +100,9 @@ private:
     putc(byte, fOutFid);
     return 1;
   }
+  void addFrameData(unsigned char const* data, unsigned dataSize);
+  static void afterAsyncWrite(void* clientData, unsigned char const* data, int result);
+  void noteWriteFailure(int err);
   unsigned addZeroWords(unsigned numWords);
   unsigned add4ByteString(char const* str);
   unsigned addArbitraryString(char const* str,
@@ -96,6 +96,19 @@ public:
       // of "name" are used.  (If "name" has fewer than 4 bytes, or is NULL,
       // then the remaining bytes are '\0'.)
 
+  void sendGenericNACK(u_int32_t mediaSSRC, u_int16_t const* seqNums, unsigned numSeqNums);
+      // Asks the sender of the stream "mediaSSRC" to retransmit the RTP packets with these sequence numbers, by sending
+      // a RTCP "Generic NACK" (RFC 4585, section 6.2.1).  (Like other RTCP feedback messages, this is sent - immediately -
+      // in a compound packet, after a "RR" and "SDES".)  We must have been created with a "RTPSource".
+  void sendPLI(u_int32_t mediaSSRC);
+  void sendFIR(u_int32_t mediaSSRC);
+      // Ask the sender of the stream "mediaSSRC" for a new key frame (e.g., after unrecoverable packet loss), by sending a
+      // RTCP "Picture Loss Indication" (RFC 4585, section 6.3.1) or "Full Intra Request" (RFC 5104, section 4.3.1).
+  void setKeyFrameRequestHandler(TaskFunc* handlerTask, void* clientData);
+      // Assigns a handler routine to be called whenever a "PLI" or "FIR" arrives for our "RTPSink"s stream.  (To turn off
+      // handling, call the function again with "handlerTask" (and "clientData") as NULL.)
+      // (Incoming "Generic NACK"s are handled automatically, by asking our "RTPSink" to retransmit the packets.)
+
   Groupsock* RTCPgs() const { return fRTCPInterface.gs(); }
 
   void setStreamSocket(int sockNum, unsigned char streamChannelId);
@@ -111,6 +124,16 @@ public:
 					    handlerClientData);
   }
 
+  void setCaptureWriter(class RTPCaptureWriter* captureWriter, u_int8_t streamId) {
+    // records each incoming RTCP packet (see "RTPCapture.hh")
+    fRTCPInterface.setCaptureWriter(captureWriter, streamId, True);
+  }
+
+  void setCPUAccount(class CPUAccount* cpuAccount) {
+    // charges our network reading to "cpuAccount" (see "CPUAccount.hh")
+    fRTCPInterface.setCPUAccount(cpuAccount);
+  }
+
   void injectReport(u_int8_t const* packet, unsigned packetSize, struct sockaddr_in const& fromAddress);
     // Allows an outside party to inject an RTCP report (from other than the network interface)
 
@@ -141,6 +164,7 @@ private:
         void enqueueReportBlock(RTPReceptionStats* receptionStats);
   void addSDES();
   void addBYE();
+  void addFeedbackHeader(u_int8_t fmt, u_int8_t packetType, unsigned numFCIWords, u_int32_t mediaSSRC);
 
   void sendBuiltPacket();
 
@@ -190,6 +214,9 @@ private:
   AddressPortLookupTable* fSpecificRRHandlerTable;
   RTCPAppHandlerFunc* fAppHandlerTask;
   void* fAppHandlerClientData;
+  TaskFunc* fKeyFrameRequestHandlerTask;
+  void* fKeyFrameRequestHandlerClientData;
+  u_int8_t fFIRSeqNum; // for the next "FIR" that we send
 
 public: // because this stuff is used by an external "C" function
   void schedule(double nextTime);
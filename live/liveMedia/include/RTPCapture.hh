@@ -0,0 +1,126 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Capturing incoming RTP and RTCP packets (with their arrival times) to a file, and replaying them later
+// (e.g., to reproduce - without a camera - the input to a receiver).
+// C++ header
+
+#ifndef _RTP_CAPTURE_HH
+#define _RTP_CAPTURE_HH
+
+#ifndef _MEDIA_HH
+#include "Media.hh"
+#endif
+#ifndef _NET_ADDRESS_HH
+#include "NetAddress.hh"
+#endif
+#include <stdio.h>
+
+// The file format (all numbers are in network byte order):
+//   An 8-byte header: "RTPCAP" followed by the bytes 0 and 1 (the version number)
+//   Then, a sequence of records, each consisting of:
+//     4 bytes: the arrival time (seconds since the Unix epoch)
+//     4 bytes: the arrival time (microseconds)
+//     1 byte: a 'stream id' (chosen by whoever did the capture; e.g., the subsession's index)
+//     1 byte: flags (see below)
+//     2 bytes: the size of the data that follows
+//     the data: a RTP or RTCP packet, or a SDP description
+#define RTP_CAPTURE_FLAG_RTCP 0x01 // the packet is RTCP (rather than RTP)
+#define RTP_CAPTURE_FLAG_TCP 0x02 // the packet was received (interleaved) over TCP
+#define RTP_CAPTURE_FLAG_SDP 0x80 // the data is a SDP description (rather than a packet)
+
+#define RTP_CAPTURE_MAX_RECORD_DATA_SIZE 65535
+
+class RTPCaptureWriter: public Medium {
+public:
+  static RTPCaptureWriter* createNew(UsageEnvironment& env, char const* fileName);
+      // Returns NULL if the file could not be created.
+
+  void recordSDPDescription(char const* sdpDescription);
+      // Call this before any packets arrive, so that a replayer can set up the same session.
+  void recordPacket(u_int8_t streamId, Boolean isRTCP, Boolean wasReceivedOverTCP,
+		    unsigned char const* packet, unsigned packetSize);
+      // Called by "RTPInterface", for each complete packet that it reads.  The arrival time is 'now'.
+
+  unsigned numPacketsRecorded() const { return fNumPacketsRecorded; }
+
+protected:
+  RTPCaptureWriter(UsageEnvironment& env, FILE* fid);
+      // called only by createNew()
+  virtual ~RTPCaptureWriter();
+
+private:
+  void writeRecord(struct timeval const& arrivalTime, u_int8_t streamId, u_int8_t flags,
+		   unsigned char const* data, unsigned dataSize);
+  static void flushTask(void* clientData);
+
+private:
+  FILE* fFid;
+  TaskToken fFlushTask; // so that a capture that's interrupted (e.g., by killing the process) is not missing much
+  unsigned fNumPacketsRecorded;
+};
+
+class RTPCaptureReplayer: public Medium {
+public:
+  static RTPCaptureReplayer* createNew(UsageEnvironment& env, char const* fileName, double speed = 1.0);
+      // "speed" is relative to the original arrival times (e.g., 1.0 means: in real time; 4.0 means: 4x as fast).
+      // 0 means: as fast as possible (one packet per event loop iteration, so that receivers in the same event loop
+      // can keep up).  Returns NULL if the file could not be opened, or is not a capture file.
+
+  char const* sdpDescription() const { return fSDPDescription; } // NULL if none was recorded
+
+  void setDestination(u_int8_t streamId, Boolean isRTCP, struct in_addr const& address, Port port);
+      // Where the packets captured for "streamId" (RTP or RTCP) are sent (as UDP datagrams, even if they were
+      // originally received over TCP).  Packets for streams without a destination are skipped.
+
+  void startReplaying(TaskFunc* onEndFunc = NULL, void* onEndClientData = NULL);
+      // "onEndFunc" (if not NULL) is called after the last packet has been sent.
+
+  unsigned numPacketsReplayed() const { return fNumPacketsReplayed; }
+
+protected:
+  RTPCaptureReplayer(UsageEnvironment& env, FILE* fid, double speed);
+      // called only by createNew()
+  virtual ~RTPCaptureReplayer();
+
+private:
+  Boolean readNextRecord(); // into "fRecord..."; returns False at the end of the file
+  void scheduleNextPacket();
+  static void sendNextPacket(void* clientData);
+  void sendNextPacket();
+
+private:
+  FILE* fFid;
+  double fSpeed;
+  char* fSDPDescription;
+  int fOurSocket;
+  struct sockaddr_in fDestinations[256][2]; // indexed by stream id, and then 0 (RTP) or 1 (RTCP); port 0 means: none
+  TaskFunc* fOnEndFunc;
+  void* fOnEndClientData;
+  TaskToken fNextPacketTask;
+  struct timeval fStartTime, fFirstArrivalTime;
+  unsigned fNumPacketsReplayed;
+
+  // The record that we've read ahead:
+  Boolean fHaveRecord;
+  struct timeval fRecordArrivalTime;
+  u_int8_t fRecordStreamId, fRecordFlags;
+  unsigned fRecordDataSize;
+  unsigned char fRecordData[RTP_CAPTURE_MAX_RECORD_DATA_SIZE];
+};
+
+#endif
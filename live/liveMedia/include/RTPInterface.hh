@@ -65,8 +65,24 @@ public:
   static void setServerRequestAlternativeByteHandler(UsageEnvironment& env, int socketNum,
 						     ServerRequestAlternativeByteHandler* handler, void* clientData);
   static void clearServerRequestAlternativeByteHandler(UsageEnvironment& env, int socketNum);
+  static int sendDataOverStreamSocket(UsageEnvironment& env, int socketNum, u_int8_t const* data, unsigned dataSize);
+      // Used (like "send()") to send other data - e.g., RTSP responses - over a TCP socket that might also be carrying
+      // RTP-over-TCP.  If RTP/RTCP data is waiting to be sent on the socket, then "data" is queued behind it.
+  static Boolean pushBackStreamSocketInput(UsageEnvironment& env, int socketNum, u_int8_t const* data, unsigned dataSize);
+      // Used by a RTSP client that had already read "data" from a TCP socket - e.g., RTP/RTCP packets that followed the
+      // response to a "SETUP" (pipelined with "PLAY") - before the socket began to be read for RTP-over-TCP.  "data" is then
+      // handled (shortly) as if it had been read from the socket.  Returns False if the socket is not used for RTP-over-TCP.
+
+  static unsigned tcpSendBacklogLimit;
+      // The maximum number of bytes of RTP packets that may be queued - waiting for a TCP socket to become writable -
+      // before we start dropping (the rest of) frames for that socket.  (RTCP packets are never dropped.)
+  unsigned numPacketsDroppedOverTCP() const { return fNumPacketsDroppedOverTCP; }
 
   Boolean sendPacket(unsigned char* packet, unsigned packetSize);
+  Boolean queuePacket(unsigned char* packet, unsigned packetSize);
+      // Like "sendPacket()", except that - over UDP - the packet may be held back, to be sent (along with any other queued
+      // packets) by "flushPackets()"; see "Groupsock::queueOutput()".  (Over TCP, the packet is sent immediately.)
+  Boolean flushPackets() { return fGS == NULL || fGS->flushOutput(envir()); }
   void startNetworkReading(TaskScheduler::BackgroundHandlerProc*
                            handlerProc);
   Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
@@ -91,16 +107,31 @@ public:
     fAuxReadHandlerClientData = handlerClientData;
   }
 
+  void setCaptureWriter(class RTPCaptureWriter* captureWriter, u_int8_t streamId, Boolean isRTCP) {
+    fCaptureWriter = captureWriter; fCaptureStreamId = streamId; fCaptureIsRTCP = isRTCP;
+  }
+      // If "captureWriter" is not NULL, then each complete packet that's read (by our owner) is also recorded by it.
+  void notePacketRead(unsigned char const* packet, unsigned packetSize) {
+    if (fCaptureWriter != NULL) capturePacket(packet, packetSize);
+  }
+      // Called by our owner after each complete (perhaps after several calls to "handleRead()") packet has been read.
+
+  void setCPUAccount(class CPUAccount* cpuAccount) { fCPUAccount = cpuAccount; }
+      // If "cpuAccount" is not NULL, then our network reading is charged to it (see "CPUAccount.hh"), rather than to
+      // whatever account is current when "startNetworkReading()" is called.
+
   void forgetOurGroupsock() { fGS = NULL; }
     // This may be called - *only immediately prior* to deleting this - to prevent our destructor
     // from turning off background reading on the 'groupsock'.  (This is in case the 'groupsock'
     // is also being read from elsewhere.)
 
 private:
+  void capturePacket(unsigned char const* packet, unsigned packetSize);
+  Boolean sendPacketOverTCPStreams(unsigned char* packet, unsigned packetSize);
+
   // Helper functions for sending a RTP or RTCP packet over a TCP connection:
   Boolean sendRTPorRTCPPacketOverTCP(unsigned char* packet, unsigned packetSize,
-				     int socketNum, unsigned char streamChannelId);
-  Boolean sendDataOverTCP(int socketNum, u_int8_t const* data, unsigned dataSize, Boolean forceSendToSucceed);
+				     int socketNum, unsigned char streamChannelId, Boolean isRTCP);
 
 private:
   friend class SocketDescriptor;
@@ -116,6 +147,14 @@ private:
 
   AuxHandlerFunc* fAuxReadHandlerFunc;
   void* fAuxReadHandlerClientData;
+
+  class RTPCaptureWriter* fCaptureWriter; // if any
+  u_int8_t fCaptureStreamId;
+  Boolean fCaptureIsRTCP;
+
+  class CPUAccount* fCPUAccount; // if any
+
+  unsigned fNumPacketsDroppedOverTCP; // because a TCP receiver's backlog was too large
 };
 
 #endif
@@ -52,6 +52,12 @@ public:
   virtual char* rtpmapLine() const; // returns a string to be delete[]d
   virtual char const* auxSDPLine();
       // optional SDP line (e.g. a=fmtp:...)
+  virtual unsigned char rtxPayloadType() const;
+      // the payload type of the stream (RFC 4588) in which we retransmit lost packets; 0 (the default) if we don't
+
+  virtual Boolean retransmitPacket(u_int16_t seqNum);
+      // Called (by RTCP) when a receiver reports - in a "Generic NACK" - that it didn't get our packet "seqNum".
+      // Returns True iff we were able to retransmit it.  (By default, we can't.)
 
   u_int16_t currentSeqNo() const { return fSeqNo; }
   u_int32_t presetNextTimestamp();
@@ -44,6 +44,30 @@ public:
   Groupsock* RTPgs() const { return fRTPInterface.gs(); }
 
   virtual void setPacketReorderingThresholdTime(unsigned uSeconds) = 0;
+  virtual void setAdaptivePacketReordering(unsigned maxThresholdUSeconds, double lateFraction = 0.01);
+      // Instead of always waiting (up to) a fixed time for a missing packet to arrive out of order, adapt the wait to the
+      // network: Wait just long enough that - judging by how late out-of-order packets have recently arrived - no more
+      // than "lateFraction" of them arrive too late (after we've given up on them), but no less than a multiple of the
+      // interarrival jitter, and no more than "maxThresholdUSeconds".  A smaller "lateFraction" trades latency (and, for
+      // lost packets, a longer stall) for fewer packets that are wasted by arriving too late.
+      // (Calling "setPacketReorderingThresholdTime()" returns to a fixed threshold.)
+  virtual unsigned packetReorderingThresholdTime() const;
+      // the time (in microseconds) that we currently wait for a missing packet
+  virtual unsigned numPacketsInReorderingBuffer() const;
+      // the number of received packets that are waiting (e.g., for an earlier, missing packet) to be delivered
+  virtual unsigned numPacketsArrivedTooLate() const;
+      // the number of packets that arrived - out of order - after we'd stopped waiting for them (and so were discarded)
+
+  virtual void enableRetransmissionRequests(class RTCPInstance* rtcpInstance, unsigned char rtxPayloadFormat,
+					    Boolean sendNACKs, Boolean sendPLIs, Boolean sendFIRs);
+      // Use "rtcpInstance" to send RTCP feedback to the sender: If "sendNACKs", then ask it (RFC 4585) to retransmit each
+      // packet that we're missing - while we're still waiting for it (see above) - which it may do in a separate stream
+      // (RFC 4588) with payload format "rtxPayloadFormat" (or 0 if none).  And after we've given up on a missing packet,
+      // ask for a new key frame: with a "PLI" if "sendPLIs", otherwise with a "FIR" if "sendFIRs".
+      // (With adaptive reordering, our wait grows as needed to allow for retransmissions.)
+  virtual unsigned numPacketsNACKed() const;
+  virtual unsigned numPacketsRetransmitted() const; // i.e., that we received in the retransmission stream
+  virtual unsigned numKeyFrameRequests() const;
 
   // used by RTCP:
   u_int32_t SSRC() const { return fSSRC; }
@@ -77,6 +101,16 @@ public:
 					   handlerClientData);
   }
 
+  void setCaptureWriter(class RTPCaptureWriter* captureWriter, u_int8_t streamId) {
+    // records each incoming RTP packet (see "RTPCapture.hh")
+    fRTPInterface.setCaptureWriter(captureWriter, streamId, False);
+  }
+
+  void setCPUAccount(class CPUAccount* cpuAccount) {
+    // charges our network reading to "cpuAccount" (see "CPUAccount.hh")
+    fRTPInterface.setCPUAccount(cpuAccount);
+  }
+
   // Note that RTP receivers will usually not need to call either of the following two functions, because
   // RTP sequence numbers and timestamps are usually not useful to receivers.
   // (Our implementation of RTP reception already does all needed handling of RTP sequence numbers and timestamps.)
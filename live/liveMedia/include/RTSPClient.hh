@@ -30,6 +30,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _DIGEST_AUTHENTICATION_HH
 #include "DigestAuthentication.hh"
 #endif
+#ifndef _RTSP_COMMON_HH
+#include "RTSPCommon.hh"
+#endif
 #ifndef OMIT_REGISTER_HANDLING
 #ifndef _RTSP_SERVER_HH
 #include "RTSPServer.hh" // For the optional "HandlerForREGISTERCommand" mini-server
@@ -185,6 +188,11 @@ public:
 
   unsigned sessionTimeoutParameter() const { return fSessionTimeoutParameter; }
 
+  void setPipelineId(u_int32_t pipelineId) { fPipelineId = pipelineId; }
+      // If non-zero, then subsequent "SETUP" and "PLAY" requests include a "Pipelined-Requests:" header (RFC 7826,
+      // section 18.33) with this id.  This lets a "PLAY" be sent right behind the first "SETUP" - i.e., before we know
+      // the session id.  (A server that doesn't support this will reject such a "PLAY".)
+
   char const* url() const { return fBaseURL; }
 
   static unsigned responseBufferSize;
@@ -277,7 +285,6 @@ private:
   void handleRequestError(RequestRecord* request);
   Boolean parseResponseCode(char const* line, unsigned& responseCode, char const*& responseString);
   void handleIncomingRequest();
-  static Boolean checkForHeader(char const* line, char const* headerName, unsigned headerNameLength, char const*& headerParams);
   Boolean parseTransportParams(char const* paramsStr,
 			       char*& serverAddressStr, portNumBits& serverPortNum,
 			       unsigned char& rtpChannelId, unsigned char& rtcpChannelId);
@@ -337,8 +344,11 @@ private:
   unsigned char fTCPStreamIdCount; // used for (optional) RTP/TCP
   char* fLastSessionId;
   unsigned fSessionTimeoutParameter; // optionally set in response "Session:" headers
+  u_int32_t fPipelineId; // if non-zero, sent in "Pipelined-Requests:" headers
   char* fResponseBuffer;
   unsigned fResponseBytesAlreadySeen, fResponseBufferBytesLeft;
+  RTSPMessageParser fResponseParser; // for the response in "fResponseBuffer"
+  char* fResponseHeaders; // a copy of the response's headers, with each (known) header value '\0'-terminated
   RequestQueue fRequestsAwaitingConnection, fRequestsAwaitingHTTPTunneling, fRequestsAwaitingResponse;
 
   // Support for tunneling RTSP-over-HTTP:
@@ -51,6 +51,84 @@ Boolean parseRTSPRequestString(char const *reqStr, unsigned reqStrSize,
 			       unsigned resultSessionIdMaxSize,
 			       unsigned& contentLength);
 
+// An incremental parser for the first line and headers of a RTSP (or HTTP) request or response, used by both RTSP clients
+// and servers.  The message may arrive over several reads; each call to "parse()" examines only the bytes that weren't seen
+// by earlier calls.  Header names are looked up (using a perfect hash) as they are scanned, and only the offsets of their
+// values are recorded - so parsing allocates no memory, and never copies or rescans the message.
+#define RTSP_MAX_KNOWN_HEADERS 64 // the most (known) headers in a message that we record, in order
+
+class RTSPMessageParser {
+public:
+  enum HeaderId { CSEQ, SESSION, CONTENT_LENGTH, CONTENT_BASE, CONTENT_TYPE, TRANSPORT, RANGE, SCALE, SPEED, RTP_INFO,
+		  WWW_AUTHENTICATE, PUBLIC, ALLOW, LOCATION, COM_SES_STREAMID, CONNECTION, AUTHORIZATION, ACCEPT,
+		  X_SESSIONCOOKIE, USER_AGENT, DATE, REQUIRE, CACHE_CONTROL, PRAGMA,
+		  NUM_KNOWN_HEADERS, UNKNOWN = NUM_KNOWN_HEADERS };
+
+  RTSPMessageParser() { reset(); }
+  void reset(); // to parse a new message
+
+  Boolean parse(char const* message, unsigned messageSize);
+      // "message" must begin with the same (unchanged) bytes that were given to earlier calls (since "reset()").
+      // Returns True iff we've now seen the end of the headers (a blank line).
+  void finish(unsigned messageSize);
+      // treats the end of the message (at "messageSize") as the end of the headers, even if there's no blank line
+  Boolean isComplete() const { return fState == DONE; }
+  unsigned headersSize() const { return fHeadersSize; } // including the blank line; i.e., the offset of any body
+
+  // The first line of the message (after any initial white space):
+  unsigned startLineOffset() const { return fStartLineOffset; }
+  unsigned startLineSize() const { return fStartLineEnd - fStartLineOffset; }
+
+  // The headers that we know, in the order in which they appeared:
+  unsigned numKnownHeaders() const { return fNumKnownHeaders; }
+  HeaderId headerId(unsigned i) const { return (HeaderId)fKnownHeaders[i].id; }
+  unsigned headerValueOffset(unsigned i) const { return fKnownHeaders[i].valueOffset; }
+  unsigned headerValueSize(unsigned i) const { return fKnownHeaders[i].valueSize; }
+
+  Boolean lookupHeader(HeaderId id, unsigned& valueOffset, unsigned& valueSize) const;
+      // the value of the first such header (if any), without leading white space
+  Boolean copyHeaderValue(char const* message, HeaderId id, char* resultStr, unsigned resultMaxSize) const;
+      // Returns False (and an empty "resultStr") if there was no such header, or if its value doesn't fit
+  unsigned contentLength(char const* message) const; // 0 if there was no (valid) "Content-Length:" header
+
+  Boolean getRTSPRequestParams(char const* message,
+			       char* resultCmdName, unsigned resultCmdNameMaxSize,
+			       char* resultURLPreSuffix, unsigned resultURLPreSuffixMaxSize,
+			       char* resultURLSuffix, unsigned resultURLSuffixMaxSize,
+			       char* resultCSeq, unsigned resultCSeqMaxSize,
+			       char* resultSessionId, unsigned resultSessionIdMaxSize) const;
+      // For a RTSP request; returns False if the message isn't one (or has no "CSeq:" header)
+  Boolean getHTTPRequestParams(char const* message,
+			       char* resultCmdName, unsigned resultCmdNameMaxSize,
+			       char* resultURLSuffix, unsigned resultURLSuffixMaxSize) const;
+      // For a HTTP request (e.g., for RTSP-over-HTTP tunneling); returns False if the message isn't one
+
+  static HeaderId lookupHeaderName(char const* name, unsigned nameSize);
+  static char const* headerName(HeaderId id);
+
+private:
+  Boolean getRequestLine(char const* message, char const* protocolPrefix,
+			 char* resultCmdName, unsigned resultCmdNameMaxSize,
+			 unsigned& urlOffset, unsigned& urlSize) const;
+  void noteHeader(unsigned endOffset);
+
+private:
+  enum { START, START_LINE, LINE_START, HEADER_NAME, HEADER_VALUE_START, HEADER_VALUE, BLANK_LINE_CR, DONE } fState;
+  unsigned fParsedSize; // the number of bytes of the message that we've seen so far
+  Boolean fHaveCR; // the previous line ended with <CR>; a following <LF> is part of its end
+  unsigned fHeadersSize;
+  unsigned fStartLineOffset, fStartLineEnd;
+  unsigned fFirstSpace; // the end of the first token of the first line
+  unsigned fLastTokenOffset, fLastTokenSpaceOffset; // the last token of the first line, and the white space before it
+  unsigned fSpaceOffset; Boolean fInSpace; // the most recent white space in the first line
+  unsigned fNameOffset, fValueOffset;
+  u_int32_t fNameHash;
+  HeaderId fCurrentHeaderId;
+  struct { u_int8_t id; unsigned valueOffset, valueSize; } fKnownHeaders[RTSP_MAX_KNOWN_HEADERS];
+  unsigned fNumKnownHeaders;
+  unsigned fFirstValueOffset[NUM_KNOWN_HEADERS], fFirstValueSize[NUM_KNOWN_HEADERS]; // offset 0 means 'none'
+};
+
 Boolean parseRangeParam(char const* paramStr, double& rangeStart, double& rangeEnd, char*& absStartTime, char*& absEndTime, Boolean& startTimeIsNow);
 Boolean parseRangeHeader(char const* buf, double& rangeStart, double& rangeEnd, char*& absStartTime, char*& absEndTime, Boolean& startTimeIsNow);
 
@@ -27,6 +27,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _DIGEST_AUTHENTICATION_HH
 #include "DigestAuthentication.hh"
 #endif
+#ifndef _RTSP_COMMON_HH
+#include "RTSPCommon.hh"
+#endif
 
 class RTSPServer: public GenericMediaServer {
 public:
@@ -208,12 +211,14 @@ public: // should be protected, but some old compilers complain otherwise
     int& fClientInputSocket; // aliased to ::fOurSocket
     int fClientOutputSocket;
     Boolean fIsActive;
-    unsigned char* fLastCRLF;
+    RTSPMessageParser fRequestParser; // for the request in "fRequestBuffer"
     unsigned fRecursionCount;
     char const* fCurrentCSeq;
     Authenticator fCurrentAuthenticator; // used if access control is needed
     char* fOurSessionCookie; // used for optional RTSP-over-HTTP tunneling
     unsigned fBase64RemainderCount; // used for optional RTSP-over-HTTP tunneling (possible values: 0,1,2,3)
+    u_int32_t fPipelineId; // from the "Pipelined-Requests:" header of the last "SETUP" that created a session; 0 if none
+    u_int32_t fPipelinedSessionId; // the id of that session
   };
 
   // The state of an individual client session (using one or more sequential TCP connections) handled by a RTSP server:
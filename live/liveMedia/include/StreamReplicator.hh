@@ -26,6 +26,36 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class StreamReplica; // forward
+class SharedFramePool; // forward
+
+// A reference-counted frame, shared (without copying) by all of the replicas of a "StreamReplicator" that was created
+// using "createNewWithSharedFrames()":
+class SharedFrame {
+public:
+  unsigned char* data() const { return fData; }
+  unsigned frameSize() const { return fFrameSize; }
+  unsigned numTruncatedBytes() const { return fNumTruncatedBytes; }
+  struct timeval const& presentationTime() const { return fPresentationTime; }
+  unsigned durationInMicroseconds() const { return fDurationInMicroseconds; }
+
+  void addReference() { ++fReferenceCount; }
+  void release(); // each reference - including the one that was handed to you - must be released exactly once
+
+private:
+  friend class StreamReplicator;
+  friend class SharedFramePool;
+  SharedFrame(SharedFramePool& ourPool, unsigned maxSize);
+  ~SharedFrame();
+
+private:
+  SharedFramePool& fOurPool;
+  unsigned char* fData;
+  unsigned fFrameSize, fNumTruncatedBytes;
+  struct timeval fPresentationTime;
+  unsigned fDurationInMicroseconds;
+  unsigned fReferenceCount;
+  SharedFrame* fNextFree;
+};
 
 class StreamReplicator: public Medium {
 public:
@@ -37,8 +67,33 @@ public:
     //   have been deleted.  (This allows you to create new replicas later, if you wish.)  In this case, you delete the
     //   "StreamReplicator" object by calling "Medium::close()" on it - but you must do so only when "numReplicas()" returns 0.
 
+  enum DropPolicy { DROP_OLDEST_FRAME, DROP_NEWEST_FRAME };
+  static StreamReplicator* createNewWithSharedFrames(UsageEnvironment& env, FramedSource* inputSource,
+						     unsigned maxFrameSize, unsigned maxQueuedFramesPerReplica = 30,
+						     DropPolicy dropPolicy = DROP_OLDEST_FRAME,
+						     Boolean deleteWhenLastReplicaDies = True);
+    // A replicator that reads each incoming frame (once) into a reference-counted "SharedFrame", and queues a reference
+    // to it for each active replica, rather than copying the frame from one replica's buffer to another.  The input
+    // source is read at its own pace, rather than at the pace of the slowest replica: if a replica's queue is full,
+    // a frame is dropped - for that replica only - according to "dropPolicy".
+    // Replicas can be read either (as usual) using "getNextFrame()" - which copies the frame into the reader's
+    // buffer - or without copying, using "getNextSharedFrame()" (below).
+
   FramedSource* createStreamReplica();
 
+  Boolean usesSharedFrames() const { return fSharedFramePool != NULL; }
+
+  typedef void (afterGettingSharedFrameFunc)(void* clientData, SharedFrame* frame);
+      // The receiver owns one reference to "frame", and must call "frame->release()" when it is done with it.
+  void getNextSharedFrame(FramedSource* replica,
+			  afterGettingSharedFrameFunc* afterGettingFunc, void* afterGettingClientData,
+			  FramedSource::onCloseFunc* onCloseFunc, void* onCloseClientData);
+      // Can be used (instead of "replica->getNextFrame()") only if "usesSharedFrames()".
+      // "replica" must have been created by us.  (To stop, call "replica->stopGettingFrames()", as usual.)
+
+  unsigned numDroppedFrames(FramedSource* replica) const;
+      // The number of frames that have been dropped - because its queue was full - for "replica" (if "usesSharedFrames()")
+
   unsigned numReplicas() const { return fNumReplicas; }
 
   FramedSource* inputSource() const { return fInputSource; }
@@ -46,9 +101,15 @@ public:
   // Call before destruction if you want to prevent the destructor from closing the input source
   void detachInputSource() { fInputSource = NULL; }
 
+  void replaceInputSource(FramedSource* newInputSource);
+    // Stops reading from the current input source (without closing it), and continues - for the existing replicas - with
+    // "newInputSource" (which may be NULL, meaning: no input for now).  This lets the replicas survive a change of source
+    // (e.g., after reconnecting to a camera).  (Note: This can be used only in 'shared frames' mode.)
+
 protected:
-  StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies);
-    // called only by "createNew()"
+  StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies,
+		   unsigned maxFrameSize = 0, unsigned maxQueuedFramesPerReplica = 0, DropPolicy dropPolicy = DROP_OLDEST_FRAME);
+    // called only by "createNew()" or "createNewWithSharedFrames()"
   virtual ~StreamReplicator();
 
 private:
@@ -71,6 +132,16 @@ private:
 
   void deliverReceivedFrame();
 
+  // Implementation of the 'shared frames' mode:
+  void getNextSharedFrame(StreamReplica* replica);
+  void deactivateSharedFrameReplica(StreamReplica* replica);
+  void readNextSharedFrame();
+  void afterGettingSharedFrame(unsigned frameSize, unsigned numTruncatedBytes,
+			       struct timeval presentationTime, unsigned durationInMicroseconds);
+  void enqueueSharedFrame(StreamReplica* replica, SharedFrame* frame);
+  Boolean deliverQueuedFrames(); // returns True iff a delivery was made
+  void onSourceClosureSharedFrames();
+
 private:
   FramedSource* fInputSource;
   Boolean fDeleteWhenLastReplicaDies, fInputSourceHasClosed; 
@@ -80,5 +151,12 @@ private:
   StreamReplica* fMasterReplica; // the first replica that requests each frame.  We use its buffer when copying to the others.
   StreamReplica* fReplicasAwaitingCurrentFrame; // other than the 'master' replica
   StreamReplica* fReplicasAwaitingNextFrame; // replicas that have already received the current frame, and have asked for the next
+
+  // Used only in 'shared frames' mode:
+  SharedFramePool* fSharedFramePool;
+  unsigned fMaxQueuedFramesPerReplica;
+  DropPolicy fDropPolicy;
+  SharedFrame* fFrameBeingRead;
+  StreamReplica* fAllReplicas; // a list of all of our replicas
 };
 #endif
@@ -35,4 +35,9 @@ extern unsigned char* our_MD5DataRaw(unsigned char const* data, unsigned dataSiz
     // buffer, which should be later delete[]d by the caller), or else it must point to
     // a (>=)16-byte buffer (which this function will also return).
 
+extern char* our_MD5Fields(char const* const* fields, unsigned numFields, char* outputDigest);
+    // Like "ourMD5Data()", except that the data is the "numFields" ('\0'-terminated) strings "fields", separated by ':'
+    // - e.g., "<username>:<realm>:<password>", as used in digest authentication - so the caller needn't construct it.
+    // "outputDigest" must point to a (>=)33-byte buffer (which this function will also return).
+
 #endif
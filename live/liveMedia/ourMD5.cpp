@@ -73,6 +73,18 @@ unsigned char* our_MD5DataRaw(unsigned char const* data, unsigned dataSize,
   return outputDigest;
 }
 
+char* our_MD5Fields(char const* const* fields, unsigned numFields, char* outputDigest) {
+  MD5Context ctx;
+
+  for (unsigned i = 0; i < numFields; ++i) {
+    if (i > 0) ctx.addData((unsigned char const*)":", 1);
+    ctx.addData((unsigned char const*)fields[i], strlen(fields[i]));
+  }
+  ctx.end(outputDigest);
+
+  return outputDigest;
+}
+
 
 ////////// MD5Context implementation //////////
 
@@ -205,8 +217,10 @@ void MD5Context::zeroize() {
 #define S44 21
 
 // Basic MD5 functions:
-#define F(x, y, z) (((x) & (y)) | ((~x) & (z)))
-#define G(x, y, z) (((x) & (z)) | ((y) & (~z)))
+// (We use equivalent forms of "F()" and "G()" that need one fewer operation:
+//  ((x & y) | (~x & z)) == (z ^ (x & (y ^ z))), and ((x & z) | (y & ~z)) == (y ^ (z & (x ^ y))).)
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
 #define H(x, y, z) ((x) ^ (y) ^ (z))
 #define I(x, y, z) ((y) ^ ((x) | (~z)))
 
@@ -0,0 +1,416 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// A 'connect storm' benchmark for a TCP server (e.g., that of "RtspToTCP") or a RTSP server.  It opens a number of
+// connections, spread evenly over a short time - as when many viewers reconnect at once, after a network outage - and
+// reports how long it took until each of them (and all of them) were streaming, i.e., had received their first media data.
+// (We use "poll()" - rather than a "TaskScheduler" - because we may have many more sockets than "select()" can handle.)
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <poll.h>
+#include <sys/resource.h>
+#endif
+
+UsageEnvironment* env;
+char const* progName;
+
+// Parameters (set by command-line options):
+unsigned numConnections = 1000;
+unsigned stormMilliseconds = 1000; // over which the connections are started
+unsigned timeoutSeconds = 30; // after the last connection was started
+char const* rtspURL = NULL; // if we're connecting to a RTSP server (otherwise, we just wait for data from a TCP server)
+char const* serverHostName = NULL;
+portNumBits serverPortNum = 0;
+
+#if !defined(__WIN32__) && !defined(_WIN32)
+
+static double secondsSince(struct timeval const& time) {
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  return (timeNow.tv_sec - time.tv_sec) + (timeNow.tv_usec - time.tv_usec)/1000000.0;
+}
+
+class StormConnection {
+public:
+  StormConnection();
+  ~StormConnection();
+
+  void start(struct sockaddr_in const& serverAddress);
+  void handleWritable(); // our connection has been established (or has failed)
+  void handleReadable();
+
+  Boolean isActive() const { return fState != NOT_STARTED && fState != FAILED && fState != ENDED; }
+  Boolean hasStreamed() const { return fState == STREAMING || fState == ENDED; }
+  short pollEvents() const { return fState == CONNECTING ? POLLOUT : POLLIN; }
+
+public:
+  enum { NOT_STARTED, CONNECTING, AWAITING_DESCRIBE_RESPONSE, AWAITING_SETUP_RESPONSE, AWAITING_PLAY_RESPONSE,
+	 AWAITING_DATA, STREAMING, ENDED/*the server closed the connection after streaming*/, FAILED } fState;
+  int fSocketNum;
+  struct timeval fStartTime;
+  double fConnectSeconds; // from starting, until the TCP connection was established
+  double fStreamingSeconds; // from starting, until we received our first media data
+  double fStreamingTime; // from the start of the storm (set by our caller)
+
+private:
+  void fail();
+  void sendRequest(char const* command, char const* url, char const* extraHeaders);
+  Boolean haveResponse(char const*& body); // returns True iff we've received a complete RTSP response
+  void handleResponse(char const* body);
+  void startStreaming();
+
+private:
+  char fBuffer[20000];
+  unsigned fBufferSize;
+  unsigned fCSeq;
+  char* fSessionId;
+};
+
+StormConnection::StormConnection()
+  : fState(NOT_STARTED), fSocketNum(-1), fConnectSeconds(0.0), fStreamingSeconds(0.0), fStreamingTime(0.0),
+    fBufferSize(0), fCSeq(0), fSessionId(NULL) {
+}
+
+StormConnection::~StormConnection() {
+  if (fSocketNum >= 0) closeSocket(fSocketNum);
+  delete[] fSessionId;
+}
+
+void StormConnection::start(struct sockaddr_in const& serverAddress) {
+  gettimeofday(&fStartTime, NULL);
+  fSocketNum = socket(AF_INET, SOCK_STREAM, 0);
+  if (fSocketNum < 0) {
+    fail();
+    return;
+  }
+  makeSocketNonBlocking(fSocketNum);
+
+  fState = CONNECTING;
+  if (connect(fSocketNum, (struct sockaddr*)&serverAddress, sizeof serverAddress) < 0
+      && env->getErrno() != EINPROGRESS && env->getErrno() != EWOULDBLOCK) {
+    fail();
+  }
+}
+
+void StormConnection::handleWritable() {
+  int err = 0;
+  SOCKLEN_T len = sizeof err;
+  if (getsockopt(fSocketNum, SOL_SOCKET, SO_ERROR, (char*)&err, &len) < 0 || err != 0) {
+    fail();
+    return;
+  }
+  fConnectSeconds = secondsSince(fStartTime);
+
+  if (rtspURL == NULL) {
+    fState = AWAITING_DATA; // a TCP server starts sending data to us right away
+  } else {
+    fState = AWAITING_DESCRIBE_RESPONSE;
+    sendRequest("DESCRIBE", rtspURL, "Accept: application/sdp\r\n");
+  }
+}
+
+void StormConnection::handleReadable() {
+  if (fBufferSize >= sizeof fBuffer - 1) fBufferSize = 0; // we've seen all that we need of earlier data
+  int bytesRead = recv(fSocketNum, &fBuffer[fBufferSize], sizeof fBuffer - 1 - fBufferSize, 0);
+  if (bytesRead <= 0) {
+    if (bytesRead < 0 && env->getErrno() == EWOULDBLOCK) return;
+    Boolean const hadStreamed = fState == STREAMING;
+    fail();
+    if (hadStreamed) fState = ENDED;
+    return;
+  }
+  if (fState == STREAMING) return; // we just discard data now
+
+  fBufferSize += bytesRead;
+  fBuffer[fBufferSize] = '\0';
+
+  if (fState == AWAITING_DATA || (fState == AWAITING_PLAY_RESPONSE && fBuffer[0] == '$')) {
+    // (A server may start sending (interleaved) media data before its response to "PLAY".)
+    startStreaming();
+    return;
+  }
+
+  char const* body;
+  if (haveResponse(body)) handleResponse(body);
+}
+
+void StormConnection::fail() {
+  if (fSocketNum >= 0) closeSocket(fSocketNum);
+  fSocketNum = -1;
+  fState = FAILED;
+}
+
+void StormConnection::sendRequest(char const* command, char const* url, char const* extraHeaders) {
+  char request[2000];
+  snprintf(request, sizeof request, "%s %s RTSP/1.0\r\nCSeq: %u\r\n%s%s%s%s\r\n",
+	   command, url, ++fCSeq, extraHeaders,
+	   fSessionId == NULL ? "" : "Session: ", fSessionId == NULL ? "" : fSessionId, fSessionId == NULL ? "" : "\r\n");
+  fBufferSize = 0;
+  if (send(fSocketNum, request, strlen(request), 0) != (int)strlen(request)) fail();
+}
+
+Boolean StormConnection::haveResponse(char const*& body) {
+  char const* endOfHeaders = strstr(fBuffer, "\r\n\r\n");
+  if (endOfHeaders == NULL) return False;
+  body = endOfHeaders + 4;
+
+  unsigned contentLength = 0;
+  char const* contentLengthHeader = strstr(fBuffer, "Content-Length:");
+  if (contentLengthHeader != NULL && contentLengthHeader < endOfHeaders) {
+    sscanf(contentLengthHeader, "Content-Length: %u", &contentLength);
+  }
+  return &fBuffer[fBufferSize] - body >= (int)contentLength;
+}
+
+void StormConnection::handleResponse(char const* body) {
+  if (strncmp(fBuffer, "RTSP/1.0 200", 12) != 0) {
+    fail();
+    return;
+  }
+
+  switch (fState) {
+    case AWAITING_DESCRIBE_RESPONSE: {
+      // Set up the first subsession in the SDP description, streaming (interleaved) over our connection:
+      char const* mediaLine = strstr(body, "m=");
+      char const* controlAttribute = mediaLine == NULL ? NULL : strstr(mediaLine, "a=control:");
+      char control[1000];
+      if (controlAttribute == NULL || sscanf(controlAttribute, "a=control:%999s", control) != 1) {
+	fail();
+	return;
+      }
+      char setupURL[2000];
+      if (strncmp(control, "rtsp://", 7) == 0) {
+	snprintf(setupURL, sizeof setupURL, "%s", control);
+      } else {
+	snprintf(setupURL, sizeof setupURL, "%s/%s", rtspURL, control);
+      }
+      fState = AWAITING_SETUP_RESPONSE;
+      sendRequest("SETUP", setupURL, "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n");
+      break;
+    }
+    case AWAITING_SETUP_RESPONSE: {
+      char const* sessionHeader = strstr(fBuffer, "Session: ");
+      char sessionId[200];
+      if (sessionHeader == NULL || sscanf(sessionHeader, "Session: %199[^;\r]", sessionId) != 1) {
+	fail();
+	return;
+      }
+      fSessionId = strDup(sessionId);
+      fState = AWAITING_PLAY_RESPONSE;
+      sendRequest("PLAY", rtspURL, "Range: npt=0.000-\r\n");
+      break;
+    }
+    case AWAITING_PLAY_RESPONSE: {
+      // Any data after the response is (interleaved) media data:
+      if (body < &fBuffer[fBufferSize]) {
+	startStreaming();
+      } else {
+	fState = AWAITING_DATA;
+      }
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+void StormConnection::startStreaming() {
+  fStreamingSeconds = secondsSince(fStartTime);
+  fState = STREAMING;
+}
+
+static int compareDoubles(void const* a, void const* b) {
+  double const da = *(double const*)a, db = *(double const*)b;
+  return da < db ? -1 : da > db ? 1 : 0;
+}
+
+static void reportPercentiles(char const* label, double* values, unsigned numValues) {
+  if (numValues == 0) return;
+  qsort(values, numValues, sizeof values[0], compareDoubles);
+
+  char line[200];
+  snprintf(line, sizeof line, "%s: p50 %.1f ms, p99 %.1f ms, max %.1f ms\n", label,
+	   values[numValues/2]*1000, values[(numValues*99)/100]*1000, values[numValues-1]*1000);
+  *env << line;
+}
+#endif
+
+////////// main program //////////
+
+void usage() {
+  *env << "Usage: " << progName << " [-n connections] [-t storm-milliseconds] [-d timeout-seconds]"
+       << " <tcp-server-host> <tcp-server-port>\n"
+       << "   or: " << progName << " [options] <rtsp-url>\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  while (argc > 1 && argv[1][0] == '-') {
+    char* const opt = argv[1];
+    if (argc < 3 || opt[2] != '\0') usage(); // each option takes one value
+
+    char* const value = argv[2];
+    Boolean ok;
+    switch (opt[1]) {
+      case 'n': { ok = sscanf(value, "%u", &numConnections) == 1 && numConnections > 0; break; }
+      case 't': { ok = sscanf(value, "%u", &stormMilliseconds) == 1; break; }
+      case 'd': { ok = sscanf(value, "%u", &timeoutSeconds) == 1 && timeoutSeconds > 0; break; }
+      default: { ok = False; break; }
+    }
+    if (!ok) usage();
+    argv += 2; argc -= 2;
+  }
+
+  char* username; char* password; char const* urlSuffix;
+  NetAddress serverAddress;
+  if (argc == 2) {
+    rtspURL = argv[1];
+    if (!RTSPClient::parseRTSPURL(*env, rtspURL, username, password, serverAddress, serverPortNum, &urlSuffix)) usage();
+    delete[] username; delete[] password;
+  } else if (argc == 3) {
+    serverHostName = argv[1];
+    if (sscanf(argv[2], "%hu", &serverPortNum) != 1 || serverPortNum == 0) usage();
+    NetAddressList addresses(serverHostName);
+    if (addresses.numAddresses() == 0) usage();
+    serverAddress = *addresses.firstAddress();
+  } else {
+    usage();
+  }
+
+#if defined(__WIN32__) || defined(_WIN32)
+  *env << progName << ": This benchmark uses \"poll()\", so it isn't supported on Windows\n";
+  return 1;
+#else
+  // Make sure that we can open enough sockets:
+  struct rlimit fileLimit;
+  if (getrlimit(RLIMIT_NOFILE, &fileLimit) == 0 && fileLimit.rlim_cur < numConnections + 100) {
+    fileLimit.rlim_cur = fileLimit.rlim_max < numConnections + 100 ? fileLimit.rlim_max : numConnections + 100;
+    setrlimit(RLIMIT_NOFILE, &fileLimit);
+    if (fileLimit.rlim_cur < numConnections + 100) {
+      *env << progName << ": Warning: We can open only " << (unsigned)fileLimit.rlim_cur << " files; some connections will fail\n";
+    }
+  }
+
+  struct sockaddr_in serverSockAddr;
+  memset(&serverSockAddr, 0, sizeof serverSockAddr);
+  serverSockAddr.sin_family = AF_INET;
+  serverSockAddr.sin_addr.s_addr = *(unsigned*)(serverAddress.data());
+  serverSockAddr.sin_port = htons(serverPortNum);
+
+  *env << "Opening " << numConnections << " connections to " << (rtspURL != NULL ? rtspURL : serverHostName)
+       << (rtspURL != NULL ? "" : " port ");
+  if (rtspURL == NULL) *env << serverPortNum;
+  *env << " over " << stormMilliseconds << " ms...\n";
+
+  StormConnection* connections = new StormConnection[numConnections];
+  struct pollfd* pollFds = new struct pollfd[numConnections];
+  unsigned* pollConnectionIndices = new unsigned[numConnections];
+  unsigned numStarted = 0, numStreaming = 0;
+
+  struct timeval stormStartTime;
+  gettimeofday(&stormStartTime, NULL);
+  while (1) {
+    double const elapsedSeconds = secondsSince(stormStartTime);
+
+    // Start the connections that are now due:
+    while (numStarted < numConnections
+	   && (stormMilliseconds == 0 || numStarted*(double)stormMilliseconds/numConnections <= elapsedSeconds*1000)) {
+      connections[numStarted++].start(serverSockAddr);
+    }
+
+    unsigned numPending = 0;
+    unsigned numPollFds = 0;
+    for (unsigned i = 0; i < numStarted; ++i) {
+      StormConnection& connection = connections[i];
+      if (!connection.isActive()) continue;
+      if (connection.fState != StormConnection::STREAMING) ++numPending;
+
+      pollFds[numPollFds].fd = connection.fSocketNum;
+      pollFds[numPollFds].events = connection.pollEvents();
+      pollFds[numPollFds].revents = 0;
+      pollConnectionIndices[numPollFds++] = i;
+    }
+    if (numStarted == numConnections
+	&& (numPending == 0 || elapsedSeconds > stormMilliseconds/1000.0 + timeoutSeconds)) break;
+
+    if (poll(pollFds, numPollFds, 1) < 0 && env->getErrno() != EINTR) {
+      *env << "poll() failed: " << env->getErrno() << "\n";
+      break;
+    }
+    for (unsigned j = 0; j < numPollFds; ++j) {
+      if (pollFds[j].revents == 0) continue;
+      StormConnection& connection = connections[pollConnectionIndices[j]];
+
+      if (connection.fState == StormConnection::CONNECTING) {
+	connection.handleWritable();
+      } else {
+	connection.handleReadable();
+      }
+      if (connection.fState == StormConnection::STREAMING && connection.fStreamingTime == 0.0) {
+	connection.fStreamingTime = secondsSince(stormStartTime);
+	++numStreaming;
+      }
+    }
+  }
+  double const totalSeconds = secondsSince(stormStartTime);
+
+  // Report our results:
+  double* connectSeconds = new double[numConnections];
+  double* streamingSeconds = new double[numConnections];
+  unsigned numConnected = 0, numSlowConnects = 0, numFailed = 0, numStreamingReported = 0;
+  double lastStreamingTime = 0.0;
+  for (unsigned i = 0; i < numConnections; ++i) {
+    StormConnection& connection = connections[i];
+    if (connection.fState == StormConnection::FAILED) ++numFailed;
+    if (connection.fConnectSeconds > 0.0) {
+      connectSeconds[numConnected++] = connection.fConnectSeconds;
+      if (connection.fConnectSeconds >= 1.0) ++numSlowConnects; // the SYN (or its SYN-ACK) must have been retransmitted
+    }
+    if (connection.hasStreamed()) {
+      streamingSeconds[numStreamingReported++] = connection.fStreamingSeconds;
+      if (connection.fStreamingTime > lastStreamingTime) lastStreamingTime = connection.fStreamingTime;
+    }
+  }
+
+  char line[300];
+  snprintf(line, sizeof line, "%u connections: %u streaming, %u failed, %u still waiting after %.1f seconds\n",
+	   numConnections, numStreaming, numFailed, numConnections - numStreaming - numFailed, totalSeconds);
+  *env << line;
+  reportPercentiles("Time to connect", connectSeconds, numConnected);
+  snprintf(line, sizeof line, "Connections that took 1 second or more to connect (SYN retransmissions): %u\n", numSlowConnects);
+  *env << line;
+  reportPercentiles("Time from connecting until streaming", streamingSeconds, numStreamingReported);
+  if (numStreaming == numConnections) {
+    snprintf(line, sizeof line, "All connections were streaming %.1f ms after the storm began\n", lastStreamingTime*1000);
+    *env << line;
+  }
+
+  delete[] connectSeconds; delete[] streamingSeconds;
+  delete[] pollFds; delete[] pollConnectionIndices;
+  delete[] connections; // closes our sockets (so that the 'TIME_WAIT' state ends up at our end of the connections)
+  return numStreaming == numConnections ? 0 : 2;
+#endif
+}
@@ -0,0 +1,875 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// A benchmark for "RtspToTCP".  It serves a number of simulated H.264 cameras (with a built-in RTSP server),
+// runs a "RtspToTCP" process for each of them, attaches a number of TCP clients to each "RtspToTCP" process,
+// and then reports - for each camera, and in total - the frame rate, frame loss and latency seen by the
+// TCP clients, and the CPU and memory used by the "RtspToTCP" processes.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#endif
+
+UsageEnvironment* env;
+char const* progName;
+
+// Parameters (set by command-line options):
+unsigned numCameras = 4;
+unsigned numConsumersPerCamera = 1;
+unsigned bitrateKbps = 2000;
+unsigned frameRate = 25;
+unsigned gopLength = 50; // frames from one key frame to the next
+double lossPercent = 0.0; // of RTP and RTCP packets sent by the cameras
+double reorderPercent = 0.0; // of RTP and RTCP packets sent by the cameras (each is delayed until after the next packet)
+unsigned retransmissionHistorySize = 0; // if non-zero, the cameras keep this many packets, to retransmit any that are NACKed
+unsigned startupSeconds = 2; // before the TCP clients connect
+unsigned warmupSeconds = 3; // after the TCP clients connect, before we start measuring
+unsigned durationSeconds = 10; // of the measurement
+portNumBits rtspServerPortNum = 18554;
+portNumBits firstTCPServerPortNum = 19001; // for camera 0; camera i uses firstTCPServerPortNum+i
+char const* rtspToTCPPath = NULL;
+char** rtspToTCPExtraArgs = NULL; // additional arguments for each "RtspToTCP" process
+int numRtspToTCPExtraArgs = 0;
+
+// Each picture that a simulated camera sends is preceded by a SEI NAL unit ("user data unregistered") that contains
+// this UUID, followed by a text that identifies the picture, its capture time, and the size of its slice NAL unit:
+static unsigned char const seiUUID[16]
+  = {'R','t','s','p','T','o','T','C','P','-','b','e','n','c','h','1'};
+#define SEI_TEXT_FORMAT "camera %u frame %u time %lu.%06lu slice %u"
+
+// Our SPS and PPS NAL units.  (The slice NAL units that follow them contain random data, so the stream can't be decoded.
+// None of our NAL units contain a 0 byte, so the TCP clients can find them - and their start codes - unambiguously.)
+static unsigned char const sps[] = { 0x67, 0x42, 0xC0, 0x1F, 0x8C, 0x8D, 0x40, 0x50, 0x1E, 0xD8, 0x08, 0x80, 0x8C, 0x04 };
+static unsigned char const pps[] = { 0x68, 0xCE, 0x3C, 0x80 };
+
+class CameraState {
+public:
+  CameraState();
+
+public:
+  unsigned index;
+  portNumBits tcpServerPortNum; // of this camera's "RtspToTCP" process
+  unsigned numFramesSent; // since we started measuring
+#if !defined(__WIN32__) && !defined(_WIN32)
+  pid_t pid; // of this camera's "RtspToTCP" process
+#endif
+  Boolean processHasExited;
+  double cpuSecondsAtStart; // used by this camera's "RtspToTCP" process, when we started measuring
+  double cpuSecondsUsed; // by this camera's "RtspToTCP" process, while we were measuring
+  unsigned rssKB, peakRSSKB; // of this camera's "RtspToTCP" process, when we stopped measuring
+};
+
+CameraState* cameras = NULL;
+
+class LoadConsumer; // forward
+LoadConsumer** consumers = NULL; // numCameras*numConsumersPerCamera of them
+Boolean areMeasuring = False;
+struct timeval measurementStartTime;
+double selfCPUSecondsAtStart;
+
+////////// A source of synthetic H.264 NAL units, at the configured frame rate, bit rate, and GOP length //////////
+
+class SyntheticH264Source: public FramedSource {
+public:
+  static SyntheticH264Source* createNew(UsageEnvironment& env, CameraState& camera);
+
+protected:
+  SyntheticH264Source(UsageEnvironment& env, CameraState& camera);
+      // called only by createNew()
+  virtual ~SyntheticH264Source();
+
+private:
+  // redefined virtual functions:
+  virtual void doGetNextFrame();
+  virtual void doStopGettingFrames();
+
+private:
+  static void startNextPicture(void* clientData);
+  void startNextPicture1();
+  void deliverNextNALUnit();
+
+private:
+  CameraState& fCamera;
+  TaskToken fNextPictureTask;
+  unsigned fFrameNum;
+  struct timeval fPictureTime, fNextPictureTime;
+  Boolean fIsKeyFrame;
+  unsigned fNALUnitIndex, fNumNALUnits; // within the current picture
+  unsigned char fSEI[3 + sizeof seiUUID + 100 + 1];
+  unsigned fSEISize;
+  unsigned fSliceSize;
+};
+
+static unsigned char* randomSliceData = NULL; // shared by all sources
+static unsigned maxSliceSize = 0;
+
+static unsigned sliceSize(Boolean isKeyFrame) {
+  // Key frames are 4 times the size of other frames:
+  unsigned const bytesPerGOP = (unsigned)(((u_int64_t)bitrateKbps*1000/8)*gopLength/frameRate);
+  unsigned const bytesPerFrame = bytesPerGOP/(gopLength + 3);
+  unsigned size = isKeyFrame && gopLength > 1 ? 4*bytesPerFrame : bytesPerFrame;
+  if (size < 2) size = 2;
+  return size;
+}
+
+SyntheticH264Source* SyntheticH264Source::createNew(UsageEnvironment& env, CameraState& camera) {
+  return new SyntheticH264Source(env, camera);
+}
+
+SyntheticH264Source::SyntheticH264Source(UsageEnvironment& env, CameraState& camera)
+  : FramedSource(env), fCamera(camera), fNextPictureTask(NULL), fFrameNum(0),
+    fIsKeyFrame(False), fNALUnitIndex(0), fNumNALUnits(0), fSEISize(0), fSliceSize(0) {
+  fNextPictureTime.tv_sec = fNextPictureTime.tv_usec = 0;
+
+  if (randomSliceData == NULL) {
+    maxSliceSize = sliceSize(True);
+    randomSliceData = new unsigned char[maxSliceSize];
+    for (unsigned i = 0; i < maxSliceSize; ++i) randomSliceData[i] = 1 + our_random()%255; // never 0
+  }
+}
+
+SyntheticH264Source::~SyntheticH264Source() {
+  envir().taskScheduler().unscheduleDelayedTask(fNextPictureTask);
+}
+
+void SyntheticH264Source::doGetNextFrame() {
+  if (fNALUnitIndex < fNumNALUnits) {
+    // Deliver the next NAL unit of the current picture immediately:
+    deliverNextNALUnit();
+    return;
+  }
+
+  // Wait until it's time for the next picture:
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  if (fNextPictureTime.tv_sec == 0) fNextPictureTime = timeNow;
+  int64_t uSecondsToGo = (int64_t)(fNextPictureTime.tv_sec - timeNow.tv_sec)*1000000
+    + (fNextPictureTime.tv_usec - timeNow.tv_usec);
+  if (uSecondsToGo < 0) uSecondsToGo = 0;
+  fNextPictureTask = envir().taskScheduler().scheduleDelayedTask(uSecondsToGo, startNextPicture, this);
+}
+
+void SyntheticH264Source::doStopGettingFrames() {
+  envir().taskScheduler().unscheduleDelayedTask(fNextPictureTask);
+}
+
+void SyntheticH264Source::startNextPicture(void* clientData) {
+  ((SyntheticH264Source*)clientData)->startNextPicture1();
+}
+
+void SyntheticH264Source::startNextPicture1() {
+  fNextPictureTask = NULL;
+
+  // The picture's 'capture' time is the time at which it was due:
+  fPictureTime = fNextPictureTime;
+  fNextPictureTime.tv_usec += 1000000/frameRate;
+  fNextPictureTime.tv_sec += fNextPictureTime.tv_usec/1000000;
+  fNextPictureTime.tv_usec %= 1000000;
+
+  fIsKeyFrame = fFrameNum%gopLength == 0;
+  fSliceSize = sliceSize(fIsKeyFrame);
+
+  // Construct the SEI NAL unit that identifies this picture:
+  char text[100];
+  int const textSize = snprintf(text, sizeof text, SEI_TEXT_FORMAT, fCamera.index, fFrameNum,
+				(unsigned long)fPictureTime.tv_sec, (unsigned long)fPictureTime.tv_usec, fSliceSize);
+  unsigned const payloadSize = sizeof seiUUID + textSize;
+  fSEI[0] = 6; // nal_unit_type: SEI
+  fSEI[1] = 5; // payloadType: user_data_unregistered
+  fSEI[2] = payloadSize;
+  memmove(&fSEI[3], seiUUID, sizeof seiUUID);
+  memmove(&fSEI[3 + sizeof seiUUID], text, textSize);
+  fSEI[3 + payloadSize] = 0x80; // rbsp_trailing_bits
+  fSEISize = 3 + payloadSize + 1;
+
+  // A key frame is preceded by the SPS and PPS (as most cameras do):
+  fNALUnitIndex = fIsKeyFrame ? 0 : 2;
+  fNumNALUnits = 4;
+
+  ++fFrameNum;
+  if (areMeasuring) ++fCamera.numFramesSent;
+  deliverNextNALUnit();
+}
+
+void SyntheticH264Source::deliverNextNALUnit() {
+  unsigned char const* nalUnit;
+  unsigned nalUnitSize;
+  switch (fNALUnitIndex++) {
+    case 0: { nalUnit = sps; nalUnitSize = sizeof sps; break; }
+    case 1: { nalUnit = pps; nalUnitSize = sizeof pps; break; }
+    case 2: { nalUnit = fSEI; nalUnitSize = fSEISize; break; }
+    default: { nalUnit = NULL; nalUnitSize = fSliceSize; break; } // the slice
+  }
+
+  if (nalUnitSize > fMaxSize) {
+    fNumTruncatedBytes = nalUnitSize - fMaxSize;
+    nalUnitSize = fMaxSize;
+  } else {
+    fNumTruncatedBytes = 0;
+  }
+  fFrameSize = nalUnitSize;
+
+  if (nalUnit != NULL) {
+    memmove(fTo, nalUnit, nalUnitSize);
+  } else {
+    fTo[0] = fIsKeyFrame ? 0x65 /*IDR slice*/ : 0x41 /*non-IDR slice*/;
+    memmove(&fTo[1], randomSliceData, nalUnitSize - 1);
+  }
+
+  fPresentationTime = fPictureTime;
+  fDurationInMicroseconds = 0; // we do our own pacing
+  FramedSource::afterGetting(this);
+}
+
+////////// A "Groupsock" that drops, and reorders, a proportion of the packets that it sends //////////
+
+class ImpairedGroupsock: public Groupsock {
+public:
+  ImpairedGroupsock(UsageEnvironment& env, struct in_addr const& groupAddr, Port port);
+  virtual ~ImpairedGroupsock();
+
+  // redefined virtual functions:
+  virtual Boolean output(UsageEnvironment& env, unsigned char* buffer, unsigned bufferSize,
+			 DirectedNetInterface* interfaceNotToFwdBackTo = NULL);
+
+private:
+  unsigned char fHeldPacket[2048]; // a packet that we're delaying until after the next one
+  unsigned fHeldPacketSize;
+};
+
+static Boolean withProbability(double percent) {
+  return percent > 0.0 && (our_random()%1000000) < percent*10000;
+}
+
+ImpairedGroupsock::ImpairedGroupsock(UsageEnvironment& env, struct in_addr const& groupAddr, Port port)
+  : Groupsock(env, groupAddr, port, 255), fHeldPacketSize(0) {
+}
+
+ImpairedGroupsock::~ImpairedGroupsock() {
+}
+
+Boolean ImpairedGroupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned bufferSize,
+				  DirectedNetInterface* interfaceNotToFwdBackTo) {
+  if (withProbability(lossPercent)) return True; // the packet was 'lost'
+
+  if (fHeldPacketSize == 0 && bufferSize <= sizeof fHeldPacket && withProbability(reorderPercent)) {
+    // Send this packet after the next one:
+    memmove(fHeldPacket, buffer, bufferSize);
+    fHeldPacketSize = bufferSize;
+    return True;
+  }
+
+  Boolean result = Groupsock::output(env, buffer, bufferSize, interfaceNotToFwdBackTo);
+  if (fHeldPacketSize > 0) {
+    Groupsock::output(env, fHeldPacket, fHeldPacketSize, interfaceNotToFwdBackTo);
+    fHeldPacketSize = 0;
+  }
+  return result;
+}
+
+////////// A simulated camera's subsession, served on demand //////////
+
+class SyntheticH264ServerMediaSubsession: public OnDemandServerMediaSubsession {
+public:
+  static SyntheticH264ServerMediaSubsession* createNew(UsageEnvironment& env, CameraState& camera);
+
+protected:
+  SyntheticH264ServerMediaSubsession(UsageEnvironment& env, CameraState& camera);
+      // called only by createNew()
+  virtual ~SyntheticH264ServerMediaSubsession();
+
+protected: // redefined virtual functions
+  virtual FramedSource* createNewStreamSource(unsigned clientSessionId, unsigned& estBitrate);
+  virtual RTPSink* createNewRTPSink(Groupsock* rtpGroupsock, unsigned char rtpPayloadTypeIfDynamic,
+				    FramedSource* inputSource);
+  virtual Groupsock* createGroupsock(struct in_addr const& addr, Port port);
+
+private:
+  CameraState& fCamera;
+};
+
+SyntheticH264ServerMediaSubsession*
+SyntheticH264ServerMediaSubsession::createNew(UsageEnvironment& env, CameraState& camera) {
+  return new SyntheticH264ServerMediaSubsession(env, camera);
+}
+
+SyntheticH264ServerMediaSubsession::SyntheticH264ServerMediaSubsession(UsageEnvironment& env, CameraState& camera)
+  : OnDemandServerMediaSubsession(env, True/*reuse the first source*/), fCamera(camera) {
+}
+
+SyntheticH264ServerMediaSubsession::~SyntheticH264ServerMediaSubsession() {
+}
+
+FramedSource* SyntheticH264ServerMediaSubsession::createNewStreamSource(unsigned /*clientSessionId*/, unsigned& estBitrate) {
+  estBitrate = bitrateKbps;
+  return H264VideoStreamDiscreteFramer::createNew(envir(), SyntheticH264Source::createNew(envir(), fCamera));
+}
+
+RTPSink* SyntheticH264ServerMediaSubsession::createNewRTPSink(Groupsock* rtpGroupsock, unsigned char rtpPayloadTypeIfDynamic,
+							     FramedSource* /*inputSource*/) {
+  H264VideoRTPSink* rtpSink
+    = H264VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic, sps, sizeof sps, pps, sizeof pps);
+  if (retransmissionHistorySize > 0) {
+    // Like a camera that supports RFC 4588, retransmit - in a separate stream - packets that the receiver NACKs:
+    rtpSink->enableRetransmissions(rtpPayloadTypeIfDynamic + 1, retransmissionHistorySize);
+  }
+  return rtpSink;
+}
+
+Groupsock* SyntheticH264ServerMediaSubsession::createGroupsock(struct in_addr const& addr, Port port) {
+  return new ImpairedGroupsock(envir(), addr, port);
+}
+
+////////// A TCP client of a "RtspToTCP" process, which measures the frames that it receives //////////
+
+class LoadConsumer {
+public:
+  LoadConsumer(UsageEnvironment& env, CameraState& camera);
+  virtual ~LoadConsumer();
+
+  void connect();
+  void resetStats();
+
+private:
+  static void connectAgain(void* clientData);
+  static void incomingDataHandler(void* clientData, int mask);
+  void incomingDataHandler1();
+  void disconnect();
+  void parse(unsigned char const* data, unsigned dataSize);
+  void addNALUnitByte(unsigned char byte);
+  void endNALUnit();
+  void parseSEI();
+
+public:
+  CameraState& fCamera;
+  u_int64_t fNumBytesReceived;
+  unsigned fNumFramesReceived; // complete (i.e., with all of their slice)
+  unsigned fNumFramesExpected; // (from the frame numbers in the SEI NAL units that we've seen)
+  unsigned fNumDisconnections;
+  LatencyHistogram fLatency; // from each frame's capture until its last byte arrived (in microseconds)
+
+private:
+  UsageEnvironment& fEnv;
+  int fSocketNum;
+  TaskToken fConnectTask;
+  // Parsing state:
+  unsigned fNumZeroBytes; // pending (in case they're part of a start code)
+  Boolean fInNALUnit;
+  u_int8_t fNALUnitType;
+  unsigned fNALUnitSize;
+  unsigned char fSEI[256];
+  Boolean fHaveLastFrameNum;
+  unsigned fLastFrameNum;
+  Boolean fWaitingForSlice;
+  struct timeval fPictureTime;
+  unsigned fExpectedSliceSize;
+};
+
+LoadConsumer::LoadConsumer(UsageEnvironment& env, CameraState& camera)
+  : fCamera(camera), fNumDisconnections(0), fEnv(env), fSocketNum(-1), fConnectTask(NULL),
+    fNumZeroBytes(0), fInNALUnit(False), fNALUnitType(0), fNALUnitSize(0),
+    fHaveLastFrameNum(False), fLastFrameNum(0), fWaitingForSlice(False), fExpectedSliceSize(0) {
+  resetStats();
+}
+
+LoadConsumer::~LoadConsumer() {
+  fEnv.taskScheduler().unscheduleDelayedTask(fConnectTask);
+  if (fSocketNum >= 0) {
+    fEnv.taskScheduler().turnOffBackgroundReadHandling(fSocketNum);
+    ::closeSocket(fSocketNum);
+  }
+}
+
+void LoadConsumer::resetStats() {
+  fNumBytesReceived = 0;
+  fNumFramesReceived = fNumFramesExpected = 0;
+  fLatency.reset();
+}
+
+void LoadConsumer::connect() {
+  fConnectTask = NULL;
+
+  fSocketNum = setupStreamSocket(fEnv, 0, False);
+  if (fSocketNum >= 0) {
+    struct sockaddr_in serverAddress;
+    memset(&serverAddress, 0, sizeof serverAddress);
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_addr.s_addr = our_inet_addr("127.0.0.1");
+    serverAddress.sin_port = htons(fCamera.tcpServerPortNum);
+    if (::connect(fSocketNum, (struct sockaddr*)&serverAddress, sizeof serverAddress) == 0) {
+      makeSocketNonBlocking(fSocketNum);
+      increaseReceiveBufferTo(fEnv, fSocketNum, 1024*1024);
+      fEnv.taskScheduler().setBackgroundHandling(fSocketNum, SOCKET_READABLE, incomingDataHandler, this);
+      return;
+    }
+    ::closeSocket(fSocketNum);
+    fSocketNum = -1;
+  }
+
+  // The "RtspToTCP" process isn't (yet) ready; try again later:
+  fConnectTask = fEnv.taskScheduler().scheduleDelayedTask(500000, connectAgain, this);
+}
+
+void LoadConsumer::connectAgain(void* clientData) {
+  ((LoadConsumer*)clientData)->connect();
+}
+
+void LoadConsumer::disconnect() {
+  fEnv.taskScheduler().turnOffBackgroundReadHandling(fSocketNum);
+  ::closeSocket(fSocketNum);
+  fSocketNum = -1;
+  ++fNumDisconnections;
+
+  fNumZeroBytes = 0;
+  fInNALUnit = fHaveLastFrameNum = fWaitingForSlice = False;
+  fConnectTask = fEnv.taskScheduler().scheduleDelayedTask(1000000, connectAgain, this);
+}
+
+void LoadConsumer::incomingDataHandler(void* clientData, int /*mask*/) {
+  ((LoadConsumer*)clientData)->incomingDataHandler1();
+}
+
+void LoadConsumer::incomingDataHandler1() {
+  static unsigned char buffer[65536]; // shared by all consumers
+  int bytesRead = recv(fSocketNum, (char*)buffer, sizeof buffer, 0);
+  if (bytesRead <= 0) {
+    if (bytesRead < 0 && (fEnv.getErrno() == EWOULDBLOCK || fEnv.getErrno() == EAGAIN)) return;
+    disconnect();
+    return;
+  }
+
+  fNumBytesReceived += bytesRead;
+  parse(buffer, bytesRead);
+}
+
+void LoadConsumer::parse(unsigned char const* data, unsigned dataSize) {
+  // The stream consists of NAL units, each preceded by a 4-byte start code:
+  for (unsigned i = 0; i < dataSize; ++i) {
+    unsigned char const byte = data[i];
+    if (byte == 0) {
+      ++fNumZeroBytes;
+    } else if (byte == 1 && fNumZeroBytes >= 2) {
+      endNALUnit();
+      fInNALUnit = True;
+      fNALUnitSize = 0;
+      fNumZeroBytes = 0;
+    } else {
+      // Any 0 bytes that we skipped over were part of the NAL unit:
+      for (; fNumZeroBytes > 0; --fNumZeroBytes) addNALUnitByte(0);
+      addNALUnitByte(byte);
+    }
+  }
+}
+
+void LoadConsumer::addNALUnitByte(unsigned char byte) {
+  if (!fInNALUnit) return;
+
+  if (fNALUnitSize == 0) fNALUnitType = byte&0x1F;
+  if (fNALUnitType == 6/*SEI*/ && fNALUnitSize < sizeof fSEI) fSEI[fNALUnitSize] = byte;
+  ++fNALUnitSize;
+
+  if ((fNALUnitType == 1 || fNALUnitType == 5) && fWaitingForSlice && fNALUnitSize == fExpectedSliceSize) {
+    // We've now received all of this frame:
+    fWaitingForSlice = False;
+    if (areMeasuring) {
+      struct timeval timeNow;
+      gettimeofday(&timeNow, NULL);
+      int64_t latency = (int64_t)(timeNow.tv_sec - fPictureTime.tv_sec)*1000000 + (timeNow.tv_usec - fPictureTime.tv_usec);
+      fLatency.record(latency < 0 ? 0 : latency > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned)latency);
+      ++fNumFramesReceived;
+    }
+  }
+}
+
+void LoadConsumer::endNALUnit() {
+  if (fInNALUnit && fNALUnitType == 6/*SEI*/) parseSEI();
+}
+
+void LoadConsumer::parseSEI() {
+  unsigned const seiSize = fNALUnitSize < sizeof fSEI ? fNALUnitSize : sizeof fSEI;
+  if (seiSize < 3 + sizeof seiUUID || fSEI[1] != 5 || memcmp(&fSEI[3], seiUUID, sizeof seiUUID) != 0) return;
+
+  unsigned const textSize = fSEI[2] - sizeof seiUUID;
+  if (3 + sizeof seiUUID + textSize > seiSize) return;
+  char text[256];
+  memmove(text, &fSEI[3 + sizeof seiUUID], textSize);
+  text[textSize] = '\0';
+
+  unsigned cameraIndex, frameNum, sliceSize;
+  unsigned long secs, usecs;
+  if (sscanf(text, SEI_TEXT_FORMAT, &cameraIndex, &frameNum, &secs, &usecs, &sliceSize) != 5) return;
+
+  // Note any frames that we didn't see at all (or whose slice didn't arrive completely):
+  if (areMeasuring) {
+    fNumFramesExpected += fHaveLastFrameNum && frameNum > fLastFrameNum ? frameNum - fLastFrameNum : 1;
+  }
+  fHaveLastFrameNum = True;
+  fLastFrameNum = frameNum;
+
+  fWaitingForSlice = True;
+  fPictureTime.tv_sec = secs;
+  fPictureTime.tv_usec = usecs;
+  fExpectedSliceSize = sliceSize;
+}
+
+////////// Measuring the "RtspToTCP" processes //////////
+
+CameraState::CameraState()
+  : index(0), tcpServerPortNum(0), numFramesSent(0),
+#if !defined(__WIN32__) && !defined(_WIN32)
+    pid(0),
+#endif
+    processHasExited(False), cpuSecondsAtStart(0.0), cpuSecondsUsed(0.0), rssKB(0), peakRSSKB(0) {
+}
+
+#if !defined(__WIN32__) && !defined(_WIN32)
+static double processCPUSeconds(pid_t pid) {
+#ifdef __linux__
+  char fileName[50];
+  sprintf(fileName, "/proc/%d/stat", (int)pid);
+  FILE* fid = fopen(fileName, "r");
+  if (fid == NULL) return 0.0;
+
+  char line[1024];
+  unsigned long utime = 0, stime = 0;
+  if (fgets(line, sizeof line, fid) != NULL) {
+    // The fields that we want are the 14th and 15th; the 2nd (the command name, in parentheses) may contain spaces:
+    char const* afterName = strrchr(line, ')');
+    if (afterName == NULL
+	|| sscanf(afterName + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) {
+      utime = stime = 0;
+    }
+  }
+  fclose(fid);
+  return (double)(utime + stime)/sysconf(_SC_CLK_TCK);
+#else
+  return 0.0;
+#endif
+}
+
+static unsigned processMemoryKB(pid_t pid, char const* fieldName) {
+#ifdef __linux__
+  char fileName[50];
+  sprintf(fileName, "/proc/%d/status", (int)pid);
+  FILE* fid = fopen(fileName, "r");
+  if (fid == NULL) return 0;
+
+  char line[256];
+  unsigned kB = 0;
+  size_t const fieldNameLen = strlen(fieldName);
+  while (fgets(line, sizeof line, fid) != NULL) {
+    if (strncmp(line, fieldName, fieldNameLen) == 0) {
+      sscanf(&line[fieldNameLen], "%u", &kB);
+      break;
+    }
+  }
+  fclose(fid);
+  return kB;
+#else
+  return 0;
+#endif
+}
+
+static double selfCPUSeconds() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec)/1000000.0;
+}
+
+static void checkProcesses() {
+  for (unsigned i = 0; i < numCameras; ++i) {
+    if (!cameras[i].processHasExited && waitpid(cameras[i].pid, NULL, WNOHANG) == cameras[i].pid) {
+      cameras[i].processHasExited = True;
+      *env << "The \"RtspToTCP\" process for camera " << i << " has exited!\n";
+    }
+  }
+}
+
+static void killProcesses() {
+  for (unsigned i = 0; i < numCameras; ++i) {
+    if (cameras[i].pid > 0 && !cameras[i].processHasExited) {
+      kill(cameras[i].pid, SIGTERM);
+      waitpid(cameras[i].pid, NULL, 0);
+      cameras[i].processHasExited = True;
+    }
+  }
+}
+
+static void handleInterrupt(int /*sig*/) {
+  killProcesses();
+  _exit(1);
+}
+
+static Boolean startRtspToTCP(CameraState& camera) {
+  char portStr[10];
+  sprintf(portStr, "%u", camera.tcpServerPortNum);
+  char url[100];
+  sprintf(url, "rtsp://127.0.0.1:%u/camera%u", rtspServerPortNum, camera.index);
+
+  char** argv = new char*[numRtspToTCPExtraArgs + 7];
+  int argc = 0;
+  argv[argc++] = (char*)rtspToTCPPath;
+  argv[argc++] = (char*)"-p"; argv[argc++] = portStr;
+  argv[argc++] = (char*)"-l"; argv[argc++] = (char*)"warning"; // (can be overridden by the extra arguments)
+  for (int i = 0; i < numRtspToTCPExtraArgs; ++i) argv[argc++] = rtspToTCPExtraArgs[i];
+  argv[argc++] = url;
+  argv[argc] = NULL;
+
+  camera.pid = fork();
+  if (camera.pid == 0) {
+    execv(rtspToTCPPath, argv);
+    fprintf(stderr, "Failed to run \"%s\": %s\n", rtspToTCPPath, strerror(errno));
+    _exit(127);
+  }
+  delete[] argv;
+
+  if (camera.pid < 0) {
+    *env << "Failed to start \"" << rtspToTCPPath << "\": " << strerror(errno) << "\n";
+    return False;
+  }
+  return True;
+}
+#endif
+
+////////// The benchmark's phases //////////
+
+static void startMeasuring(void* clientData); // forward
+static void stopMeasuring(void* clientData); // forward
+
+static void connectConsumers(void* /*clientData*/) {
+  *env << "Connecting " << numConsumersPerCamera << " TCP client(s) to each \"RtspToTCP\" process...\n";
+  for (unsigned i = 0; i < numCameras*numConsumersPerCamera; ++i) consumers[i]->connect();
+
+  env->taskScheduler().scheduleDelayedTask(warmupSeconds*1000000, startMeasuring, NULL);
+}
+
+static void startMeasuring(void* /*clientData*/) {
+  *env << "Measuring for " << durationSeconds << " seconds...\n";
+#if !defined(__WIN32__) && !defined(_WIN32)
+  checkProcesses();
+  for (unsigned i = 0; i < numCameras; ++i) {
+    cameras[i].numFramesSent = 0;
+    cameras[i].cpuSecondsAtStart = processCPUSeconds(cameras[i].pid);
+  }
+  selfCPUSecondsAtStart = selfCPUSeconds();
+#endif
+  for (unsigned i = 0; i < numCameras*numConsumersPerCamera; ++i) consumers[i]->resetStats();
+  gettimeofday(&measurementStartTime, NULL);
+  areMeasuring = True;
+
+  env->taskScheduler().scheduleDelayedTask(durationSeconds*1000000, stopMeasuring, NULL);
+}
+
+static void reportLine(char const* name, double framesSentPerSecond, double framesReceivedPerSecond, double lossPercent,
+		       double mbps, LatencyHistogram const& latency, unsigned disconnections,
+		       double cpuPercent, unsigned rssKB, unsigned peakRSSKB) {
+  char line[200];
+  snprintf(line, sizeof line, "%-8s %8.1f %8.1f %6.2f %8.2f %8.1f %8.1f %8.1f %6u %6.1f %8.1f %8.1f\n",
+	   name, framesSentPerSecond, framesReceivedPerSecond, lossPercent, mbps,
+	   latency.valueAtPercentile(50)/1000.0, latency.valueAtPercentile(99)/1000.0, latency.maxValue()/1000.0,
+	   disconnections, cpuPercent, rssKB/1024.0, peakRSSKB/1024.0);
+  *env << line;
+}
+
+static void stopMeasuring(void* /*clientData*/) {
+  areMeasuring = False;
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  double const seconds = (timeNow.tv_sec - measurementStartTime.tv_sec) + (timeNow.tv_usec - measurementStartTime.tv_usec)/1000000.0;
+
+  double selfCPUSecondsUsed = 0.0;
+#if !defined(__WIN32__) && !defined(_WIN32)
+  checkProcesses();
+  for (unsigned i = 0; i < numCameras; ++i) {
+    CameraState& camera = cameras[i];
+    if (camera.processHasExited) continue;
+    camera.cpuSecondsUsed = processCPUSeconds(camera.pid) - camera.cpuSecondsAtStart;
+    camera.rssKB = processMemoryKB(camera.pid, "VmRSS:");
+    camera.peakRSSKB = processMemoryKB(camera.pid, "VmHWM:");
+  }
+  selfCPUSecondsUsed = selfCPUSeconds() - selfCPUSecondsAtStart;
+#endif
+
+  char line[300];
+  snprintf(line, sizeof line, "\n%u camera(s), each %u kbps at %u fps (GOP %u, %.2f%% loss, %.2f%% reordering%s), "
+	   "with %u TCP client(s) each, for %.1f seconds:\n",
+	   numCameras, bitrateKbps, frameRate, gopLength, lossPercent, reorderPercent,
+	   retransmissionHistorySize > 0 ? ", retransmitting NACKed packets" : "", numConsumersPerCamera, seconds);
+  *env << line;
+  snprintf(line, sizeof line, "%-8s %8s %8s %6s %8s %8s %8s %8s %6s %6s %8s %8s\n",
+	   "camera", "sent/s", "recv/s", "loss%", "Mbit/s", "p50 ms", "p99 ms", "max ms", "disc", "CPU%", "RSS MB", "peak MB");
+  *env << line;
+
+  // (The received frame rate, loss, and bit rate are per TCP client; the latency is for all of each camera's TCP clients.)
+  LatencyHistogram totalLatency;
+  u_int64_t totalBytesReceived = 0;
+  unsigned totalFramesSent = 0, totalFramesReceived = 0, totalFramesExpected = 0, totalDisconnections = 0;
+  unsigned totalRSSKB = 0, totalPeakRSSKB = 0;
+  double totalCPUSecondsUsed = 0.0;
+  for (unsigned i = 0; i < numCameras; ++i) {
+    CameraState& camera = cameras[i];
+    LatencyHistogram latency;
+    u_int64_t bytesReceived = 0;
+    unsigned framesReceived = 0, framesExpected = 0, disconnections = 0;
+    for (unsigned j = 0; j < numConsumersPerCamera; ++j) {
+      LoadConsumer& consumer = *consumers[i*numConsumersPerCamera + j];
+      latency.merge(consumer.fLatency);
+      bytesReceived += consumer.fNumBytesReceived;
+      framesReceived += consumer.fNumFramesReceived;
+      framesExpected += consumer.fNumFramesExpected;
+      disconnections += consumer.fNumDisconnections;
+    }
+
+    char name[20];
+    sprintf(name, "%u", i);
+    reportLine(name, camera.numFramesSent/seconds, framesReceived/seconds/numConsumersPerCamera,
+	       framesExpected == 0 ? 0.0 : 100.0*(framesExpected - framesReceived)/framesExpected,
+	       bytesReceived*8/seconds/1000000/numConsumersPerCamera, latency, disconnections,
+	       100.0*camera.cpuSecondsUsed/seconds, camera.rssKB, camera.peakRSSKB);
+
+    totalLatency.merge(latency);
+    totalBytesReceived += bytesReceived;
+    totalFramesSent += camera.numFramesSent;
+    totalFramesReceived += framesReceived;
+    totalFramesExpected += framesExpected;
+    totalDisconnections += disconnections;
+    totalCPUSecondsUsed += camera.cpuSecondsUsed;
+    totalRSSKB += camera.rssKB;
+    totalPeakRSSKB += camera.peakRSSKB;
+  }
+
+  reportLine("total", totalFramesSent/seconds, totalFramesReceived/seconds/numConsumersPerCamera,
+	     totalFramesExpected == 0 ? 0.0 : 100.0*(totalFramesExpected - totalFramesReceived)/totalFramesExpected,
+	     totalBytesReceived*8/seconds/1000000/numConsumersPerCamera, totalLatency, totalDisconnections,
+	     100.0*totalCPUSecondsUsed/seconds, totalRSSKB, totalPeakRSSKB);
+  snprintf(line, sizeof line, "p99.9 latency: %.1f ms; mean latency: %.1f ms; this benchmark process used %.1f%% CPU\n",
+	   totalLatency.valueAtPercentile(99.9)/1000.0, totalLatency.mean()/1000.0, 100.0*selfCPUSecondsUsed/seconds);
+  *env << line;
+
+  // Disconnect our TCP clients first (so that the 'TIME_WAIT' state - which could stop the next run of "RtspToTCP"
+  // from binding to its TCP server port - ends up at our end of the connections):
+  for (unsigned i = 0; i < numCameras*numConsumersPerCamera; ++i) delete consumers[i];
+#if !defined(__WIN32__) && !defined(_WIN32)
+  killProcesses();
+#endif
+  exit(0);
+}
+
+////////// main program //////////
+
+void usage() {
+  *env << "Usage: " << progName
+       << " [-n cameras] [-m tcp-clients-per-camera] [-b kbps] [-f fps] [-g gop-length]"
+       << " [-l loss-percent] [-r reorder-percent] [-x retransmission-history-packets] [-w warmup-seconds] [-d seconds]"
+       << " [-p rtsp-server-port] [-q first-tcp-server-port]"
+       << " <path-of-RtspToTCP> [RtspToTCP-options]\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  while (argc > 1 && argv[1][0] == '-') {
+    char* const opt = argv[1];
+    if (argc < 3 || opt[2] != '\0') usage(); // each option takes one value
+
+    char* const value = argv[2];
+    Boolean ok;
+    switch (opt[1]) {
+      case 'n': { ok = sscanf(value, "%u", &numCameras) == 1 && numCameras > 0; break; }
+      case 'm': { ok = sscanf(value, "%u", &numConsumersPerCamera) == 1 && numConsumersPerCamera > 0; break; }
+      case 'b': { ok = sscanf(value, "%u", &bitrateKbps) == 1 && bitrateKbps > 0; break; }
+      case 'f': { ok = sscanf(value, "%u", &frameRate) == 1 && frameRate > 0 && frameRate <= 1000; break; }
+      case 'g': { ok = sscanf(value, "%u", &gopLength) == 1 && gopLength > 0; break; }
+      case 'l': { ok = sscanf(value, "%lf", &lossPercent) == 1 && lossPercent >= 0.0 && lossPercent < 100.0; break; }
+      case 'r': { ok = sscanf(value, "%lf", &reorderPercent) == 1 && reorderPercent >= 0.0 && reorderPercent < 100.0; break; }
+      case 'x': { ok = sscanf(value, "%u", &retransmissionHistorySize) == 1; break; }
+      case 'w': { ok = sscanf(value, "%u", &warmupSeconds) == 1; break; }
+      case 'd': { ok = sscanf(value, "%u", &durationSeconds) == 1 && durationSeconds > 0; break; }
+      case 'p': { ok = sscanf(value, "%hu", &rtspServerPortNum) == 1 && rtspServerPortNum > 0; break; }
+      case 'q': { ok = sscanf(value, "%hu", &firstTCPServerPortNum) == 1 && firstTCPServerPortNum > 0; break; }
+      default: { ok = False; break; }
+    }
+    if (!ok) usage();
+    argv += 2; argc -= 2;
+  }
+  if (argc < 2) usage();
+  rtspToTCPPath = argv[1];
+  rtspToTCPExtraArgs = &argv[2];
+  numRtspToTCPExtraArgs = argc - 2;
+
+#if defined(__WIN32__) || defined(_WIN32)
+  *env << progName << ": This benchmark runs \"RtspToTCP\" processes using \"fork()\", so it isn't supported on Windows\n";
+  return 1;
+#else
+  signal(SIGINT, handleInterrupt);
+  signal(SIGTERM, handleInterrupt);
+
+  // Our largest NAL units are the key frames' slices:
+  OutPacketBuffer::maxSize = sliceSize(True) + 1000;
+
+  // Serve our simulated cameras:
+  RTSPServer* rtspServer = RTSPServer::createNew(*env, rtspServerPortNum);
+  if (rtspServer == NULL) {
+    *env << "Failed to create RTSP server: " << env->getResultMsg() << "\n";
+    exit(1);
+  }
+
+  cameras = new CameraState[numCameras];
+  consumers = new LoadConsumer*[numCameras*numConsumersPerCamera];
+  for (unsigned i = 0; i < numCameras; ++i) {
+    CameraState& camera = cameras[i];
+    camera.index = i;
+    camera.tcpServerPortNum = firstTCPServerPortNum + i;
+
+    char streamName[30];
+    sprintf(streamName, "camera%u", i);
+    ServerMediaSession* sms = ServerMediaSession::createNew(*env, streamName, streamName,
+							    "Simulated camera, streamed by \"benchRtspToTCP\"");
+    sms->addSubsession(SyntheticH264ServerMediaSubsession::createNew(*env, camera));
+    rtspServer->addServerMediaSession(sms);
+
+    for (unsigned j = 0; j < numConsumersPerCamera; ++j) {
+      consumers[i*numConsumersPerCamera + j] = new LoadConsumer(*env, camera);
+    }
+  }
+
+  // Start a "RtspToTCP" process for each camera:
+  *env << "Starting " << numCameras << " \"" << rtspToTCPPath << "\" process(es)...\n";
+  for (unsigned i = 0; i < numCameras; ++i) {
+    if (!startRtspToTCP(cameras[i])) {
+      killProcesses();
+      exit(1);
+    }
+  }
+
+  env->taskScheduler().scheduleDelayedTask(startupSeconds*1000000, connectConsumers, NULL);
+  env->taskScheduler().doEventLoop(); // does not return
+
+  return 0; // only to prevent compiler warning
+#endif
+}
@@ -0,0 +1,316 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// A benchmark of how a RTSP server's per-request cost depends upon its number of client sessions.  Over a single TCP
+// connection, it creates a number of sessions (each by "SETUP"ing the stream's first track, using RTP/UDP, but without
+// "PLAY"ing it), then sends "GET_PARAMETER" requests - each naming one of these sessions, in turn - as a client would to
+// keep its session alive, and finally "TEARDOWN"s each session.  Requests are pipelined, so the rates that we report are
+// those of the server (and, if it is on the same host, of ourself).
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <netinet/tcp.h> // for TCP_NODELAY
+#endif
+
+UsageEnvironment* env;
+char const* progName;
+
+// Parameters (set by command-line options):
+unsigned numSessions = 10000;
+unsigned numRequests = 100000; // "GET_PARAMETER"s
+unsigned pipelineDepth = 64; // the number of requests that we send before reading their responses
+unsigned serverPid = 0; // if non-zero (Linux only), we also report the CPU time used by this (server) process
+
+#define MAX_SESSION_ID_SIZE 32
+
+static int ourSocket = -1;
+static unsigned nextCSeq = 1;
+static char requestBuffer[100000];
+static unsigned requestBytes = 0;
+static char responseBuffer[100000];
+static unsigned responseBytes = 0; // the number of bytes in "responseBuffer"
+static unsigned responseBytesUsed = 0; // by previous responses
+
+static double secondsSince(struct timeval const& time) {
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  return (timeNow.tv_sec - time.tv_sec) + (timeNow.tv_usec - time.tv_usec)/1000000.0;
+}
+
+static double serverCPUSeconds() {
+  // Returns the user+system CPU time used so far by process "serverPid" (or -1, if this is unknown):
+#if defined(__WIN32__) || defined(_WIN32)
+  return -1.0;
+#else
+  if (serverPid == 0) return -1.0;
+
+  char fileName[100];
+  sprintf(fileName, "/proc/%u/stat", serverPid);
+  FILE* fid = fopen(fileName, "r");
+  if (fid == NULL) return -1.0;
+
+  char line[1000];
+  unsigned long uTime, sTime;
+  Boolean ok = fgets(line, sizeof line, fid) != NULL;
+  fclose(fid);
+  char const* afterCommandName = ok ? strrchr(line, ')') : NULL; // the command name might contain spaces
+  if (afterCommandName == NULL
+      || sscanf(afterCommandName, ") %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &uTime, &sTime) != 2) {
+    return -1.0;
+  }
+  return (uTime + sTime)/(double)sysconf(_SC_CLK_TCK);
+#endif
+}
+
+static void queueRequest(char const* command, char const* url, char const* sessionId, char const* extraHeaders) {
+  if (requestBytes + 1000 + strlen(url) > sizeof requestBuffer) return; // shouldn't happen, with our pipeline depth
+
+  char* const request = &requestBuffer[requestBytes];
+  unsigned const maxSize = sizeof requestBuffer - requestBytes;
+  unsigned requestSize = snprintf(request, maxSize, "%s %s RTSP/1.0\r\nCSeq: %u\r\n", command, url, nextCSeq++);
+  if (sessionId != NULL) requestSize += snprintf(&request[requestSize], maxSize - requestSize, "Session: %s\r\n", sessionId);
+  requestSize += snprintf(&request[requestSize], maxSize - requestSize, "%s\r\n", extraHeaders);
+  requestBytes += requestSize;
+}
+
+static Boolean sendQueuedRequests() {
+  unsigned bytesSent = 0;
+  while (bytesSent < requestBytes) {
+    int result = send(ourSocket, &requestBuffer[bytesSent], requestBytes - bytesSent, 0);
+    if (result <= 0) {
+      *env << progName << ": send() failed: " << env->getResultMsg() << "\n";
+      return False;
+    }
+    bytesSent += result;
+  }
+  requestBytes = 0;
+  return True;
+}
+
+static char const* lookupHeader(char const* headers, char const* headersEnd, char const* headerName) {
+  // Returns a pointer to the value of the header "headerName" (or NULL, if there isn't one):
+  unsigned const nameSize = strlen(headerName);
+  for (char const* line = headers; line < headersEnd; ) {
+    if (strncasecmp(line, headerName, nameSize) == 0 && line[nameSize] == ':') {
+      char const* value = &line[nameSize+1];
+      while (*value == ' ') ++value;
+      return value;
+    }
+    char const* lineEnd = strstr(line, "\r\n");
+    if (lineEnd == NULL) break;
+    line = lineEnd + 2;
+  }
+  return NULL;
+}
+
+static Boolean readResponse(unsigned& statusCode, char* sessionId = NULL, char* body = NULL, unsigned bodyMaxSize = 0,
+			    char* contentBase = NULL) {
+  // Reads the next response, and returns its status code, and (if requested) its "Session:" id, body,
+  // and "Content-Base:" URL:
+  while (1) {
+    char* const response = &responseBuffer[responseBytesUsed];
+    responseBuffer[responseBytes] = '\0';
+    char* const headersEnd = strstr(response, "\r\n\r\n");
+    if (headersEnd != NULL) {
+      char const* value = lookupHeader(response, headersEnd, "Content-Length");
+      unsigned contentLength = 0;
+      if (value != NULL) sscanf(value, "%u", &contentLength);
+      char* const content = headersEnd + 4;
+      if (content + contentLength <= &responseBuffer[responseBytes]) {
+	// We have the complete response:
+	if (sscanf(response, "RTSP/%*u.%*u %u", &statusCode) != 1) statusCode = 0;
+	if (sessionId != NULL) {
+	  sessionId[0] = '\0';
+	  value = lookupHeader(response, headersEnd, "Session");
+	  if (value != NULL) sscanf(value, "%31[^;\r\n ]", sessionId);
+	}
+	if (contentBase != NULL) {
+	  contentBase[0] = '\0';
+	  value = lookupHeader(response, headersEnd, "Content-Base");
+	  if (value != NULL) sscanf(value, "%999[^\r\n ]", contentBase);
+	}
+	if (body != NULL) {
+	  unsigned const bodySize = contentLength < bodyMaxSize ? contentLength : bodyMaxSize-1;
+	  memmove(body, content, bodySize);
+	  body[bodySize] = '\0';
+	}
+	responseBytesUsed = (content + contentLength) - responseBuffer;
+	return True;
+      }
+    }
+
+    // We need more data.  First, move any partial response to the start of our buffer:
+    memmove(responseBuffer, response, responseBytes - responseBytesUsed);
+    responseBytes -= responseBytesUsed;
+    responseBytesUsed = 0;
+    if (responseBytes >= sizeof responseBuffer - 1) {
+      *env << progName << ": Response too large\n";
+      return False;
+    }
+    int result = recv(ourSocket, &responseBuffer[responseBytes], sizeof responseBuffer - 1 - responseBytes, 0);
+    if (result <= 0) {
+      *env << progName << ": The server closed the connection\n";
+      return False;
+    }
+    responseBytes += result;
+#ifdef TCP_QUICKACK
+    // Acknowledge the server's data at once (the server sends each response separately, so if our acknowledgment were delayed,
+    // the server's 'Nagle algorithm' would then delay its next response until the acknowledgment was sent):
+    int const one = 1;
+    setsockopt(ourSocket, IPPROTO_TCP, TCP_QUICKACK, (char const*)&one, sizeof one);
+#endif
+  }
+}
+
+static void reportPhase(char const* description, unsigned numDone, struct timeval const& startTime, double startCPUSeconds) {
+  double const seconds = secondsSince(startTime);
+  char line[200];
+  sprintf(line, "%-15s %8u in %7.3f s: %8.0f/s, %6.2f us each", description, numDone, seconds,
+	  numDone/seconds, seconds*1000000/numDone);
+  *env << line;
+  if (startCPUSeconds >= 0.0) {
+    double const serverCPU = serverCPUSeconds() - startCPUSeconds;
+    sprintf(line, " (server CPU: %6.2f us each)", serverCPU*1000000/numDone);
+    *env << line;
+  }
+  *env << "\n";
+}
+
+static char const* rtspURL;
+static char trackURL[2100];
+static char (*sessionIds)[MAX_SESSION_ID_SIZE];
+
+static void queuePhaseRequest(char const* command, unsigned i) {
+  if (strcmp(command, "SETUP") == 0) {
+    queueRequest(command, trackURL, NULL, "Transport: RTP/AVP;unicast;client_port=50000-50001\r\n");
+  } else { // "GET_PARAMETER" or "TEARDOWN"
+    queueRequest(command, rtspURL, sessionIds[i%numSessions], "");
+  }
+}
+
+static Boolean runPhase(char const* command, unsigned numRequestsToSend) {
+  // Sends "numRequestsToSend" "command" requests, refilling the pipeline whenever half of it has been responded to.
+  // (This way, the server always has requests to handle, and our acknowledgments of its responses aren't delayed.)
+  struct timeval startTime;
+  gettimeofday(&startTime, NULL);
+  double const startCPUSeconds = serverCPUSeconds();
+
+  unsigned numSent = 0;
+  for (unsigned numResponses = 0; numResponses < numRequestsToSend; ++numResponses) {
+    if (numSent - numResponses <= pipelineDepth/2) {
+      while (numSent < numRequestsToSend && numSent - numResponses < pipelineDepth) queuePhaseRequest(command, numSent++);
+      if (!sendQueuedRequests()) return False;
+    }
+
+    unsigned statusCode;
+    char* sessionId = strcmp(command, "SETUP") == 0 ? sessionIds[numResponses] : NULL; // we record new sessions' ids
+    if (!readResponse(statusCode, sessionId)) return False;
+    if (statusCode != 200 || (sessionId != NULL && sessionId[0] == '\0')) {
+      *env << progName << ": \"" << command << "\" failed (status code " << statusCode << ")\n";
+      return False;
+    }
+  }
+
+  if (numRequestsToSend > 0) reportPhase(command, numRequestsToSend, startTime, startCPUSeconds);
+  return True;
+}
+
+void usage() {
+  *env << "Usage: " << progName << " [-n sessions] [-r requests] [-w pipeline-depth] [-p server-pid] <rtsp-url>\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  while (argc > 1 && argv[1][0] == '-') {
+    char* const opt = argv[1];
+    if (argc < 3 || opt[2] != '\0') usage(); // each option takes one value
+
+    char* const value = argv[2];
+    Boolean ok;
+    switch (opt[1]) {
+      case 'n': { ok = sscanf(value, "%u", &numSessions) == 1 && numSessions > 0; break; }
+      case 'r': { ok = sscanf(value, "%u", &numRequests) == 1; break; }
+      case 'w': { ok = sscanf(value, "%u", &pipelineDepth) == 1 && pipelineDepth > 0 && pipelineDepth <= 64; break; }
+      case 'p': { ok = sscanf(value, "%u", &serverPid) == 1; break; }
+      default: { ok = False; break; }
+    }
+    if (!ok) usage();
+    argv += 2; argc -= 2;
+  }
+  if (argc != 2) usage();
+  rtspURL = argv[1];
+
+  char* username; char* password; char const* urlSuffix;
+  NetAddress serverAddress;
+  portNumBits serverPortNum;
+  if (!RTSPClient::parseRTSPURL(*env, rtspURL, username, password, serverAddress, serverPortNum, &urlSuffix)) usage();
+  delete[] username; delete[] password;
+
+  struct sockaddr_in serverSockAddr;
+  memset(&serverSockAddr, 0, sizeof serverSockAddr);
+  serverSockAddr.sin_family = AF_INET;
+  serverSockAddr.sin_addr.s_addr = *(unsigned*)(serverAddress.data());
+  serverSockAddr.sin_port = htons(serverPortNum);
+
+  ourSocket = socket(AF_INET, SOCK_STREAM, 0);
+  if (ourSocket < 0 || connect(ourSocket, (struct sockaddr*)&serverSockAddr, sizeof serverSockAddr) != 0) {
+    *env << progName << ": Failed to connect to " << rtspURL << "\n";
+    return 1;
+  }
+  int const one = 1;
+  setsockopt(ourSocket, IPPROTO_TCP, TCP_NODELAY, (char const*)&one, sizeof one); // send each request batch at once
+
+  // Find the URL of the stream's first track (from the "a=control:" line that follows the first "m=" line in its SDP):
+  unsigned statusCode;
+  static char sdp[20000];
+  char contentBase[1000];
+  queueRequest("DESCRIBE", rtspURL, NULL, "Accept: application/sdp\r\n");
+  if (!sendQueuedRequests() || !readResponse(statusCode, NULL, sdp, sizeof sdp, contentBase)) return 1;
+  char const* mediaLine = strstr(sdp, "\nm=");
+  char const* controlLine = mediaLine == NULL ? NULL : strstr(mediaLine, "\na=control:");
+  if (statusCode != 200 || controlLine == NULL) {
+    *env << progName << ": \"DESCRIBE\" failed (status code " << statusCode << "), or its SDP had no track\n";
+    return 1;
+  }
+  char control[1000];
+  sscanf(controlLine, "\na=control:%999[^\r\n]", control);
+  if (strncmp(control, "rtsp://", 7) == 0) {
+    strcpy(trackURL, control);
+  } else {
+    char const* baseURL = contentBase[0] != '\0' ? contentBase : rtspURL;
+    unsigned const baseURLSize = strlen(baseURL);
+    sprintf(trackURL, "%s%s%s", baseURL, baseURLSize > 0 && baseURL[baseURLSize-1] == '/' ? "" : "/", control);
+  }
+
+  sessionIds = new char[numSessions][MAX_SESSION_ID_SIZE];
+  *env << "Creating " << numSessions << " sessions on " << trackURL << ", then sending " << numRequests
+       << " \"GET_PARAMETER\"s (pipelined up to " << pipelineDepth << " deep)...\n";
+  if (!runPhase("SETUP", numSessions) || !runPhase("GET_PARAMETER", numRequests) || !runPhase("TEARDOWN", numSessions)) {
+    return 1;
+  }
+
+  closeSocket(ourSocket);
+  delete[] sessionIds;
+  return 0;
+}
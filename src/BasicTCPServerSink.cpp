@@ -20,7 +20,13 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // other media content should also work but this wasn't tested
 
 #include "BasicTCPServerSink.h"
+#include "RTPSource.hh"
+#include "FrameTrace.hh"
 #include <GroupsockHelper.hh>
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <linux/sockios.h> // for "SIOCOUTQ"
+#endif
 
 
 BasicTCPServerSink* BasicTCPServerSink::createNew(UsageEnvironment& env, Port ourPort,
@@ -36,6 +42,9 @@ BasicTCPServerSink::BasicTCPServerSink(UsageEnvironment& env,
   : MediaSink(env),
     fServerSocket(ourSocket), fServerPort(ourPort),
     fMaxPayloadSize(maxPayloadSize),
+    fSharedFrameReplicator(NULL),
+    fNumFramesReceived(0), fNumKeyFramesReceived(0), fNumBytesReceived(0), fNumTruncatedBytes(0),
+    fRTCPSyncSource(NULL), fNumFramesFromTheFuture(0), fWaitingForKeyFrame(False), fNumFramesSkipped(0),
     H264(False),
     fServerMediaSessions(HashTable::create(STRING_HASH_KEYS)),
     fClientConnections(HashTable::create(ONE_WORD_HASH_KEYS)),
@@ -49,6 +58,19 @@ BasicTCPServerSink::BasicTCPServerSink(UsageEnvironment& env,
   //fOutputBuffer = new unsigned char[fMaxPayloadSize];
 }
 
+void BasicTCPServerSink::resumeAtKeyFrame() {
+  if (H264) fWaitingForKeyFrame = True; // (Otherwise (JPEG), each frame can be decoded on its own.)
+}
+
+void BasicTCPServerSink::setCPUAccount(CPUAccount* cpuAccount) {
+  // Re-assign the handler for our server socket, with "cpuAccount" current, so that it - and the handlers that it sets
+  // up for each new connection - are charged to it:
+  TaskScheduler& scheduler = envir().taskScheduler();
+  CPUAccount* prevAccount = scheduler.setCurrentCPUAccount(cpuAccount);
+  scheduler.turnOnBackgroundReadHandling(fServerSocket, incomingConnectionHandler, this);
+  scheduler.setCurrentCPUAccount(prevAccount);
+}
+
 BasicTCPServerSink::~BasicTCPServerSink() {
   delete[] fOutputBuffer;
   envir().taskScheduler().turnOffBackgroundReadHandling(fServerSocket);
@@ -90,6 +112,8 @@ void BasicTCPServerSink::cleanup() {
 }
 
 #define LISTEN_BACKLOG_SIZE 20
+unsigned BasicTCPServerSink::listenBacklogSize = LISTEN_BACKLOG_SIZE;
+Boolean BasicTCPServerSink::shareListeningPort = False;
 
 int BasicTCPServerSink::setUpOurSocket(UsageEnvironment& env, Port& ourPort) {
   int ourSocket = -1;
@@ -102,14 +126,14 @@ int BasicTCPServerSink::setUpOurSocket(UsageEnvironment& env, Port& ourPort) {
     NoReuse dummy(env); // Don't use this socket if there's already a local server using it
 #endif
 
-    ourSocket = setupStreamSocket(env, ourPort);
+    ourSocket = setupStreamSocket(env, ourPort, True, shareListeningPort);
     if (ourSocket < 0) break;
 
     // Make sure we have a big send buffer:
     if (!increaseSendBufferTo(env, ourSocket, 50 * 1024)) break;
 
     // Allow multiple simultaneous connections:
-    if (listen(ourSocket, LISTEN_BACKLOG_SIZE) < 0) {
+    if (listen(ourSocket, listenBacklogSize) < 0) {
       env.setResultErrMsg("listen() failed: ");
       break;
     }
@@ -134,34 +158,49 @@ void BasicTCPServerSink::incomingConnectionHandler() {
   incomingConnectionHandlerOnSocket(fServerSocket);
 }
 
+// As in "GenericMediaServer", we accept all of the connections that are waiting (up to a limit) each time:
+#define MAX_CONNECTIONS_ACCEPTED_PER_WAKEUP 100
+
 void BasicTCPServerSink::incomingConnectionHandlerOnSocket(int serverSocket) {
-  struct sockaddr_in clientAddr;
-  SOCKLEN_T clientAddrLen = sizeof clientAddr;
-  int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
-  if (clientSocket < 0) {
-    int err = envir().getErrno();
-    if (err != EWOULDBLOCK) {
-      envir().setResultErrMsg("accept() failed: ");
+  for (unsigned i = 0; i < MAX_CONNECTIONS_ACCEPTED_PER_WAKEUP; ++i) {
+    struct sockaddr_in clientAddr;
+    SOCKLEN_T clientAddrLen = sizeof clientAddr;
+#if defined(__linux__) && defined(SOCK_NONBLOCK)
+    int clientSocket = accept4(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen, SOCK_NONBLOCK|SOCK_CLOEXEC);
+#else
+    int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
+#endif
+    envir().taskScheduler().noteSyscalls();
+    if (clientSocket < 0) {
+      int err = envir().getErrno();
+      if (err != EWOULDBLOCK) {
+	envir().setResultErrMsg("accept() failed: ");
+	ENV_LOG(envir(), LOG_LEVEL_ERROR) << envir().getResultMsg() << "\n";
+      }
+      return;
     }
-    return;
-  }
-  ignoreSigPipeOnSocket(clientSocket); // so that clients on the same host that are killed don't also kill us
-  makeSocketNonBlocking(clientSocket);
-  increaseSendBufferTo(envir(), clientSocket, 50 * 1024);
+    ignoreSigPipeOnSocket(clientSocket); // so that clients on the same host that are killed don't also kill us
+#if !defined(__linux__) || !defined(SOCK_NONBLOCK)
+    makeSocketNonBlocking(clientSocket);
+#endif
+    increaseSendBufferTo(envir(), clientSocket, 50 * 1024);
 
 #ifdef DEBUG
-  envir() << "accept()ed connection from " << AddressString(clientAddr).val() << "\n";
+    envir() << "accept()ed connection from " << AddressString(clientAddr).val() << "\n";
 #endif
-  envir() << "accept()ed connection from " << AddressString(clientAddr).val() << ", clientSocket=" << clientSocket << "\n";
+    envir() << "accept()ed connection from " << AddressString(clientAddr).val() << ", clientSocket=" << clientSocket << "\n";
 
-  // Create a new object for handling this connection:
-  (void)createNewClientConnection(clientSocket, clientAddr);
+    // Create a new object for handling this connection:
+    (void)createNewClientConnection(clientSocket, clientAddr);
+  }
 }
 
 BasicTCPServerSink::ClientConnection
 ::ClientConnection(BasicTCPServerSink& ourServer, int clientSocket, struct sockaddr_in clientAddr)
   : fOurServer(ourServer), fOurSocket(clientSocket), fClientAddr(clientAddr), 
-  fClientOutputSocket(fOurSocket), fClientInputSocket(fOurSocket), fIsActive(True) {
+  fClientOutputSocket(fOurSocket), fClientInputSocket(fOurSocket), fIsActive(True),
+  fNumBytesSent(0), fNumFramesSent(0), fNumFramesDropped(0) {
+  gettimeofday(&fConnectTime, NULL);
   // Add ourself to our 'client connections' table:
   fOurServer.fClientConnections->Add((char const*)this, this);
 
@@ -269,6 +308,70 @@ void BasicTCPServerSink::stopTCPStreamingOnSocket(int socketNum) {
 }
 
 
+void BasicTCPServerSink
+::addMetrics(PrometheusMetrics& metrics, char const* cameraName, char const* subsessionName) const {
+  char* labels = PrometheusMetrics::makeLabels("camera", cameraName, "subsession", subsessionName);
+  metrics.addCounter("rtsptotcp_frames_received_total", "Frames received from the camera", labels,
+		     fNumFramesReceived);
+  metrics.addCounter("rtsptotcp_key_frames_received_total", "Key frames (H.264 IDR NAL units) received from the camera",
+		     labels, fNumKeyFramesReceived);
+  metrics.addCounter("rtsptotcp_frame_bytes_received_total", "Bytes of frame data received from the camera", labels,
+		     (double)fNumBytesReceived);
+  metrics.addCounter("rtsptotcp_truncated_bytes_total", "Bytes of frame data dropped because a frame was too large",
+		     labels, (double)fNumTruncatedBytes);
+  metrics.addGauge("rtsptotcp_tcp_clients", "TCP clients currently connected", labels,
+		   fClientConnections->numEntries());
+  if (fRTCPSyncSource != NULL) {
+    metrics.addSummary("rtsptotcp_frame_receive_latency_seconds",
+		       "Time from each frame's capture (its RTCP-synchronized presentation time) until we received it",
+		       labels, fReceiveLatency);
+    metrics.addSummary("rtsptotcp_glass_to_socket_latency_seconds",
+		       "Time from each frame's capture until a TCP client's socket accepted its last byte (for all clients)",
+		       labels, fLatency);
+    metrics.addCounter("rtsptotcp_frames_from_the_future_total",
+		       "Frames whose capture time was later than our clock (the camera's clock is not synchronized with ours)",
+		       labels, fNumFramesFromTheFuture);
+  }
+  metrics.addCounter("rtsptotcp_frames_skipped_total",
+		     "Frames not sent to TCP clients because they were waiting (after a reconnection) for a key frame",
+		     labels, fNumFramesSkipped);
+  delete[] labels;
+
+  HashTable::Iterator* iter = HashTable::Iterator::create(*fClientConnections);
+  BasicTCPServerSink::ClientConnection* clientConnection;
+  char const* key; // dummy
+  while ((clientConnection = (BasicTCPServerSink::ClientConnection*)(iter->next(key))) != NULL) {
+    char clientName[100];
+    sprintf(clientName, "%s:%u",
+	    AddressString(clientConnection->fClientAddr).val(), ntohs(clientConnection->fClientAddr.sin_port));
+    labels = PrometheusMetrics::makeLabels("camera", cameraName, "subsession", subsessionName, "client", clientName);
+
+    metrics.addCounter("rtsptotcp_tcp_client_bytes_sent_total", "Bytes sent to the TCP client", labels,
+		       (double)clientConnection->fNumBytesSent);
+    metrics.addCounter("rtsptotcp_tcp_client_frames_sent_total", "Frames sent (completely) to the TCP client", labels,
+		       clientConnection->fNumFramesSent);
+    metrics.addCounter("rtsptotcp_tcp_client_frames_dropped_total",
+		       "Frames that the TCP client's socket could not (completely) accept", labels,
+		       clientConnection->fNumFramesDropped);
+    metrics.addGauge("rtsptotcp_tcp_client_connect_time_seconds", "When the TCP client connected (Unix time)", labels,
+		     clientConnection->fConnectTime.tv_sec + clientConnection->fConnectTime.tv_usec/1000000.0);
+    if (fRTCPSyncSource != NULL) {
+      metrics.addSummary("rtsptotcp_tcp_client_glass_to_socket_latency_seconds",
+			 "Time from each frame's capture until the TCP client's socket accepted its last byte", labels,
+			 clientConnection->fLatency);
+    }
+#ifdef SIOCOUTQ
+    int queuedBytes;
+    if (ioctl(clientConnection->fOurSocket, SIOCOUTQ, &queuedBytes) == 0) {
+      metrics.addGauge("rtsptotcp_tcp_client_send_queue_bytes", "Bytes queued (unsent) in the TCP client's socket",
+		       labels, queuedBytes);
+    }
+#endif
+    delete[] labels;
+  }
+  delete iter;
+}
+
 Boolean BasicTCPServerSink::continuePlaying() {
   // Record the fact that we're starting to play now:
   gettimeofday(&fNextSendTime, NULL);
@@ -281,7 +384,11 @@ Boolean BasicTCPServerSink::continuePlaying() {
 
 void BasicTCPServerSink::continuePlaying1() {
   nextTask() = NULL;
-  if (fSource != NULL) {
+  if (fSource == NULL) return;
+
+  if (fSharedFrameReplicator != NULL && fSharedFrameReplicator->usesSharedFrames()) {
+    fSharedFrameReplicator->getNextSharedFrame(fSource, afterGettingSharedFrame, this, onSourceClosure, this);
+  } else {
     fSource->getNextFrame(fOutputBuffer, fMaxPayloadSize,
 			  afterGettingFrame, this,
 			  onSourceClosure, this);
@@ -293,13 +400,27 @@ void BasicTCPServerSink::afterGettingFrame(void* clientData, unsigned frameSize,
 				     struct timeval presentationTime,
 				     unsigned durationInMicroseconds) {
   BasicTCPServerSink* sink = (BasicTCPServerSink*)clientData;
-  sink->afterGettingFrame1(frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
+  sink->afterGettingFrame1(sink->fOutputBuffer, frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
+}
+
+void BasicTCPServerSink::afterGettingSharedFrame(void* clientData, SharedFrame* frame) {
+  BasicTCPServerSink* sink = (BasicTCPServerSink*)clientData;
+  sink->afterGettingFrame1(frame->data(), frame->frameSize(), frame->numTruncatedBytes(),
+			   frame->presentationTime(), frame->durationInMicroseconds());
+  frame->release(); // because our sends (above) are synchronous, we're now done with it
+}
+
+static int64_t uSecondsSince(struct timeval const& time) { // (negative if "time" is in the future)
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  return (timeNow.tv_sec - time.tv_sec)*(int64_t)1000000 + (timeNow.tv_usec - time.tv_usec);
 }
 
-void BasicTCPServerSink::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes, struct timeval presentationTime,
-				      unsigned durationInMicroseconds) {
+void BasicTCPServerSink::afterGettingFrame1(unsigned char const* frameData, unsigned frameSize, unsigned numTruncatedBytes,
+				      struct timeval presentationTime, unsigned durationInMicroseconds) {
+  FRAME_TRACE_SPAN(sinkSpan, "sink", FrameTrace::frameIdFromPresentationTime(presentationTime), "size", frameSize);
   if (numTruncatedBytes > 0) {
-    envir() << "BasicTCPServerSink::afterGettingFrame1(): The input frame data was too large for our spcified maximum payload size ("
+    ENV_LOG(envir(), LOG_LEVEL_WARNING) << "BasicTCPServerSink::afterGettingFrame1(): The input frame data was too large for our spcified maximum payload size ("
 	    << fMaxPayloadSize << ").  "
 	    << numTruncatedBytes << " bytes of trailing data was dropped!\n";
   }
@@ -331,29 +452,76 @@ fclose(f);
 //  delete fClientConnections;
   char fResponseBuffer[256];
   sprintf(fResponseBuffer, "frameSize: %d bytes, dur: %d us\r\n", frameSize, durationInMicroseconds);
-  
+
+  ++fNumFramesReceived;
+  if (!H264 || (frameSize > 0 && (frameData[0]&0x1F) == 5/*IDR*/)) ++fNumKeyFramesReceived;
+  fNumBytesReceived += frameSize;
+  fNumTruncatedBytes += numTruncatedBytes;
+
+  // If the frame's presentation time is its capture time (by the camera's clock), then measure its latency:
+  Boolean measureLatency = False;
+  if (fRTCPSyncSource != NULL && fRTCPSyncSource->hasBeenSynchronizedUsingRTCP()) {
+    int64_t latency = uSecondsSince(presentationTime);
+    if (latency < 0) {
+      ++fNumFramesFromTheFuture;
+    } else {
+      fReceiveLatency.record(latency > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned)latency);
+      measureLatency = True;
+    }
+  }
+
+  if (fWaitingForKeyFrame) {
+    // Our source was replaced; don't send anything more until its next SPS (which precedes an IDR) or IDR NAL unit:
+    u_int8_t const nalUnitType = frameSize > 0 ? (frameData[0]&0x1F) : 0;
+    if (nalUnitType == 7/*SPS*/ || nalUnitType == 5/*IDR*/) {
+      fWaitingForKeyFrame = False;
+    } else {
+      ++fNumFramesSkipped;
+    }
+  }
+
   HashTable::Iterator* iter = HashTable::Iterator::create(*fClientConnections);
   BasicTCPServerSink::ClientConnection* clientConnection;
   char const* key; // dummy
   while ((clientConnection = (BasicTCPServerSink::ClientConnection*)(iter->next(key))) != NULL) {
-    if (clientConnection->fIsActive) {
+    if (clientConnection->fIsActive && !fWaitingForKeyFrame) {
+      FRAME_TRACE_SPAN(writeSpan, "client write", FrameTrace::frameIdFromPresentationTime(presentationTime),
+		       "socket", clientConnection->fClientOutputSocket);
       //send(clientConnection->fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
+      int prefixBytesSent = 0;
       if (H264) {
-        send(clientConnection->fClientOutputSocket, (char const*)nalbytes, 4, 0);
+        prefixBytesSent = send(clientConnection->fClientOutputSocket, (char const*)nalbytes, 4, 0);
+      }
+      int frameBytesSent = send(clientConnection->fClientOutputSocket, (char const*)frameData, frameSize, 0);
+      envir().taskScheduler().noteSyscalls(H264 ? 2 : 1);
+
+      if (prefixBytesSent > 0) clientConnection->fNumBytesSent += prefixBytesSent;
+      if (frameBytesSent > 0) clientConnection->fNumBytesSent += frameBytesSent;
+      if (prefixBytesSent < (H264 ? 4 : 0) || frameBytesSent < (int)frameSize) {
+        ++clientConnection->fNumFramesDropped;
+      } else {
+        ++clientConnection->fNumFramesSent;
+
+        if (measureLatency) {
+          // The socket has accepted the frame's last byte:
+          int64_t latency = uSecondsSince(presentationTime);
+          unsigned const latencyUSecs = latency > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned)latency;
+          clientConnection->fLatency.record(latencyUSecs);
+          fLatency.record(latencyUSecs);
+        }
       }
-      send(clientConnection->fClientOutputSocket, (char const*)fOutputBuffer, frameSize, 0);
     }
   }
   delete iter;
 
-//#ifdef DEBUG
-  envir() << "Received " << frameSize << " bytes";
-  if (numTruncatedBytes > 0) envir() << " (with " << numTruncatedBytes << " bytes truncated)";
-  char uSecsStr[6 + 1]; // used to output the 'microseconds' part of the presentation time
-  sprintf(uSecsStr, "%06u", (unsigned)presentationTime.tv_usec);
-  envir() << ".\tPresentation time: " << (int)presentationTime.tv_sec << "." << uSecsStr;
-  envir() << "\n";
-//#endif
+  if (ENV_DEBUG_LOG_ENABLED(envir(), LOG_CATEGORY_FRAMES)) {
+    envir() << "Received " << frameSize << " bytes";
+    if (numTruncatedBytes > 0) envir() << " (with " << numTruncatedBytes << " bytes truncated)";
+    char uSecsStr[6 + 1]; // used to output the 'microseconds' part of the presentation time
+    sprintf(uSecsStr, "%06u", (unsigned)presentationTime.tv_usec);
+    envir() << ".\tPresentation time: " << (int)presentationTime.tv_sec << "." << uSecsStr;
+    envir() << "\n";
+  }
 
 
   // Figure out the time at which the next packet should be sent, based
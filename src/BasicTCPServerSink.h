@@ -29,6 +29,15 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _GROUPSOCK_HH
 #include <Groupsock.hh>
 #endif
+#ifndef _STREAM_REPLICATOR_HH
+#include "StreamReplicator.hh"
+#endif
+#ifndef _PROMETHEUS_METRICS_HH
+#include "PrometheusMetrics.h"
+#endif
+#ifndef _LATENCY_HISTOGRAM_HH
+#include "LatencyHistogram.hh"
+#endif
 
 #ifndef REQUEST_BUFFER_SIZE
 #define REQUEST_BUFFER_SIZE 20000 // for incoming requests
@@ -37,12 +46,45 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #define RESPONSE_BUFFER_SIZE 20000
 #endif 
 
+#ifndef LOG_CATEGORY_FRAMES
+#define LOG_CATEGORY_FRAMES 0x0001 // an "ENV_DEBUG_LOG()" category: a line for each frame that we receive
+#endif
+
+class RTPSource; // forward
+
 class BasicTCPServerSink: public MediaSink {
 public:
   static BasicTCPServerSink* createNew(UsageEnvironment& env, Port ourPort = 9001,
 				  unsigned maxPayloadSize = 1450);
   Boolean H264;
 
+  void setSharedFrameReplicator(StreamReplicator* replicator) { fSharedFrameReplicator = replicator; }
+      // Call this (before "startPlaying()") if our source is a replica created by "replicator", and
+      // "replicator->usesSharedFrames()".  We then send each frame directly from the shared frame, without copying it.
+
+  void setRTCPSyncSource(RTPSource* rtpSource) { fRTCPSyncSource = rtpSource; }
+      // Call this to measure the latency of each frame (from when the camera captured it, until we received it, and until
+      // each TCP client's socket accepted its last byte).  "rtpSource" is the source of our frames, which we use only to
+      // check whether their presentation times have been synchronized using RTCP (i.e., are the camera's capture times).
+      // (Until then, we don't measure latency.)  Note that this assumes that the camera's clock is synchronized with ours.
+
+  void resumeAtKeyFrame();
+      // Call this (for H.264) when our source is replaced by a new one (e.g., after reconnecting to the camera): our TCP
+      // clients - which stay connected - are then sent nothing more until the next SPS or IDR NAL unit, so that
+      // their decoders can resume cleanly.
+
+  void setCPUAccount(CPUAccount* cpuAccount);
+      // Charges the handling of our TCP clients' connections and requests to "cpuAccount" (see "CPUAccount.hh").
+      // (The sending of frames is charged to whatever handler delivers them to us - normally, our source's.)
+
+  void addMetrics(PrometheusMetrics& metrics, char const* cameraName, char const* subsessionName) const;
+      // Adds our own (frame) statistics, and those of each of our TCP clients.
+
+  static unsigned listenBacklogSize; // the "listen()" backlog of the sinks that are created after this is set (default: 20)
+  static Boolean shareListeningPort;
+      // If True when a sink is created, then its listening socket can be shared (using SO_REUSEPORT, where supported) with
+      // sinks in other processes, with the OS distributing new TCP clients among them.  (default: False)
+
 protected:
   BasicTCPServerSink::BasicTCPServerSink(UsageEnvironment& env,
     int ourSocket, Port ourPort, unsigned maxPayloadSize);
@@ -86,6 +128,10 @@ public: // should be protected, but some old compilers complain otherwise
     Boolean fIsActive;
 
     struct sockaddr_in fClientAddr;
+    struct timeval fConnectTime;
+    u_int64_t fNumBytesSent;
+    unsigned fNumFramesSent, fNumFramesDropped; // a frame is 'dropped' if the socket couldn't take all of it
+    LatencyHistogram fLatency; // from each frame's capture until our socket accepted its last byte (in microseconds)
     unsigned char fRequestBuffer[REQUEST_BUFFER_SIZE];
     unsigned char fResponseBuffer[RESPONSE_BUFFER_SIZE];
     unsigned fRequestBytesAlreadySeen, fRequestBufferBytesLeft;
@@ -104,8 +150,9 @@ private:
 				unsigned numTruncatedBytes,
 				struct timeval presentationTime,
 				unsigned durationInMicroseconds);
-  void afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes, struct timeval presentationTime,
-			  unsigned durationInMicroseconds);
+  void afterGettingFrame1(unsigned char const* frameData, unsigned frameSize, unsigned numTruncatedBytes,
+			  struct timeval presentationTime, unsigned durationInMicroseconds);
+  static void afterGettingSharedFrame(void* clientData, SharedFrame* frame);
 
   static void sendNext(void* firstArg);
 
@@ -115,8 +162,19 @@ private:
   Groupsock* fGS;
   unsigned fMaxPayloadSize;
   unsigned char* fOutputBuffer;
+  StreamReplicator* fSharedFrameReplicator;
   struct timeval fNextSendTime;
 
+  // Statistics:
+  unsigned fNumFramesReceived, fNumKeyFramesReceived;
+  u_int64_t fNumBytesReceived, fNumTruncatedBytes;
+  RTPSource* fRTCPSyncSource;
+  LatencyHistogram fReceiveLatency; // from each frame's capture until we received it (in microseconds)
+  LatencyHistogram fLatency; // from each frame's capture until any client's socket accepted its last byte
+  unsigned fNumFramesFromTheFuture; // frames whose capture time was later than our clock (so we couldn't measure latency)
+  Boolean fWaitingForKeyFrame; // set by "resumeAtKeyFrame()"
+  unsigned fNumFramesSkipped; // frames not sent to clients, because we were waiting for a key frame
+
 private:
   HashTable* fServerMediaSessions; // maps 'stream name' strings to "ServerMediaSession" objects
   HashTable* fClientConnections; // the "ClientConnection" objects that we're using
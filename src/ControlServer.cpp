@@ -0,0 +1,256 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// A minimal HTTP control server, run from the event loop
+// Implementation
+
+#include "ControlServer.h"
+#include <GroupsockHelper.hh>
+#include <string.h>
+
+class HandlerRecord {
+public:
+  HandlerRecord(ControlServer::RequestHandlerFunc* handlerFunc, void* clientData, char const* contentType)
+    : fHandlerFunc(handlerFunc), fClientData(clientData), fContentType(strDup(contentType)) {
+  }
+  virtual ~HandlerRecord() {
+    delete[] fContentType;
+  }
+
+  ControlServer::RequestHandlerFunc* fHandlerFunc;
+  void* fClientData;
+  char* fContentType;
+};
+
+ControlServer* ControlServer::createNew(UsageEnvironment& env, Port ourPort) {
+  int ourSocket = setUpOurSocket(env, ourPort);
+  if (ourSocket == -1) return NULL;
+  return new ControlServer(env, ourSocket, ourPort);
+}
+
+ControlServer::ControlServer(UsageEnvironment& env, int ourSocket, Port ourPort)
+  : Medium(env),
+    fServerSocket(ourSocket), fServerPort(ourPort),
+    fHandlers(HashTable::create(STRING_HASH_KEYS)),
+    fClientConnections(HashTable::create(ONE_WORD_HASH_KEYS)) {
+  ignoreSigPipeOnSocket(fServerSocket); // so that clients on the same host that are killed don't also kill us
+
+  // Arrange to handle connections from others:
+  env.taskScheduler().turnOnBackgroundReadHandling(fServerSocket, incomingConnectionHandler, this);
+}
+
+ControlServer::~ControlServer() {
+  // Close all client connection objects:
+  ControlServer::ClientConnection* connection;
+  while ((connection = (ControlServer::ClientConnection*)fClientConnections->getFirst()) != NULL) {
+    delete connection;
+  }
+  delete fClientConnections;
+
+  HandlerRecord* record;
+  while ((record = (HandlerRecord*)fHandlers->RemoveNext()) != NULL) {
+    delete record;
+  }
+  delete fHandlers;
+
+  envir().taskScheduler().turnOffBackgroundReadHandling(fServerSocket);
+  ::closeSocket(fServerSocket);
+}
+
+void ControlServer::addHandler(char const* path, RequestHandlerFunc* handlerFunc, void* clientData,
+			       char const* contentType) {
+  HandlerRecord* oldRecord
+    = (HandlerRecord*)fHandlers->Add(path, new HandlerRecord(handlerFunc, clientData, contentType));
+  delete oldRecord;
+}
+
+void ControlServer::removeHandler(char const* path) {
+  HandlerRecord* record = (HandlerRecord*)fHandlers->Lookup(path);
+  if (record == NULL) return;
+
+  fHandlers->Remove(path);
+  delete record;
+}
+
+#define LISTEN_BACKLOG_SIZE 20
+
+int ControlServer::setUpOurSocket(UsageEnvironment& env, Port& ourPort) {
+  int ourSocket = -1;
+
+  do {
+#if !defined(ALLOW_SERVER_PORT_REUSE) && !defined(ALLOW_RTSP_SERVER_PORT_REUSE)
+    NoReuse dummy(env); // Don't use this socket if there's already a local server using it
+#endif
+
+    ourSocket = setupStreamSocket(env, ourPort);
+    if (ourSocket < 0) break;
+
+    if (listen(ourSocket, LISTEN_BACKLOG_SIZE) < 0) {
+      env.setResultErrMsg("listen() failed: ");
+      break;
+    }
+
+    if (ourPort.num() == 0) {
+      // bind() will have chosen a port for us; return it also:
+      if (!getSourcePort(env, ourSocket, ourPort)) break;
+    }
+
+    return ourSocket;
+  } while (0);
+
+  if (ourSocket != -1) ::closeSocket(ourSocket);
+  return -1;
+}
+
+void ControlServer::incomingConnectionHandler(void* instance, int /*mask*/) {
+  ControlServer* server = (ControlServer*)instance;
+  server->incomingConnectionHandler();
+}
+
+void ControlServer::incomingConnectionHandler() {
+  struct sockaddr_in clientAddr;
+  SOCKLEN_T clientAddrLen = sizeof clientAddr;
+  int clientSocket = accept(fServerSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
+  if (clientSocket < 0) {
+    int err = envir().getErrno();
+    if (err != EWOULDBLOCK) {
+      envir().setResultErrMsg("accept() failed: ");
+    }
+    return;
+  }
+  ignoreSigPipeOnSocket(clientSocket); // so that clients on the same host that are killed don't also kill us
+  makeSocketNonBlocking(clientSocket);
+
+  // Create a new object for handling this connection:
+  (void)new ClientConnection(*this, clientSocket, clientAddr);
+}
+
+ControlServer::ClientConnection
+::ClientConnection(ControlServer& ourServer, int clientSocket, struct sockaddr_in clientAddr)
+  : fOurServer(ourServer), fOurSocket(clientSocket), fClientAddr(clientAddr),
+    fRequestBytesAlreadySeen(0), fResponse(NULL), fResponseSize(0), fResponseBytesSent(0) {
+  // Add ourself to our 'client connections' table:
+  fOurServer.fClientConnections->Add((char const*)this, this);
+
+  // Arrange to handle incoming requests:
+  envir().taskScheduler()
+    .setBackgroundHandling(fOurSocket, SOCKET_READABLE | SOCKET_EXCEPTION, incomingRequestHandler, this);
+}
+
+ControlServer::ClientConnection::~ClientConnection() {
+  // Remove ourself from the server's 'client connections' hash table before we go:
+  fOurServer.fClientConnections->Remove((char const*)this);
+
+  envir().taskScheduler().disableBackgroundHandling(fOurSocket);
+  ::closeSocket(fOurSocket);
+  delete[] fResponse;
+}
+
+void ControlServer::ClientConnection::incomingRequestHandler(void* instance, int /*mask*/) {
+  ClientConnection* connection = (ClientConnection*)instance;
+  connection->incomingRequestHandler();
+}
+
+void ControlServer::ClientConnection::incomingRequestHandler() {
+  struct sockaddr_in dummy; // 'from' address, meaningless in this case
+  unsigned bufferBytesLeft = sizeof fRequestBuffer - 1 - fRequestBytesAlreadySeen; // leave room for a trailing '\0'
+
+  int bytesRead = readSocket(envir(), fOurSocket, (unsigned char*)&fRequestBuffer[fRequestBytesAlreadySeen],
+			     bufferBytesLeft, dummy);
+  if (bytesRead <= 0 || (unsigned)bytesRead >= bufferBytesLeft) {
+    // Either the client socket has died, or the request was too big for us:
+    delete this;
+    return;
+  }
+  fRequestBytesAlreadySeen += bytesRead;
+  fRequestBuffer[fRequestBytesAlreadySeen] = '\0';
+
+  // We handle the request once we've seen all of its headers:
+  if (strstr(fRequestBuffer, "\r\n\r\n") == NULL && strstr(fRequestBuffer, "\n\n") == NULL) return;
+
+  envir().taskScheduler().disableBackgroundHandling(fOurSocket);
+  handleRequest();
+}
+
+void ControlServer::ClientConnection::handleRequest() {
+  // Parse the request line: "GET <path>[?<query>] HTTP/1.x"
+  char* path = fRequestBuffer;
+  if (strncmp(path, "GET ", 4) != 0) {
+    sendResponse("405 Method Not Allowed", "text/plain", "Only \"GET\" is supported\n");
+    return;
+  }
+  path += 4;
+  while (*path == ' ') ++path;
+
+  char* end = path;
+  while (*end != '\0' && *end != ' ' && *end != '\r' && *end != '\n') ++end;
+  *end = '\0';
+
+  char const* queryString = "";
+  char* question = strchr(path, '?');
+  if (question != NULL) {
+    *question = '\0';
+    queryString = question + 1;
+  }
+
+  HandlerRecord* record = (HandlerRecord*)(fOurServer.fHandlers->Lookup(path));
+  char* body = record == NULL ? NULL : (*record->fHandlerFunc)(record->fClientData, queryString);
+  if (body == NULL) {
+    sendResponse("404 Not Found", "text/plain", "Not found\n");
+  } else {
+    sendResponse("200 OK", record->fContentType, body);
+    delete[] body;
+  }
+}
+
+void ControlServer::ClientConnection
+::sendResponse(char const* status, char const* contentType, char const* body) {
+  unsigned bodySize = strlen(body);
+  char header[300];
+  sprintf(header, "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+	  status, contentType, bodySize);
+  unsigned headerSize = strlen(header);
+
+  fResponseSize = headerSize + bodySize;
+  fResponse = new char[fResponseSize];
+  memcpy(fResponse, header, headerSize);
+  memcpy(&fResponse[headerSize], body, bodySize);
+  fResponseBytesSent = 0;
+
+  writableHandler();
+}
+
+void ControlServer::ClientConnection::writableHandler(void* instance, int /*mask*/) {
+  ClientConnection* connection = (ClientConnection*)instance;
+  connection->writableHandler();
+}
+
+void ControlServer::ClientConnection::writableHandler() {
+  while (fResponseBytesSent < fResponseSize) {
+    int bytesSent = send(fOurSocket, &fResponse[fResponseBytesSent], fResponseSize - fResponseBytesSent, 0);
+    if (bytesSent < 0) {
+      if (envir().getErrno() == EWOULDBLOCK) {
+	// Try again once the socket becomes writable:
+	envir().taskScheduler().setBackgroundHandling(fOurSocket, SOCKET_WRITABLE, writableHandler, this);
+	return;
+      }
+      break; // the client has gone away
+    }
+    fResponseBytesSent += bytesSent;
+  }
+
+  // We've sent the whole response (or can't), so we're done with this connection:
+  delete this;
+}
@@ -0,0 +1,95 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// A minimal HTTP control server, run from the event loop
+// C++ header
+// each "GET /<path>?<query>" request is dispatched to the handler that was registered for "<path>"
+
+#ifndef _CONTROL_SERVER_HH
+#define _CONTROL_SERVER_HH
+
+#ifndef _MEDIA_HH
+#include "Media.hh"
+#endif
+#ifndef _NET_ADDRESS_HH
+#include <NetAddress.hh>
+#endif
+
+#ifndef CONTROL_REQUEST_BUFFER_SIZE
+#define CONTROL_REQUEST_BUFFER_SIZE 4096
+#endif
+
+class ControlServer: public Medium {
+public:
+  static ControlServer* createNew(UsageEnvironment& env, Port ourPort);
+
+  typedef char* (RequestHandlerFunc)(void* clientData, char const* queryString);
+      // Returns the (heap-allocated, "\0"-terminated) body of the response, which we will delete[].
+      // "queryString" is the part of the URL after "?" ("" if none).  Returning NULL means "404 Not Found".
+  void addHandler(char const* path, RequestHandlerFunc* handlerFunc, void* clientData,
+		  char const* contentType = "text/plain");
+  void removeHandler(char const* path);
+
+  Port serverPort() const { return fServerPort; }
+
+protected:
+  ControlServer(UsageEnvironment& env, int ourSocket, Port ourPort);
+      // called only by createNew()
+  virtual ~ControlServer();
+
+  static int setUpOurSocket(UsageEnvironment& env, Port& ourPort);
+
+  static void incomingConnectionHandler(void*, int /*mask*/);
+  void incomingConnectionHandler();
+
+public: // should be protected, but some old compilers complain otherwise
+  // The state of a TCP connection used by a client:
+  class ClientConnection {
+  public:
+    ClientConnection(ControlServer& ourServer, int clientSocket, struct sockaddr_in clientAddr);
+    virtual ~ClientConnection();
+
+  protected:
+    UsageEnvironment& envir() { return fOurServer.envir(); }
+
+    static void incomingRequestHandler(void*, int /*mask*/);
+    void incomingRequestHandler();
+    void handleRequest();
+    void sendResponse(char const* status, char const* contentType, char const* body);
+    static void writableHandler(void*, int /*mask*/);
+    void writableHandler();
+
+  protected:
+    friend class ControlServer;
+    ControlServer& fOurServer;
+    int fOurSocket;
+    struct sockaddr_in fClientAddr;
+    char fRequestBuffer[CONTROL_REQUEST_BUFFER_SIZE];
+    unsigned fRequestBytesAlreadySeen;
+    char* fResponse; // the (heap-allocated) response that we're still sending
+    unsigned fResponseSize, fResponseBytesSent;
+  };
+
+private:
+  friend class ClientConnection;
+  int fServerSocket;
+  Port fServerPort;
+  HashTable* fHandlers; // maps 'path' strings to "HandlerRecord"s
+  HashTable* fClientConnections; // the "ClientConnection" objects that we're using
+};
+
+#endif
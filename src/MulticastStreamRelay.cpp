@@ -0,0 +1,123 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// A relay that re-publishes an already-received (H.264 or H.265) RTSP subsession - once - as multicast RTP and RTCP,
+// using a replica of its (depacketized) source
+// Implementation
+
+#include "MulticastStreamRelay.h"
+#include "H264VideoRTPSink.hh"
+#include "H265VideoRTPSink.hh"
+#include "H264VideoStreamDiscreteFramer.hh"
+#include "H265VideoStreamDiscreteFramer.hh"
+#include <GroupsockHelper.hh>
+#include <string.h>
+
+#define RTP_PAYLOAD_FORMAT 96 // dynamic
+
+MulticastStreamRelay* MulticastStreamRelay
+::createNew(UsageEnvironment& env, StreamReplicator& replicator, MediaSubsession const& inputSubsession,
+	    struct in_addr const& groupAddress, portNumBits rtpPortNum, u_int8_t ttl,
+	    unsigned maxPacingRateKbps) {
+  Boolean isH264;
+  if (strcmp(inputSubsession.codecName(), "H264") == 0) {
+    isH264 = True;
+  } else if (strcmp(inputSubsession.codecName(), "H265") == 0) {
+    isH264 = False;
+  } else {
+    env.setResultMsg("Re-serving \"", inputSubsession.codecName(), "\" streams is not supported");
+    return NULL;
+  }
+  if (!IsMulticastAddress(groupAddress.s_addr)) {
+    env.setResultMsg("Not a multicast address");
+    return NULL;
+  }
+  Boolean const isSSM = (ntohl(groupAddress.s_addr)>>24) == 232;
+
+  Groupsock* rtpGroupsock = new Groupsock(env, groupAddress, Port(rtpPortNum), ttl);
+  Groupsock* rtcpGroupsock = new Groupsock(env, groupAddress, Port(rtpPortNum+1), ttl);
+  if (rtpGroupsock->socketNum() < 0 || rtcpGroupsock->socketNum() < 0) {
+    delete rtpGroupsock; delete rtcpGroupsock;
+    return NULL;
+  }
+  if (maxPacingRateKbps > 0 && !rtpGroupsock->setMaxPacingRate(maxPacingRateKbps*(1000/8))) {
+    delete rtpGroupsock; delete rtcpGroupsock;
+    return NULL;
+  }
+  // We only send to the group (and don't want to receive our own packets back):
+  rtpGroupsock->multicastSendOnly();
+  rtcpGroupsock->multicastSendOnly();
+
+  // The replica delivers discrete NAL units (as depacketized from the camera's RTP stream):
+  FramedSource* replica = replicator.createStreamReplica();
+  FramedSource* framer;
+  MultiFramedRTPSink* rtpSink;
+  if (isH264) {
+    framer = H264VideoStreamDiscreteFramer::createNew(env, replica);
+    char const* sPropParameterSets = inputSubsession.fmtp_spropparametersets();
+    rtpSink = sPropParameterSets != NULL && sPropParameterSets[0] != '\0'
+      ? H264VideoRTPSink::createNew(env, rtpGroupsock, RTP_PAYLOAD_FORMAT, sPropParameterSets)
+      : H264VideoRTPSink::createNew(env, rtpGroupsock, RTP_PAYLOAD_FORMAT);
+  } else {
+    framer = H265VideoStreamDiscreteFramer::createNew(env, replica);
+    char const* sPropVPS = inputSubsession.fmtp_spropvps();
+    char const* sPropSPS = inputSubsession.fmtp_spropsps();
+    char const* sPropPPS = inputSubsession.fmtp_sproppps();
+    rtpSink = sPropVPS != NULL && sPropSPS != NULL && sPropPPS != NULL
+      ? H265VideoRTPSink::createNew(env, rtpGroupsock, RTP_PAYLOAD_FORMAT, sPropVPS, sPropSPS, sPropPPS)
+      : H265VideoRTPSink::createNew(env, rtpGroupsock, RTP_PAYLOAD_FORMAT);
+  }
+  // (If the parameter sets weren't in the camera's SDP description, then the sink will get them - for our own SDP
+  //  description - from the stream itself.)
+  rtpSink->setBatchedOutput(); // send each frame's packets together
+
+  unsigned const estimatedBitrate = inputSubsession.bandwidth() > 0 ? inputSubsession.bandwidth() : 2000; // kbps
+  return new MulticastStreamRelay(env, rtpGroupsock, rtcpGroupsock, isSSM, framer, rtpSink, estimatedBitrate);
+}
+
+MulticastStreamRelay
+::MulticastStreamRelay(UsageEnvironment& env, Groupsock* rtpGroupsock, Groupsock* rtcpGroupsock, Boolean isSSM,
+		       FramedSource* framer, RTPSink* rtpSink, unsigned estimatedBitrate)
+  : Medium(env),
+    fRTPGroupsock(rtpGroupsock), fRTCPGroupsock(rtcpGroupsock), fIsSSM(isSSM),
+    fFramer(framer), fRTPSink(rtpSink) {
+  unsigned char CNAME[100+1];
+  gethostname((char*)CNAME, sizeof CNAME - 1);
+  CNAME[sizeof CNAME - 1] = '\0'; // just in case
+  fRTCPInstance = RTCPInstance::createNew(env, fRTCPGroupsock, estimatedBitrate, CNAME,
+					  fRTPSink, NULL/*we're a server*/, fIsSSM);
+      // Note: This starts RTCP running automatically
+
+  fRTPSink->startPlaying(*fFramer, NULL, NULL);
+}
+
+MulticastStreamRelay::~MulticastStreamRelay() {
+  fRTPSink->stopPlaying();
+  Medium::close(fRTCPInstance); // (which also sends a RTCP "BYE")
+  Medium::close(fRTPSink);
+  Medium::close(fFramer); // (which also closes our replica)
+  delete fRTCPGroupsock;
+  delete fRTPGroupsock;
+}
+
+ServerMediaSubsession* MulticastStreamRelay::createServerMediaSubsession() {
+  return PassiveServerMediaSubsession::createNew(*fRTPSink, fRTCPInstance);
+}
+
+void MulticastStreamRelay::restartIfStopped() {
+  if (fRTPSink->source() == NULL) fRTPSink->startPlaying(*fFramer, NULL, NULL);
+}
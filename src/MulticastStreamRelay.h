@@ -0,0 +1,80 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// A relay that re-publishes an already-received (H.264 or H.265) RTSP subsession - once - as multicast RTP and RTCP,
+// using a replica of its (depacketized) source
+// C++ header
+// each packet is sent once (to the multicast group), however many clients receive it
+
+#ifndef _MULTICAST_STREAM_RELAY_HH
+#define _MULTICAST_STREAM_RELAY_HH
+
+#ifndef _PASSIVE_SERVER_MEDIA_SUBSESSION_HH
+#include "PassiveServerMediaSubsession.hh"
+#endif
+#ifndef _STREAM_REPLICATOR_HH
+#include "StreamReplicator.hh"
+#endif
+#ifndef _MEDIA_SESSION_HH
+#include "MediaSession.hh"
+#endif
+#ifndef _GROUPSOCK_HH
+#include <Groupsock.hh>
+#endif
+
+class MulticastStreamRelay: public Medium {
+public:
+  static MulticastStreamRelay* createNew(UsageEnvironment& env, StreamReplicator& replicator,
+					 MediaSubsession const& inputSubsession,
+					 struct in_addr const& groupAddress, portNumBits rtpPortNum, u_int8_t ttl,
+					 unsigned maxPacingRateKbps = 0);
+      // "replicator" must replicate "inputSubsession.readSource()".  The stream is sent to "groupAddress" - port
+      // "rtpPortNum" (RTP) and "rtpPortNum"+1 (RTCP) - with time-to-live "ttl".  If "groupAddress" is a source-specific
+      // multicast address (232.0.0.0/8), then we're a SSM source; otherwise, receivers use any-source multicast.
+      // If "maxPacingRateKbps" is non-zero, then the OS spaces out our RTP packets so that bursts (e.g., key frames)
+      // leave no faster than this (see "Groupsock::setMaxPacingRate()").
+      // Returns NULL if "groupAddress" isn't a multicast address, or if we can't re-serve "inputSubsession"s codec.
+
+  Boolean isSSM() const { return fIsSSM; }
+
+  ServerMediaSubsession* createServerMediaSubsession();
+      // Returns a new "ServerMediaSubsession" that describes our stream to (and 'sets up') RTSP clients.  Add it to a
+      // "ServerMediaSession" that was created with "isSSM()"; that "ServerMediaSession" must be deleted before we are.
+
+  void restartIfStopped();
+      // Call this after the replicator's input source has been replaced (e.g., after reconnecting to the camera), in case
+      // the old source had closed (which would have stopped our sending).
+
+  double numPacketsSent() const { return fRTPGroupsock->statsGroupOutgoing.totNumPackets(); }
+  double numBytesSent() const { return fRTPGroupsock->statsGroupOutgoing.totNumBytes(); } // (including RTP headers)
+
+protected:
+  MulticastStreamRelay(UsageEnvironment& env, Groupsock* rtpGroupsock, Groupsock* rtcpGroupsock, Boolean isSSM,
+		       FramedSource* framer, RTPSink* rtpSink, unsigned estimatedBitrate);
+      // called only by createNew()
+  virtual ~MulticastStreamRelay();
+
+private:
+  Groupsock* fRTPGroupsock;
+  Groupsock* fRTCPGroupsock;
+  Boolean fIsSSM;
+  FramedSource* fFramer; // reads from our replica
+  RTPSink* fRTPSink;
+  RTCPInstance* fRTCPInstance;
+};
+
+#endif
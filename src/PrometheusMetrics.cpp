@@ -0,0 +1,172 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Collects metrics, and formats them in the Prometheus text exposition format
+// Implementation
+
+#include "PrometheusMetrics.h"
+#include <stdio.h>
+#include <string.h>
+
+// A growable string buffer:
+class MetricsText {
+public:
+  MetricsText() : fText(NULL), fSize(0), fMaxSize(0) {}
+  virtual ~MetricsText() { delete[] fText; }
+
+  void append(char const* str) { append(str, strlen(str)); }
+  void append(char const* str, unsigned strSize) {
+    if (fSize + strSize + 1 > fMaxSize) {
+      unsigned newMaxSize = 2*(fSize + strSize + 1);
+      if (newMaxSize < 1000) newMaxSize = 1000;
+      char* newText = new char[newMaxSize];
+      if (fText != NULL) memcpy(newText, fText, fSize);
+      delete[] fText;
+      fText = newText;
+      fMaxSize = newMaxSize;
+    }
+    memcpy(&fText[fSize], str, strSize);
+    fSize += strSize;
+    fText[fSize] = '\0';
+  }
+
+  char const* text() const { return fText == NULL ? "" : fText; }
+
+private:
+  char* fText;
+  unsigned fSize, fMaxSize;
+};
+
+// All of the samples for one metric name:
+class MetricFamily {
+public:
+  MetricFamily(char const* name, char const* type, char const* help)
+    : fNext(NULL) {
+    fSamples.append("# HELP "); fSamples.append(name); fSamples.append(" "); fSamples.append(help);
+    fSamples.append("\n# TYPE "); fSamples.append(name); fSamples.append(" "); fSamples.append(type);
+    fSamples.append("\n");
+  }
+
+  MetricFamily* fNext;
+  MetricsText fSamples; // (preceded by the "# HELP" and "# TYPE" lines)
+};
+
+PrometheusMetrics::PrometheusMetrics()
+  : fFamilies(HashTable::create(STRING_HASH_KEYS)), fFirstFamily(NULL), fLastFamily(NULL) {
+}
+
+PrometheusMetrics::~PrometheusMetrics() {
+  while (fFirstFamily != NULL) {
+    MetricFamily* next = fFirstFamily->fNext;
+    delete fFirstFamily;
+    fFirstFamily = next;
+  }
+  delete fFamilies;
+}
+
+void PrometheusMetrics::addCounter(char const* name, char const* help, char const* labels, double value) {
+  addSample(name, "counter", help, labels, value);
+}
+
+void PrometheusMetrics::addGauge(char const* name, char const* help, char const* labels, double value) {
+  addSample(name, "gauge", help, labels, value);
+}
+
+void PrometheusMetrics::addSummary(char const* name, char const* help, char const* labels,
+				   LatencyHistogram const& histogram) {
+  MetricFamily* family = lookupFamily(name, "summary", help);
+
+  static double const percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+  for (unsigned i = 0; i < sizeof percentiles/sizeof percentiles[0]; ++i) {
+    char quantileLabel[50];
+    sprintf(quantileLabel, "quantile=\"%g\"", percentiles[i]/100.0);
+    appendSample(family, name, "", labels, quantileLabel, histogram.valueAtPercentile(percentiles[i])/1000000.0);
+  }
+  appendSample(family, name, "_sum", labels, NULL, histogram.sum()/1000000.0);
+  appendSample(family, name, "_count", labels, NULL, (double)histogram.count());
+}
+
+char* PrometheusMetrics::render() const {
+  MetricsText result;
+  for (MetricFamily* family = fFirstFamily; family != NULL; family = family->fNext) {
+    result.append(family->fSamples.text());
+  }
+
+  return strDup(result.text());
+}
+
+char* PrometheusMetrics::makeLabels(char const* name1, char const* value1,
+				    char const* name2, char const* value2,
+				    char const* name3, char const* value3) {
+  char const* names[3] = { name1, name2, name3 };
+  char const* values[3] = { value1, value2, value3 };
+
+  MetricsText labels;
+  for (unsigned i = 0; i < 3 && names[i] != NULL; ++i) {
+    if (i > 0) labels.append(",");
+    labels.append(names[i]);
+    labels.append("=\"");
+    for (char const* p = values[i] == NULL ? "" : values[i]; *p != '\0'; ++p) {
+      // Escape backslashes, double quotes, and newlines:
+      switch (*p) {
+        case '\\': labels.append("\\\\"); break;
+        case '"': labels.append("\\\""); break;
+        case '\n': labels.append("\\n"); break;
+        default: labels.append(p, 1); break;
+      }
+    }
+    labels.append("\"");
+  }
+
+  return strDup(labels.text());
+}
+
+void PrometheusMetrics::addSample(char const* name, char const* type, char const* help,
+				  char const* labels, double value) {
+  appendSample(lookupFamily(name, type, help), name, "", labels, NULL, value);
+}
+
+MetricFamily* PrometheusMetrics::lookupFamily(char const* name, char const* type, char const* help) {
+  MetricFamily* family = (MetricFamily*)fFamilies->Lookup(name);
+  if (family == NULL) {
+    family = new MetricFamily(name, type, help);
+    fFamilies->Add(name, family);
+    if (fLastFamily == NULL) {
+      fFirstFamily = family;
+    } else {
+      fLastFamily->fNext = family;
+    }
+    fLastFamily = family;
+  }
+
+  return family;
+}
+
+void PrometheusMetrics::appendSample(MetricFamily* family, char const* name, char const* suffix,
+				     char const* labels, char const* extraLabel, double value) {
+  family->fSamples.append(name);
+  family->fSamples.append(suffix);
+  Boolean const haveLabels = labels != NULL && labels[0] != '\0';
+  if (haveLabels || extraLabel != NULL) {
+    family->fSamples.append("{");
+    if (haveLabels) family->fSamples.append(labels);
+    if (haveLabels && extraLabel != NULL) family->fSamples.append(",");
+    if (extraLabel != NULL) family->fSamples.append(extraLabel);
+    family->fSamples.append("}");
+  }
+  char valueStr[50];
+  sprintf(valueStr, " %.15g\n", value);
+  family->fSamples.append(valueStr);
+}
@@ -0,0 +1,72 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Collects metrics, and formats them in the Prometheus text exposition format (version 0.0.4)
+// C++ header
+// samples may be added in any order; they are output grouped by metric name, in the order each name was first added
+
+#ifndef _PROMETHEUS_METRICS_HH
+#define _PROMETHEUS_METRICS_HH
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+#ifndef _HASH_TABLE_HH
+#include "HashTable.hh"
+#endif
+#ifndef _LATENCY_HISTOGRAM_HH
+#include "LatencyHistogram.hh"
+#endif
+
+#define PROMETHEUS_CONTENT_TYPE "text/plain; version=0.0.4"
+
+class MetricFamily; // forward
+
+class PrometheusMetrics {
+public:
+  PrometheusMetrics();
+  virtual ~PrometheusMetrics();
+
+  void addCounter(char const* name, char const* help, char const* labels, double value);
+  void addGauge(char const* name, char const* help, char const* labels, double value);
+      // "labels" is either NULL, or a string made by "makeLabels()"
+  void addSummary(char const* name, char const* help, char const* labels, LatencyHistogram const& histogram);
+      // Outputs the histogram's 50th, 90th, 99th and 99.9th percentiles (as "quantile" labels), sum and count.
+      // The histogram's values are in microseconds; the summary's are in seconds.
+
+  char* render() const;
+      // Returns the metrics (as a heap-allocated string, which the caller should delete[]).
+
+  static char* makeLabels(char const* name1, char const* value1,
+			  char const* name2 = NULL, char const* value2 = NULL,
+			  char const* name3 = NULL, char const* value3 = NULL);
+      // Returns a (heap-allocated) string of the form: name1="value1",name2="value2",...
+      // with each value escaped as necessary.
+
+private:
+  void addSample(char const* name, char const* type, char const* help, char const* labels, double value);
+  MetricFamily* lookupFamily(char const* name, char const* type, char const* help); // creates it, if necessary
+  static void appendSample(MetricFamily* family, char const* name, char const* suffix,
+			   char const* labels, char const* extraLabel, double value);
+
+private:
+  HashTable* fFamilies; // maps metric names to "MetricFamily"s
+  MetricFamily* fFirstFamily;
+  MetricFamily* fLastFamily;
+};
+
+#endif
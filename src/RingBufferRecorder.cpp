@@ -0,0 +1,279 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// A sink that keeps the most recent (compressed) frames in a memory-bounded ring buffer, and - when triggered -
+// writes the 'pre-roll' frames, followed by live frames, to a file until a 'post-roll' timeout
+// Implementation
+
+#include "RingBufferRecorder.h"
+#include "H264VideoRTPSource.hh" // for "parseSPropParameterSets()"
+#include "AsyncFileIO.hh"
+#include "OutputFile.hh"
+#include <GroupsockHelper.hh> // for "gettimeofday()"
+#include <string.h>
+#include <time.h>
+
+static unsigned char const startCode[4] = { 0, 0, 0, 1 };
+
+RingBufferRecorder* RingBufferRecorder
+::createNew(UsageEnvironment& env, char const* fileNamePrefix,
+	    unsigned preRollSeconds, unsigned postRollSeconds,
+	    Boolean isH264, char const* sPropParameterSetsStr,
+	    unsigned ringBufferSize, unsigned maxFrameSize) {
+  if (fileNamePrefix == NULL || maxFrameSize == 0) return NULL;
+
+  return new RingBufferRecorder(env, fileNamePrefix, preRollSeconds, postRollSeconds,
+				isH264, sPropParameterSetsStr, ringBufferSize, maxFrameSize);
+}
+
+RingBufferRecorder
+::RingBufferRecorder(UsageEnvironment& env, char const* fileNamePrefix,
+		     unsigned preRollSeconds, unsigned postRollSeconds,
+		     Boolean isH264, char const* sPropParameterSetsStr,
+		     unsigned ringBufferSize, unsigned maxFrameSize)
+  : MediaSink(env),
+    fFileNamePrefix(strDup(fileNamePrefix)),
+    fPreRollSeconds(preRollSeconds), fPostRollSeconds(postRollSeconds == 0 ? 1 : postRollSeconds),
+    fIsH264(isH264), fSPropParameterSetsStr(strDup(sPropParameterSetsStr)),
+    fMaxFrameSize(maxFrameSize), fPrefixSize(isH264 ? sizeof startCode : 0),
+    fWritePosition(0),
+    fFramesCapacity(1024), fFirstFrame(0), fNumFrames(0), fPrevFrameWasKeyFrameData(False),
+    fOutFid(NULL), fCurrentFileName(NULL), fPostRollTask(NULL) {
+  // The ring buffer must be able to hold at least two maximum-size frames:
+  unsigned const minRingSize = 2*(fPrefixSize + fMaxFrameSize);
+  fRingSize = ringBufferSize < minRingSize ? minRingSize : ringBufferSize;
+  fRing = new unsigned char[fRingSize];
+  fFrames = new RingFrame[fFramesCapacity];
+
+  fAsyncFileIO = AsyncFileIO::getInstance(env); // may be NULL
+}
+
+RingBufferRecorder::~RingBufferRecorder() {
+  stopRecording();
+  if (fAsyncFileIO != NULL) fAsyncFileIO->release();
+
+  delete[] fFrames;
+  delete[] fRing;
+  delete[] fSPropParameterSetsStr;
+  delete[] fFileNamePrefix;
+}
+
+void RingBufferRecorder::trigger(unsigned postRollSeconds) {
+  if (postRollSeconds == 0) postRollSeconds = fPostRollSeconds;
+
+  if (fOutFid == NULL) {
+    // Begin a new file, named after the current (local) time:
+    time_t now = time(NULL);
+    char timeStr[20];
+    strftime(timeStr, sizeof timeStr, "%Y%m%d-%H%M%S", localtime(&now));
+
+    unsigned fileNameSize = strlen(fFileNamePrefix) + 1 + strlen(timeStr) + 7/*".mjpeg"*/ + 1;
+    fCurrentFileName = new char[fileNameSize];
+    sprintf(fCurrentFileName, "%s-%s%s", fFileNamePrefix, timeStr, fIsH264 ? ".264" : ".mjpeg");
+
+    fOutFid = OpenOutputFile(envir(), fCurrentFileName);
+    if (fOutFid == NULL) {
+      envir() << "RingBufferRecorder: Failed to open \"" << fCurrentFileName << "\": " << envir().getResultMsg() << "\n";
+      delete[] fCurrentFileName; fCurrentFileName = NULL;
+      return;
+    }
+
+    if (fIsH264 && fSPropParameterSetsStr != NULL) {
+      // Begin with the SPS and PPS from the SDP description, in case the stream doesn't repeat them in-band:
+      unsigned numSPropRecords;
+      SPropRecord* sPropRecords = parseSPropParameterSets(fSPropParameterSetsStr, numSPropRecords);
+      for (unsigned i = 0; i < numSPropRecords; ++i) {
+	writeToFile(startCode, sizeof startCode);
+	writeToFile(sPropRecords[i].sPropBytes, sPropRecords[i].sPropLength);
+      }
+      delete[] sPropRecords;
+    }
+
+    // Then write the buffered 'pre-roll' frames.  These are (usually) contiguous in the ring buffer, so we write
+    // each contiguous run of them at once:
+    unsigned i = 0;
+    while (i < fNumFrames) {
+      RingFrame const& first = fFrames[frameIndex(i)];
+      unsigned runSize = first.size;
+      for (++i; i < fNumFrames; ++i) {
+	RingFrame const& next = fFrames[frameIndex(i)];
+	if (next.offset != first.offset + runSize) break;
+	runSize += next.size;
+      }
+      writeToFile(&fRing[first.offset], runSize);
+    }
+
+    envir() << "RingBufferRecorder: Recording to \"" << fCurrentFileName << "\" (" << bufferedSeconds()
+	    << " seconds of pre-roll)\n";
+  }
+
+  // (Re)start the 'post-roll' timer:
+  envir().taskScheduler().rescheduleDelayedTask(fPostRollTask, postRollSeconds*1000000,
+						(TaskFunc*)postRollTimeout, this);
+}
+
+double RingBufferRecorder::bufferedSeconds() const {
+  if (fNumFrames == 0) return 0.0;
+
+  struct timeval const& oldest = fFrames[frameIndex(0)].presentationTime;
+  struct timeval const& newest = fFrames[frameIndex(fNumFrames-1)].presentationTime;
+  return (newest.tv_sec - oldest.tv_sec) + (newest.tv_usec - oldest.tv_usec)/1000000.0;
+}
+
+unsigned RingBufferRecorder::bufferedBytes() const {
+  unsigned result = 0;
+  for (unsigned i = 0; i < fNumFrames; ++i) result += fFrames[frameIndex(i)].size;
+  return result;
+}
+
+Boolean RingBufferRecorder::continuePlaying() {
+  if (fSource == NULL) return False;
+
+  makeRoomForNextFrame();
+
+  // Read the next frame directly into the ring buffer (after room for a 'start code', if needed):
+  fSource->getNextFrame(&fRing[fWritePosition + fPrefixSize], fMaxFrameSize,
+			afterGettingFrame, this,
+			ourOnSourceClosure, this);
+  return True;
+}
+
+void RingBufferRecorder::afterGettingFrame(void* clientData, unsigned frameSize,
+					   unsigned numTruncatedBytes,
+					   struct timeval presentationTime,
+					   unsigned /*durationInMicroseconds*/) {
+  RingBufferRecorder* sink = (RingBufferRecorder*)clientData;
+  sink->afterGettingFrame1(frameSize, numTruncatedBytes, presentationTime);
+}
+
+void RingBufferRecorder::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes,
+					    struct timeval presentationTime) {
+  if (numTruncatedBytes > 0) {
+    envir() << "RingBufferRecorder::afterGettingFrame1(): The input frame data was too large for our buffer size ("
+	    << fMaxFrameSize << ").  "
+	    << numTruncatedBytes << " bytes of trailing data was dropped!\n";
+  }
+
+  if (frameSize > 0) {
+    Boolean isKeyFrame;
+    if (fIsH264) {
+      // A GOP begins with a SPS, or (if the SPS and PPS aren't sent in-band) an IDR slice that doesn't follow one:
+      u_int8_t nal_unit_type = fRing[fWritePosition + fPrefixSize]&0x1F;
+      isKeyFrame = nal_unit_type == 7/*SPS*/ || (nal_unit_type == 5/*IDR*/ && !fPrevFrameWasKeyFrameData);
+      fPrevFrameWasKeyFrameData = nal_unit_type == 7 || nal_unit_type == 8/*PPS*/ || nal_unit_type == 5;
+
+      memcpy(&fRing[fWritePosition], startCode, sizeof startCode);
+    } else {
+      isKeyFrame = True; // every JPEG image is independently decodable
+    }
+
+    if (fNumFrames == fFramesCapacity) {
+      // Grow our (circular) array of frame descriptors:
+      unsigned newCapacity = 2*fFramesCapacity;
+      RingFrame* newFrames = new RingFrame[newCapacity];
+      for (unsigned i = 0; i < fNumFrames; ++i) newFrames[i] = fFrames[frameIndex(i)];
+      delete[] fFrames; fFrames = newFrames;
+      fFramesCapacity = newCapacity;
+      fFirstFrame = 0;
+    }
+
+    RingFrame& frame = fFrames[frameIndex(fNumFrames++)];
+    frame.offset = fWritePosition;
+    frame.size = fPrefixSize + frameSize;
+    frame.presentationTime = presentationTime;
+    frame.isKeyFrame = isKeyFrame;
+    fWritePosition += frame.size;
+
+    if (fOutFid != NULL) writeToFile(&fRing[frame.offset], frame.size);
+
+    trimToPreRoll();
+  }
+
+  // Then try getting the next frame:
+  continuePlaying();
+}
+
+void RingBufferRecorder::ourOnSourceClosure(void* clientData) {
+  RingBufferRecorder* sink = (RingBufferRecorder*)clientData;
+  sink->stopRecording();
+  sink->onSourceClosure();
+}
+
+void RingBufferRecorder::makeRoomForNextFrame() {
+  unsigned const spaceNeeded = fPrefixSize + fMaxFrameSize;
+  if (fWritePosition + spaceNeeded > fRingSize) {
+    // Wrap around.  Any (older) frames that are still stored after the current position get removed first:
+    while (fNumFrames > 0 && fFrames[frameIndex(0)].offset >= fWritePosition) removeOldestFrame();
+    fWritePosition = 0;
+  }
+
+  // Remove the oldest frames while they overlap the region that the next frame will be read into.  (Because frames
+  // are stored in order, the oldest frame is the first one at or after this region, so we need check only it.)
+  while (fNumFrames > 0) {
+    RingFrame const& oldest = fFrames[frameIndex(0)];
+    if (oldest.offset >= fWritePosition + spaceNeeded || oldest.offset + oldest.size <= fWritePosition) break;
+    removeOldestFrame();
+  }
+
+  // The buffer must begin at a key frame, so that a file written from it can be decoded:
+  while (fNumFrames > 0 && !fFrames[frameIndex(0)].isKeyFrame) removeOldestFrame();
+}
+
+void RingBufferRecorder::trimToPreRoll() {
+  // Remove whole GOPs from the start of the buffer, while we'd still have at least "fPreRollSeconds" without them:
+  struct timeval const& newest = fFrames[frameIndex(fNumFrames-1)].presentationTime;
+  while (1) {
+    unsigned nextKey;
+    for (nextKey = 1; nextKey < fNumFrames; ++nextKey) {
+      if (fFrames[frameIndex(nextKey)].isKeyFrame) break;
+    }
+    if (nextKey >= fNumFrames) break;
+
+    struct timeval const& keyTime = fFrames[frameIndex(nextKey)].presentationTime;
+    double secondsFromKey = (newest.tv_sec - keyTime.tv_sec) + (newest.tv_usec - keyTime.tv_usec)/1000000.0;
+    if (secondsFromKey < fPreRollSeconds) break;
+
+    while (nextKey-- > 0) removeOldestFrame();
+  }
+}
+
+void RingBufferRecorder::removeOldestFrame() {
+  fFirstFrame = (fFirstFrame + 1)%fFramesCapacity;
+  --fNumFrames;
+}
+
+void RingBufferRecorder::writeToFile(unsigned char const* data, unsigned dataSize) {
+  if (fAsyncFileIO != NULL && fAsyncFileIO->appendToFile(fOutFid, data, dataSize)) return;
+
+  fwrite(data, 1, dataSize, fOutFid);
+}
+
+void RingBufferRecorder::postRollTimeout(void* clientData) {
+  RingBufferRecorder* sink = (RingBufferRecorder*)clientData;
+  sink->fPostRollTask = NULL;
+  sink->stopRecording();
+}
+
+void RingBufferRecorder::stopRecording() {
+  envir().taskScheduler().unscheduleDelayedTask(fPostRollTask);
+  if (fOutFid == NULL) return;
+
+  if (fAsyncFileIO != NULL) fAsyncFileIO->flush(fOutFid);
+  CloseOutputFile(fOutFid);
+  fOutFid = NULL;
+
+  envir() << "RingBufferRecorder: Finished recording \"" << fCurrentFileName << "\"\n";
+  delete[] fCurrentFileName; fCurrentFileName = NULL;
+}
@@ -0,0 +1,111 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// A sink that keeps the most recent (compressed) frames in a memory-bounded ring buffer, and - when triggered -
+// writes the 'pre-roll' frames, followed by live frames, to a file until a 'post-roll' timeout
+// C++ header
+// it supports H.264 (written as an Annex B byte stream) and MJPEG (written as concatenated JPEG images)
+
+#ifndef _RING_BUFFER_RECORDER_HH
+#define _RING_BUFFER_RECORDER_HH
+
+#ifndef _MEDIA_SINK_HH
+#include "MediaSink.hh"
+#endif
+
+#ifndef RING_BUFFER_RECORDER_DEFAULT_SIZE
+#define RING_BUFFER_RECORDER_DEFAULT_SIZE (32*1024*1024) // enough for 30 seconds at 8 Mbps
+#endif
+
+class AsyncFileIO; // forward
+
+class RingBufferRecorder: public MediaSink {
+public:
+  static RingBufferRecorder* createNew(UsageEnvironment& env, char const* fileNamePrefix,
+				       unsigned preRollSeconds, unsigned postRollSeconds,
+				       Boolean isH264, char const* sPropParameterSetsStr = NULL,
+				       unsigned ringBufferSize = RING_BUFFER_RECORDER_DEFAULT_SIZE,
+				       unsigned maxFrameSize = 1024 * 1024);
+      // "sPropParameterSetsStr" (H.264 only) is the subsession's "sprop-parameter-sets" SDP attribute;
+      // its SPS and PPS are written at the start of each file, in case the stream doesn't carry them in-band.
+
+  void trigger(unsigned postRollSeconds = 0);
+      // Starts writing a new file (beginning with the buffered 'pre-roll' frames), or - if we're already
+      // writing one - extends it.  The file is closed "postRollSeconds" (0 means: the default) after the
+      // most recent trigger.
+
+  Boolean isRecording() const { return fOutFid != NULL; }
+  char const* currentFileName() const { return fCurrentFileName; }
+  double bufferedSeconds() const;
+  unsigned bufferedBytes() const;
+
+protected:
+  RingBufferRecorder(UsageEnvironment& env, char const* fileNamePrefix,
+		     unsigned preRollSeconds, unsigned postRollSeconds,
+		     Boolean isH264, char const* sPropParameterSetsStr,
+		     unsigned ringBufferSize, unsigned maxFrameSize);
+      // called only by createNew()
+  virtual ~RingBufferRecorder();
+
+private: // redefined virtual functions:
+  virtual Boolean continuePlaying();
+
+private:
+  static void afterGettingFrame(void* clientData, unsigned frameSize,
+				unsigned numTruncatedBytes,
+				struct timeval presentationTime,
+				unsigned durationInMicroseconds);
+  void afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes, struct timeval presentationTime);
+  static void ourOnSourceClosure(void* clientData);
+
+  void makeRoomForNextFrame();
+  void trimToPreRoll();
+  void removeOldestFrame();
+  unsigned frameIndex(unsigned i) const { return (fFirstFrame + i)%fFramesCapacity; }
+
+  void writeToFile(unsigned char const* data, unsigned dataSize);
+  static void postRollTimeout(void* clientData);
+  void stopRecording();
+
+private:
+  char* fFileNamePrefix;
+  unsigned fPreRollSeconds, fPostRollSeconds;
+  Boolean fIsH264;
+  char* fSPropParameterSetsStr;
+  unsigned fMaxFrameSize;
+  unsigned fPrefixSize; // 4 (the 'start code') for H.264; 0 for MJPEG
+
+  // The ring buffer (of frame data), and a circular array that describes the frames in it:
+  unsigned char* fRing;
+  unsigned fRingSize;
+  unsigned fWritePosition; // where the next frame will be read
+  struct RingFrame {
+    unsigned offset, size; // "size" includes the 'start code' prefix (if any)
+    struct timeval presentationTime;
+    Boolean isKeyFrame; // i.e., a frame that a decoder can start from
+  }* fFrames;
+  unsigned fFramesCapacity, fFirstFrame, fNumFrames;
+  Boolean fPrevFrameWasKeyFrameData; // used to detect the start of each H.264 GOP
+
+  // The file that we're currently writing (if any):
+  FILE* fOutFid;
+  char* fCurrentFileName;
+  AsyncFileIO* fAsyncFileIO;
+  TaskToken fPostRollTask;
+};
+
+#endif
@@ -24,7 +24,16 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "liveMedia.hh"
 #include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include "FrameTrace.hh"
 #include "BasicTCPServerSink.h"
+#include "RingBufferRecorder.h"
+#include "ControlServer.h"
+#include "StreamReplicaServerMediaSubsession.h"
+#include "MulticastStreamRelay.h"
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <signal.h>
+#endif
 
 // Forward function definitions:
 
@@ -34,6 +43,7 @@ void checkSessionTimeoutBrokenServer(void* clientData);
 void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultString);
 void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultString);
 void continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultString);
+void continueAfterPipelinedPLAY(RTSPClient* rtspClient, int resultCode, char* resultString);
 
 // Other event handler functions:
 void subsessionAfterPlaying(void* clientData); // called when a stream's subsession (e.g., audio or video substream) ends
@@ -50,6 +60,11 @@ void setupNextSubsession(RTSPClient* rtspClient);
 // Used to shut down and close a stream (including its "RTSPClient" object):
 void shutdownStream(RTSPClient* rtspClient, int exitCode = 1);
 
+// Used (with "-r") to close a failed or stalled stream, and reconnect to the camera:
+void streamFailed(RTSPClient* rtspClient, char const* reason);
+void recoverStream(RTSPClient* rtspClient, char const* reason);
+void checkForStall(void* clientData);
+
 // A function that outputs a string that identifies each stream (for debugging output).  Modify this if you wish:
 UsageEnvironment& operator<<(UsageEnvironment& env, const RTSPClient& rtspClient) {
   return env << "[URL:\"" << rtspClient.url() << "\"]: ";
@@ -71,8 +86,17 @@ Boolean controlConnectionUsesTCP = True;
 Boolean streamUsingTCP = False;
 //Boolean forceMulticastOnUnspecified = False;
 Boolean sendKeepAlivesToBrokenServers = False;
+Boolean pipelineSetup = False; // "-f": send "OPTIONS" with "DESCRIBE", and "SETUP"s with "PLAY", without waiting for responses
 Boolean waitForResponseToTEARDOWN = True;
 
+// Adaptive packet reordering ("-j"): Rather than always waiting (up to) 100 ms for a missing RTP packet, wait only as long
+// as packets have recently been arriving out of order (or jittering), up to this:
+#define DEFAULT_REORDERING_MAX_WAIT_MS 500
+#define DEFAULT_REORDERING_LATE_FRACTION 0.01
+unsigned reorderingMaxWaitMS = 0; // 0 means: use a fixed (100 ms) reordering threshold
+double reorderingLateFraction = DEFAULT_REORDERING_LATE_FRACTION; // of out-of-order packets that we let arrive too late
+Boolean requestRetransmissions = False; // "-N": send RTCP NACKs (and PLIs/FIRs) to cameras that accept them
+
 char* username = NULL;
 char* password = NULL;
 char* userAgent = NULL;
@@ -82,10 +106,63 @@ MediaSession* session = NULL;
 Medium* ourClient = NULL;
 RTSPClient* globalRTSPClient = NULL;
 portNumBits tcpServerPort = 9001;
+portNumBits controlServerPort = 0; // 0 means: no control server
+unsigned preRollSeconds = 0, postRollSeconds = 0;
+char const* recordingFileNamePrefix = NULL; // non-NULL means: keep a ring buffer, for recording on demand
+
+#define REPLICA_QUEUE_LENGTH 60 // frames queued for each consumer of the replicated stream, before we start dropping them
+
+ControlServer* controlServer = NULL;
+StreamReplicator* videoReplicator = NULL; // used (to share the received frames) if we're recording and/or re-serving
+RingBufferRecorder* ringBufferRecorder = NULL;
+
+portNumBits rtspServerPort = 0; // 0 means: don't re-serve the stream over RTSP
+char const* rtspServerStreamName = "live";
+RTSPServer* rtspServer = NULL;
+ServerMediaSession* reServedSession = NULL;
+
+// Multicast relay ("-M"): Our RTSP server describes the stream as multicast, which we send (once) to this group:
+char const* multicastAddressStr = NULL; // NULL means: re-serve the stream by unicast, to each RTSP client
+portNumBits multicastRTPPortNum = 18888; // (RTCP uses the next port)
+unsigned multicastTTL = 1; // i.e., the local network only
+unsigned multicastPacingRateKbps = 0; // 0 means: send each frame's packets as fast as possible
+MulticastStreamRelay* multicastRelay = NULL;
+
+char const* captureFileName = NULL; // non-NULL means: record the camera's RTP and RTCP packets to this file
+RTPCaptureWriter* captureWriter = NULL;
+char const* replayFileName = NULL; // non-NULL means: instead of a camera, replay the packets recorded in this file
+double replaySpeed = 1.0; // 0 means: as fast as possible
+RTPCaptureReplayer* replayer = NULL;
+
+// Automatic recovery ("-r"): Instead of exiting when the camera's stream fails (or stalls), we reconnect - with an
+// exponential backoff between attempts - while keeping our TCP server (and its clients), recorder and RTSP server:
+#define DEFAULT_STALL_TIMEOUT_MS 3000
+#define SETUP_TIMEOUT_MS 10000 // how long a (re)connection's "DESCRIBE", "SETUP"s and "PLAY" may take
+#define MIN_RECONNECT_DELAY_MS 250
+#define MAX_RECONNECT_DELAY_MS 30000
+unsigned stallTimeoutMS = 0; // 0 means: don't recover; exit instead
+enum CameraStreamState { STREAM_CONNECTING, STREAM_PLAYING, STREAM_WAITING_TO_RECONNECT };
+CameraStreamState streamState = STREAM_CONNECTING;
+TaskToken stallCheckTask = NULL;
+TaskToken reconnectTask = NULL;
+unsigned reconnectDelayMS = MIN_RECONNECT_DELAY_MS;
+struct timeval lastProgressTime; // when we last received a RTP packet (or started connecting, or playing)
+double lastNumPacketsReceived = 0;
+struct timeval outageStartTime = { 0, 0 }; // when we lost the stream (tv_sec == 0 if we haven't)
+unsigned numReconnects = 0;
+double lastOutageSeconds = 0.0; // from losing the stream, until packets arrived again
+
+BasicTCPServerSink* videoSink = NULL; // (with its TCP clients) kept across reconnections
+MediaSubsession* videoSubsession = NULL; // the subsession currently feeding "videoSink" (NULL while we're reconnecting)
+FramedSource* videoSinkReplica = NULL; // "videoSink"'s input, if it's fed through "videoReplicator"
+FramedSource* recorderReplica = NULL; // "ringBufferRecorder"'s input
 
 TaskToken sessionTimeoutBrokenServerTask = NULL;
 unsigned sessionTimeoutParameter = 0;
 UsageEnvironment* env;
+EventLoopStats* eventLoopStats = NULL;
+CPUAccount* streamCPUAccount = NULL; // charged for all of the stream's handling (see "CPUAccount.hh")
+EventTriggerId dumpEventLoopStatsTrigger = 0;
 
 /*
 void usage(UsageEnvironment& env, char const* progName) {
@@ -97,16 +174,70 @@ void usage(UsageEnvironment& env, char const* progName) {
 Boolean areAlreadyShuttingDown = False;
 int shutdownExitCode;
 
+static unsigned msSince(struct timeval const& time, struct timeval const& timeNow) {
+  int64_t uSecs = (timeNow.tv_sec - time.tv_sec)*(int64_t)1000000 + (timeNow.tv_usec - time.tv_usec);
+  return uSecs < 0 ? 0 : (unsigned)(uSecs/1000);
+}
+
 void usage() {
   *env << "Usage: " << progName
     << (controlConnectionUsesTCP ? " [-t]" : "")
     << " [-u <username> <password>"
     << " [-g user-agent]"
-    << " [-p tcp-server-port]"
-    << " [-K]"
-    << " <url>\n";
+    << " [-p tcp-server-port] [-b listen-backlog] [-m]"
+    << " [-c control-server-port]"
+    << " [-R pre-roll-seconds post-roll-seconds file-name-prefix]"
+    << " [-s rtsp-server-port [stream-name]] [-M multicast-address [port [ttl]]] [-x pacing-kbps]"
+    << " [-C capture-file]"
+    << " [-r [stall-timeout-ms]] [-j [max-wait-ms [late-fraction]]] [-N]"
+    << " [-v] [-l debug|info|warning|error] [-L log-file|syslog]"
+    << " [-K] [-f]"
+    << " <url>\n"
+    << "   or: " << progName << " [options] -P capture-file [speed|max]\n";
   shutdown();
 }
+
+void closeReplicator(void* clientData) {
+  Medium::close((StreamReplicator*)clientData);
+}
+
+void closeSubsessionSink(MediaSubsession* subsession) {
+  FramedSource* sinkSource = subsession->sink == NULL ? NULL : subsession->sink->source();
+  if (subsession->sink != NULL && subsession->sink == videoSink) {
+    videoSink = NULL;
+    videoSubsession = NULL;
+    if (videoSinkReplica != NULL) sinkSource = videoSinkReplica; // (even if the sink had stopped reading it)
+  }
+  Medium::close(subsession->sink);
+  subsession->sink = NULL;
+
+  if (videoReplicator != NULL && videoReplicator->inputSource() == subsession->readSource()) {
+    // Stop re-serving the stream (which also closes the replicas that its clients were reading):
+    if (reServedSession != NULL) {
+      rtspServer->deleteServerMediaSession(reServedSession);
+      reServedSession = NULL;
+    }
+    Medium::close(multicastRelay); // (after its "ServerMediaSession" was deleted)
+    multicastRelay = NULL;
+
+    // Also close the recorder, and the replicas that fed it and the sink, then the replicator itself
+    // (but not its input source, which belongs to the subsession):
+    if (ringBufferRecorder != NULL) {
+      Medium::close(ringBufferRecorder);
+      ringBufferRecorder = NULL;
+      Medium::close(recorderReplica);
+      recorderReplica = NULL;
+    }
+    Medium::close(sinkSource);
+    videoSinkReplica = NULL;
+
+    subsession->readSource()->stopGettingFrames();
+    videoReplicator->detachInputSource();
+    // (We may have been called from within the replicator's own closure handling, so close it later:)
+    env->taskScheduler().scheduleDelayedTask(0, closeReplicator, videoReplicator);
+    videoReplicator = NULL;
+  }
+}
 
 void closeMediaSinks() {
 
@@ -114,10 +245,362 @@ void closeMediaSinks() {
   MediaSubsessionIterator iter(*session);
   MediaSubsession* subsession;
   while ((subsession = iter.next()) != NULL) {
-    Medium::close(subsession->sink);
-    subsession->sink = NULL;
+    closeSubsessionSink(subsession);
+  }
+}
+
+void reServeSubsession(UsageEnvironment& env, MediaSubsession& subsession) {
+  // Make the received stream available - through our own RTSP server - to any number of clients, who will share
+  // its frames (via "videoReplicator"), rather than each opening a new session to the camera.  Either each client is
+  // sent its own (unicast) copy of the stream, or ("-M") we send a single copy to a multicast group, which the clients
+  // then join (so that the number of clients doesn't affect us):
+  ServerMediaSubsession* sms;
+  Boolean isSSM = False;
+  if (multicastAddressStr != NULL) {
+    struct in_addr groupAddress;
+    groupAddress.s_addr = our_inet_addr(multicastAddressStr);
+    multicastRelay = MulticastStreamRelay::createNew(env, *videoReplicator, subsession,
+      groupAddress, multicastRTPPortNum, (u_int8_t)multicastTTL, multicastPacingRateKbps);
+    sms = multicastRelay == NULL ? NULL : multicastRelay->createServerMediaSubsession();
+    if (multicastRelay != NULL) isSSM = multicastRelay->isSSM();
+  } else {
+    sms = StreamReplicaServerMediaSubsession::createNew(env, *videoReplicator, subsession);
+  }
+  if (sms == NULL) {
+    ENV_LOG(env, LOG_LEVEL_WARNING) << "Can't re-serve the \"" << subsession << "\" subsession: " << env.getResultMsg() << "\n";
+    return;
+  }
+
+  reServedSession = ServerMediaSession::createNew(env, rtspServerStreamName, rtspServerStreamName,
+    "Session re-served by RtspToTCP", isSSM);
+  reServedSession->addSubsession(sms);
+  rtspServer->addServerMediaSession(reServedSession);
+
+  char* url = rtspServer->rtspURL(reServedSession);
+  env << "Re-serving the \"" << subsession << "\" subsession as \"" << url << "\"";
+  if (multicastRelay != NULL) {
+    env << " (sent by " << (isSSM ? "source-specific " : "") << "multicast to " << multicastAddressStr
+	<< " port " << multicastRTPPortNum << ", TTL " << multicastTTL << ")";
+  }
+  env << "\n";
+  delete[] url;
+}
+
+unsigned subsessionIndex(MediaSubsession& subsession) {
+  // The subsession's position within its session (used to identify its packets in a capture file):
+  MediaSubsessionIterator iter(subsession.parentSession());
+  unsigned index = 0;
+  MediaSubsession* s;
+  while ((s = iter.next()) != NULL && s != &subsession) ++index;
+  return index;
+}
+
+void videoSinkAfterPlaying(void* /*clientData*/) {
+  if (videoSubsession != NULL) subsessionAfterPlaying(videoSubsession);
+}
+
+void detachVideoSink() {
+  // Before the subsession that feeds "videoSink" is closed (because we're reconnecting), stop the sink - or the
+  // replicator that feeds it - from reading from it, but keep the sink (and its TCP clients):
+  if (videoReplicator != NULL) {
+    videoReplicator->replaceInputSource(NULL);
+  } else {
+    videoSink->stopPlaying();
+  }
+  videoSink->setRTCPSyncSource(NULL);
+  videoSubsession->sink = NULL;
+  videoSubsession = NULL;
+}
+
+Boolean reattachVideoSink(UsageEnvironment& env, MediaSubsession& subsession) {
+  // We've reconnected, so feed our existing sink (and any recorder and re-served stream) from the new subsession:
+  subsession.sink = videoSink;
+  videoSubsession = &subsession;
+  videoSink->H264 = strcmp(subsession.codecName(), "H264") == 0;
+  videoSink->setRTCPSyncSource(subsession.rtpSource());
+  videoSink->resumeAtKeyFrame();
+
+  if (videoReplicator != NULL) {
+    videoReplicator->replaceInputSource(subsession.readSource());
+    // If the old source had closed, then the replicas' readers will have stopped, so restart them:
+    if (videoSink->source() == NULL) videoSink->startPlaying(*videoSinkReplica, videoSinkAfterPlaying, NULL);
+    if (ringBufferRecorder != NULL && ringBufferRecorder->source() == NULL) {
+      ringBufferRecorder->startPlaying(*recorderReplica, NULL, NULL);
+    }
+    if (multicastRelay != NULL) multicastRelay->restartIfStopped();
+  } else {
+    videoSink->startPlaying(*subsession.readSource(), videoSinkAfterPlaying, NULL);
+  }
+
+  env << "Re-attached the data sink (and its TCP clients) to the \"" << subsession << "\" subsession\n";
+  return True;
+}
+
+Boolean createSubsessionSink(UsageEnvironment& env, MediaSubsession& subsession) {
+  if (reorderingMaxWaitMS > 0 && subsession.rtpSource() != NULL) {
+    subsession.rtpSource()->setAdaptivePacketReordering(reorderingMaxWaitMS*1000, reorderingLateFraction);
+  }
+  if (requestRetransmissions && !streamUsingTCP && subsession.rtpSource() != NULL && subsession.rtcpInstance() != NULL
+      && (subsession.supportsGenericNACK() || subsession.supportsPLI() || subsession.supportsFIR())) {
+    subsession.rtpSource()->enableRetransmissionRequests(subsession.rtcpInstance(), subsession.rtxPayloadFormat(),
+                                                         subsession.supportsGenericNACK(), subsession.supportsPLI(),
+                                                         subsession.supportsFIR());
+    env << "Requesting ";
+    if (subsession.supportsGenericNACK()) {
+      env << "retransmissions" << (subsession.rtxPayloadFormat() != 0 ? " (RFC 4588)" : "");
+      if (subsession.supportsPLI() || subsession.supportsFIR()) env << " and ";
+    }
+    if (subsession.supportsPLI() || subsession.supportsFIR()) env << "key frames";
+    env << " from the camera for the \"" << subsession << "\" subsession\n";
+  }
+
+  // Create a data sink for the subsession (if it's one that we handle), and call "startPlaying()" on it:
+  if (strcmp(subsession.mediumName(), "video") == 0) {
+    if ( (strcmp(subsession.codecName(), "H264") == 0) || (strcmp(subsession.codecName(), "JPEG") == 0) ) {
+      if (videoSink != NULL) { // we've reconnected
+        return videoSubsession == NULL && reattachVideoSink(env, subsession);
+      }
+
+      subsession.sink = BasicTCPServerSink::createNew(env, tcpServerPort, 1024 * 1024);
+      // perhaps use your own custom "MediaSink" subclass instead
+      if (subsession.sink == NULL) {
+        ENV_LOG(env, LOG_LEVEL_ERROR) << "Failed to create a data sink for the \"" << subsession
+          << "\" subsession: " << env.getResultMsg() << "\n";
+        return False;
+      }
+      
+      videoSink = (BasicTCPServerSink*)subsession.sink;
+      videoSubsession = &subsession;
+      videoSink->setCPUAccount(streamCPUAccount);
+      if (strcmp(subsession.codecName(), "H264") == 0) {
+        BasicTCPServerSink *sink_h264 = (BasicTCPServerSink *)subsession.sink;
+        sink_h264->H264 = True;
+      }
+      if (subsession.rtpSource() != NULL) {
+        ((BasicTCPServerSink*)subsession.sink)->setRTCPSyncSource(subsession.rtpSource());
+      }
+
+      env << "Created a data sink for the \"" << subsession << "\" subsession\n";
+      FramedSource* sinkSource = subsession.readSource();
+      if ((recordingFileNamePrefix != NULL || rtspServer != NULL) && videoReplicator == NULL) {
+        // Share the received frames between the sink, and a ring buffer recorder and/or our RTSP server's clients:
+        videoReplicator = StreamReplicator::createNewWithSharedFrames(env, subsession.readSource(), 1024 * 1024,
+          REPLICA_QUEUE_LENGTH, StreamReplicator::DROP_OLDEST_FRAME, False);
+        sinkSource = videoSinkReplica = videoReplicator->createStreamReplica();
+        ((BasicTCPServerSink*)subsession.sink)->setSharedFrameReplicator(videoReplicator);
+
+        if (recordingFileNamePrefix != NULL) {
+          ringBufferRecorder = RingBufferRecorder::createNew(env, recordingFileNamePrefix, preRollSeconds, postRollSeconds,
+            strcmp(subsession.codecName(), "H264") == 0, subsession.fmtp_spropparametersets());
+          if (ringBufferRecorder != NULL) {
+            recorderReplica = videoReplicator->createStreamReplica();
+            ringBufferRecorder->startPlaying(*recorderReplica, NULL, NULL);
+            env << "Keeping " << preRollSeconds << " seconds of pre-roll for recording to \""
+              << recordingFileNamePrefix << "-*\"\n";
+          }
+        }
+
+        if (rtspServer != NULL) reServeSubsession(env, subsession);
+      }
+
+      subsession.sink->startPlaying(*sinkSource, videoSinkAfterPlaying, NULL);
+      return True;
+    }
+  }
+
+  return False;
+}
+
+char* handleTriggerRequest(void* /*clientData*/, char const* queryString) {
+  // "GET /trigger[?postroll=<seconds>]"
+  unsigned postRoll = 0; // means: the default
+  char const* param = strstr(queryString, "postroll=");
+  if (param != NULL) sscanf(param + 9, "%u", &postRoll);
+
+  if (ringBufferRecorder == NULL) return strDup("not recording: the stream has not started\n");
+
+  ringBufferRecorder->trigger(postRoll);
+  char const* fileName = ringBufferRecorder->currentFileName();
+  if (fileName == NULL) return strDup("not recording: failed to open the output file\n");
+
+  char* result = new char[strlen(fileName) + 100];
+  sprintf(result, "recording to %s (%u bytes of pre-roll buffered)\n", fileName, ringBufferRecorder->bufferedBytes());
+  return result;
+}
+
+void addSubsessionMetrics(PrometheusMetrics& metrics, char const* cameraName, MediaSubsession& subsession) {
+  char subsessionName[100];
+  snprintf(subsessionName, sizeof subsessionName, "%s/%s", subsession.mediumName(), subsession.codecName());
+  char* labels = PrometheusMetrics::makeLabels("camera", cameraName, "subsession", subsessionName);
+
+  RTPSource* rtpSource = subsession.rtpSource();
+  if (rtpSource != NULL) {
+    // Sum the reception statistics from each SSRC (there's normally just one):
+    double numPacketsReceived = 0, numPacketsExpected = 0, numKBytesReceived = 0, jitterSeconds = 0;
+    RTPReceptionStatsDB::Iterator statsIter(rtpSource->receptionStatsDB());
+    RTPReceptionStats* stats;
+    while ((stats = statsIter.next(True)) != NULL) {
+      numPacketsReceived += stats->totNumPacketsReceived();
+      numPacketsExpected += stats->totNumPacketsExpected();
+      numKBytesReceived += stats->totNumKBytesReceived();
+      if (rtpSource->timestampFrequency() > 0) {
+        double jitter = stats->jitter()/(double)rtpSource->timestampFrequency();
+        if (jitter > jitterSeconds) jitterSeconds = jitter;
+      }
+    }
+
+    metrics.addCounter("rtsptotcp_rtp_packets_received_total", "RTP packets received from the camera", labels,
+      numPacketsReceived);
+    metrics.addCounter("rtsptotcp_rtp_bytes_received_total", "RTP payload bytes received from the camera", labels,
+      numKBytesReceived*1024);
+    metrics.addCounter("rtsptotcp_rtp_packets_lost_total", "RTP packets expected (from their sequence numbers), but not received",
+      labels, numPacketsExpected > numPacketsReceived ? numPacketsExpected - numPacketsReceived : 0);
+    metrics.addGauge("rtsptotcp_rtp_jitter_seconds", "RTP interarrival jitter (RFC 3550)", labels, jitterSeconds);
+    metrics.addGauge("rtsptotcp_rtp_reordering_buffer_packets", "RTP packets waiting in the reordering buffer", labels,
+      rtpSource->numPacketsInReorderingBuffer());
+    metrics.addGauge("rtsptotcp_rtp_reordering_wait_seconds", "How long we currently wait for a missing RTP packet", labels,
+      rtpSource->packetReorderingThresholdTime()/1000000.0);
+    metrics.addCounter("rtsptotcp_rtp_packets_too_late_total",
+      "RTP packets that arrived (out of order) after we'd stopped waiting for them", labels,
+      rtpSource->numPacketsArrivedTooLate());
+    metrics.addCounter("rtsptotcp_rtp_packets_nacked_total", "Lost RTP packets that we asked the camera to retransmit",
+      labels, rtpSource->numPacketsNACKed());
+    metrics.addCounter("rtsptotcp_rtp_packets_retransmitted_total", "RTP packets that the camera retransmitted to us",
+      labels, rtpSource->numPacketsRetransmitted());
+    metrics.addCounter("rtsptotcp_rtp_key_frame_requests_total",
+      "Key frames that we asked the camera for, after unrecoverable packet loss", labels,
+      rtpSource->numKeyFrameRequests());
+  }
+
+  if (subsession.sink != NULL) {
+    BasicTCPServerSink* sink = (BasicTCPServerSink*)subsession.sink; // the only kind of sink that we create
+    sink->addMetrics(metrics, cameraName, subsessionName);
+
+    if (videoReplicator != NULL && videoReplicator->inputSource() == subsession.readSource()) {
+      char const* const help = "Frames dropped (because they were not consumed fast enough) from each copy of the stream";
+      char* consumerLabels = PrometheusMetrics::makeLabels("camera", cameraName, "subsession", subsessionName, "consumer", "tcp-sink");
+      metrics.addCounter("rtsptotcp_replica_dropped_frames_total", help, consumerLabels,
+        videoReplicator->numDroppedFrames(sink->source()));
+      delete[] consumerLabels;
+
+      if (ringBufferRecorder != NULL) {
+        consumerLabels = PrometheusMetrics::makeLabels("camera", cameraName, "subsession", subsessionName, "consumer", "recorder");
+        metrics.addCounter("rtsptotcp_replica_dropped_frames_total", help, consumerLabels,
+          videoReplicator->numDroppedFrames(ringBufferRecorder->source()));
+        delete[] consumerLabels;
+      }
+    }
+  }
+
+  if (multicastRelay != NULL && videoReplicator != NULL && videoReplicator->inputSource() == subsession.readSource()) {
+    metrics.addCounter("rtsptotcp_multicast_packets_sent_total", "RTP packets sent (once, however many clients) to the multicast group",
+      labels, multicastRelay->numPacketsSent());
+    metrics.addCounter("rtsptotcp_multicast_bytes_sent_total", "RTP bytes (including headers) sent to the multicast group", labels,
+      multicastRelay->numBytesSent());
+  }
+
+  delete[] labels;
+}
+
+void addEventLoopMetrics(PrometheusMetrics& metrics) {
+  metrics.addSummary("rtsptotcp_event_loop_wait_seconds", "Time spent waiting (in select()) for events", NULL,
+		     eventLoopStats->waitTime());
+  metrics.addSummary("rtsptotcp_event_loop_busy_seconds", "Time spent handling events, per event loop iteration", NULL,
+		     eventLoopStats->busyTime());
+  metrics.addSummary("rtsptotcp_event_loop_timer_lateness_seconds", "How long after they were due that delayed tasks ran",
+		     NULL, eventLoopStats->timerLateness());
+
+  EventLoopStats::Iterator iter(*eventLoopStats);
+  EventLoopStats::HandlerType type;
+  char const* name;
+  LatencyHistogram const* histogram;
+  while ((histogram = iter.next(type, name)) != NULL) {
+    char* labels = PrometheusMetrics::makeLabels("type", EventLoopStats::handlerTypeName(type), "handler", name);
+    metrics.addSummary("rtsptotcp_event_loop_handler_seconds",
+		       "Time spent in each socket handler, delayed task, and event trigger handler", labels, *histogram);
+    delete[] labels;
+  }
+}
+
+void addCPUAccountMetrics(PrometheusMetrics& metrics, CPUAccount const& account) {
+  char* labels = PrometheusMetrics::makeLabels("stream", account.name());
+  metrics.addCounter("rtsptotcp_stream_cpu_seconds_total", "CPU time spent handling the stream's events", labels,
+		     account.cpuSeconds());
+  metrics.addCounter("rtsptotcp_stream_handler_calls_total", "Socket handlers, delayed tasks and event triggers run for the stream",
+		     labels, (double)account.numHandlerCalls());
+  metrics.addCounter("rtsptotcp_stream_syscalls_total", "Socket system calls made while handling the stream's events", labels,
+		     (double)account.numSyscalls());
+  delete[] labels;
+}
+
+char* makeCameraName() {
+  // Identify the camera by its URL, but without any "<username>:<password>@" (or by the capture file that we're replaying):
+  char* cameraName = strDup(replayFileName != NULL ? replayFileName : streamURL);
+  char* hostStart = strstr(cameraName, "://");
+  if (hostStart != NULL) {
+    hostStart += 3;
+    char* at = strchr(hostStart, '@');
+    char* slash = strchr(hostStart, '/');
+    if (at != NULL && (slash == NULL || at < slash)) memmove(hostStart, at + 1, strlen(at + 1) + 1);
+  }
+
+  return cameraName;
+}
+
+char* handleMetricsRequest(void* /*clientData*/, char const* /*queryString*/) {
+  // "GET /metrics"
+  char* cameraName = makeCameraName();
+
+  PrometheusMetrics metrics;
+  if (session != NULL) {
+    MediaSubsessionIterator iter(*session);
+    MediaSubsession* subsession;
+    while ((subsession = iter.next()) != NULL) {
+      addSubsessionMetrics(metrics, cameraName, *subsession);
+    }
   }
+  if (stallTimeoutMS > 0) {
+    char* labels = PrometheusMetrics::makeLabels("camera", cameraName);
+    metrics.addGauge("rtsptotcp_stream_up", "Whether we're currently receiving the camera's stream", labels,
+		     streamState == STREAM_PLAYING && outageStartTime.tv_sec == 0 ? 1 : 0);
+    metrics.addCounter("rtsptotcp_stream_reconnects_total", "Reconnections to the camera (after the stream failed or stalled)",
+		       labels, numReconnects);
+    metrics.addGauge("rtsptotcp_stream_last_outage_seconds",
+		     "How long the last outage lasted (from losing the stream, until packets arrived again)", labels,
+		     lastOutageSeconds);
+    delete[] labels;
+  }
+  delete[] cameraName;
+  if (eventLoopStats != NULL) addEventLoopMetrics(metrics);
+  if (streamCPUAccount != NULL) {
+    addCPUAccountMetrics(metrics, *streamCPUAccount);
+    addCPUAccountMetrics(metrics, ((BasicTaskScheduler&)env->taskScheduler()).unattributedCPUAccount());
+  }
+
+  return metrics.render();
+}
+
+#ifdef FRAME_TRACING
+char* handleTraceRequest(void* /*clientData*/, char const* queryString) {
+  // "GET /trace[?seconds=<seconds>]": the recent per-frame trace events, for "chrome://tracing" or "ui.perfetto.dev"
+  double seconds = 10.0;
+  char const* param = strstr(queryString, "seconds=");
+  if (param != NULL) sscanf(param + 8, "%lf", &seconds);
+
+  return FrameTrace::chromeTraceJSON(seconds);
 }
+#endif
+
+void dumpEventLoopStats(void* /*clientData*/) {
+  if (eventLoopStats != NULL) eventLoopStats->dump(*env);
+}
+
+#if !defined(__WIN32__) && !defined(_WIN32)
+void handleDumpSignal(int /*sig*/) {
+  // We're in a signal handler, so just get the event loop to do the work:
+  env->taskScheduler().triggerEvent(dumpEventLoopStatsTrigger);
+}
+#endif
 
 void continueAfterTEARDOWN(RTSPClient*, int /*resultCode*/, char* resultString) {
   delete[] resultString;
@@ -126,9 +609,14 @@ void continueAfterTEARDOWN(RTSPClient*, int /*resultCode*/, char* resultString)
   closeMediaSinks();
   Medium::close(session);
 
+  Medium::close(replayer);
+  Medium::close(captureWriter); // (which also flushes the capture file)
+
   // Finally, shut down our client:
   delete ourAuthenticator;
   Medium::close(ourClient);
+  Medium::close(controlServer);
+  Medium::close(rtspServer);
 
   // Adios...
   exit(shutdownExitCode);
@@ -147,6 +635,8 @@ void shutdown(int exitCode) {
     //env->taskScheduler().unscheduleDelayedTask(periodicFileOutputTask);
     //env->taskScheduler().unscheduleDelayedTask(sessionTimerTask);
     env->taskScheduler().unscheduleDelayedTask(sessionTimeoutBrokenServerTask);
+    env->taskScheduler().unscheduleDelayedTask(stallCheckTask);
+    env->taskScheduler().unscheduleDelayedTask(reconnectTask);
     //env->taskScheduler().unscheduleDelayedTask(arrivalCheckTimerTask);
     //env->taskScheduler().unscheduleDelayedTask(interPacketGapCheckTimerTask);
     //env->taskScheduler().unscheduleDelayedTask(qosMeasurementTimerTask);
@@ -158,7 +648,7 @@ void shutdown(int exitCode) {
 
   // Teardown, then shutdown, any outstanding RTP/RTCP subsessions
   Boolean shutdownImmediately = True; // by default
-  if (session != NULL) {
+  if (session != NULL && globalRTSPClient != NULL) {
     RTSPClient::responseHandler* responseHandlerForTEARDOWN = NULL; // unless:
     if (waitForResponseToTEARDOWN) {
       shutdownImmediately = False;
@@ -170,10 +660,67 @@ void shutdown(int exitCode) {
   if (shutdownImmediately) continueAfterTEARDOWN(NULL, 0, NULL);
 }
 
+void replayEnded(void* /*clientData*/) {
+  *env << "Replayed " << replayer->numPacketsReplayed() << " packets from \"" << replayFileName << "\"\n";
+  shutdown(0);
+}
+
+void startReplay(UsageEnvironment& env) {
+  // Instead of opening a RTSP session, feed the packets from a capture file - through the loopback interface, and
+  // our normal reception path - to the subsessions described by the SDP description that was recorded with them:
+  replayer = RTPCaptureReplayer::createNew(env, replayFileName, replaySpeed);
+  if (replayer == NULL) {
+    ENV_LOG(env, LOG_LEVEL_ERROR) << "Failed to open the capture file \"" << replayFileName << "\": " << env.getResultMsg() << "\n";
+    shutdown();
+    return;
+  }
+
+  if (replayer->sdpDescription() != NULL) session = MediaSession::createNew(env, replayer->sdpDescription());
+  if (session == NULL || !session->hasSubsessions()) {
+    ENV_LOG(env, LOG_LEVEL_ERROR) << "Failed to create a MediaSession object from the capture file's SDP description: " << env.getResultMsg() << "\n";
+    shutdown();
+    return;
+  }
+
+  struct in_addr loopback;
+  loopback.s_addr = our_inet_addr("127.0.0.1");
+  MediaSubsessionIterator iter(*session);
+  MediaSubsession* subsession;
+  for (u_int8_t streamId = 0; (subsession = iter.next()) != NULL; ++streamId) {
+    subsession->setCPUAccount(streamCPUAccount);
+    if (!subsession->initiate()) {
+      ENV_LOG(env, LOG_LEVEL_WARNING) << "Failed to initiate the \"" << *subsession << "\" subsession: " << env.getResultMsg() << "\n";
+      continue;
+    }
+    replayer->setDestination(streamId, False, loopback, Port(subsession->clientPortNum()));
+    replayer->setDestination(streamId, True, loopback,
+      Port(subsession->rtcpIsMuxed() ? subsession->clientPortNum() : subsession->clientPortNum() + 1));
+    createSubsessionSink(env, *subsession);
+  }
+
+  env << "Replaying \"" << replayFileName << "\"";
+  if (replaySpeed > 0.0) env << " at a speed factor of " << replaySpeed; else env << " as fast as possible";
+  env << "...\n";
+  replayer->startReplaying(replayEnded, NULL);
+}
+
 int main(int argc, char** argv) {
   // Begin by setting up our usage environment:
-  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
-  env = BasicUsageEnvironment::createNew(*scheduler);
+  BasicTaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  BasicUsageEnvironment* basicEnv = BasicUsageEnvironment::createNew(*scheduler);
+  env = basicEnv;
+  // Keep statistics about the event loop (for "GET /metrics", and - except on Windows - dumped on SIGUSR1):
+  scheduler->enableEventLoopStats();
+  eventLoopStats = scheduler->eventLoopStats();
+  dumpEventLoopStatsTrigger = scheduler->createEventTrigger(dumpEventLoopStats);
+#if !defined(__WIN32__) && !defined(_WIN32)
+  signal(SIGUSR1, handleDumpSignal);
+#endif
+  // Write our output from a background thread, so that the event loop never blocks on it:
+  basicEnv->setLogWriter(LogWriter::createNew(LogWriter::LOG_TO_STDERR));
+#ifdef FRAME_TRACING
+  FrameTrace::setThreadName("event loop");
+#endif
 
   progName = argv[0];
   // We need at least one "rtsp://" URL argument:
@@ -187,7 +734,7 @@ int main(int argc, char** argv) {
   while (argc > 1) {
     char* const opt = argv[1];
     if (opt[0] != '-') {
-      if (argc == 2) break; // only the URL is left
+      if (argc == 2 && replayFileName == NULL) break; // only the URL is left
       usage();
     }
 
@@ -218,6 +765,24 @@ int main(int argc, char** argv) {
       break;
     }
 
+    case 'b': { // the "listen()" backlog of our TCP server (and RTSP server), for when many clients connect at once
+      unsigned listenBacklogSize;
+      if (argc < 3 || sscanf(argv[2], "%u", &listenBacklogSize) != 1 || listenBacklogSize == 0) usage();
+      BasicTCPServerSink::listenBacklogSize = GenericMediaServer::listenBacklogSize = listenBacklogSize;
+      ++argv; --argc;
+      break;
+    }
+
+    case 'm': { // share our TCP server (and RTSP server) port with other "RtspToTCP" processes (using SO_REUSEPORT)
+      BasicTCPServerSink::shareListeningPort = GenericMediaServer::shareListeningPort = True;
+      break;
+    }
+
+    case 'f': { // pipeline the RTSP requests (to start streaming sooner over high-latency links)
+      pipelineSetup = True;
+      break;
+    }
+
     case 'g': { // specify a user agent name to use in outgoing requests
       userAgent = argv[2];
       ++argv; --argc;
@@ -239,8 +804,188 @@ int main(int argc, char** argv) {
       break;
     }
 
+    case 'c': { // specify the port of the HTTP control server
+      if (argc > 3 && argv[2][0] != '-') {
+        if (sscanf(argv[2], "%hu", &controlServerPort) == 1
+          && controlServerPort > 0) {
+          ++argv; --argc;
+          break;
+        }
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+    case 'R': { // keep a pre-roll ring buffer, and record (on request) to files
+      if (argc > 5 && sscanf(argv[2], "%u", &preRollSeconds) == 1
+        && sscanf(argv[3], "%u", &postRollSeconds) == 1 && postRollSeconds > 0) {
+        recordingFileNamePrefix = argv[4];
+        argv += 3; argc -= 3;
+        break;
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+    case 's': { // re-serve the stream using our own RTSP server
+      if (argc > 3 && argv[2][0] != '-') {
+        if (sscanf(argv[2], "%hu", &rtspServerPort) == 1
+          && rtspServerPort > 0) {
+          ++argv; --argc;
+          if (argc > 3 && argv[2][0] != '-') { // the (optional) stream name
+            rtspServerStreamName = argv[2];
+            ++argv; --argc;
+          }
+          break;
+        }
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+    case 'x': { // pace the multicast stream's packets
+      if (argc > 3 && argv[2][0] != '-' && sscanf(argv[2], "%u", &multicastPacingRateKbps) == 1
+          && multicastPacingRateKbps > 0) {
+        ++argv; --argc;
+        break;
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+    case 'M': { // re-serve the stream by multicast (rather than by unicast)
+      if (argc > 3 && argv[2][0] != '-' && IsMulticastAddress(our_inet_addr(argv[2]))) {
+        multicastAddressStr = argv[2];
+        ++argv; --argc;
+        if (argc > 3 && argv[2][0] != '-') { // the (optional) RTP port
+          if (sscanf(argv[2], "%hu", &multicastRTPPortNum) != 1 || (multicastRTPPortNum&1) != 0) {
+            ENV_LOG(*env, LOG_LEVEL_ERROR) << "The multicast RTP port must be even (RTCP uses the next port)\n";
+            usage();
+          }
+          ++argv; --argc;
+          if (argc > 3 && argv[2][0] != '-') { // the (optional) time-to-live
+            if (sscanf(argv[2], "%u", &multicastTTL) != 1 || multicastTTL == 0 || multicastTTL > 255) usage();
+            ++argv; --argc;
+          }
+        }
+        break;
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+    case 'C': { // record the camera's RTP and RTCP packets to a file
+      if (argc > 3 && argv[2][0] != '-') {
+        captureFileName = argv[2];
+        ++argv; --argc;
+        break;
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+    case 'P': { // replay a capture file, instead of receiving from a camera
+      if (argc > 2) {
+        replayFileName = argv[2];
+        ++argv; --argc;
+        if (argc > 2 && argv[2][0] != '-') { // the (optional) speed
+          if (strcmp(argv[2], "max") == 0) {
+            replaySpeed = 0.0;
+          } else if (sscanf(argv[2], "%lf", &replaySpeed) != 1 || replaySpeed <= 0.0) {
+            usage();
+          }
+          ++argv; --argc;
+        }
+        break;
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+    case 'r': { // recover from failures and stalls by reconnecting to the camera, instead of exiting
+      stallTimeoutMS = DEFAULT_STALL_TIMEOUT_MS;
+      if (argc > 3 && argv[2][0] >= '0' && argv[2][0] <= '9') { // the (optional) stall timeout
+        if (sscanf(argv[2], "%u", &stallTimeoutMS) != 1 || stallTimeoutMS == 0) usage();
+        ++argv; --argc;
+      }
+      break;
+    }
+
+    case 'j': { // size the wait for out-of-order RTP packets to the network, instead of always waiting (up to) 100 ms
+      reorderingMaxWaitMS = DEFAULT_REORDERING_MAX_WAIT_MS;
+      if (argc > 3 && argv[2][0] >= '0' && argv[2][0] <= '9') { // the (optional) maximum wait
+        if (sscanf(argv[2], "%u", &reorderingMaxWaitMS) != 1 || reorderingMaxWaitMS == 0) usage();
+        ++argv; --argc;
+        if (argc > 3 && (argv[2][0] == '.' || (argv[2][0] >= '0' && argv[2][0] <= '9'))) { // the (optional) late fraction
+          if (sscanf(argv[2], "%lf", &reorderingLateFraction) != 1
+              || reorderingLateFraction <= 0.0 || reorderingLateFraction >= 1.0) usage();
+          ++argv; --argc;
+        }
+      }
+      break;
+    }
+
+    case 'N': { // ask the camera to retransmit lost packets, and to send a key frame after unrecoverable loss
+      requestRetransmissions = True;
+      break;
+    }
+
+    case 'v': { // output a line for each frame that we receive
+      basicEnv->enableDebugCategories(LOG_CATEGORY_FRAMES);
+      break;
+    }
+
+    case 'l': { // specify the minimum level of output
+      char const* const levelNames[] = { "debug", "info", "warning", "error" };
+      unsigned level;
+      for (level = LOG_LEVEL_DEBUG; level <= LOG_LEVEL_ERROR; ++level) {
+        if (argc > 3 && strcmp(argv[2], levelNames[level]) == 0) break;
+      }
+      if (level <= LOG_LEVEL_ERROR) {
+        basicEnv->setMinLogLevel(level);
+        ++argv; --argc;
+        break;
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+    case 'L': { // write our output to a file, or to 'syslog'
+      if (argc > 3 && argv[2][0] != '-') {
+        LogWriter* logWriter = strcmp(argv[2], "syslog") == 0
+          ? LogWriter::createNew(LogWriter::LOG_TO_SYSLOG, progName)
+          : LogWriter::createNew(LogWriter::LOG_TO_FILE, argv[2]);
+        if (logWriter != NULL) {
+          basicEnv->setLogWriter(logWriter);
+          ++argv; --argc;
+          break;
+        }
+        ENV_LOG(*env, LOG_LEVEL_ERROR) << "Failed to open the log file \"" << argv[2] << "\"\n";
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
     default: {
-      *env << "Invalid option: " << opt << "\n";
+      ENV_LOG(*env, LOG_LEVEL_ERROR) << "Invalid option: " << opt << "\n";
       usage();
       break;
     }
@@ -249,14 +994,70 @@ int main(int argc, char** argv) {
     ++argv; --argc;
   }
 
-  streamURL = argv[1];
+  if (replayFileName == NULL) {
+    if (argc < 2) usage();
+    streamURL = argv[1];
+  } else if (argc > 1) {
+    usage(); // there's no URL when replaying
+  }
+  if (multicastAddressStr != NULL && rtspServerPort == 0) {
+    ENV_LOG(*env, LOG_LEVEL_ERROR) << "\"-M\" needs a RTSP server (\"-s\") to describe the multicast stream to clients\n";
+    usage();
+  }
+  if (multicastPacingRateKbps > 0 && multicastAddressStr == NULL) {
+    ENV_LOG(*env, LOG_LEVEL_ERROR) << "\"-x\" (pacing) applies only to the multicast stream (\"-M\")\n";
+    usage();
+  }
+
+  if (captureFileName != NULL && replayFileName == NULL) {
+    captureWriter = RTPCaptureWriter::createNew(*env, captureFileName);
+    if (captureWriter == NULL) {
+      ENV_LOG(*env, LOG_LEVEL_ERROR) << "Failed to open the capture file \"" << captureFileName << "\": " << env->getResultMsg() << "\n";
+      shutdown();
+    }
+  }
+
+  if (controlServerPort != 0) {
+    controlServer = ControlServer::createNew(*env, controlServerPort);
+    if (controlServer == NULL) {
+      ENV_LOG(*env, LOG_LEVEL_ERROR) << "Failed to create the control server on port " << controlServerPort << ": " << env->getResultMsg() << "\n";
+      shutdown();
+    }
+    controlServer->addHandler("/trigger", handleTriggerRequest, NULL);
+    controlServer->addHandler("/metrics", handleMetricsRequest, NULL, PROMETHEUS_CONTENT_TYPE);
+#ifdef FRAME_TRACING
+    controlServer->addHandler("/trace", handleTraceRequest, NULL, "application/json");
+#endif
+  }
+
+  if (rtspServerPort != 0) {
+    OutPacketBuffer::maxSize = 1024 * 1024; // allow for large (key) frames
+    rtspServer = RTSPServer::createNew(*env, rtspServerPort);
+    if (rtspServer == NULL) {
+      ENV_LOG(*env, LOG_LEVEL_ERROR) << "Failed to create the RTSP server on port " << rtspServerPort << ": " << env->getResultMsg() << "\n";
+      shutdown();
+    }
+  }
 
   // There are argc-1 URLs: argv[1] through argv[argc-1].  Open and start streaming each one:
 //  for (int i = 1; i <= argc-1; ++i) {
 //    openURL(*env, argv[0], argv[i]);
 //  }
 
-  openURL(*env, progName, streamURL);
+  // Charge everything that the stream sets up - its RTSP client (or replayer), subsessions and TCP server - to its own
+  // CPU account (for "GET /metrics"):
+  char* cameraName = makeCameraName();
+  streamCPUAccount = new CPUAccount(cameraName);
+  delete[] cameraName;
+  scheduler->enableCPUAccounting();
+  CPUAccount* prevAccount = scheduler->setCurrentCPUAccount(streamCPUAccount);
+  if (replayFileName != NULL) {
+    startReplay(*env);
+  } else {
+    openURL(*env, progName, streamURL);
+    if (stallTimeoutMS > 0) checkForStall(NULL); // (which also schedules further checks)
+  }
+  scheduler->setCurrentCPUAccount(prevAccount);
 
   // All subsequent activity takes place within the event loop:
   env->taskScheduler().doEventLoop(&eventLoopWatchVariable);
@@ -286,6 +1087,11 @@ public:
   MediaSubsession* subsession;
   TaskToken streamTimerTask;
   double duration;
+  struct timeval connectTime; // when we sent our first request
+  Boolean havePipelined; // whether we've sent the remaining "SETUP"s and "PLAY" without waiting
+  unsigned numPipelinedSETUPsPending; // how many of those "SETUP"s we're still awaiting responses to
+  Boolean aPipelinedSETUPFailed;
+  Boolean pipelinedPLAYSucceeded; // if so, we don't "PLAY" again after retrying any "SETUP"s that failed
 };
 
 // If you're streaming just a single stream (i.e., just from a single URL, once), then you can define and use just a single
@@ -331,7 +1137,7 @@ void openURL(UsageEnvironment& env, char const* progName, char const* rtspURL) {
   // to receive (even if more than stream uses the same "rtsp://" URL).
   RTSPClient* rtspClient = ourRTSPClient::createNew(env, rtspURL, RTSP_CLIENT_VERBOSITY_LEVEL, progName);
   if (rtspClient == NULL) {
-    env << "Failed to create a RTSP client for URL \"" << rtspURL << "\": " << env.getResultMsg() << "\n";
+    ENV_LOG(env, LOG_LEVEL_ERROR) << "Failed to create a RTSP client for URL \"" << rtspURL << "\": " << env.getResultMsg() << "\n";
     return;
   }
 
@@ -341,10 +1147,17 @@ void openURL(UsageEnvironment& env, char const* progName, char const* rtspURL) {
 
   ++rtspClientCount;
 
+  if (pipelineSetup) {
+    // Some cameras expect an "OPTIONS" first.  Send it right before the "DESCRIBE" (we don't need its response):
+    rtspClient->sendOptionsCommand(NULL, ourAuthenticator);
+  }
+
   // Next, send a RTSP "DESCRIBE" command, to get a SDP description for the stream.
   // Note that this command - like all RTSP commands - is sent asynchronously; we do not block, waiting for a response.
   // Instead, the following function call returns immediately, and we handle the RTSP response later, from within the event loop:
   rtspClient->sendDescribeCommand(continueAfterDESCRIBE, ourAuthenticator);
+  streamState = STREAM_CONNECTING;
+  gettimeofday(&lastProgressTime, NULL);
 }
 
 
@@ -356,7 +1169,7 @@ void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultS
     StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
 
     if (resultCode != 0) {
-      env << *rtspClient << "Failed to get a SDP description: " << resultString << "\n";
+      ENV_LOG(env, LOG_LEVEL_ERROR) << *rtspClient << "Failed to get a SDP description: " << resultString << "\n";
       delete[] resultString;
       break;
     }
@@ -367,13 +1180,14 @@ void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultS
     // Create a media session object from this SDP description:
     scs.session = MediaSession::createNew(env, sdpDescription);
     session = scs.session;
+    if (captureWriter != NULL) captureWriter->recordSDPDescription(sdpDescription);
 
     delete[] sdpDescription; // because we don't need it anymore
     if (scs.session == NULL) {
-      env << *rtspClient << "Failed to create a MediaSession object from the SDP description: " << env.getResultMsg() << "\n";
+      ENV_LOG(env, LOG_LEVEL_ERROR) << *rtspClient << "Failed to create a MediaSession object from the SDP description: " << env.getResultMsg() << "\n";
       break;
     } else if (!scs.session->hasSubsessions()) {
-      env << *rtspClient << "This session has no media subsessions (i.e., no \"m=\" lines)\n";
+      ENV_LOG(env, LOG_LEVEL_ERROR) << *rtspClient << "This session has no media subsessions (i.e., no \"m=\" lines)\n";
       break;
     }
 
@@ -386,7 +1200,7 @@ void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultS
   } while (0);
 
   // An unrecoverable error occurred with this stream.
-  shutdownStream(rtspClient);
+  streamFailed(rtspClient, "failed to get a usable SDP description");
 }
 
 // By default, we request that the server stream its data using RTP/UDP.
@@ -394,38 +1208,108 @@ void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultS
 //#define REQUEST_STREAMING_OVER_TCP False
 //#define REQUEST_STREAMING_OVER_TCP True
 
-void setupNextSubsession(RTSPClient* rtspClient) {
+Boolean initiateSubsession(RTSPClient* rtspClient, MediaSubsession& subsession) {
   UsageEnvironment& env = rtspClient->envir(); // alias
+
+  if (subsession.readSource() != NULL) return True; // we've already initiated it (before falling back from pipelining)
+
+  subsession.setCPUAccount(streamCPUAccount);
+  if (!subsession.initiate()) {
+    ENV_LOG(env, LOG_LEVEL_ERROR) << *rtspClient << "Failed to initiate the \"" << subsession << "\" subsession: " << env.getResultMsg() << "\n";
+    return False;
+  }
+
+  env << *rtspClient << "Initiated the \"" << subsession << "\" subsession (";
+  if (subsession.rtcpIsMuxed()) {
+    env << "client port " << subsession.clientPortNum();
+  } else {
+    env << "client ports " << subsession.clientPortNum() << "-" << subsession.clientPortNum()+1;
+  }
+  env << ")\n";
+  return True;
+}
+
+void sendPlayCommand(RTSPClient* rtspClient, RTSPClient::responseHandler* responseHandler) {
+  StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
+
+  if (scs.session->absStartTime() != NULL) {
+    // Special case: The stream is indexed by 'absolute' time, so send an appropriate "PLAY" command:
+    rtspClient->sendPlayCommand(*scs.session, responseHandler, scs.session->absStartTime(), scs.session->absEndTime());
+  } else {
+    scs.duration = scs.session->playEndTime() - scs.session->playStartTime();
+    rtspClient->sendPlayCommand(*scs.session, responseHandler);
+  }
+}
+
+Boolean hasOneSubsession(MediaSession& session) {
+  MediaSubsessionIterator iter(session);
+  return iter.next() != NULL && iter.next() == NULL;
+}
+
+void pipelineSetupAndPlay(RTSPClient* rtspClient) {
+  // (Used with "-f", for a session with just one subsession.)  Send the "PLAY" right behind the "SETUP", rather than
+  // waiting a round trip for the session id.  The requests share a "Pipelined-Requests:" id (RFC 7826, section 18.33)
+  // instead.  A server that doesn't support this rejects the "PLAY"; we then send it again, with the session id:
+  StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
+  scs.havePipelined = True;
+
+  rtspClient->setPipelineId(1 + our_random()%99999999); // (at most 8 digits)
+  rtspClient->sendSetupCommand(*scs.subsession, continueAfterSETUP, False, streamUsingTCP);
+  ++scs.numPipelinedSETUPsPending;
+  scs.subsession = NULL; // so that "continueAfterSETUP()" finds this subsession again, as the first that we initiated
+
+  sendPlayCommand(rtspClient, continueAfterPipelinedPLAY);
+}
+
+void setupNextSubsession(RTSPClient* rtspClient) {
   StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
   
   scs.subsession = scs.iter->next();
   if (scs.subsession != NULL) {
-    if (!scs.subsession->initiate()) {
-      env << *rtspClient << "Failed to initiate the \"" << *scs.subsession << "\" subsession: " << env.getResultMsg() << "\n";
-      setupNextSubsession(rtspClient); // give up on this subsession; go to the next one
+    if (scs.subsession->sessionId() != NULL // it's already been set up (before we fell back from pipelining)
+	|| !initiateSubsession(rtspClient, *scs.subsession)) {
+      setupNextSubsession(rtspClient); // go to the next one
+    } else if (pipelineSetup && !scs.havePipelined && hasOneSubsession(*scs.session)) {
+      pipelineSetupAndPlay(rtspClient);
     } else {
-      env << *rtspClient << "Initiated the \"" << *scs.subsession << "\" subsession (";
-      if (scs.subsession->rtcpIsMuxed()) {
-	env << "client port " << scs.subsession->clientPortNum();
-      } else {
-	env << "client ports " << scs.subsession->clientPortNum() << "-" << scs.subsession->clientPortNum()+1;
-      }
-      env << ")\n";
-
       // Continue setting up this subsession, by sending a RTSP "SETUP" command:
       rtspClient->sendSetupCommand(*scs.subsession, continueAfterSETUP, False, streamUsingTCP);
     }
     return;
   }
 
-  // We've finished setting up all of the subsessions.  Now, send a RTSP "PLAY" command to start the streaming:
-  if (scs.session->absStartTime() != NULL) {
-    // Special case: The stream is indexed by 'absolute' time, so send an appropriate "PLAY" command:
-    rtspClient->sendPlayCommand(*scs.session, continueAfterPLAY, scs.session->absStartTime(), scs.session->absEndTime());
-  } else {
-    scs.duration = scs.session->playEndTime() - scs.session->playStartTime();
-    rtspClient->sendPlayCommand(*scs.session, continueAfterPLAY);
+  // We've finished setting up all of the subsessions.  Now, send a RTSP "PLAY" command to start the streaming
+  // (unless the session is already playing, because we're just retrying "SETUP"s that failed when pipelined):
+  if (scs.pipelinedPLAYSucceeded) return;
+  sendPlayCommand(rtspClient, continueAfterPLAY);
+}
+
+void pipelineRemainingRequests(RTSPClient* rtspClient) {
+  // (Used with "-f".)  Now that the first "SETUP" has given us a session id, send the "SETUP"s for the remaining
+  // subsessions, and then the "PLAY", back-to-back - rather than waiting a round trip for each response.  The server
+  // will respond to them in order:
+  StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
+  scs.havePipelined = True;
+
+  MediaSubsession* subsession;
+  while ((subsession = scs.iter->next()) != NULL) {
+    if (!initiateSubsession(rtspClient, *subsession)) continue;
+
+    rtspClient->sendSetupCommand(*subsession, continueAfterSETUP, False, streamUsingTCP);
+    ++scs.numPipelinedSETUPsPending;
   }
+
+  sendPlayCommand(rtspClient, continueAfterPipelinedPLAY);
+}
+
+MediaSubsession* nextInitiatedSubsession(MediaSession& session, MediaSubsession* prevSubsession) {
+  // Returns the first subsession after "prevSubsession" (or the first, if "prevSubsession" is NULL) that we were able to
+  // initiate (i.e., that we sent a "SETUP" for):
+  MediaSubsessionIterator iter(session);
+  MediaSubsession* subsession;
+  if (prevSubsession != NULL) while ((subsession = iter.next()) != NULL && subsession != prevSubsession) {}
+  while ((subsession = iter.next()) != NULL && subsession->readSource() == NULL) {}
+  return subsession;
 }
 
 void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultString) {
@@ -433,8 +1317,14 @@ void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultStri
     UsageEnvironment& env = rtspClient->envir(); // alias
     StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
 
+    if (scs.numPipelinedSETUPsPending > 0) {
+      // This is the response to the next of our pipelined "SETUP"s:
+      scs.subsession = nextInitiatedSubsession(*scs.session, scs.subsession);
+    }
+
     if (resultCode != 0) {
-      env << *rtspClient << "Failed to set up the \"" << *scs.subsession << "\" subsession: " << resultString << "\n";
+      ENV_LOG(env, LOG_LEVEL_ERROR) << *rtspClient << "Failed to set up the \"" << *scs.subsession << "\" subsession: " << resultString << "\n";
+      if (scs.numPipelinedSETUPsPending > 0) scs.aPipelinedSETUPFailed = True;
       break;
     }
 
@@ -450,36 +1340,61 @@ void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultStri
     // (This will prepare the data sink to receive data; the actual flow of data from the client won't start happening until later,
     // after we've sent a RTSP "PLAY" command.)
 
-    if (strcmp(scs.subsession->mediumName(), "video") == 0) {
-      if ( (strcmp(scs.subsession->codecName(), "H264") == 0) || (strcmp(scs.subsession->codecName(), "JPEG") == 0) ) {
-
-        scs.subsession->sink = BasicTCPServerSink::createNew(env, tcpServerPort, 1024 * 1024);
-        // perhaps use your own custom "MediaSink" subclass instead
-        if (scs.subsession->sink == NULL) {
-          env << *rtspClient << "Failed to create a data sink for the \"" << *scs.subsession
-            << "\" subsession: " << env.getResultMsg() << "\n";
-          break;
-        }
-        
-        if (strcmp(scs.subsession->codecName(), "H264") == 0) {
-          BasicTCPServerSink *sink_h264 = (BasicTCPServerSink *)scs.subsession->sink;
-          sink_h264->H264 = True;
-        }
-
-        env << *rtspClient << "Created a data sink for the \"" << *scs.subsession << "\" subsession\n";
-        scs.subsession->miscPtr = rtspClient; // a hack to let subsession handler functions get the "RTSPClient" from the subsession 
-        scs.subsession->sink->startPlaying(*(scs.subsession->readSource()),
-          subsessionAfterPlaying, scs.subsession);
-        // Also set a handler to be called if a RTCP "BYE" arrives for this subsession:
-        if (scs.subsession->rtcpInstance() != NULL) {
-          scs.subsession->rtcpInstance()->setByeHandler(subsessionByeHandler, scs.subsession);
-        }
+    if (captureWriter != NULL) {
+      // Also record the subsession's incoming RTP and RTCP packets:
+      unsigned const streamId = subsessionIndex(*scs.subsession);
+      if (scs.subsession->rtpSource() != NULL) scs.subsession->rtpSource()->setCaptureWriter(captureWriter, streamId);
+      if (scs.subsession->rtcpInstance() != NULL) scs.subsession->rtcpInstance()->setCaptureWriter(captureWriter, streamId);
+    }
+
+    if (createSubsessionSink(env, *scs.subsession)) {
+      scs.subsession->miscPtr = rtspClient; // a hack to let subsession handler functions get the "RTSPClient" from the subsession 
+
+      // Also set a handler to be called if a RTCP "BYE" arrives for this subsession:
+      if (scs.subsession->rtcpInstance() != NULL) {
+        scs.subsession->rtcpInstance()->setByeHandler(subsessionByeHandler, scs.subsession);
       }
     }
   } while (0);
   delete[] resultString;
 
-  // Set up the next subsession, if any:
+  StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
+  if (scs.numPipelinedSETUPsPending > 0) {
+    --scs.numPipelinedSETUPsPending; // our "PLAY" has already been sent
+  } else if (pipelineSetup && !scs.havePipelined && resultCode == 0) {
+    pipelineRemainingRequests(rtspClient);
+  } else {
+    // Set up the next subsession, if any:
+    setupNextSubsession(rtspClient);
+  }
+}
+
+void continueAfterPipelinedPLAY(RTSPClient* rtspClient, int resultCode, char* resultString) {
+  StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
+
+  if (resultCode == 0 && !scs.aPipelinedSETUPFailed) {
+    continueAfterPLAY(rtspClient, resultCode, resultString);
+    return;
+  }
+
+  // The server didn't accept all of our pipelined requests, so set up (again) - one at a time - the subsessions that
+  // failed.  If the "PLAY" failed, then we "PLAY" again after this; otherwise, the session is already playing (the
+  // subsessions that were set up), so we don't.  (We also won't pipeline requests to this server again - e.g., after
+  // reconnecting.)
+  UsageEnvironment& env = rtspClient->envir(); // alias
+  ENV_LOG(env, LOG_LEVEL_WARNING) << *rtspClient << "The server didn't accept our pipelined requests ("
+      << (resultCode != 0 ? resultString : "a \"SETUP\" failed") << "); falling back to sequential setup\n";
+
+  pipelineSetup = False;
+  rtspClient->setPipelineId(0);
+  scs.numPipelinedSETUPsPending = 0;
+  if (resultCode == 0) {
+    scs.pipelinedPLAYSucceeded = True;
+    continueAfterPLAY(rtspClient, resultCode, resultString); // (which deletes "resultString")
+  } else {
+    delete[] resultString;
+  }
+  scs.iter->reset();
   setupNextSubsession(rtspClient);
 }
 
@@ -491,7 +1406,7 @@ void continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultStrin
     StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
 
     if (resultCode != 0) {
-      env << *rtspClient << "Failed to start playing session: " << resultString << "\n";
+      ENV_LOG(env, LOG_LEVEL_ERROR) << *rtspClient << "Failed to start playing session: " << resultString << "\n";
       break;
     }
 
@@ -506,11 +1421,13 @@ void continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultStrin
       scs.streamTimerTask = env.taskScheduler().scheduleDelayedTask(uSecsToDelay, (TaskFunc*)streamTimerHandler, rtspClient);
     }
 
+    struct timeval timeNow;
+    gettimeofday(&timeNow, NULL);
     env << *rtspClient << "Started playing session";
     if (scs.duration > 0) {
       env << " (for up to " << scs.duration << " seconds)";
     }
-    env << "...\n";
+    env << ", " << (int)msSince(scs.connectTime, timeNow) << " ms after connecting...\n";
 
     success = True;
   } while (0);
@@ -518,11 +1435,15 @@ void continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultStrin
 
   if (!success) {
     // An unrecoverable error occurred with this stream.
-    shutdownStream(rtspClient);
+    streamFailed(rtspClient, "failed to start playing");
     return;
   }
 
-  sessionTimeoutBrokenServerTask = NULL;
+  streamState = STREAM_PLAYING;
+  lastNumPacketsReceived = 0;
+  gettimeofday(&lastProgressTime, NULL);
+
+  rtspClient->envir().taskScheduler().unscheduleDelayedTask(sessionTimeoutBrokenServerTask); // in case we've reconnected
   checkSessionTimeoutBrokenServer(NULL);
 }
 
@@ -533,9 +1454,14 @@ void subsessionAfterPlaying(void* clientData) {
   MediaSubsession* subsession = (MediaSubsession*)clientData;
   RTSPClient* rtspClient = (RTSPClient*)(subsession->miscPtr);
 
+  if (rtspClient != NULL && stallTimeoutMS > 0 && !areAlreadyShuttingDown) {
+    // Don't close anything; reconnect to the camera instead:
+    recoverStream(rtspClient, "the stream ended");
+    return;
+  }
+
   // Begin by closing this subsession's stream:
-  Medium::close(subsession->sink);
-  subsession->sink = NULL;
+  closeSubsessionSink(subsession);
 
   // Next, check whether *all* subsessions' streams have now been closed:
   MediaSession& session = subsession->parentSession();
@@ -545,6 +1471,10 @@ void subsessionAfterPlaying(void* clientData) {
   }
 
   // All subsessions' streams have now been closed, so shutdown the client:
+  if (rtspClient == NULL) { // we're replaying a capture file
+    shutdown(0);
+    return;
+  }
   shutdownStream(rtspClient);
 }
 
@@ -581,8 +1511,7 @@ void shutdownStream(RTSPClient* rtspClient, int exitCode) {
 
     while ((subsession = iter.next()) != NULL) {
       if (subsession->sink != NULL) {
-	Medium::close(subsession->sink);
-	subsession->sink = NULL;
+	closeSubsessionSink(subsession);
 
 	if (subsession->rtcpInstance() != NULL) {
 	  subsession->rtcpInstance()->setByeHandler(NULL, NULL); // in case the server sends a RTCP "BYE" while handling "TEARDOWN"
@@ -612,6 +1541,117 @@ void shutdownStream(RTSPClient* rtspClient, int exitCode) {
 }
 
 
+void streamFailed(RTSPClient* rtspClient, char const* reason) {
+  if (stallTimeoutMS > 0 && !areAlreadyShuttingDown) {
+    recoverStream(rtspClient, reason);
+  } else {
+    shutdownStream(rtspClient);
+  }
+}
+
+void closeStreamForReconnect(RTSPClient* rtspClient) {
+  // Like "shutdownStream()", except that we keep "videoSink" (and its clients), and don't exit:
+  StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
+
+  if (scs.session != NULL) {
+    Boolean someSubsessionsWereActive = False;
+    MediaSubsessionIterator iter(*scs.session);
+    MediaSubsession* subsession;
+
+    while ((subsession = iter.next()) != NULL) {
+      if (subsession->sink != NULL) {
+	if (subsession == videoSubsession) {
+	  detachVideoSink();
+	} else {
+	  closeSubsessionSink(subsession);
+	}
+
+	if (subsession->rtcpInstance() != NULL) {
+	  subsession->rtcpInstance()->setByeHandler(NULL, NULL);
+	}
+
+	someSubsessionsWereActive = True;
+      }
+    }
+
+    if (someSubsessionsWereActive) {
+      // Tell the server (if it's still there) that we're done with the old session:
+      rtspClient->sendTeardownCommand(*scs.session, NULL);
+    }
+    if (scs.session == session) session = NULL;
+  }
+
+  if (rtspClient == globalRTSPClient) globalRTSPClient = NULL;
+  Medium::close(rtspClient);
+    // Note that this will also cause this stream's "StreamClientState" structure - including its session - to get reclaimed.
+  --rtspClientCount;
+}
+
+void reconnect(void* /*clientData*/) {
+  reconnectTask = NULL;
+  ++numReconnects;
+  openURL(*env, progName, streamURL);
+}
+
+void recoverStream(RTSPClient* rtspClient, char const* reason) {
+  if (outageStartTime.tv_sec == 0) gettimeofday(&outageStartTime, NULL);
+
+  ENV_LOG(*env, LOG_LEVEL_WARNING) << "[URL:\"" << streamURL << "\"]: Lost the stream (" << reason << "); reconnecting in "
+      << reconnectDelayMS << " ms\n";
+  if (rtspClient != NULL) closeStreamForReconnect(rtspClient);
+
+  streamState = STREAM_WAITING_TO_RECONNECT;
+  env->taskScheduler().unscheduleDelayedTask(reconnectTask);
+  reconnectTask = env->taskScheduler().scheduleDelayedTask(reconnectDelayMS*1000, reconnect, NULL);
+
+  // Back off exponentially, until the stream is flowing again:
+  reconnectDelayMS *= 2;
+  if (reconnectDelayMS > MAX_RECONNECT_DELAY_MS) reconnectDelayMS = MAX_RECONNECT_DELAY_MS;
+}
+
+double numRTPPacketsReceived() {
+  double result = 0;
+  if (session == NULL) return result;
+
+  MediaSubsessionIterator iter(*session);
+  MediaSubsession* subsession;
+  while ((subsession = iter.next()) != NULL) {
+    if (subsession->rtpSource() != NULL) result += subsession->rtpSource()->receptionStatsDB().totNumPacketsReceived();
+  }
+  return result;
+}
+
+void checkForStall(void* /*clientData*/) {
+  // Called periodically (with "-r"), to check that the stream is still flowing (or that a (re)connection hasn't hung):
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+
+  if (streamState == STREAM_PLAYING) {
+    double const numPacketsReceived = numRTPPacketsReceived();
+    if (numPacketsReceived != lastNumPacketsReceived) {
+      lastNumPacketsReceived = numPacketsReceived;
+      lastProgressTime = timeNow;
+
+      if (outageStartTime.tv_sec != 0) {
+	lastOutageSeconds = msSince(outageStartTime, timeNow)/1000.0;
+	*env << "[URL:\"" << streamURL << "\"]: Recovered the stream after " << lastOutageSeconds << " seconds\n";
+	outageStartTime.tv_sec = 0;
+	reconnectDelayMS = MIN_RECONNECT_DELAY_MS;
+      }
+    } else if (msSince(lastProgressTime, timeNow) >= stallTimeoutMS) {
+      char reason[100];
+      sprintf(reason, "no RTP packets received for %u ms", msSince(lastProgressTime, timeNow));
+      recoverStream(globalRTSPClient, reason);
+    }
+  } else if (streamState == STREAM_CONNECTING && msSince(lastProgressTime, timeNow) >= SETUP_TIMEOUT_MS) {
+    recoverStream(globalRTSPClient, "timed out setting up the session");
+  }
+
+  unsigned const checkIntervalMS = stallTimeoutMS < 400 ? 100 : stallTimeoutMS/4;
+  stallCheckTask = env->taskScheduler().scheduleDelayedTask(checkIntervalMS*1000, checkForStall, NULL);
+}
+
+
 // Implementation of "ourRTSPClient":
 
 ourRTSPClient* ourRTSPClient::createNew(UsageEnvironment& env, char const* rtspURL,
@@ -631,7 +1671,9 @@ ourRTSPClient::~ourRTSPClient() {
 // Implementation of "StreamClientState":
 
 StreamClientState::StreamClientState()
-  : iter(NULL), session(NULL), subsession(NULL), streamTimerTask(NULL), duration(0.0) {
+  : iter(NULL), session(NULL), subsession(NULL), streamTimerTask(NULL), duration(0.0),
+    havePipelined(False), numPipelinedSETUPsPending(0), aPipelinedSETUPFailed(False), pipelinedPLAYSucceeded(False) {
+  gettimeofday(&connectTime, NULL);
 }
 
 StreamClientState::~StreamClientState() {
@@ -649,7 +1691,7 @@ void checkSessionTimeoutBrokenServer(void* ) {
   if (!sendKeepAlivesToBrokenServers) return; // we're not checking
 
                                               // Send an "OPTIONS" request, starting with the second call
-  if (sessionTimeoutBrokenServerTask != NULL) {
+  if (sessionTimeoutBrokenServerTask != NULL && globalRTSPClient != NULL) {
     getOptions(NULL);
   }
 
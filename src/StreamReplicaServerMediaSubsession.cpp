@@ -0,0 +1,157 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// A 'ServerMediaSubsession' object that re-serves - on demand - an already-received (H.264 or H.265) RTSP
+// subsession, using replicas of its (depacketized) source
+// Implementation
+
+#include "StreamReplicaServerMediaSubsession.h"
+#include "H264VideoRTPSink.hh"
+#include "H265VideoRTPSink.hh"
+#include "H264VideoStreamDiscreteFramer.hh"
+#include "H265VideoStreamDiscreteFramer.hh"
+#include <string.h>
+
+StreamReplicaServerMediaSubsession*
+StreamReplicaServerMediaSubsession::createNew(UsageEnvironment& env, StreamReplicator& replicator,
+					      MediaSubsession const& inputSubsession) {
+  Boolean isH264;
+  if (strcmp(inputSubsession.codecName(), "H264") == 0) {
+    isH264 = True;
+  } else if (strcmp(inputSubsession.codecName(), "H265") == 0) {
+    isH264 = False;
+  } else {
+    env.setResultMsg("Re-serving \"", inputSubsession.codecName(), "\" streams is not supported");
+    return NULL;
+  }
+
+  return new StreamReplicaServerMediaSubsession(env, replicator, inputSubsession, isH264);
+}
+
+StreamReplicaServerMediaSubsession
+::StreamReplicaServerMediaSubsession(UsageEnvironment& env, StreamReplicator& replicator,
+				     MediaSubsession const& inputSubsession, Boolean isH264)
+  : OnDemandServerMediaSubsession(env, True/*reuseFirstSource: all clients share one source and "RTPSink"*/),
+    fReplicator(replicator), fIsH264(isH264),
+    fEstimatedBitrate(inputSubsession.bandwidth() > 0 ? inputSubsession.bandwidth() : 2000),
+    fSPropVPS(strDup(inputSubsession.fmtp_spropvps())),
+    fSPropSPS(strDup(inputSubsession.fmtp_spropsps())),
+    fSPropPPS(strDup(inputSubsession.fmtp_sproppps())),
+    fSPropParameterSets(strDup(inputSubsession.fmtp_spropparametersets())),
+    fAuxSDPLine(NULL), fDoneFlag(0), fDummyRTPSink(NULL) {
+}
+
+StreamReplicaServerMediaSubsession::~StreamReplicaServerMediaSubsession() {
+  delete[] fAuxSDPLine;
+  delete[] fSPropParameterSets;
+  delete[] fSPropPPS;
+  delete[] fSPropSPS;
+  delete[] fSPropVPS;
+}
+
+static void afterPlayingDummy(void* clientData) {
+  StreamReplicaServerMediaSubsession* subsess = (StreamReplicaServerMediaSubsession*)clientData;
+  subsess->afterPlayingDummy1();
+}
+
+void StreamReplicaServerMediaSubsession::afterPlayingDummy1() {
+  // Unschedule any pending 'checking' task:
+  envir().taskScheduler().unscheduleDelayedTask(nextTask());
+  // Signal the event loop that we're done:
+  setDoneFlag();
+}
+
+static void checkForAuxSDPLine(void* clientData) {
+  StreamReplicaServerMediaSubsession* subsess = (StreamReplicaServerMediaSubsession*)clientData;
+  subsess->checkForAuxSDPLine1();
+}
+
+void StreamReplicaServerMediaSubsession::checkForAuxSDPLine1() {
+  nextTask() = NULL;
+
+  char const* dasl;
+  if (fAuxSDPLine != NULL) {
+    // Signal the event loop that we're done:
+    setDoneFlag();
+  } else if (fDummyRTPSink != NULL && (dasl = fDummyRTPSink->auxSDPLine()) != NULL) {
+    fAuxSDPLine = strDup(dasl);
+    fDummyRTPSink = NULL;
+
+    // Signal the event loop that we're done:
+    setDoneFlag();
+  } else if (!fDoneFlag) {
+    // try again after a brief delay:
+    int uSecsToDelay = 100000; // 100 ms
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(uSecsToDelay,
+			      (TaskFunc*)checkForAuxSDPLine, this);
+  }
+}
+
+char const* StreamReplicaServerMediaSubsession::getAuxSDPLine(RTPSink* rtpSink, FramedSource* inputSource) {
+  if (fAuxSDPLine != NULL) return fAuxSDPLine; // it's already been set up (for a previous client)
+
+  // If the parameter sets were in the camera's SDP description, then the sink already knows them:
+  char const* dasl = rtpSink->auxSDPLine();
+  if (dasl != NULL) {
+    fAuxSDPLine = strDup(dasl);
+    return fAuxSDPLine;
+  }
+
+  if (fDummyRTPSink == NULL) { // we're not already setting it up for another, concurrent stream
+    // Otherwise, we need to read from the stream until the framer has seen them in-band:
+    fDummyRTPSink = rtpSink;
+    fDoneFlag = 0;
+
+    fDummyRTPSink->startPlaying(*inputSource, afterPlayingDummy, this);
+
+    // Check whether the sink's 'auxSDPLine()' is ready:
+    checkForAuxSDPLine(this);
+  }
+
+  envir().taskScheduler().doEventLoop(&fDoneFlag);
+
+  return fAuxSDPLine;
+}
+
+FramedSource* StreamReplicaServerMediaSubsession::createNewStreamSource(unsigned /*clientSessionId*/, unsigned& estBitrate) {
+  estBitrate = fEstimatedBitrate;
+
+  // The replica delivers discrete NAL units (as depacketized from the camera's RTP stream):
+  FramedSource* replica = fReplicator.createStreamReplica();
+  if (fIsH264) {
+    return H264VideoStreamDiscreteFramer::createNew(envir(), replica);
+  } else {
+    return H265VideoStreamDiscreteFramer::createNew(envir(), replica);
+  }
+}
+
+RTPSink* StreamReplicaServerMediaSubsession
+::createNewRTPSink(Groupsock* rtpGroupsock,
+		   unsigned char rtpPayloadTypeIfDynamic,
+		   FramedSource* /*inputSource*/) {
+  MultiFramedRTPSink* rtpSink;
+  if (fIsH264) {
+    rtpSink = fSPropParameterSets != NULL
+      ? H264VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic, fSPropParameterSets)
+      : H264VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic);
+  } else {
+    rtpSink = fSPropVPS != NULL && fSPropSPS != NULL && fSPropPPS != NULL
+      ? H265VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic, fSPropVPS, fSPropSPS, fSPropPPS)
+      : H265VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic);
+  }
+  if (rtpSink != NULL) rtpSink->setBatchedOutput(); // (our groupsock is a plain "Groupsock", so its packets can be queued)
+
+  return rtpSink;
+}
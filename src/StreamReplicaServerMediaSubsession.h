@@ -0,0 +1,77 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// A 'ServerMediaSubsession' object that re-serves - on demand - an already-received (H.264 or H.265) RTSP
+// subsession, using replicas of its (depacketized) source
+// C++ header
+// all clients share a single source and "RTPSink", so each frame is packetized only once
+
+#ifndef _STREAM_REPLICA_SERVER_MEDIA_SUBSESSION_HH
+#define _STREAM_REPLICA_SERVER_MEDIA_SUBSESSION_HH
+
+#ifndef _ON_DEMAND_SERVER_MEDIA_SUBSESSION_HH
+#include "OnDemandServerMediaSubsession.hh"
+#endif
+#ifndef _STREAM_REPLICATOR_HH
+#include "StreamReplicator.hh"
+#endif
+#ifndef _MEDIA_SESSION_HH
+#include "MediaSession.hh"
+#endif
+
+class StreamReplicaServerMediaSubsession: public OnDemandServerMediaSubsession {
+public:
+  static StreamReplicaServerMediaSubsession*
+  createNew(UsageEnvironment& env, StreamReplicator& replicator, MediaSubsession const& inputSubsession);
+      // "replicator" must replicate "inputSubsession.readSource()".  Returns NULL if we can't re-serve
+      // "inputSubsession"s codec.
+
+  // Used to implement "getAuxSDPLine()":
+  void checkForAuxSDPLine1();
+  void afterPlayingDummy1();
+
+protected:
+  StreamReplicaServerMediaSubsession(UsageEnvironment& env, StreamReplicator& replicator,
+				     MediaSubsession const& inputSubsession, Boolean isH264);
+      // called only by createNew();
+  virtual ~StreamReplicaServerMediaSubsession();
+
+  void setDoneFlag() { fDoneFlag = ~0; }
+
+protected: // redefined virtual functions
+  virtual char const* getAuxSDPLine(RTPSink* rtpSink,
+				    FramedSource* inputSource);
+  virtual FramedSource* createNewStreamSource(unsigned clientSessionId,
+					      unsigned& estBitrate);
+  virtual RTPSink* createNewRTPSink(Groupsock* rtpGroupsock,
+                                    unsigned char rtpPayloadTypeIfDynamic,
+				    FramedSource* inputSource);
+
+private:
+  StreamReplicator& fReplicator;
+  Boolean fIsH264; // otherwise H.265
+  unsigned fEstimatedBitrate; // kbps
+  char* fSPropVPS; // H.265 only
+  char* fSPropSPS; // H.265 only
+  char* fSPropPPS; // H.265 only
+  char* fSPropParameterSets; // H.264 only
+  char* fAuxSDPLine;
+  char fDoneFlag; // used when setting up "fAuxSDPLine"
+  RTPSink* fDummyRTPSink; // ditto
+};
+
+#endif